@@ -11,6 +11,9 @@
 ColorSensor colorSensor;
 DisplayManager display;
 
+// Running RGB statistics; sampling stops once the decision is clear
+ColorEstimator estimator;
+
 // Variables to store RGB values
 int redValue = 0;
 int greenValue = 0;
@@ -18,12 +21,12 @@ int blueValue = 0;
 
 void setup() {
   Serial.begin(9600);
-  Serial.println("TCS230 Color Sensor Calibration");
+  Serial.println(F("TCS230 Color Sensor Calibration"));
   
   // Initialize display
   display.begin();
-  display.displayMessage("Color Sensor", 0, true);
-  display.displayMessage("Calibration", 1, true);
+  display.displayMessage(F("Color Sensor"), 0, true);
+  display.displayMessage(F("Calibration"), 1, true);
   delay(2000);
   
   // Initialize color sensor
@@ -34,53 +37,67 @@ void setup() {
   
   // Instruct the user
   display.clear();
-  display.displayMessage("Move WHITE", 0, true);
-  display.displayMessage("surface to sensor", 1, true);
-  Serial.println("Place WHITE surface in front of the sensor for calibration");
+  display.displayMessage(F("Move WHITE"), 0, true);
+  display.displayMessage(F("surface to sensor"), 1, true);
+  Serial.println(F("Place WHITE surface in front of the sensor for calibration"));
   delay(5000);
   
-  // Run automatic calibration
+  // Run automatic calibration; percentiles shrug off glitchy readings,
+  // and the run ends early once the estimates have settled
   display.clear();
-  display.displayMessage("Calibrating...", 0, true);
+  display.displayMessage(F("Calibrating..."), 0, true);
   
-  if (colorSensor.runCalibration(5000)) {
-    display.displayMessage("Calibration OK", 1, true);
-    Serial.println("Calibration successful!");
+  unsigned long calibrationStart = millis();
+  if (colorSensor.runQuantileCalibration(5000)) {
+    display.displayMessage(F("Calibration OK"), 1, true);
+    Serial.print(F("Calibration successful! Confidence "));
+    Serial.print(colorSensor.getCalibrationConfidence());
+    Serial.print(F("% after "));
+    Serial.print(millis() - calibrationStart);
+    Serial.println(F(" ms"));
   } else {
-    display.displayMessage("Calibration FAILED", 1, true);
-    Serial.println("Calibration failed. Using default values.");
+    display.displayMessage(F("Calibration FAILED"), 1, true);
+    Serial.println(F("Calibration failed. Using default values."));
   }
   
   delay(2000);
   display.clear();
-  display.displayMessage("Ready to test", 0, true);
-  display.displayMessage("colors", 1, true);
+  display.displayMessage(F("Ready to test"), 0, true);
+  display.displayMessage(F("colors"), 1, true);
   delay(2000);
 }
 
 void loop() {
-  // Read RGB values from the sensor
-  colorSensor.readRGB(redValue, greenValue, blueValue);
+  // Sample until the color is clear or the sample cap is reached
+  ColorIdentifier detectedColor = colorSensor.detectColorSequential(estimator);
+  const __FlashStringHelper* colorName = colorSensor.getColorName(detectedColor);
   
-  // Detect color
-  ColorIdentifier detectedColor = colorSensor.detectColor();
-  String colorName = colorSensor.getColorName(detectedColor);
+  // Mean RGB values over the samples taken
+  redValue = static_cast<int>(estimator.getMean(ColorSensor::CHANNEL_RED) + 0.5f);
+  greenValue = static_cast<int>(estimator.getMean(ColorSensor::CHANNEL_GREEN) + 0.5f);
+  blueValue = static_cast<int>(estimator.getMean(ColorSensor::CHANNEL_BLUE) + 0.5f);
   
   // Display results on LCD
   display.clear();
-  display.displayMessage("Color: " + colorName, 0);
+  display.displayLabelValue(F("Color"), colorName, 0);
   
   // Format RGB values as string (R:xxx G:xxx)
   String rgbString = "R:" + String(redValue) + " G:" + String(greenValue);
   display.displayMessage(rgbString, 1);
   
   // Print details to serial monitor
-  Serial.println("Detected color: " + colorName);
-  Serial.print("Red: ");
+  Serial.print(F("Detected color: "));
+  Serial.print(colorName);
+  Serial.print(F(" ("));
+  Serial.print(estimator.getCount());
+  Serial.print(F(" samples, margin "));
+  Serial.print(estimator.getMargin(), 1);
+  Serial.println(F(")"));
+  Serial.print(F("Red: "));
   Serial.print(redValue);
-  Serial.print(" Green: ");
+  Serial.print(F(" Green: "));
   Serial.print(greenValue);
-  Serial.print(" Blue: ");
+  Serial.print(F(" Blue: "));
   Serial.println(blueValue);
   
   // Add a delay before the next reading
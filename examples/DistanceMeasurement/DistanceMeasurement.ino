@@ -5,24 +5,44 @@
  */
 
 #include <DistanceSensor.h>
+#include <MotionTracker.h>
 #include <DisplayManager.h>
 #include <AudioManager.h>
 #include <LedManager.h>
+#include <Telemetry.h>
+#include <PowerManager.h>
 
 // Create sensor and peripheral instances
 DistanceSensor distanceSensor;
 DisplayManager display;
 AudioManager audio;
 LedManager leds;
+Telemetry telemetry(Serial);
 
-// Proximity thresholds for different alerts
+// Velocity and time to collision from the distance readings
+MotionTracker tracker;
+
+// Sleeps between readings
+PowerManager power(display);
+
+// Proximity bands for the LED colors
 const float PROXIMITY_CLOSE = 10.0;  // cm
 const float PROXIMITY_MEDIUM = 25.0; // cm
 const float PROXIMITY_FAR = 50.0;    // cm
 
+// Alerts follow the time to collision, so only an approaching object raises them
+const unsigned long TTC_CRITICAL = 1000; // ms
+const unsigned long TTC_WARNING = 2500;  // ms
+
+// Delay between readings
+const unsigned long READING_INTERVAL = 200; // ms
+
+// Echo pulses longer than this are the sensor's no-echo timeout (beyond 4 m)
+const unsigned long NO_ECHO_WIDTH = 30000; // µs
+
 void setup() {
   Serial.begin(9600);
-  Serial.println("Distance Measurement System");
+  Serial.println(F("Distance Measurement System"));
   
   // Initialize components
   distanceSensor.begin();
@@ -36,12 +56,15 @@ void setup() {
   audio.playSuccessSound();
   
   // Welcome message
-  display.displayMessage("Distance Sensor", 0, true);
-  display.displayMessage("Ready", 1, true);
+  display.displayMessage(F("Distance Sensor"), 0, true);
+  display.displayMessage(F("Ready"), 1, true);
   delay(2000);
   
   // Calibrate for room temperature (adjust as needed)
   distanceSensor.calibrateForTemperature(22.0); // 22°C
+  
+  // Time in each power state counts from here
+  power.begin();
 }
 
 void loop() {
@@ -51,18 +74,40 @@ void loop() {
   // Display the distance
   display.displayDistance(distance);
   
-  // Print to serial monitor
-  Serial.print("Distance: ");
-  Serial.print(distance);
-  Serial.println(" cm");
+  // No echo reads as 0 and ends the track
+  unsigned long echo = distanceSensor.getLastPulseDuration();
+  bool noEcho = echo == 0 || echo > NO_ECHO_WIDTH;
+  tracker.update(noEcho ? 0.0 : distance, millis());
+  unsigned long timeToCollision = tracker.getTimeToCollision();
   
-  // Check proximity and provide feedback
-  if (distance <= PROXIMITY_CLOSE) {
-    // Object is very close
+  // Queue a binary telemetry record instead of printing text
+  TelemetryRecord record = {};
+  record.timestamp = millis();
+  record.echoDuration = echo > 0xFFFF ? 0xFFFF : echo;
+  record.distance = constrain(distance * 10.0, 0, 0xFFFF);
+  if (distance <= PROXIMITY_FAR) {
+    record.status |= Telemetry::STATUS_OBJECT_IN_RANGE;
+  }
+  if (noEcho) {
+    record.status |= Telemetry::STATUS_NO_ECHO;
+  }
+  Telemetry::captureStageTimings(record);
+  telemetry.send(record);
+  
+  // Check the approach and provide feedback
+  if (timeToCollision <= TTC_CRITICAL) {
+    // Object will reach the sensor within a second
+    leds.setLed(ColorIdentifier::RED);
+    
+    // Preempts any lower-priority sound still playing
+    audio.queueSound(AudioManager::SOUND_ALERT, AudioManager::PRIORITY_CRITICAL, READING_INTERVAL);
+  } else if (timeToCollision <= TTC_WARNING) {
+    // Object approaching; a critical alert preempts this one
+    leds.setLed(ColorIdentifier::RED);
+    audio.queueSound(AudioManager::SOUND_ALERT, AudioManager::PRIORITY_NORMAL, READING_INTERVAL);
+  } else if (distance <= PROXIMITY_CLOSE) {
+    // Object is very close but not moving in
     leds.setLed(ColorIdentifier::RED);
-    if (!audio.isPlaying()) {
-      audio.playAlertSound();
-    }
   } else if (distance <= PROXIMITY_MEDIUM) {
     // Object at medium distance
     leds.setLed(ColorIdentifier::NONE); // Yellow LED
@@ -74,6 +119,13 @@ void loop() {
     leds.allOff();
   }
   
-  // Delay before next reading
-  delay(200);
+  // Wait before next reading while keeping the audio queue running,
+  // asleep between polls (idle sleep while sound or telemetry is going out)
+  unsigned long waitStart = millis();
+  unsigned long elapsed;
+  while ((elapsed = millis() - waitStart) < READING_INTERVAL) {
+    audio.update();
+    telemetry.pump();
+    power.sleep(READING_INTERVAL - elapsed, audio.isPlaying() || telemetry.getPendingBytes() > 0);
+  }
 }
@@ -0,0 +1,98 @@
+/**
+ * @file StaticColorDistanceSystem.ino
+ * @brief ColorDistanceSystem with its drivers and tasks fixed at compile time
+ * @author catalina
+*/
+
+#include <ColorDistanceApp.h>
+#include <System.h>
+
+// The system logic lives in ColorDistanceApp; this sketch only wires the drivers and tasks
+struct Board;
+typedef ColorDistanceApp<Board> App;
+
+// Tasks in ColorDistanceTask order, which is also the tie order
+typedef PeriodicTask<App::sampleDistance, App::DISTANCE_PERIOD> DistanceTask;
+typedef PeriodicTask<App::runPipeline, App::PIPELINE_PERIOD, App::PIPELINE_DEADLINE> PipelineTask;
+typedef PeriodicTask<App::refreshDisplay, App::DISPLAY_PERIOD> DisplayTask;
+typedef DriverUpdate<LedManager, App::LED_PERIOD, App::EFFECT_DEADLINE> LedTask;
+typedef DriverUpdate<AudioManager, App::AUDIO_PERIOD, App::EFFECT_DEADLINE> AudioTask;
+typedef PeriodicTask<App::handleCommands, App::COMMAND_PERIOD> CommandTask;
+typedef PeriodicTask<App::checkLoad, App::LOAD_PERIOD> LoadTask;
+
+// Drivers on their pins, started in this order, and the tasks they run
+typedef System<
+  DriverSet<
+    ColorPins<PinConfig::ColorSensor::S0, PinConfig::ColorSensor::S1, PinConfig::ColorSensor::S2,
+              PinConfig::ColorSensor::S3, PinConfig::ColorSensor::OUT>,
+    DistancePins<PinConfig::DistanceSensor::TRIG, PinConfig::DistanceSensor::ECHO>,
+    I2cLcd<>,
+    BuzzerPin<PinConfig::BUZZER>,
+    LedPins<PinConfig::LEDs::RED, PinConfig::LEDs::GREEN, PinConfig::LEDs::YELLOW>
+  >,
+  TaskSet<DistanceTask, PipelineTask, DisplayTask, LedTask, AudioTask, CommandTask, LoadTask>
+> ColorDistanceUnit;
+
+ColorDistanceUnit unit;
+
+// Every call is inline and every task is picked by type, so the switches
+// below fold away
+struct Board {
+  static ColorSensor& colorSensor() { return unit.get<ColorSensor>(); }
+  static DistanceSensor& distanceSensor() { return unit.get<DistanceSensor>(); }
+  static DisplayManager& display() { return unit.get<DisplayManager>(); }
+  static LedManager& leds() { return unit.get<LedManager>(); }
+  static AudioManager& audio() { return unit.get<AudioManager>(); }
+
+  static void begin() { unit.begin(); }
+
+  static void start(App::OverrunCallback overrun) {
+    unit.start();
+    unit.setOverrunCallback(overrun);
+  }
+
+  static bool run() { return unit.run(); }
+  static unsigned long getLastLateness() { return unit.getLastLateness(); }
+  static unsigned long getIdleTime() { return unit.getIdleTime(); }
+
+  static void enableTask(ColorDistanceTask task, unsigned long startDelay = 0) {
+    switch (task) {
+      case ColorDistanceTask::DISTANCE: unit.enable<DistanceTask>(startDelay); break;
+      case ColorDistanceTask::PIPELINE: unit.enable<PipelineTask>(startDelay); break;
+      case ColorDistanceTask::DISPLAY: unit.enable<DisplayTask>(startDelay); break;
+      case ColorDistanceTask::LED: unit.enable<LedTask>(startDelay); break;
+      case ColorDistanceTask::AUDIO: unit.enable<AudioTask>(startDelay); break;
+      default: break;
+    }
+  }
+
+  static void disableTask(ColorDistanceTask task) {
+    switch (task) {
+      case ColorDistanceTask::DISTANCE: unit.disable<DistanceTask>(); break;
+      case ColorDistanceTask::PIPELINE: unit.disable<PipelineTask>(); break;
+      case ColorDistanceTask::DISPLAY: unit.disable<DisplayTask>(); break;
+      case ColorDistanceTask::LED: unit.disable<LedTask>(); break;
+      case ColorDistanceTask::AUDIO: unit.disable<AudioTask>(); break;
+      default: break;
+    }
+  }
+
+  static void setTaskPeriod(ColorDistanceTask task, unsigned long period) {
+    switch (task) {
+      case ColorDistanceTask::DISTANCE: unit.setPeriod<DistanceTask>(period); break;
+      case ColorDistanceTask::PIPELINE: unit.setPeriod<PipelineTask>(period); break;
+      case ColorDistanceTask::DISPLAY: unit.setPeriod<DisplayTask>(period); break;
+      case ColorDistanceTask::LED: unit.setPeriod<LedTask>(period); break;
+      case ColorDistanceTask::AUDIO: unit.setPeriod<AudioTask>(period); break;
+      default: break;
+    }
+  }
+};
+
+void setup() {
+  App::setup();
+}
+
+void loop() {
+  App::loop();
+}
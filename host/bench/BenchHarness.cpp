@@ -0,0 +1,169 @@
+/**
+ * @file BenchHarness.cpp
+ * @brief Virtual-time micro-benchmark harness implementation
+ * @author catalina
+ */
+
+#include "BenchHarness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+    double percentile(const std::vector<uint64_t>& sorted, double fraction) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+        return sorted[index] / 1000.0;
+    }
+
+    // Benchmark names are plain identifiers, but keep the output valid JSON anyway
+    void writeJsonString(FILE* out, const std::string& value) {
+        fputc('"', out);
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                fputc('\\', out);
+            }
+            fputc(c, out);
+        }
+        fputc('"', out);
+    }
+}
+
+BenchContext::BenchContext(const SimScene& scene)
+    : _scope(_device),
+      _scene(scene),
+      _echoModel(_scene),
+      _colorModel(_scene) {
+    _echoModel.attach(_device);
+    _colorModel.attach(_device);
+    _device.setSerialCapture(false);
+}
+
+BenchResult BenchContext::measure(const std::string& name, uint32_t calls, const std::function<void()>& body) {
+    std::vector<uint64_t> samples;
+    samples.reserve(calls);
+
+    _device.resetStats();
+    uint64_t virtualStart = _device.nowNs();
+    std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < calls; i++) {
+        uint64_t start = _device.nowNs();
+        body();
+        samples.push_back(_device.nowNs() - start);
+    }
+
+    double hostNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - hostStart).count();
+    uint64_t virtualNs = _device.nowNs() - virtualStart;
+    const DeviceStats& stats = _device.stats();
+
+    BenchResult result;
+    result.name = name;
+    result.calls = calls;
+    if (calls == 0) {
+        return result;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    result.virtualUsMean = virtualNs / 1000.0 / calls;
+    result.virtualUsMin = samples.front() / 1000.0;
+    result.virtualUsP50 = percentile(samples, 0.50);
+    result.virtualUsP99 = percentile(samples, 0.99);
+    result.virtualUsMax = samples.back() / 1000.0;
+    result.callsPerVirtualSecond = virtualNs > 0 ? calls * 1e9 / virtualNs : 0.0;
+    result.hostNsPerCall = hostNs / calls;
+    result.i2cBytesPerCall = static_cast<double>(stats.i2cBytes) / calls;
+    result.i2cUsPerCall = stats.i2cBusyNs / 1000.0 / calls;
+    result.serialBytesPerCall = static_cast<double>(stats.serialBytes) / calls;
+    result.pinWritesPerCall = static_cast<double>(stats.digitalWrites + stats.analogWrites) / calls;
+    result.pulseInPerCall = static_cast<double>(stats.pulseInCalls) / calls;
+    return result;
+}
+
+BenchReport::BenchReport(const std::string& suite)
+    : _suite(suite) {
+}
+
+void BenchReport::add(const BenchResult& result) {
+    _results.push_back(result);
+}
+
+void BenchReport::writeJson(FILE* out) const {
+    fprintf(out, "{\n  \"suite\": ");
+    writeJsonString(out, _suite);
+    fprintf(out, ",\n  \"results\": [");
+
+    for (size_t i = 0; i < _results.size(); i++) {
+        const BenchResult& r = _results[i];
+        fprintf(out, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+        writeJsonString(out, r.name);
+        fprintf(out, ", \"calls\": %u", r.calls);
+        fprintf(out, ", \"virtual_us_mean\": %.3f", r.virtualUsMean);
+        fprintf(out, ", \"virtual_us_min\": %.3f", r.virtualUsMin);
+        fprintf(out, ", \"virtual_us_p50\": %.3f", r.virtualUsP50);
+        fprintf(out, ", \"virtual_us_p99\": %.3f", r.virtualUsP99);
+        fprintf(out, ", \"virtual_us_max\": %.3f", r.virtualUsMax);
+        fprintf(out, ", \"calls_per_virtual_s\": %.3f", r.callsPerVirtualSecond);
+        fprintf(out, ", \"host_ns_per_call\": %.1f", r.hostNsPerCall);
+        fprintf(out, ", \"i2c_bytes_per_call\": %.3f", r.i2cBytesPerCall);
+        fprintf(out, ", \"i2c_us_per_call\": %.3f", r.i2cUsPerCall);
+        fprintf(out, ", \"serial_bytes_per_call\": %.3f", r.serialBytesPerCall);
+        fprintf(out, ", \"pin_writes_per_call\": %.3f", r.pinWritesPerCall);
+        fprintf(out, ", \"pulsein_per_call\": %.3f}", r.pulseInPerCall);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+}
+
+void BenchReport::writeTable(FILE* out) const {
+    fprintf(out, "%-40s %8s %12s %12s %12s %10s %10s\n",
+            "benchmark", "calls", "mean us", "p99 us", "max us", "i2c B", "host ns");
+    for (const BenchResult& r : _results) {
+        fprintf(out, "%-40s %8u %12.1f %12.1f %12.1f %10.1f %10.0f\n",
+                r.name.c_str(), r.calls, r.virtualUsMean, r.virtualUsP99, r.virtualUsMax,
+                r.i2cBytesPerCall, r.hostNsPerCall);
+    }
+}
+
+int BenchReport::finish(int argc, char** argv) const {
+    const char* jsonPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+    }
+
+    if (jsonPath == nullptr) {
+        writeJson(stdout);
+        return 0;
+    }
+
+    FILE* file = fopen(jsonPath, "w");
+    if (file == nullptr) {
+        fprintf(stderr, "cannot write %s\n", jsonPath);
+        return 1;
+    }
+    writeJson(file);
+    fclose(file);
+    writeTable(stdout);
+    return 0;
+}
+
+double benchScale(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            double scale = atof(argv[i + 1]);
+            return scale > 0.0 ? scale : 1.0;
+        }
+    }
+    return 1.0;
+}
+
+uint32_t scaledCalls(uint32_t calls, double scale) {
+    uint32_t scaled = static_cast<uint32_t>(calls * scale);
+    return scaled > 0 ? scaled : 1;
+}
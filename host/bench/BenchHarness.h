@@ -0,0 +1,134 @@
+/**
+ * @file BenchHarness.h
+ * @brief Virtual-time micro-benchmark harness for the host build
+ * @author catalina
+ */
+
+#ifndef HOST_BENCH_HARNESS_H
+#define HOST_BENCH_HARNESS_H
+
+#include <VirtualDevice.h>
+
+#include "../sim/SimScene.h"
+#include "../sim/HcSr04Model.h"
+#include "../sim/Tcs230Model.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Measurements of one benchmark
+ *
+ * Virtual times are what the call would take on the board according to
+ * the cost model; host time is what the simulation itself cost.
+ */
+struct BenchResult {
+    std::string name;
+    uint32_t calls = 0;
+    double virtualUsMean = 0.0;
+    double virtualUsMin = 0.0;
+    double virtualUsP50 = 0.0;
+    double virtualUsP99 = 0.0;
+    double virtualUsMax = 0.0;
+    double callsPerVirtualSecond = 0.0;
+    double hostNsPerCall = 0.0;
+    double i2cBytesPerCall = 0.0;
+    double i2cUsPerCall = 0.0;
+    double serialBytesPerCall = 0.0;
+    double pinWritesPerCall = 0.0;
+    double pulseInPerCall = 0.0;
+};
+
+/**
+ * @class BenchContext
+ * @brief A fresh simulated board with both sensor models attached
+ *
+ * The context makes its device current for the calling thread for as long
+ * as it lives, so drivers created inside it talk to this board only.
+ */
+class BenchContext {
+public:
+    explicit BenchContext(const SimScene& scene = SimScene::demo());
+
+    BenchContext(const BenchContext&) = delete;
+    BenchContext& operator=(const BenchContext&) = delete;
+
+    /**
+     * @brief Time a call repeatedly
+     *
+     * Device statistics are reset first, so per-call counters only cover
+     * the measured calls and not any setup done before.
+     *
+     * @param name Benchmark name
+     * @param calls Number of calls to time
+     * @param body Code under test
+     * @return Measurements
+     */
+    BenchResult measure(const std::string& name, uint32_t calls, const std::function<void()>& body);
+
+    VirtualDevice& device() { return _device; }
+    SimScene& scene() { return _scene; }
+    Tcs230Model& colorModel() { return _colorModel; }
+
+private:
+    VirtualDevice _device;
+    VirtualDevice::Scope _scope;
+    SimScene _scene;
+    HcSr04Model _echoModel;
+    Tcs230Model _colorModel;
+};
+
+/**
+ * @class BenchReport
+ * @brief Collects results of one suite and writes them as JSON
+ */
+class BenchReport {
+public:
+    explicit BenchReport(const std::string& suite);
+
+    void add(const BenchResult& result);
+
+    /**
+     * @brief Write the suite as a JSON object
+     *
+     * Format: {"suite": NAME, "results": [{"name": ..., ...}, ...]}
+     */
+    void writeJson(FILE* out) const;
+
+    /**
+     * @brief Write a human-readable table
+     */
+    void writeTable(FILE* out) const;
+
+    /**
+     * @brief Parse the common command line and write the report
+     *
+     * With --json FILE the JSON goes to FILE and the table to stdout,
+     * otherwise the JSON goes to stdout.
+     *
+     * @return Process exit code
+     */
+    int finish(int argc, char** argv) const;
+
+private:
+    std::string _suite;
+    std::vector<BenchResult> _results;
+};
+
+/**
+ * @brief Get the value of --scale from the command line
+ *
+ * Iteration counts are multiplied by it, so a quick smoke run can use a
+ * fraction of the default work.
+ */
+double benchScale(int argc, char** argv);
+
+/**
+ * @brief Scale an iteration count, keeping at least one call
+ */
+uint32_t scaledCalls(uint32_t calls, double scale);
+
+#endif // HOST_BENCH_HARNESS_H
@@ -0,0 +1,262 @@
+/**
+ * @file DriverBench.cpp
+ * @brief Per-call cost of every driver hot path in virtual time
+ * @author catalina
+ *
+ * Each benchmark runs on a fresh simulated board. The driver under test
+ * is initialised outside the timed region; only the hot-path call itself
+ * is measured. Run with --json FILE to keep the results, --scale F to
+ * change the iteration counts.
+ */
+
+#include "BenchHarness.h"
+
+#include <DistanceSensor.h>
+#include <ColorSensor.h>
+#include <ColorSensorArray.h>
+#include <ColorEstimator.h>
+#include <AcquisitionPipeline.h>
+#include <MotionTracker.h>
+#include <QuantileRange.h>
+#include <DisplayManager.h>
+#include <LedManager.h>
+#include <AudioManager.h>
+
+#include <memory>
+#include <vector>
+
+namespace {
+    const uint16_t benchMelody[] = {
+        Notes::NOTE_C5, Notes::NOTE_E5, Notes::NOTE_G5, Notes::NOTE_C5
+    };
+    const uint8_t benchDurations[] = { 16, 16, 16, 8 };
+
+    // OUT pins of the heads sharing the select lines; the first is the default sensor's
+    const uint8_t HEAD_OUT_PINS[] = { PinConfig::ColorSensor::OUT, 10, 14, 15 };
+
+    // Object held still in front of both sensors
+    SimScene steadyScene(float distanceCm) {
+        SimScene scene;
+        scene.hold(1000, distanceCm, 0.9f, 0.15f, 0.1f);
+        return scene;
+    }
+
+    void benchDistance(BenchReport& report, double scale) {
+        const uint8_t sampleCounts[] = { 1, 3, 10 };
+        for (uint8_t samples : sampleCounts) {
+            BenchContext context;
+            DistanceSensor sensor;
+            sensor.begin();
+            report.add(context.measure("DistanceSensor::getDistance/" + std::to_string(samples),
+                                       scaledCalls(2000 / samples, scale),
+                                       [&] { sensor.getDistance(DistanceSensor::CENTIMETERS, samples); }));
+        }
+
+        // Worst case: nothing in range, every ping runs into the timeout
+        BenchContext context(steadyScene(SimScene::NO_OBJECT));
+        DistanceSensor sensor;
+        sensor.begin();
+        report.add(context.measure("DistanceSensor::getDistance/1/no_echo", scaledCalls(200, scale),
+                                   [&] { sensor.getDistance(); }));
+    }
+
+    void benchTracker(BenchReport& report, double scale) {
+        // Pure arithmetic: no virtual time, host time shows the relative cost
+        BenchContext context;
+        MotionTracker tracker;
+        unsigned long timestamp = 0;
+        float distance = 100.0f;
+        report.add(context.measure("MotionTracker::update", scaledCalls(20000, scale),
+                                   [&] {
+                                       tracker.update(distance, timestamp);
+                                       timestamp += 100;
+                                       distance = distance > 5.0f ? distance - 0.5f : 100.0f;
+                                   }));
+    }
+
+    void benchQuantile(BenchReport& report, double scale) {
+        // Pure arithmetic as well; a wide, repeating sweep keeps every marker moving
+        BenchContext context;
+        QuantileRange range;
+        int value = 0;
+        report.add(context.measure("QuantileRange::add", scaledCalls(20000, scale),
+                                   [&] {
+                                       range.add(20 + (value * 37) % 200);
+                                       value++;
+                                   }));
+    }
+
+    void benchColor(BenchReport& report, double scale) {
+        BenchContext context(steadyScene(3.0f));
+        ColorSensor sensor;
+        sensor.begin();
+
+        int red, green, blue;
+        report.add(context.measure("ColorSensor::readRawValues", scaledCalls(100, scale),
+                                   [&] { sensor.readRawValues(red, green, blue); }));
+        report.add(context.measure("ColorSensor::readRGB", scaledCalls(100, scale),
+                                   [&] { sensor.readRGB(red, green, blue); }));
+        report.add(context.measure("ColorSensor::detectColor", scaledCalls(100, scale),
+                                   [&] { sensor.detectColor(); }));
+        report.add(context.measure("ColorSensor::readChannel", scaledCalls(3000, scale),
+                                   [&] { sensor.readChannel(ColorSensor::CHANNEL_RED); }));
+    }
+
+    void benchColorSequential(BenchReport& report, double scale) {
+        // A clear red stops at the minimum sample count; a red-orange object
+        // near the threshold keeps sampling up to the cap
+        SimScene ambiguous;
+        ambiguous.hold(1000, 3.0f, 0.6f, 0.45f, 0.15f);
+        const std::pair<const char*, SimScene> scenes[] = {
+            { "clear", steadyScene(3.0f) },
+            { "ambiguous", ambiguous },
+        };
+        for (const std::pair<const char*, SimScene>& scene : scenes) {
+            BenchContext context(scene.second);
+            context.colorModel().setNoise(0.08f, 7);
+            ColorSensor sensor;
+            sensor.begin();
+            ColorEstimator estimator;
+            report.add(context.measure(std::string("ColorSensor::detectColorSequential/") + scene.first,
+                                       scaledCalls(20, scale),
+                                       [&] { sensor.detectColorSequential(estimator); }));
+        }
+    }
+
+    void benchColorArray(BenchReport& report, double scale) {
+        // N heads read one after another with pulseIn() against one pass of the array
+        const uint8_t headCounts[] = { 1, 2, 4 };
+        for (uint8_t count : headCounts) {
+            BenchContext context(steadyScene(3.0f));
+            std::vector<std::unique_ptr<Tcs230Model>> models;
+            std::vector<ColorSensor> heads;
+            for (uint8_t i = 0; i < count; i++) {
+                if (i > 0) {
+                    models.emplace_back(new Tcs230Model(context.scene(), PinConfig::ColorSensor::S0,
+                                                        PinConfig::ColorSensor::S1, PinConfig::ColorSensor::S2,
+                                                        PinConfig::ColorSensor::S3, HEAD_OUT_PINS[i]));
+                    models.back()->attach(context.device());
+                }
+                heads.emplace_back(PinConfig::ColorSensor::S0, PinConfig::ColorSensor::S1,
+                                   PinConfig::ColorSensor::S2, PinConfig::ColorSensor::S3, HEAD_OUT_PINS[i]);
+            }
+
+            int red[ColorSensorArray::MAX_HEADS];
+            int green[ColorSensorArray::MAX_HEADS];
+            int blue[ColorSensorArray::MAX_HEADS];
+            for (ColorSensor& head : heads) {
+                head.begin();
+            }
+            report.add(context.measure("ColorSensor::readRawValues/" + std::to_string(count) + "_heads",
+                                       scaledCalls(20, scale),
+                                       [&] {
+                                           for (uint8_t i = 0; i < count; i++) {
+                                               heads[i].readRawValues(red[i], green[i], blue[i]);
+                                           }
+                                       }));
+
+            ColorSensorArray array(heads.data(), count);
+            array.begin();
+            report.add(context.measure("ColorSensorArray::readRawValues/" + std::to_string(count) + "_heads",
+                                       scaledCalls(20, scale),
+                                       [&] { array.readRawValues(red, green, blue); }));
+        }
+    }
+
+    void benchPipeline(BenchReport& report, double scale) {
+        // One fused sample against the serial reads it replaces
+        BenchContext context(steadyScene(6.0f));
+        DistanceSensor distanceSensor;
+        ColorSensor colorSensor;
+        distanceSensor.begin();
+        colorSensor.begin();
+
+        int red, green, blue;
+        report.add(context.measure("serial getDistance+readRawValues", scaledCalls(50, scale),
+                                   [&] {
+                                       distanceSensor.getDistance();
+                                       colorSensor.readRawValues(red, green, blue);
+                                   }));
+
+        AcquisitionPipeline pipeline(distanceSensor, colorSensor);
+        pipeline.reset();
+        report.add(context.measure("AcquisitionPipeline::update/sample", scaledCalls(50, scale),
+                                   [&] {
+                                       while (!(pipeline.update() & AcquisitionPipeline::SAMPLE_READY)) {
+                                           delay(1);
+                                       }
+                                   }));
+    }
+
+    void benchDisplay(BenchReport& report, double scale) {
+        BenchContext context;
+        DisplayManager display;
+        display.begin();
+
+        report.add(context.measure("DisplayManager::displayMessage", scaledCalls(500, scale),
+                                   [&] { display.displayMessage("Distance:", 0); }));
+        report.add(context.measure("DisplayManager::displayMessage/center", scaledCalls(500, scale),
+                                   [&] { display.displayMessage("Red", 1, true); }));
+
+        float distance = 0.0f;
+        report.add(context.measure("DisplayManager::displayDistance", scaledCalls(500, scale),
+                                   [&] {
+                                       display.displayDistance(distance);
+                                       distance += 0.7f;
+                                   }));
+    }
+
+    void benchLeds(BenchReport& report, double scale) {
+        BenchContext context;
+        LedManager leds;
+        leds.begin();
+
+        report.add(context.measure("LedManager::setLed", scaledCalls(5000, scale),
+                                   [&] { leds.setLed(ColorIdentifier::GREEN, 128); }));
+        report.add(context.measure("LedManager::blinkLed", scaledCalls(100, scale),
+                                   [&] { leds.blinkLed(ColorIdentifier::RED, 2, 50, 50); }));
+        report.add(context.measure("LedManager::pulseLed", scaledCalls(50, scale),
+                                   [&] { leds.pulseLed(ColorIdentifier::GREEN, 1, 1000); }));
+        report.add(context.measure("LedManager::update", scaledCalls(5000, scale),
+                                   [&] {
+                                       if (!leds.isEffectActive()) {
+                                           leds.startPulse(ColorIdentifier::GREEN, 1, 500);
+                                       }
+                                       leds.update();
+                                   }));
+    }
+
+    void benchAudio(BenchReport& report, double scale) {
+        BenchContext context;
+        AudioManager audio;
+        audio.begin();
+
+        report.add(context.measure("AudioManager::playMelody", scaledCalls(100, scale),
+                                   [&] { audio.playMelody(benchMelody, benchDurations, 4); }));
+        report.add(context.measure("AudioManager::update", scaledCalls(5000, scale),
+                                   [&] {
+                                       if (audio.getQueuedCount() == 0 && !audio.isPlaying()) {
+                                           audio.queueMelody(benchMelody, benchDurations, 4);
+                                       }
+                                       audio.update();
+                                   }));
+    }
+}
+
+int main(int argc, char** argv) {
+    double scale = benchScale(argc, argv);
+    BenchReport report("drivers");
+
+    benchDistance(report, scale);
+    benchTracker(report, scale);
+    benchQuantile(report, scale);
+    benchColor(report, scale);
+    benchColorSequential(report, scale);
+    benchColorArray(report, scale);
+    benchPipeline(report, scale);
+    benchDisplay(report, scale);
+    benchLeds(report, scale);
+    benchAudio(report, scale);
+
+    return report.finish(argc, argv);
+}
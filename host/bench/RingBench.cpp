@@ -0,0 +1,104 @@
+/**
+ * @file RingBench.cpp
+ * @brief Throughput of SpscRing
+ * @author catalina
+ *
+ * A producer thread pushes a numbered sequence through the ring while a
+ * consumer thread pops it. Throughput is reported as host time per item;
+ * no virtual time is involved. The delivery checks live in
+ * host/test/RingTest.cpp.
+ */
+
+#include "BenchHarness.h"
+
+#include <SpscRing.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+    struct RingItem {
+        uint32_t sequence;
+        uint32_t check;
+    };
+
+    double elapsedNs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template <uint8_t CAPACITY>
+    void benchCrossThread(BenchReport& report, uint32_t items) {
+        SpscRing<RingItem, CAPACITY> ring;
+
+        auto start = std::chrono::steady_clock::now();
+        std::thread consumer([&] {
+            uint32_t expected = 0;
+            RingItem item;
+            while (expected < items) {
+                if (!ring.pop(item)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                expected = item.sequence + 1;
+            }
+        });
+
+        // A full ring makes the producer retry; every retry counts as an overflow
+        for (uint32_t sequence = 0; sequence < items; sequence++) {
+            RingItem item = { sequence, ~sequence };
+            while (!ring.push(item)) {
+                std::this_thread::yield();
+            }
+        }
+        consumer.join();
+
+        BenchResult result;
+        result.name = "SpscRing/threads/" + std::to_string(CAPACITY);
+        result.calls = items;
+        result.hostNsPerCall = elapsedNs(start) / items;
+        report.add(result);
+
+        fprintf(stderr, "%s: %u items, %u full\n", result.name.c_str(),
+                items, ring.getOverflowCount());
+    }
+
+    void benchSingleThread(BenchReport& report, uint32_t items) {
+        // Uncontended cost: what an interrupt and loop() pay per item
+        SpscRing<RingItem, 8> ring;
+        uint32_t sum = 0;
+        uint32_t missed = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        RingItem item = {};
+        for (uint32_t sequence = 0; sequence < items; sequence++) {
+            RingItem in = { sequence, ~sequence };
+            ring.push(in);
+            if (ring.pop(item)) {
+                sum += item.check;
+            } else {
+                missed++;
+            }
+        }
+
+        BenchResult result;
+        result.name = "SpscRing/push+pop";
+        result.calls = items;
+        result.hostNsPerCall = elapsedNs(start) / items;
+        report.add(result);
+
+        // Keeps the loop from being optimised away
+        fprintf(stderr, "%s: %u items, %u missed, sum %08x\n", result.name.c_str(), items, missed, sum);
+    }
+}
+
+int main(int argc, char** argv) {
+    double scale = benchScale(argc, argv);
+    BenchReport report("ring");
+
+    benchSingleThread(report, scaledCalls(10000000, scale));
+    benchCrossThread<4>(report, scaledCalls(2000000, scale));
+    benchCrossThread<16>(report, scaledCalls(5000000, scale));
+    benchCrossThread<128>(report, scaledCalls(10000000, scale));
+
+    return report.finish(argc, argv);
+}
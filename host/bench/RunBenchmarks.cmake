@@ -0,0 +1,29 @@
+# Runs every benchmark executable and merges their JSON reports.
+#
+# Usage: cmake -DBENCHMARKS="a|b|c" -DOUTPUT=bench.json [-DSCALE=1] -P RunBenchmarks.cmake
+
+if(NOT SCALE)
+    set(SCALE 1)
+endif()
+
+string(REPLACE "|" ";" BENCHMARKS "${BENCHMARKS}")
+
+set(suites)
+foreach(benchmark ${BENCHMARKS})
+    get_filename_component(name ${benchmark} NAME)
+    set(partial ${OUTPUT}.${name})
+    execute_process(
+        COMMAND ${benchmark} --json ${partial} --scale ${SCALE}
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${name} failed: ${result}")
+    endif()
+    file(READ ${partial} suite)
+    file(REMOVE ${partial})
+    string(STRIP "${suite}" suite)
+    list(APPEND suites "${suite}")
+endforeach()
+
+string(JOIN ",\n" body ${suites})
+file(WRITE ${OUTPUT} "[\n${body}\n]\n")
+message(STATUS "Benchmark results written to ${OUTPUT}")
@@ -0,0 +1,27 @@
+/**
+ * @file SketchBench.cpp
+ * @brief Full loop() iteration cost of an example sketch in virtual time
+ * @author catalina
+ *
+ * The sketch named by SKETCH_SOURCE is compiled into this file, as in the
+ * host runner. setup() runs once outside the timed region, then every
+ * loop() iteration is timed on the demo scene.
+ */
+
+#include "BenchHarness.h"
+
+#include <Arduino.h>
+
+#include SKETCH_SOURCE
+
+int main(int argc, char** argv) {
+    double scale = benchScale(argc, argv);
+    BenchReport report(SKETCH_NAME);
+
+    BenchContext context;
+    report.add(context.measure(std::string(SKETCH_NAME) + "::setup", 1, [] { setup(); }));
+    report.add(context.measure(std::string(SKETCH_NAME) + "::loop", scaledCalls(SKETCH_LOOPS, scale),
+                               [] { loop(); }));
+
+    return report.finish(argc, argv);
+}
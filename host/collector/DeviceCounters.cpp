@@ -0,0 +1,155 @@
+/**
+ * @file DeviceCounters.cpp
+ * @brief Per-device telemetry statistics implementation
+ * @author catalina
+ */
+
+#include "DeviceCounters.h"
+
+namespace {
+    const uint16_t DISTANCE_BUCKET_MM = 100;
+
+    // Octave of a value: 0 for 0, else 1 + floor(log2(value))
+    size_t octave(uint64_t value) {
+        size_t bits = 0;
+        while (value != 0) {
+            bits++;
+            value >>= 1;
+        }
+        return bits;
+    }
+
+    void load(const std::atomic<uint64_t>* counters, uint64_t* values, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = counters[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+double DeviceSnapshot::readingRate(const DeviceSnapshot& earlier) const {
+    if (timeNs <= earlier.timeNs) {
+        return 0.0;
+    }
+    return (readings - earlier.readings) * 1e9 / (timeNs - earlier.timeNs);
+}
+
+uint64_t DeviceSnapshot::latencyPercentile(double fraction) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        total += latency[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the percentile, 1-based
+    uint64_t rank = static_cast<uint64_t>(fraction * total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += latency[i];
+        if (seen >= rank) {
+            return latencyBucketLimit(i);
+        }
+    }
+    return latencyBucketLimit(LATENCY_BUCKETS - 1);
+}
+
+void DeviceSnapshot::add(const DeviceSnapshot& other) {
+    bytes += other.bytes;
+    readings += other.readings;
+    samples += other.samples;
+    badFrames += other.badFrames;
+    skippedBytes += other.skippedBytes;
+    sequenceGaps += other.sequenceGaps;
+    droppedRecords += other.droppedRecords;
+    noEcho += other.noEcho;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        latency[i] += other.latency[i];
+    }
+    for (size_t i = 0; i < DISTANCE_BUCKETS; i++) {
+        distance[i] += other.distance[i];
+    }
+    for (size_t i = 0; i < COLOR_CLASSES; i++) {
+        colors[i] += other.colors[i];
+    }
+}
+
+size_t DeviceSnapshot::latencyBucket(uint64_t latencyUs) {
+    // Values below 4 get a bucket each; above, the octave and the two bits
+    // after the leading one pick one of four buckets
+    if (latencyUs < 4) {
+        return latencyUs;
+    }
+    size_t bits = octave(latencyUs);
+    size_t bucket = (bits - 2) * 4 + ((latencyUs >> (bits - 3)) & 0x03);
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+uint64_t DeviceSnapshot::latencyBucketLimit(size_t bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    size_t bits = bucket / 4 + 2;
+    uint64_t step = 1ULL << (bits - 3);
+    return (4 + bucket % 4) * step + step - 1;
+}
+
+DeviceCounters::DeviceCounters()
+    : _bytes(0),
+      _readings(0),
+      _samples(0),
+      _badFrames(0),
+      _skippedBytes(0),
+      _sequenceGaps(0),
+      _droppedRecords(0),
+      _noEcho(0) {
+    for (Counter& counter : _latency) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (Counter& counter : _distance) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (Counter& counter : _colors) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+void DeviceCounters::addReading(const TelemetryRecord& record, uint64_t latencyUs) {
+    bump(_readings);
+    _droppedRecords.store(record.dropped, std::memory_order_relaxed);
+    bump(_latency[DeviceSnapshot::latencyBucket(latencyUs)]);
+
+    if (record.status & Telemetry::STATUS_NO_ECHO) {
+        bump(_noEcho);
+    } else {
+        size_t bucket = record.distance / DISTANCE_BUCKET_MM;
+        bump(_distance[bucket < DeviceSnapshot::DISTANCE_BUCKETS ? bucket : DeviceSnapshot::DISTANCE_BUCKETS - 1]);
+    }
+    bump(_colors[record.colorId < DeviceSnapshot::COLOR_CLASSES ? record.colorId : 0]);
+}
+
+void DeviceCounters::setStreamErrors(uint64_t badFrames, uint64_t skippedBytes, uint64_t sequenceGaps) {
+    _badFrames.store(badFrames, std::memory_order_relaxed);
+    _skippedBytes.store(skippedBytes, std::memory_order_relaxed);
+    _sequenceGaps.store(sequenceGaps, std::memory_order_relaxed);
+}
+
+DeviceSnapshot DeviceCounters::snapshot(uint64_t timeNs) const {
+    DeviceSnapshot snapshot;
+    snapshot.timeNs = timeNs;
+    snapshot.bytes = _bytes.load(std::memory_order_relaxed);
+    snapshot.readings = _readings.load(std::memory_order_relaxed);
+    snapshot.samples = _samples.load(std::memory_order_relaxed);
+    snapshot.badFrames = _badFrames.load(std::memory_order_relaxed);
+    snapshot.skippedBytes = _skippedBytes.load(std::memory_order_relaxed);
+    snapshot.sequenceGaps = _sequenceGaps.load(std::memory_order_relaxed);
+    snapshot.droppedRecords = _droppedRecords.load(std::memory_order_relaxed);
+    snapshot.noEcho = _noEcho.load(std::memory_order_relaxed);
+    load(_latency, snapshot.latency, DeviceSnapshot::LATENCY_BUCKETS);
+    load(_distance, snapshot.distance, DeviceSnapshot::DISTANCE_BUCKETS);
+    load(_colors, snapshot.colors, DeviceSnapshot::COLOR_CLASSES);
+    return snapshot;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file DeviceCounters.h
+ * @brief Per-device telemetry statistics readable from any thread
+ * @author catalina
+ */
+
+#ifndef DEVICE_COUNTERS_H
+#define DEVICE_COUNTERS_H
+
+#include "../../src/Telemetry/Telemetry.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Copy of a device's counters at one moment
+ *
+ * Two snapshots of the same device give the rates over the time between
+ * them; the histograms give the distributions since the device was added.
+ */
+struct DeviceSnapshot {
+    static const size_t LATENCY_BUCKETS = 96;   // 4 per power of two of µs
+    static const size_t DISTANCE_BUCKETS = 41;  // 10 cm each, the last one beyond 4 m
+    static const size_t COLOR_CLASSES = 4;      // ColorIdentifier
+
+    uint64_t timeNs = 0;            // Host time of the snapshot
+    uint64_t bytes = 0;
+    uint64_t readings = 0;
+    uint64_t samples = 0;
+    uint64_t badFrames = 0;
+    uint64_t skippedBytes = 0;
+    uint64_t sequenceGaps = 0;
+    uint64_t droppedRecords = 0;    // Latest count reported by the device (TelemetryRecord::dropped)
+    uint64_t noEcho = 0;
+    uint64_t latency[LATENCY_BUCKETS] = {};
+    uint64_t distance[DISTANCE_BUCKETS] = {};
+    uint64_t colors[COLOR_CLASSES] = {};
+
+    /**
+     * @brief Get the readings per second since an earlier snapshot
+     */
+    double readingRate(const DeviceSnapshot& earlier) const;
+
+    /**
+     * @brief Get a delivery latency percentile
+     * @param fraction 0.5 for the median, 0.99 for p99, ...
+     * @return Upper bound of the histogram bucket in µs (0 without readings)
+     */
+    uint64_t latencyPercentile(double fraction) const;
+
+    /**
+     * @brief Add another device's counters (for fleet totals)
+     */
+    void add(const DeviceSnapshot& other);
+
+    // Histogram bucket of a latency, and the largest latency it holds
+    static size_t latencyBucket(uint64_t latencyUs);
+    static uint64_t latencyBucketLimit(size_t bucket);
+};
+
+/**
+ * @class DeviceCounters
+ * @brief Statistics of one device's stream, updated by one thread and read by any
+ *
+ * Every counter is a relaxed atomic written only by the aggregator thread,
+ * so an update is a plain load, add and store with no lock and no locked
+ * instruction, and a reporter thread may take a snapshot at any time. A
+ * snapshot is not taken at one instant: counters read later may include
+ * readings that earlier ones do not.
+ */
+class DeviceCounters {
+public:
+    DeviceCounters();
+
+    DeviceCounters(const DeviceCounters&) = delete;
+    DeviceCounters& operator=(const DeviceCounters&) = delete;
+
+    void addBytes(size_t count) { bump(_bytes, count); }
+    void addSamples(size_t count) { bump(_samples, count); }
+
+    /**
+     * @brief Count a reading
+     * @param record Decoded record
+     * @param latencyUs Delivery latency estimated for it
+     */
+    void addReading(const TelemetryRecord& record, uint64_t latencyUs);
+
+    /**
+     * @brief Set the decoder's error counts (totals, not increments)
+     */
+    void setStreamErrors(uint64_t badFrames, uint64_t skippedBytes, uint64_t sequenceGaps);
+
+    /**
+     * @brief Read every counter
+     * @param timeNs Host time to stamp the snapshot with
+     */
+    DeviceSnapshot snapshot(uint64_t timeNs) const;
+
+private:
+    typedef std::atomic<uint64_t> Counter;
+
+    Counter _bytes;
+    Counter _readings;
+    Counter _samples;
+    Counter _badFrames;
+    Counter _skippedBytes;
+    Counter _sequenceGaps;
+    Counter _droppedRecords;
+    Counter _noEcho;
+    Counter _latency[DeviceSnapshot::LATENCY_BUCKETS];
+    Counter _distance[DeviceSnapshot::DISTANCE_BUCKETS];
+    Counter _colors[DeviceSnapshot::COLOR_CLASSES];
+
+    // Single writer: no read-modify-write needed
+    static void bump(Counter& counter, uint64_t count = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+};
+
+#endif // DEVICE_COUNTERS_H
@@ -0,0 +1,215 @@
+/**
+ * @file PtyEmulator.cpp
+ * @brief Pty-based telemetry device emulator implementation
+ * @author catalina
+ */
+
+#include "PtyEmulator.h"
+
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+    // How often the replay thread wakes to send and pump
+    const std::chrono::microseconds TICK(1000);
+
+    // Time allowed for the queues to drain on stop()
+    const std::chrono::seconds DRAIN_TIME(1);
+}
+
+PtyDevice::PtyDevice()
+    : _master(-1),
+      _slave(-1),
+      _queueHead(0),
+      _sequence(0),
+      _droppedSinceStart(0),
+      _sent(0),
+      _dropped(0) {
+}
+
+PtyDevice::~PtyDevice() {
+    close();
+}
+
+bool PtyDevice::open() {
+    close();
+
+    _master = posix_openpt(O_RDWR | O_NOCTTY);
+    char name[128];
+    if (_master < 0 || grantpt(_master) != 0 || unlockpt(_master) != 0
+        || ptsname_r(_master, name, sizeof(name)) != 0) {
+        _error = "cannot create a pty";
+        close();
+        return false;
+    }
+    fcntl(_master, F_SETFL, fcntl(_master, F_GETFL) | O_NONBLOCK);
+    fcntl(_master, F_SETFD, FD_CLOEXEC);
+
+    // Raw mode on the slave: no echo back into the master, no line editing
+    _slave = ::open(name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    struct termios settings;
+    if (_slave < 0 || tcgetattr(_slave, &settings) != 0) {
+        _error = std::string("cannot open ") + name;
+        close();
+        return false;
+    }
+    cfmakeraw(&settings);
+    tcsetattr(_slave, TCSANOW, &settings);
+
+    _path = name;
+    return true;
+}
+
+void PtyDevice::close() {
+    if (_master >= 0) {
+        ::close(_master);
+        _master = -1;
+    }
+    if (_slave >= 0) {
+        ::close(_slave);
+        _slave = -1;
+    }
+    _queue.clear();
+    _queueHead = 0;
+}
+
+bool PtyDevice::send(TelemetryRecord& record) {
+    record.sequence = _sequence++;
+    record.dropped = _droppedSinceStart;
+
+    if (pendingBytes() + Telemetry::FRAME_SIZE > QUEUE_CAPACITY) {
+        _droppedSinceStart++;
+        _dropped++;
+        return false;
+    }
+
+    uint8_t frame[Telemetry::FRAME_SIZE];
+    Telemetry::encode(record, frame);
+    _queue.insert(_queue.end(), frame, frame + sizeof(frame));
+    _sent++;
+    return true;
+}
+
+size_t PtyDevice::pump() {
+    size_t pending = pendingBytes();
+    if (_master < 0 || pending == 0) {
+        return 0;
+    }
+
+    ssize_t written = write(_master, _queue.data() + _queueHead, pending);
+    if (written <= 0) {
+        return 0;
+    }
+    _queueHead += written;
+    if (_queueHead == _queue.size()) {
+        _queue.clear();
+        _queueHead = 0;
+    } else if (_queueHead > QUEUE_CAPACITY) {
+        _queue.erase(_queue.begin(), _queue.begin() + _queueHead);
+        _queueHead = 0;
+    }
+    return written;
+}
+
+PtyEmulator::PtyEmulator(double speed)
+    : _speed(speed > 0.0 ? speed : 1.0),
+      _running(false),
+      _sent(0) {
+}
+
+PtyEmulator::~PtyEmulator() {
+    stop();
+    close();
+}
+
+int PtyEmulator::addDevice(const std::vector<TelemetryRecord>& recording, uint32_t durationMs) {
+    if (recording.empty() || durationMs == 0) {
+        _error = "empty recording";
+        return -1;
+    }
+
+    std::unique_ptr<Device> device(new Device());
+    device->pty.reset(new PtyDevice());
+    if (!device->pty->open()) {
+        _error = device->pty->error();
+        return -1;
+    }
+    device->recording = recording;
+    device->durationMs = durationMs;
+    device->next = 0;
+    device->loops = 0;
+    _devices.push_back(std::move(device));
+    return _devices.size() - 1;
+}
+
+void PtyEmulator::start() {
+    if (_running.exchange(true)) {
+        return;
+    }
+    _thread = std::thread(&PtyEmulator::replayLoop, this);
+}
+
+void PtyEmulator::stop() {
+    if (!_running.exchange(false)) {
+        return;
+    }
+    _thread.join();
+}
+
+void PtyEmulator::close() {
+    for (std::unique_ptr<Device>& device : _devices) {
+        device->pty->close();
+    }
+}
+
+void PtyEmulator::replayLoop() {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    while (_running.load(std::memory_order_relaxed)) {
+        Clock::time_point tick = Clock::now();
+        double elapsedMs = std::chrono::duration<double, std::milli>(tick - start).count();
+        double recordedMs = elapsedMs * _speed;
+        uint32_t deviceTime = static_cast<uint32_t>(elapsedMs);
+
+        uint64_t sent = 0;
+        for (std::unique_ptr<Device>& device : _devices) {
+            for (;;) {
+                const TelemetryRecord& next = device->recording[device->next];
+                if (device->loops * device->durationMs + next.timestamp > recordedMs) {
+                    break;
+                }
+                TelemetryRecord record = next;
+                record.timestamp = deviceTime;
+                if (device->pty->send(record)) {
+                    sent++;
+                }
+                if (++device->next == device->recording.size()) {
+                    device->next = 0;
+                    device->loops++;
+                }
+            }
+            device->pty->pump();
+        }
+        _sent.fetch_add(sent, std::memory_order_relaxed);
+        std::this_thread::sleep_until(tick + TICK);
+    }
+
+    // Let the collector catch up on what is still queued
+    Clock::time_point deadline = Clock::now() + DRAIN_TIME;
+    bool pending = true;
+    while (pending && Clock::now() < deadline) {
+        pending = false;
+        for (std::unique_ptr<Device>& device : _devices) {
+            device->pty->pump();
+            pending = pending || device->pty->pendingBytes() > 0;
+        }
+        if (pending) {
+            std::this_thread::sleep_for(TICK);
+        }
+    }
+}
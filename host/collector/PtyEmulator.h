@@ -0,0 +1,160 @@
+/**
+ * @file PtyEmulator.h
+ * @brief Pseudo-terminals that stream recorded telemetry like real units
+ * @author catalina
+ */
+
+#ifndef PTY_EMULATOR_H
+#define PTY_EMULATOR_H
+
+#include "../../src/Telemetry/Telemetry.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class PtyDevice
+ * @brief The serial end of one emulated unit
+ *
+ * Opens a pty pair and writes telemetry frames to the master side; a
+ * collector opens path() like a USB serial port. Frames are queued and
+ * written without blocking, like the firmware's Telemetry ring: when the
+ * reader falls behind and the queue is full, a reading is dropped, its
+ * sequence number is lost and later readings report the drop count.
+ */
+class PtyDevice {
+public:
+    PtyDevice();
+    ~PtyDevice();
+
+    PtyDevice(const PtyDevice&) = delete;
+    PtyDevice& operator=(const PtyDevice&) = delete;
+
+    /**
+     * @brief Create the pty pair (the slave side in raw mode)
+     * @return false on failure (see error())
+     */
+    bool open();
+
+    /**
+     * @brief Close the pty; the reader sees a hang-up
+     */
+    void close();
+
+    /**
+     * @brief Queue a reading like Telemetry::send()
+     * @param record Reading; the sequence number and drop count are set here
+     * @return false if the queue was full and the reading was dropped
+     */
+    bool send(TelemetryRecord& record);
+
+    /**
+     * @brief Write queued bytes to the pty without blocking
+     * @return Bytes written
+     */
+    size_t pump();
+
+    const std::string& path() const { return _path; }
+    const std::string& error() const { return _error; }
+    size_t pendingBytes() const { return _queue.size() - _queueHead; }
+    uint64_t getSentCount() const { return _sent; }
+    uint64_t getDroppedCount() const { return _dropped; }
+
+    // Bytes the device may have waiting to go out
+    static const size_t QUEUE_CAPACITY = 4096;
+
+private:
+    int _master;
+    int _slave;                 // Held open so the master never sees a hang-up
+    std::string _path;
+    std::string _error;
+    std::vector<uint8_t> _queue;
+    size_t _queueHead;
+    uint8_t _sequence;
+    uint16_t _droppedSinceStart;
+    uint64_t _sent;
+    uint64_t _dropped;
+};
+
+/**
+ * @class PtyEmulator
+ * @brief Replays recorded readings on many ptys in real time
+ *
+ * Each device loops over its recording on a background thread. A reading
+ * goes out when the host clock reaches its recorded time divided by the
+ * speed factor, stamped with the host time since start(), so a collector
+ * sees a device clock that runs in step with its own and a reading rate
+ * speed times that of the recording.
+ */
+class PtyEmulator {
+public:
+    /**
+     * @brief Constructor
+     * @param speed Replay speed (2 = twice the recorded reading rate)
+     */
+    explicit PtyEmulator(double speed = 1.0);
+    ~PtyEmulator();
+
+    PtyEmulator(const PtyEmulator&) = delete;
+    PtyEmulator& operator=(const PtyEmulator&) = delete;
+
+    /**
+     * @brief Open a device that replays a recording
+     * @param recording Readings with timestamps in ms, in order
+     * @param durationMs Length of the recording, after which it repeats
+     * @return Device number, or -1 (see error())
+     */
+    int addDevice(const std::vector<TelemetryRecord>& recording, uint32_t durationMs);
+
+    /**
+     * @brief Start replaying on every device
+     */
+    void start();
+
+    /**
+     * @brief Stop replaying and give the queues up to a second to drain
+     */
+    void stop();
+
+    /**
+     * @brief Close the ptys; readers see a hang-up
+     *
+     * Bytes the reader has not taken yet are lost with the pty, so a
+     * collector should have caught up before this.
+     */
+    void close();
+
+    size_t deviceCount() const { return _devices.size(); }
+    const PtyDevice& device(size_t index) const { return *_devices[index]->pty; }
+    const std::string& error() const { return _error; }
+
+    /**
+     * @brief Get the readings sent so far on all devices (any thread)
+     */
+    uint64_t getSentCount() const { return _sent.load(std::memory_order_relaxed); }
+
+private:
+    struct Device {
+        std::unique_ptr<PtyDevice> pty;
+        std::vector<TelemetryRecord> recording;
+        uint32_t durationMs;
+        size_t next;
+        uint64_t loops;
+    };
+
+    double _speed;
+    std::vector<std::unique_ptr<Device>> _devices;
+    std::thread _thread;
+    std::atomic<bool> _running;
+    std::atomic<uint64_t> _sent;
+    std::string _error;
+
+    void replayLoop();
+};
+
+#endif // PTY_EMULATOR_H
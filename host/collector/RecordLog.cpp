@@ -0,0 +1,314 @@
+/**
+ * @file RecordLog.cpp
+ * @brief Append-only, time-indexed reading store implementation
+ * @author catalina
+ */
+
+#include "RecordLog.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char LOG_MAGIC[8] = { 'D', 'D', 'L', 'O', 'G', 'R', 'O', 'W' };
+    const char INDEX_MAGIC[8] = { 'D', 'D', 'L', 'O', 'G', 'I', 'D', 'X' };
+
+    std::string logPath(const char* directory) {
+        return std::string(directory) + "/readings.log";
+    }
+
+    std::string indexPath(const char* directory) {
+        return std::string(directory) + "/readings.idx";
+    }
+
+    LogHeader makeHeader(const char* magic, uint32_t entrySize) {
+        LogHeader header;
+        memcpy(header.magic, magic, sizeof(header.magic));
+        header.version = RecordLog::VERSION;
+        header.entrySize = entrySize;
+        return header;
+    }
+
+    bool isHeader(const LogHeader& header, const char* magic, uint32_t entrySize) {
+        return memcmp(header.magic, magic, sizeof(header.magic)) == 0
+            && header.version == RecordLog::VERSION && header.entrySize == entrySize;
+    }
+
+    bool writeAll(int fd, const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            ssize_t written = write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            bytes += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    // Entries after the header of a file of a given size (0 if no header)
+    uint64_t entryCount(int fd, size_t entrySize) {
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(LogHeader)) {
+            return 0;
+        }
+        return (info.st_size - sizeof(LogHeader)) / entrySize;
+    }
+
+    // Check the header of a file, writing one if the file is empty
+    bool prepare(int fd, const char* magic, uint32_t entrySize) {
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            return false;
+        }
+        if (info.st_size == 0) {
+            LogHeader header = makeHeader(magic, entrySize);
+            return writeAll(fd, &header, sizeof(header));
+        }
+        LogHeader header;
+        return pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))
+            && isHeader(header, magic, entrySize);
+    }
+
+    uint64_t rowTime(int fd, uint64_t row) {
+        uint64_t timeNs = 0;
+        off_t offset = sizeof(LogHeader) + row * sizeof(LogRow) + offsetof(LogRow, timeNs);
+        if (pread(fd, &timeNs, sizeof(timeNs), offset) != static_cast<ssize_t>(sizeof(timeNs))) {
+            return 0;
+        }
+        return timeNs;
+    }
+
+    void* mapFile(const std::string& path, size_t& size) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat info;
+        void* mapping = nullptr;
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(LogHeader)) {
+            size = info.st_size;
+            mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+            }
+        }
+        ::close(fd);
+        return mapping;
+    }
+}
+
+RecordLogWriter::RecordLogWriter()
+    : _logFd(-1),
+      _indexFd(-1),
+      _rows(0),
+      _lastTimeNs(0) {
+}
+
+RecordLogWriter::~RecordLogWriter() {
+    close();
+}
+
+bool RecordLogWriter::open(const char* directory) {
+    close();
+
+    std::string path = logPath(directory);
+    _logFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (_logFd < 0) {
+        return fail("cannot open " + path);
+    }
+    if (!prepare(_logFd, LOG_MAGIC, sizeof(LogRow))) {
+        return fail(path + " is not a record log of this build");
+    }
+
+    // Cut off a row torn by a crash
+    _rows = entryCount(_logFd, sizeof(LogRow));
+    if (ftruncate(_logFd, sizeof(LogHeader) + _rows * sizeof(LogRow)) != 0) {
+        return fail("cannot truncate " + path);
+    }
+    _lastTimeNs = _rows > 0 ? rowTime(_logFd, _rows - 1) : 0;
+
+    path = indexPath(directory);
+    _indexFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (_indexFd < 0) {
+        return fail("cannot open " + path);
+    }
+    if (!prepare(_indexFd, INDEX_MAGIC, sizeof(uint64_t))) {
+        return fail(path + " is not a record log index of this build");
+    }
+
+    uint64_t blocks = (_rows + INDEX_STRIDE - 1) / INDEX_STRIDE;
+    if (entryCount(_indexFd, sizeof(uint64_t)) != blocks) {
+        // The index is written after the rows, so it can only be short; rebuild it
+        if (ftruncate(_indexFd, sizeof(LogHeader)) != 0) {
+            return fail("cannot truncate " + path);
+        }
+        for (uint64_t block = 0; block < blocks; block++) {
+            _indexBuffer.push_back(rowTime(_logFd, block * INDEX_STRIDE));
+        }
+    }
+
+    if (lseek(_logFd, 0, SEEK_END) < 0 || lseek(_indexFd, 0, SEEK_END) < 0) {
+        return fail("cannot seek in " + std::string(directory));
+    }
+    return flush();
+}
+
+void RecordLogWriter::close() {
+    if (_logFd >= 0 && _indexFd >= 0) {
+        flush();
+    }
+    if (_logFd >= 0) {
+        ::close(_logFd);
+        _logFd = -1;
+    }
+    if (_indexFd >= 0) {
+        ::close(_indexFd);
+        _indexFd = -1;
+    }
+    _rowBuffer.clear();
+    _indexBuffer.clear();
+    _rows = 0;
+    _lastTimeNs = 0;
+}
+
+void RecordLogWriter::append(uint64_t timeNs, uint32_t device, const TelemetryRecord& record) {
+    timeNs = std::max(timeNs, _lastTimeNs);
+    _lastTimeNs = timeNs;
+
+    if (_rows % INDEX_STRIDE == 0) {
+        _indexBuffer.push_back(timeNs);
+    }
+    LogRow row;
+    memset(&row, 0, sizeof(row));   // Padding goes to disk too
+    row.timeNs = timeNs;
+    row.device = device;
+    row.record = record;
+    _rowBuffer.push_back(row);
+    _rows++;
+}
+
+bool RecordLogWriter::flush() {
+    if (_logFd < 0 || _indexFd < 0) {
+        return false;
+    }
+
+    // Rows first: an index entry must never point past the rows on disk
+    bool ok = writeAll(_logFd, _rowBuffer.data(), _rowBuffer.size() * sizeof(LogRow))
+        && writeAll(_indexFd, _indexBuffer.data(), _indexBuffer.size() * sizeof(uint64_t));
+    _rowBuffer.clear();
+    _indexBuffer.clear();
+    if (!ok) {
+        _error = "write failed";
+    }
+    return ok;
+}
+
+bool RecordLogWriter::fail(const std::string& message) {
+    _error = message;
+    if (_logFd >= 0) {
+        ::close(_logFd);
+        _logFd = -1;
+    }
+    if (_indexFd >= 0) {
+        ::close(_indexFd);
+        _indexFd = -1;
+    }
+    return false;
+}
+
+RecordLog::RecordLog()
+    : _logMapping(nullptr),
+      _logSize(0),
+      _indexMapping(nullptr),
+      _indexSize(0),
+      _rows(nullptr),
+      _rowCount(0),
+      _index(nullptr),
+      _indexCount(0) {
+}
+
+RecordLog::~RecordLog() {
+    close();
+}
+
+bool RecordLog::open(const char* directory) {
+    close();
+
+    _logMapping = mapFile(logPath(directory), _logSize);
+    _indexMapping = mapFile(indexPath(directory), _indexSize);
+    if (_logMapping == nullptr || _indexMapping == nullptr) {
+        _error = std::string("no record log in ") + directory;
+        close();
+        return false;
+    }
+    if (!isHeader(*static_cast<const LogHeader*>(_logMapping), LOG_MAGIC, sizeof(LogRow))
+        || !isHeader(*static_cast<const LogHeader*>(_indexMapping), INDEX_MAGIC, sizeof(uint64_t))) {
+        _error = std::string("not a record log of this build in ") + directory;
+        close();
+        return false;
+    }
+
+    const uint8_t* logBase = static_cast<const uint8_t*>(_logMapping);
+    const uint8_t* indexBase = static_cast<const uint8_t*>(_indexMapping);
+    _rows = reinterpret_cast<const LogRow*>(logBase + sizeof(LogHeader));
+    _rowCount = (_logSize - sizeof(LogHeader)) / sizeof(LogRow);
+    _index = reinterpret_cast<const uint64_t*>(indexBase + sizeof(LogHeader));
+    _indexCount = (_indexSize - sizeof(LogHeader)) / sizeof(uint64_t);
+
+    // A writer may have flushed rows whose index entries are not on disk yet
+    size_t blocks = (_rowCount + RecordLogWriter::INDEX_STRIDE - 1) / RecordLogWriter::INDEX_STRIDE;
+    if (_indexCount > blocks) {
+        _indexCount = blocks;
+    }
+    _rowCount = std::min(_rowCount, _indexCount * RecordLogWriter::INDEX_STRIDE);
+    return true;
+}
+
+void RecordLog::close() {
+    if (_logMapping != nullptr) {
+        munmap(_logMapping, _logSize);
+        _logMapping = nullptr;
+    }
+    if (_indexMapping != nullptr) {
+        munmap(_indexMapping, _indexSize);
+        _indexMapping = nullptr;
+    }
+    _logSize = 0;
+    _indexSize = 0;
+    _rows = nullptr;
+    _rowCount = 0;
+    _index = nullptr;
+    _indexCount = 0;
+}
+
+TraceRange RecordLog::findRange(uint64_t fromNs, uint64_t toNs) const {
+    TraceRange range;
+    range.begin = lowerBound(fromNs);
+    range.end = std::max(range.begin, lowerBound(toNs));
+    return range;
+}
+
+size_t RecordLog::lowerBound(uint64_t timeNs) const {
+    // First block starting at or after the time; the row is in the block before it
+    size_t block = std::lower_bound(_index, _index + _indexCount, timeNs) - _index;
+    if (block == 0) {
+        return 0;
+    }
+
+    size_t begin = (block - 1) * RecordLogWriter::INDEX_STRIDE;
+    size_t end = std::min(block * static_cast<size_t>(RecordLogWriter::INDEX_STRIDE), _rowCount);
+    const LogRow* row = std::lower_bound(_rows + begin, _rows + end, timeNs,
+        [](const LogRow& entry, uint64_t value) { return entry.timeNs < value; });
+    return row - _rows;
+}
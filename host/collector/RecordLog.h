@@ -0,0 +1,148 @@
+/**
+ * @file RecordLog.h
+ * @brief Append-only, time-indexed store of telemetry readings from many devices
+ * @author catalina
+ */
+
+#ifndef RECORD_LOG_H
+#define RECORD_LOG_H
+
+#include "../../src/Telemetry/Telemetry.h"
+#include "../trace/TraceStore.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One stored reading
+ */
+struct LogRow {
+    uint64_t timeNs;            // Host arrival time, ns since the Unix epoch, non-decreasing
+    uint32_t device;            // Device number in the aggregator
+    TelemetryRecord record;
+};
+
+/**
+ * @brief Header at the start of both files (host byte order)
+ */
+struct LogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entrySize;         // sizeof(LogRow) or sizeof(uint64_t)
+};
+
+/**
+ * @class RecordLogWriter
+ * @brief Appends rows to DIR/readings.log and the time index to DIR/readings.idx
+ *
+ * Rows are fixed-size and in arrival order. The index holds the time of
+ * every INDEX_STRIDE-th row, so a time range is found by a binary search
+ * of the small index and one block of rows. Appends collect in memory
+ * until flush(), which costs one write() per file however many devices
+ * the rows came from.
+ *
+ * Opening an existing log appends to it. An index left short by a crash
+ * is rebuilt from the rows, and a torn last row is cut off.
+ */
+class RecordLogWriter {
+public:
+    RecordLogWriter();
+    ~RecordLogWriter();
+
+    RecordLogWriter(const RecordLogWriter&) = delete;
+    RecordLogWriter& operator=(const RecordLogWriter&) = delete;
+
+    /**
+     * @brief Open or create the log in a directory
+     * @param directory Existing directory
+     * @return false if the files cannot be opened or are not a log (see error())
+     */
+    bool open(const char* directory);
+
+    /**
+     * @brief Flush and close the files
+     */
+    void close();
+
+    /**
+     * @brief Add a reading
+     * @param timeNs Arrival time; an earlier time than the last row's is raised to it
+     * @param device Device number
+     * @param record Reading
+     */
+    void append(uint64_t timeNs, uint32_t device, const TelemetryRecord& record);
+
+    /**
+     * @brief Write the appended rows and index entries
+     * @return false on a write error
+     */
+    bool flush();
+
+    uint64_t rowCount() const { return _rows; }
+    const std::string& error() const { return _error; }
+
+    static const uint32_t INDEX_STRIDE = 1024;
+
+private:
+    int _logFd;
+    int _indexFd;
+    uint64_t _rows;             // Including the unflushed ones
+    uint64_t _lastTimeNs;
+    std::vector<LogRow> _rowBuffer;
+    std::vector<uint64_t> _indexBuffer;
+    std::string _error;
+
+    bool fail(const std::string& message);
+};
+
+/**
+ * @class RecordLog
+ * @brief Read-only view of a record log
+ *
+ * Both files are mapped; rows are read in place. A log still being
+ * written can be opened and shows the rows flushed so far.
+ */
+class RecordLog {
+public:
+    RecordLog();
+    ~RecordLog();
+
+    RecordLog(const RecordLog&) = delete;
+    RecordLog& operator=(const RecordLog&) = delete;
+
+    /**
+     * @brief Map the log in a directory
+     * @return false if the files are missing or not a log (see error())
+     */
+    bool open(const char* directory);
+
+    void close();
+
+    size_t rowCount() const { return _rowCount; }
+    const LogRow& row(size_t index) const { return _rows[index]; }
+    const std::string& error() const { return _error; }
+
+    /**
+     * @brief Find the rows with fromNs <= timeNs < toNs
+     */
+    TraceRange findRange(uint64_t fromNs, uint64_t toNs) const;
+
+    static const uint32_t VERSION = 1;
+
+private:
+    void* _logMapping;
+    size_t _logSize;
+    void* _indexMapping;
+    size_t _indexSize;
+    const LogRow* _rows;
+    size_t _rowCount;
+    const uint64_t* _index;
+    size_t _indexCount;
+    std::string _error;
+
+    size_t lowerBound(uint64_t timeNs) const;
+};
+
+#endif // RECORD_LOG_H
@@ -0,0 +1,166 @@
+/**
+ * @file TelemetryAggregator.cpp
+ * @brief Many-port telemetry collector implementation
+ * @author catalina
+ */
+
+#include "TelemetryAggregator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+    uint64_t clockNs(clockid_t clock) {
+        struct timespec now;
+        clock_gettime(clock, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+    }
+
+    bool lineSpeed(unsigned long baud, speed_t& speed) {
+        switch (baud) {
+            case 9600: speed = B9600; return true;
+            case 19200: speed = B19200; return true;
+            case 38400: speed = B38400; return true;
+            case 57600: speed = B57600; return true;
+            case 115200: speed = B115200; return true;
+            case 230400: speed = B230400; return true;
+            case 460800: speed = B460800; return true;
+            case 921600: speed = B921600; return true;
+            default: return false;
+        }
+    }
+}
+
+TelemetryAggregator::TelemetryAggregator(RecordLogWriter* log)
+    : _epoll(epoll_create1(EPOLL_CLOEXEC)),
+      _openCount(0),
+      _log(log),
+      _buffer(READ_SIZE) {
+}
+
+TelemetryAggregator::~TelemetryAggregator() {
+    for (std::unique_ptr<Device>& device : _devices) {
+        closeDevice(*device);
+    }
+    if (_epoll >= 0) {
+        ::close(_epoll);
+    }
+}
+
+int TelemetryAggregator::addPort(const char* path, unsigned long baud) {
+    if (_epoll < 0) {
+        _error = "epoll_create1 failed";
+        return -1;
+    }
+    speed_t speed;
+    if (!lineSpeed(baud, speed)) {
+        _error = "unsupported line speed " + std::to_string(baud);
+        return -1;
+    }
+
+    int fd = ::open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        _error = std::string("cannot open ") + path;
+        return -1;
+    }
+
+    if (isatty(fd)) {
+        struct termios settings;
+        if (tcgetattr(fd, &settings) == 0) {
+            cfmakeraw(&settings);
+            cfsetispeed(&settings, speed);
+            cfsetospeed(&settings, speed);
+            settings.c_cflag |= CLOCAL | CREAD;
+            tcsetattr(fd, TCSANOW, &settings);
+        }
+    }
+
+    uint32_t index = _devices.size();
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = index;
+    if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+        ::close(fd);
+        _error = std::string("cannot poll ") + path;
+        return -1;
+    }
+
+    _devices.emplace_back(new Device());
+    _devices.back()->name = path;
+    _devices.back()->fd = fd;
+    _openCount++;
+    return index;
+}
+
+size_t TelemetryAggregator::poll(int timeoutMs) {
+    struct epoll_event events[MAX_EVENTS];
+    int ready = epoll_wait(_epoll, events, MAX_EVENTS, timeoutMs);
+    if (ready <= 0) {
+        return 0;
+    }
+
+    // One arrival time for the whole batch
+    uint64_t arrivalNs = clockNs(CLOCK_MONOTONIC);
+    uint64_t wallNs = clockNs(CLOCK_REALTIME);
+
+    size_t readings = 0;
+    for (int i = 0; i < ready; i++) {
+        read(events[i].data.u32, arrivalNs, wallNs);
+        readings += _batch.readings.size();
+    }
+    if (_log != nullptr && readings > 0) {
+        _log->flush();
+    }
+    return readings;
+}
+
+void TelemetryAggregator::read(uint32_t index, uint64_t arrivalNs, uint64_t wallNs) {
+    Device& device = *_devices[index];
+    _batch.clear();
+
+    ssize_t count = ::read(device.fd, _buffer.data(), _buffer.size());
+    if (count <= 0) {
+        // A pty whose other end has closed reports EIO; EAGAIN is a spurious wake-up
+        if (count == 0 || (errno != EAGAIN && errno != EINTR)) {
+            device.stream.finish(_batch);
+            closeDevice(device);
+        }
+    } else {
+        device.counters.addBytes(count);
+        device.stream.feed(_buffer.data(), count, _batch);
+    }
+
+    for (const TelemetryRecord& record : _batch.readings) {
+        device.counters.addReading(record, latency(device, record, arrivalNs));
+        if (_log != nullptr) {
+            _log->append(wallNs, index, record);
+        }
+    }
+    device.counters.addSamples(_batch.samples.size());
+    device.counters.setStreamErrors(device.stream.getBadFrames(), device.stream.getSkippedBytes(),
+                                    device.stream.getSequenceGaps());
+}
+
+uint64_t TelemetryAggregator::latency(Device& device, const TelemetryRecord& record, uint64_t arrivalNs) {
+    int64_t offset = static_cast<int64_t>(arrivalNs) - static_cast<int64_t>(record.timestamp) * 1000000;
+    if (!device.synced || record.timestamp < device.lastTimestamp || offset < device.offsetNs) {
+        device.offsetNs = offset;
+        device.synced = true;
+    }
+    device.lastTimestamp = record.timestamp;
+    return (offset - device.offsetNs) / 1000;
+}
+
+void TelemetryAggregator::closeDevice(Device& device) {
+    if (device.fd < 0) {
+        return;
+    }
+    epoll_ctl(_epoll, EPOLL_CTL_DEL, device.fd, nullptr);
+    ::close(device.fd);
+    device.fd = -1;
+    _openCount--;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file TelemetryAggregator.h
+ * @brief Collects the telemetry streams of many serial devices on one thread
+ * @author catalina
+ */
+
+#ifndef TELEMETRY_AGGREGATOR_H
+#define TELEMETRY_AGGREGATOR_H
+
+#include "DeviceCounters.h"
+#include "RecordLog.h"
+#include "../sim/TelemetryStream.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class TelemetryAggregator
+ * @brief Reads serial ports and ptys through epoll and decodes them in batches
+ *
+ * poll() waits until any port has data and then reads every ready port
+ * once: each read takes whatever the kernel has buffered (up to
+ * READ_SIZE bytes) and decodes it as one batch, so the cost per reading
+ * falls as the load rises. Readings update the port's DeviceCounters and
+ * are appended to the record log, which is flushed once per poll().
+ *
+ * Delivery latency is the host arrival time less the device timestamp,
+ * less the smallest such difference seen on the port: the device clock is
+ * not synchronised, so the fastest reading counts as zero latency and the
+ * figure is the extra delay buffering and scheduling added (at the 1 ms
+ * resolution of the device timestamp). A timestamp going backwards means
+ * the device restarted and the reference is found again.
+ *
+ * Ports must all be added before other threads start reading counters();
+ * poll() and addPort() belong to one thread.
+ */
+class TelemetryAggregator {
+public:
+    /**
+     * @brief Constructor
+     * @param log Store for every reading (nullptr to keep only statistics)
+     */
+    explicit TelemetryAggregator(RecordLogWriter* log = nullptr);
+    ~TelemetryAggregator();
+
+    TelemetryAggregator(const TelemetryAggregator&) = delete;
+    TelemetryAggregator& operator=(const TelemetryAggregator&) = delete;
+
+    /**
+     * @brief Open a serial port or pty for reading
+     *
+     * A terminal is switched to raw mode at the given speed.
+     *
+     * @param path Device path
+     * @param baud Line speed (ignored by ptys)
+     * @return Device number, or -1 (see error())
+     */
+    int addPort(const char* path, unsigned long baud = 9600);
+
+    /**
+     * @brief Wait for data and process every ready port once
+     * @param timeoutMs Longest wait (-1 = until data arrives)
+     * @return Readings decoded
+     */
+    size_t poll(int timeoutMs);
+
+    size_t deviceCount() const { return _devices.size(); }
+
+    /**
+     * @brief Get the number of ports still open (a port closes on hang-up or error)
+     */
+    size_t openCount() const { return _openCount; }
+
+    const std::string& name(size_t device) const { return _devices[device]->name; }
+    const DeviceCounters& counters(size_t device) const { return _devices[device]->counters; }
+    const std::string& error() const { return _error; }
+
+    // Bytes taken from a port per read
+    static const size_t READ_SIZE = 16384;
+
+    // Ready ports handled per epoll_wait()
+    static const int MAX_EVENTS = 256;
+
+private:
+    struct Device {
+        std::string name;
+        int fd = -1;
+        TelemetryStream stream;
+        DeviceCounters counters;
+        bool synced = false;        // Latency reference found
+        int64_t offsetNs = 0;       // Smallest arrival - device time seen
+        uint32_t lastTimestamp = 0;
+    };
+
+    int _epoll;
+    std::vector<std::unique_ptr<Device>> _devices;
+    size_t _openCount;
+    RecordLogWriter* _log;
+    std::vector<uint8_t> _buffer;
+    TelemetryBatch _batch;
+    std::string _error;
+
+    void read(uint32_t index, uint64_t arrivalNs, uint64_t wallNs);
+    uint64_t latency(Device& device, const TelemetryRecord& record, uint64_t arrivalNs);
+    void closeDevice(Device& device);
+};
+
+#endif // TELEMETRY_AGGREGATOR_H
@@ -0,0 +1,64 @@
+/**
+ * @file AsyncSensors.cpp
+ * @brief Awaitable measurements of the distance and color sensors and audio playback
+ * @author catalina
+ */
+
+#include "AsyncSensors.h"
+
+Task<float> AsyncDistance::measure(DistanceSensor::DistanceUnit unit) {
+    uint8_t echo = _sensor.getEchoPin();
+    _sensor.triggerPing();
+
+    // Without an echo the sensor still raises the pin for about 38 ms,
+    // which recordPulse() treats like a timeout
+    unsigned long width = 0;
+    uint64_t rise = co_await waitEdge(echo, RISING, DistanceSensor::PING_TIMEOUT);
+    if (rise != SignalSource::NEVER) {
+        uint64_t fall = co_await waitEdge(echo, FALLING, DistanceSensor::PING_TIMEOUT);
+        if (fall != SignalSource::NEVER) {
+            width = static_cast<unsigned long>((fall - rise) / 1000);
+        }
+    }
+    co_return _sensor.recordPulse(width, unit);
+}
+
+Task<ColorReading> AsyncColor::sample() {
+    ColorReading reading;
+    reading.rawRed = co_await readChannel(ColorSensor::CHANNEL_RED);
+    co_await waitMs(_settleTime);
+    reading.rawGreen = co_await readChannel(ColorSensor::CHANNEL_GREEN);
+    co_await waitMs(_settleTime);
+    reading.rawBlue = co_await readChannel(ColorSensor::CHANNEL_BLUE);
+
+    _sensor.convertToRGB(reading.rawRed, reading.rawGreen, reading.rawBlue,
+                         reading.red, reading.green, reading.blue);
+    reading.colorId = _sensor.classifyColor(reading.red, reading.green, reading.blue);
+    co_return reading;
+}
+
+Task<int> AsyncColor::readChannel(uint8_t channel) {
+    uint8_t out = _sensor.getOutputPin();
+    _sensor.selectChannel(channel);
+
+    uint64_t fall = co_await waitEdge(out, FALLING, PULSE_TIMEOUT);
+    if (fall == SignalSource::NEVER) {
+        co_return 0;
+    }
+    uint64_t rise = co_await waitEdge(out, RISING, PULSE_TIMEOUT);
+    if (rise == SignalSource::NEVER) {
+        co_return 0;
+    }
+    co_return static_cast<int>((rise - fall) / 1000);
+}
+
+Task<bool> AsyncAudio::play(uint8_t effect, uint8_t priority) {
+    if (!_audio.queueSound(effect, priority)) {
+        co_return false;
+    }
+    do {
+        _audio.update();
+        co_await waitMs(STEP_MS);
+    } while (_audio.isPlaying() || _audio.getQueuedCount() > 0);
+    co_return true;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file AsyncSensors.h
+ * @brief Awaitable measurements of the distance and color sensors and audio playback
+ * @author catalina
+ */
+
+#ifndef HOST_CORO_ASYNC_SENSORS_H
+#define HOST_CORO_ASYNC_SENSORS_H
+
+#include "EventLoop.h"
+#include "Task.h"
+
+#include <AudioManager.h>
+#include <ColorSensor.h>
+#include <DistanceSensor.h>
+#include <SensorConfig.h>
+
+#include <stdint.h>
+
+/**
+ * @class AsyncDistance
+ * @brief Distance readings that suspend while the echo is in flight
+ *
+ * Triggers a ping and awaits the rising and falling edge of the echo
+ * instead of busy-waiting in pulseIn(). The width goes through
+ * DistanceSensor::recordPulse(), so the result, the trace and
+ * getLastPulseDuration() match a blocking read.
+ */
+class AsyncDistance {
+public:
+    explicit AsyncDistance(DistanceSensor& sensor) : _sensor(sensor) {}
+
+    /**
+     * @brief Measure the distance once
+     * @param unit Unit of the result
+     * @return Distance (-1 if no echo arrived within PING_TIMEOUT)
+     */
+    Task<float> measure(DistanceSensor::DistanceUnit unit = DistanceSensor::CENTIMETERS);
+
+private:
+    DistanceSensor& _sensor;
+};
+
+/**
+ * @brief One color sample taken by AsyncColor
+ */
+struct ColorReading {
+    int rawRed = 0;                 // Pulse widths in µs (0 on timeout)
+    int rawGreen = 0;
+    int rawBlue = 0;
+    int red = 0;                    // Calibrated 0-255
+    int green = 0;
+    int blue = 0;
+    ColorIdentifier colorId = ColorIdentifier::NONE;
+};
+
+/**
+ * @class AsyncColor
+ * @brief Color samples that suspend while the channels settle and the output is timed
+ *
+ * Reads the channels in the order and with the settling time of
+ * ColorSensor::readRawValues(); the LOW width of the output is timed from
+ * its falling to its rising edge, as pulseIn(pin, LOW) does.
+ */
+class AsyncColor {
+public:
+    /**
+     * @brief Constructor
+     * @param sensor Color sensor (already begun and calibrated)
+     * @param settleTime Time in ms between two channels
+     */
+    explicit AsyncColor(ColorSensor& sensor,
+                        unsigned long settleTime = SystemSettings::SENSOR_STABILIZATION_DELAY)
+        : _sensor(sensor), _settleTime(settleTime) {}
+
+    /**
+     * @brief Read all three channels and classify the color
+     */
+    Task<ColorReading> sample();
+
+    // Wait for an output edge in µs, pulseIn()'s default
+    static const unsigned long PULSE_TIMEOUT = 1000000;
+
+private:
+    ColorSensor& _sensor;
+    unsigned long _settleTime;
+
+    Task<int> readChannel(uint8_t channel);
+};
+
+/**
+ * @class AsyncAudio
+ * @brief Queued playback that a coroutine can await to the end
+ *
+ * Drives AudioManager::update() every STEP_MS while the queue plays, which
+ * is what the sketch's audio task does every loop.
+ */
+class AsyncAudio {
+public:
+    explicit AsyncAudio(AudioManager& audio) : _audio(audio) {}
+
+    /**
+     * @brief Queue a sound effect and wait until the queue has played out
+     * @param effect Sound effect (AudioManager::SOUND_*)
+     * @param priority Priority level (AudioManager::PRIORITY_*)
+     * @return false if the sound was dropped instead of queued
+     */
+    Task<bool> play(uint8_t effect, uint8_t priority = AudioManager::PRIORITY_NORMAL);
+
+    // Time in ms between two update() calls
+    static const unsigned long STEP_MS = 10;
+
+private:
+    AudioManager& _audio;
+};
+
+#endif // HOST_CORO_ASYNC_SENSORS_H
@@ -0,0 +1,71 @@
+/**
+ * @file EventLoop.cpp
+ * @brief Runs coroutine sessions on their virtual devices in time order
+ * @author catalina
+ */
+
+#include "EventLoop.h"
+
+#include <assert.h>
+
+namespace {
+    thread_local EventLoop* currentLoop = nullptr;
+    thread_local FrameStats frameStats;
+}
+
+FrameStats& FrameStats::current() {
+    return frameStats;
+}
+
+EventLoop::EventLoop() : _sequence(0), _nextRoot(0) {
+}
+
+EventLoop::~EventLoop() {
+    // A root frame owns the tasks it awaits, so destroying the roots frees
+    // every frame still waiting in the queue
+    for (std::pair<const uint64_t, std::coroutine_handle<>>& root : _roots) {
+        root.second.destroy();
+    }
+}
+
+void EventLoop::spawn(VirtualDevice& device, Task<void> task) {
+    uint64_t id = _nextRoot++;
+    std::coroutine_handle<> handle = root(std::move(task), id).detach();
+    _roots.emplace(id, handle);
+    _queue.push(Wake{device.nowNs(), _sequence++, &device, handle});
+}
+
+uint64_t EventLoop::run(uint64_t untilNs) {
+    EventLoop* previous = currentLoop;
+    currentLoop = this;
+
+    uint64_t resumes = 0;
+    while (!_queue.empty() && _queue.top().timeNs < untilNs) {
+        Wake wake = _queue.top();
+        _queue.pop();
+
+        VirtualDevice::Scope scope(*wake.device);
+        if (wake.timeNs > wake.device->nowNs()) {
+            wake.device->advanceTo(wake.timeNs);
+        }
+        wake.handle.resume();
+        resumes++;
+    }
+
+    currentLoop = previous;
+    return resumes;
+}
+
+void EventLoop::wakeAt(uint64_t wakeNs, std::coroutine_handle<> handle) {
+    _queue.push(Wake{wakeNs, _sequence++, &VirtualDevice::current(), handle});
+}
+
+EventLoop& EventLoop::current() {
+    assert(currentLoop != nullptr && "awaiting outside EventLoop::run()");
+    return *currentLoop;
+}
+
+Task<void> EventLoop::root(Task<void> task, uint64_t id) {
+    co_await task;
+    _roots.erase(id);
+}
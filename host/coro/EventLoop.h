@@ -0,0 +1,163 @@
+/**
+ * @file EventLoop.h
+ * @brief Runs coroutine sessions on their virtual devices in time order
+ * @author catalina
+ */
+
+#ifndef HOST_CORO_EVENT_LOOP_H
+#define HOST_CORO_EVENT_LOOP_H
+
+#include <VirtualDevice.h>
+
+#include "Task.h"
+
+#include <stdint.h>
+#include <coroutine>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class EventLoop
+ * @brief Single-threaded scheduler of coroutines waiting on virtual time
+ *
+ * A coroutine waits by awaiting waitMs(), waitUs() or waitEdge(); the
+ * awaitable works out from the current device when the wait ends and
+ * parks the coroutine here. run() resumes parked coroutines earliest wake
+ * first, each with its own device made current and advanced to the wake
+ * time, so any number of sessions, each with its own device, can be
+ * interleaved on one thread. Sessions on different devices never see each
+ * other; coroutines sharing a device share its clock.
+ *
+ * A suspended session costs its coroutine frames (see FrameStats) and a
+ * queue entry; nothing blocks while it waits.
+ */
+class EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * @brief Start a task on a device at the device's current time
+     *
+     * The loop owns the task from here; it is destroyed when it finishes,
+     * or with the loop if it never does.
+     *
+     * @param device Device the task runs on (must outlive the task)
+     * @param task Task to run
+     */
+    void spawn(VirtualDevice& device, Task<void> task);
+
+    /**
+     * @brief Resume waiting coroutines in wake order
+     * @param untilNs Stop before the first wake at or after this virtual time
+     * @return Number of resumptions
+     */
+    uint64_t run(uint64_t untilNs = SignalSource::NEVER);
+
+    /**
+     * @brief Get the number of spawned tasks that have not finished
+     */
+    size_t running() const { return _roots.size(); }
+
+    /**
+     * @brief Park the calling coroutine until its device reaches a time
+     *
+     * Used by the awaitables; the device is the one current on this thread.
+     *
+     * @param wakeNs Virtual time to resume at
+     * @param handle Coroutine to resume
+     */
+    void wakeAt(uint64_t wakeNs, std::coroutine_handle<> handle);
+
+    /**
+     * @brief Get the loop running the calling coroutine
+     */
+    static EventLoop& current();
+
+private:
+    struct Wake {
+        uint64_t timeNs;
+        uint64_t sequence;      // Keeps equal wake times in FIFO order
+        VirtualDevice* device;
+        std::coroutine_handle<> handle;
+
+        bool operator>(const Wake& other) const {
+            return timeNs != other.timeNs ? timeNs > other.timeNs : sequence > other.sequence;
+        }
+    };
+
+    std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> _queue;
+    std::unordered_map<uint64_t, std::coroutine_handle<>> _roots;
+    uint64_t _sequence;
+    uint64_t _nextRoot;
+
+    Task<void> root(Task<void> task, uint64_t id);
+};
+
+/**
+ * @brief Awaitable that resumes after a stretch of virtual time
+ */
+class TimeWait {
+public:
+    explicit TimeWait(uint64_t durationNs) : _durationNs(durationNs) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        EventLoop::current().wakeAt(VirtualDevice::current().nowNs() + _durationNs, handle);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    uint64_t _durationNs;
+};
+
+/**
+ * @brief Awaitable that resumes at the next matching edge of an input pin
+ *
+ * The edge is looked up when the coroutine suspends, so pin writes made
+ * by other coroutines of the same device during the wait are not seen.
+ * The result is the edge time in ns, which stays exact even when another
+ * coroutine held the device past it, or SignalSource::NEVER on timeout.
+ */
+class EdgeWait {
+public:
+    EdgeWait(uint8_t pin, int mode, unsigned long timeoutUs)
+        : _pin(pin), _mode(mode), _timeoutUs(timeoutUs), _edgeNs(SignalSource::NEVER) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        VirtualDevice& device = VirtualDevice::current();
+        uint64_t deadline = device.nowNs() + static_cast<uint64_t>(_timeoutUs) * 1000;
+        _edgeNs = device.findEdge(_pin, _mode, device.nowNs(), deadline);
+        EventLoop::current().wakeAt(_edgeNs != SignalSource::NEVER ? _edgeNs : deadline, handle);
+    }
+
+    uint64_t await_resume() const noexcept { return _edgeNs; }
+
+private:
+    uint8_t _pin;
+    int _mode;
+    unsigned long _timeoutUs;
+    uint64_t _edgeNs;
+};
+
+inline TimeWait waitMs(unsigned long ms) {
+    return TimeWait(static_cast<uint64_t>(ms) * 1000000);
+}
+
+inline TimeWait waitUs(unsigned long us) {
+    return TimeWait(static_cast<uint64_t>(us) * 1000);
+}
+
+inline EdgeWait waitEdge(uint8_t pin, int mode, unsigned long timeoutUs) {
+    return EdgeWait(pin, mode, timeoutUs);
+}
+
+#endif // HOST_CORO_EVENT_LOOP_H
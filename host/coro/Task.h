@@ -0,0 +1,178 @@
+/**
+ * @file Task.h
+ * @brief Lazy C++20 coroutine returning a value to the coroutine awaiting it
+ * @author catalina
+ */
+
+#ifndef HOST_CORO_TASK_H
+#define HOST_CORO_TASK_H
+
+#include <stddef.h>
+#include <coroutine>
+#include <exception>
+#include <new>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Bytes held by coroutine frames on the calling thread
+ *
+ * Every Task frame is counted while it exists, so a tool can report what
+ * its suspended sessions cost in memory.
+ */
+struct FrameStats {
+    size_t liveBytes = 0;
+    size_t liveFrames = 0;
+    size_t peakBytes = 0;
+
+    static FrameStats& current();
+};
+
+template <typename T>
+class Task;
+
+// State shared by every Task promise, whatever the result type
+class TaskPromiseBase {
+public:
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            TaskPromiseBase& promise = handle.promise();
+            if (promise._continuation) {
+                return promise._continuation;
+            }
+            if (promise._detached) {
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { std::terminate(); }
+
+    void setContinuation(std::coroutine_handle<> continuation) { _continuation = continuation; }
+    void detach() { _detached = true; }
+
+    static void* operator new(size_t size) {
+        FrameStats& stats = FrameStats::current();
+        stats.liveBytes += size;
+        stats.liveFrames++;
+        if (stats.liveBytes > stats.peakBytes) {
+            stats.peakBytes = stats.liveBytes;
+        }
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* frame, size_t size) {
+        FrameStats& stats = FrameStats::current();
+        stats.liveBytes -= size;
+        stats.liveFrames--;
+        ::operator delete(frame);
+    }
+
+private:
+    std::coroutine_handle<> _continuation;
+    bool _detached = false;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    Task<T> get_return_object();
+
+    void return_value(T value) { _value.emplace(std::move(value)); }
+    T takeValue() { return std::move(*_value); }
+
+private:
+    std::optional<T> _value;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object();
+
+    void return_void() {}
+    void takeValue() {}
+};
+
+/**
+ * @class Task
+ * @brief Coroutine that starts when awaited and resumes its awaiter when done
+ *
+ * `co_await task` runs the task until it suspends and returns its result
+ * once it has finished; control passes straight back to the awaiting
+ * coroutine (symmetric transfer), so chains of awaits do not grow the
+ * stack. A task that is never awaited is destroyed unstarted, and one
+ * handed to EventLoop::spawn() runs on its own and frees itself.
+ *
+ * @tparam T Result type (void for none)
+ */
+template <typename T = void>
+class Task {
+public:
+    typedef TaskPromise<T> promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+    Task(Task&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (_handle) {
+                _handle.destroy();
+            }
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (_handle) {
+            _handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        _handle.promise().setContinuation(awaiter);
+        return _handle;
+    }
+
+    T await_resume() { return _handle.promise().takeValue(); }
+
+    /**
+     * @brief Give up ownership: the task destroys itself when it finishes
+     * @return Handle to start the task with
+     */
+    std::coroutine_handle<> detach() {
+        _handle.promise().detach();
+        return std::exchange(_handle, nullptr);
+    }
+
+private:
+    std::coroutine_handle<promise_type> _handle;
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+#endif // HOST_CORO_TASK_H
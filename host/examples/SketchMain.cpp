@@ -0,0 +1,159 @@
+/**
+ * @file SketchMain.cpp
+ * @brief Runs an example sketch on the virtual-time host HAL
+ * @author catalina
+ *
+ * The sketch named by SKETCH_SOURCE is compiled into this file. The
+ * simulated HC-SR04 and TCS230 are attached to the default pins, setup()
+ * runs once and loop() runs the requested number of times, after which
+ * the virtual and host run times are reported.
+ */
+
+#include <Arduino.h>
+#include <VirtualDevice.h>
+
+#include "../sim/SimScene.h"
+#include "../sim/HcSr04Model.h"
+#include "../sim/Tcs230Model.h"
+
+#include SKETCH_SOURCE
+
+#include <Profiler.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+    // LOW time of the dark scene's TCS230 output: a few Hz, as from a black surface
+    const float DARK_PULSE_US = 60000.0f;
+
+    void printUsage(const char* program) {
+        printf("Usage: %s [--loops N] [--scene demo|white|empty|dark] [--echo] [--profile] [--serial FILE] [--input TEXT]\n", program);
+    }
+
+    // Print adapter writing straight to the host's stdout
+    class StdoutPrint : public Print {
+    public:
+        size_t write(uint8_t value) override {
+            return fputc(value, stdout) == EOF ? 0 : 1;
+        }
+        using Print::write;
+    };
+}
+
+int main(int argc, char** argv) {
+    unsigned long loops = 1000;
+    bool echo = false;
+    const char* sceneName = "demo";
+    bool profile = false;
+    const char* serialPath = nullptr;
+    const char* input = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loops = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            sceneName = argv[++i];
+        } else if (strcmp(argv[i], "--echo") == 0) {
+            echo = true;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "--serial") == 0 && i + 1 < argc) {
+            serialPath = argv[++i];
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            input = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    SimScene scene = SimScene::demo();
+    if (strcmp(sceneName, "white") == 0) {
+        scene = SimScene();
+        scene.hold(1000, 3.0f, 1.0f, 1.0f, 1.0f);
+        scene.hold(1000, 3.0f, 0.2f, 0.2f, 0.2f);
+    } else if (strcmp(sceneName, "empty") == 0) {
+        // Nothing in front of the sensors, as on an idle line
+        scene = SimScene();
+        scene.empty(1000);
+    } else if (strcmp(sceneName, "dark") == 0) {
+        // A black object stops in front of the sensors for a while
+        scene = SimScene();
+        scene.empty(5000);
+        scene.hold(30000, 5.0f, 0.0f, 0.0f, 0.0f);
+        scene.empty(25000);
+    }
+
+    VirtualDevice& device = VirtualDevice::current();
+    HcSr04Model echoModel(scene);
+    Tcs230Model colorModel(scene);
+    if (strcmp(sceneName, "dark") == 0) {
+        colorModel.setDarkPulse(DARK_PULSE_US);
+    }
+    echoModel.attach(device);
+    colorModel.attach(device);
+
+    device.setSerialCapture(serialPath != nullptr);
+    if (input != nullptr) {
+        device.injectSerialInput(input);
+    }
+    if (echo) {
+        device.setSerialEcho(stdout);
+    }
+
+    std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+
+    setup();
+    for (unsigned long i = 0; i < loops; i++) {
+        loop();
+    }
+
+    double hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - hostStart).count();
+    double virtualSeconds = device.nowNs() / 1e9;
+    const DeviceStats& stats = device.stats();
+
+    printf("\nloops:            %lu\n", loops);
+    printf("virtual time:     %.3f s\n", virtualSeconds);
+    printf("host time:        %.3f s\n", hostSeconds);
+    printf("speedup:          %.0fx\n", hostSeconds > 0.0 ? virtualSeconds / hostSeconds : 0.0);
+    printf("pulseIn calls:    %llu (%llu timeouts)\n",
+           static_cast<unsigned long long>(stats.pulseInCalls),
+           static_cast<unsigned long long>(stats.pulseInTimeouts));
+    printf("i2c bytes:        %llu\n", static_cast<unsigned long long>(stats.i2cBytes));
+    printf("serial bytes:     %llu\n", static_cast<unsigned long long>(stats.serialBytes));
+    if (stats.sleeps > 0) {
+        printf("sleep:            %llu (%.3f s idle, %.3f s power-down, %.1f%% awake)\n",
+               static_cast<unsigned long long>(stats.sleeps), stats.idleSleepNs / 1e9,
+               stats.powerDownNs / 1e9,
+               device.nowNs() > 0
+                   ? 100.0 * (device.nowNs() - stats.idleSleepNs - stats.powerDownNs) / device.nowNs()
+                   : 0.0);
+    }
+
+    const LcdPanel* panel = device.findLcd(0x27);
+    if (panel != nullptr) {
+        for (size_t row = 0; row < panel->lines.size(); row++) {
+            printf("lcd[%zu]:           |%s|\n", row, panel->lines[row].c_str());
+        }
+    }
+
+    if (serialPath != nullptr) {
+        FILE* capture = fopen(serialPath, "wb");
+        if (capture == nullptr) {
+            fprintf(stderr, "cannot write %s\n", serialPath);
+            return 1;
+        }
+        fwrite(device.serialOutput().data(), 1, device.serialOutput().size(), capture);
+        fclose(capture);
+    }
+
+    if (profile) {
+        StdoutPrint out;
+        printf("\nstage timings (us, log2 buckets):\n");
+        Profiler::dump(out);
+    }
+
+    return 0;
+}
@@ -0,0 +1,458 @@
+/**
+ * @file FleetUnit.cpp
+ * @brief One complete detector unit in its own virtual device
+ * @author catalina
+ */
+
+#include "FleetUnit.h"
+
+#include <PitchesDefinitions.h>
+#include <SensorTrace.h>
+
+#include <random>
+
+namespace {
+    // Same timing as the ColorDistanceSystem example
+    const unsigned long DISTANCE_PERIOD = 100;   // ms
+    const unsigned long PIPELINE_PERIOD = 5;     // ms
+    const unsigned long DISPLAY_PERIOD = 250;    // ms
+    const unsigned long LED_PERIOD = 20;         // ms
+    const unsigned long AUDIO_PERIOD = 10;       // ms
+    const unsigned long BANNER_TIME = 1000;      // ms
+    const unsigned long NO_ECHO_WIDTH = 30000;   // µs
+    const unsigned long EFFECT_DEADLINE = 100;   // ms
+    const unsigned long PIPELINE_DEADLINE = 100; // ms
+
+    const uint16_t DETECTION_MELODY[] = {
+        Notes::NOTE_C4, Notes::NOTE_G3, Notes::NOTE_G3, Notes::NOTE_A3,
+        Notes::NOTE_G3, 0, Notes::NOTE_B3, Notes::NOTE_C4
+    };
+
+    const uint8_t DETECTION_DURATIONS[] = {
+        4, 8, 8, 4, 4, 4, 4, 4
+    };
+
+    // Reflectances of the objects on the line
+    const float OBJECT_COLORS[][3] = {
+        { 0.9f, 0.15f, 0.1f },
+        { 0.1f, 0.85f, 0.2f },
+        { 0.1f, 0.2f, 0.9f }
+    };
+
+    // Unit whose callbacks the scheduler on this thread is running
+    thread_local FleetUnit* activeUnit = nullptr;
+
+    /**
+     * Makes a unit and its device current for the calling thread
+     */
+    class ActiveScope {
+    public:
+        ActiveScope(FleetUnit* unit, VirtualDevice& device)
+            : _previous(activeUnit),
+              _device(device) {
+            activeUnit = unit;
+        }
+
+        ~ActiveScope() {
+            activeUnit = _previous;
+        }
+
+    private:
+        FleetUnit* _previous;
+        VirtualDevice::Scope _device;
+    };
+}
+
+void FleetStats::add(const FleetStats& other) {
+    loops += other.loops;
+    pings += other.pings;
+    colorSamples += other.colorSamples;
+    records += other.records;
+    droppedRecords += other.droppedRecords;
+    modeChanges += other.modeChanges;
+    overruns += other.overruns;
+    serialBytes += other.serialBytes;
+    i2cBytes += other.i2cBytes;
+    virtualSeconds += other.virtualSeconds;
+}
+
+FleetUnit::FleetUnit(uint32_t id)
+    : _id(id),
+      _scene(scriptedScene(id)),
+      _echoModel(_scene),
+      _colorModel(_scene),
+      _telemetry(Serial),
+      _output(_display, _leds, _audio),
+      _pipeline(_distanceSensor, _colorSensor),
+      _proximity(_distanceSensor),
+      _power(_display, &_colorSensor),
+      _currentMode(DISTANCE_MODE),
+      _distanceTask(0),
+      _pipelineTask(0),
+      _displayTask(0),
+      _ledTask(0),
+      _audioTask(0),
+      _loadTask(0),
+      _lastDistance(0.0f),
+      _sceneEmpty(true),
+      _lastActivity(0),
+      _red(0),
+      _green(0),
+      _blue(0),
+      _detectedColor(ColorIdentifier::NONE),
+      _colorValid(false),
+      _overrunPending(false) {
+    _echoModel.setNoise(8.0f, id + 1);
+    _colorModel.setNoise(0.02f, id + 1);
+    _echoModel.attach(_device);
+    _colorModel.attach(_device);
+    _device.rng().seed(id + 1);
+    _device.setSerialCapture(false);
+}
+
+void FleetUnit::run(uint32_t durationMs) {
+    ActiveScope scope(this, _device);
+    uint64_t endNs = static_cast<uint64_t>(durationMs) * 1000000ULL;
+
+    setup();
+    while (_device.nowNs() < endNs) {
+        loop();
+        _stats.loops++;
+    }
+
+    const DeviceStats& device = _device.stats();
+    _stats.serialBytes = device.serialBytes;
+    _stats.i2cBytes = device.i2cBytes;
+    _stats.virtualSeconds = _device.nowNs() / 1e9;
+}
+
+SimScene FleetUnit::scriptedScene(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> gap(1000, 4000);
+    std::uniform_int_distribution<uint32_t> approach(1500, 4000);
+    std::uniform_int_distribution<uint32_t> dwell(2000, 8000);
+    std::uniform_int_distribution<uint32_t> pick(0, 2);
+    std::uniform_real_distribution<float> far(40.0f, 120.0f);
+    std::uniform_real_distribution<float> near(3.0f, 8.0f);
+    std::uniform_real_distribution<float> shade(-0.05f, 0.05f);
+
+    // A minute of objects; the timeline repeats for longer runs
+    SimScene scene;
+    for (uint32_t elapsed = 0; elapsed < 60000;) {
+        const float* color = OBJECT_COLORS[pick(rng)];
+        float red = color[0] + shade(rng);
+        float green = color[1] + shade(rng);
+        float blue = color[2] + shade(rng);
+        float start = far(rng);
+        float stop = near(rng);
+
+        uint32_t empty = gap(rng);
+        uint32_t in = approach(rng);
+        uint32_t hold = dwell(rng);
+        uint32_t out = approach(rng) / 2;
+
+        scene.empty(empty);
+        scene.addSegment(in, start, stop, red, green, blue);
+        scene.hold(hold, stop, red, green, blue);
+        scene.addSegment(out, stop, far(rng), red, green, blue);
+        elapsed += empty + in + hold + out;
+    }
+    return scene;
+}
+
+void FleetUnit::setup() {
+    Serial.begin(9600);
+    Serial.println(F("Color and Distance Detection System"));
+
+    _colorSensor.begin();
+    _distanceSensor.begin();
+    _display.begin();
+    _audio.begin();
+    _leds.begin();
+
+    _distanceSensor.calibrateForTemperature(22.0);
+
+    _display.displayMessage(TextId::SYSTEM_STARTING, 0, true);
+    _display.displayMessage(TextId::PLEASE_WAIT, 1, true);
+
+    _colorSensor.setCalibration(
+        CalibrationSettings::ColorSensor::RED_MIN,
+        CalibrationSettings::ColorSensor::RED_MAX,
+        CalibrationSettings::ColorSensor::GREEN_MIN,
+        CalibrationSettings::ColorSensor::GREEN_MAX,
+        CalibrationSettings::ColorSensor::BLUE_MIN,
+        CalibrationSettings::ColorSensor::BLUE_MAX
+    );
+
+    _leds.blinkLed(ColorIdentifier::RED, 1);
+    _leds.blinkLed(ColorIdentifier::GREEN, 1);
+    _leds.blinkLed(ColorIdentifier::NONE, 1);
+    _audio.playSuccessSound();
+
+    delay(1000);
+    _display.clear();
+    _display.displayMessage(TextId::READY, 0, true);
+    delay(1000);
+
+    // Nothing sends a unit serial input, so the command task is left out
+    _distanceTask = _scheduler.addTask(sampleDistanceTask, DISTANCE_PERIOD);
+    _pipelineTask = _scheduler.addTask(runPipelineTask, PIPELINE_PERIOD, PIPELINE_DEADLINE);
+    _displayTask = _scheduler.addTask(refreshDisplayTask, DISPLAY_PERIOD);
+    _ledTask = _scheduler.addTask(updateLedsTask, LED_PERIOD, EFFECT_DEADLINE);
+    _audioTask = _scheduler.addTask(updateAudioTask, AUDIO_PERIOD, EFFECT_DEADLINE);
+    _loadTask = _scheduler.addTask(checkLoadTask, LoadSettings::WINDOW);
+    _scheduler.setOverrunCallback(overrun);
+
+    _output.setDetectionMelody(DETECTION_MELODY, DETECTION_DURATIONS,
+                               sizeof(DETECTION_MELODY) / sizeof(DETECTION_MELODY[0]));
+
+    _scheduler.disableTask(_pipelineTask);
+
+    _proximity.setEventCallback(proximityEvent);
+    _pipeline.setColorRange(SystemSettings::PROXIMITY_EXIT_THRESHOLD);
+
+    _power.begin();
+    _load.setLevelCallback(loadLevel);
+    _load.begin();
+    _lastActivity = millis();
+}
+
+void FleetUnit::loop() {
+    SensorTrace::flush();
+    _telemetry.pump();
+    if (_scheduler.run()) {
+        _load.recordLateness(_scheduler.getLastLateness());
+    } else {
+        _power.sleep(_scheduler.getIdleTime(), isBusy());
+    }
+}
+
+bool FleetUnit::isBusy() {
+    return _currentMode == COLOR_MODE || _telemetry.getPendingBytes() > 0 ||
+           _distanceSensor.isPingActive() ||
+           _audio.isPlaying() || _leds.isEffectActive() || _leds.isModulating();
+}
+
+void FleetUnit::onProximityEvent(ProximityEvent event) {
+    if (event == ProximityEvent::ARRIVED && _currentMode == DISTANCE_MODE) {
+        enterColorMode();
+    } else if (event == ProximityEvent::LEFT && _currentMode == COLOR_MODE) {
+        leaveColorMode();
+    }
+}
+
+void FleetUnit::enterColorMode() {
+    leaveStandby();
+
+    showBanner(TextId::OBJECT_DETECTED, TextId::CHECKING_COLOR);
+    _output.showMessage(TextId::COLOR_MODE, TextId::READING);
+    _output.pulseLed(ColorIdentifier::GREEN, 2);
+
+    _currentMode = COLOR_MODE;
+    _stats.modeChanges++;
+    startPipeline();
+}
+
+void FleetUnit::leaveColorMode() {
+    showBanner(TextId::OBJECT_LEFT, TextId::DISTANCE_MODE);
+    _output.clearColor();
+
+    _currentMode = DISTANCE_MODE;
+    _stats.modeChanges++;
+    _colorValid = false;
+    _pipeline.stop();
+    _scheduler.disableTask(_pipelineTask);
+    _scheduler.enableTask(_distanceTask, DISTANCE_PERIOD);
+}
+
+void FleetUnit::startPipeline() {
+    _colorValid = false;
+    _pipeline.reset(BANNER_TIME);
+    _scheduler.disableTask(_distanceTask);
+    _scheduler.enableTask(_pipelineTask);
+}
+
+void FleetUnit::showBanner(TextId top, TextId bottom) {
+    _output.showBanner(top, bottom, BANNER_TIME);
+    _scheduler.enableTask(_displayTask);
+}
+
+void FleetUnit::sampleDistance() {
+    _proximity.poll();
+    _stats.pings++;
+    updateDistance(_proximity.getLastDistance());
+    updateStandby();
+    sendTelemetry();
+}
+
+void FleetUnit::updateStandby() {
+    if (_currentMode == COLOR_MODE || (!_sceneEmpty && _lastDistance < PowerSettings::STANDBY_RANGE)) {
+        _lastActivity = millis();
+        leaveStandby();
+    } else if (!_power.isStandby() && millis() - _lastActivity >= PowerSettings::STANDBY_DELAY) {
+        enterStandby();
+    }
+}
+
+void FleetUnit::enterStandby() {
+    _power.setStandby(true);
+    _scheduler.setTaskPeriod(_distanceTask, PowerSettings::STANDBY_PERIOD);
+    _scheduler.disableTask(_displayTask);
+    _scheduler.disableTask(_ledTask);
+    _scheduler.disableTask(_audioTask);
+}
+
+void FleetUnit::leaveStandby() {
+    if (!_power.isStandby()) {
+        return;
+    }
+    _power.setStandby(false);
+    _scheduler.setTaskPeriod(_distanceTask, DISTANCE_PERIOD);
+    _scheduler.enableTask(_distanceTask, DISTANCE_PERIOD);
+    _scheduler.enableTask(_displayTask);
+    _scheduler.enableTask(_ledTask);
+    _scheduler.enableTask(_audioTask);
+}
+
+void FleetUnit::runPipeline() {
+    uint8_t events = _pipeline.update();
+
+    if (events & AcquisitionPipeline::PING_READY) {
+        _stats.pings++;
+        updateDistance(_pipeline.getLastDistance());
+        _proximity.update(_lastDistance);
+        sendTelemetry();
+    }
+
+    if (events & AcquisitionPipeline::SAMPLE_READY) {
+        _stats.colorSamples++;
+        handleColorSample(_pipeline.getSample());
+    }
+}
+
+void FleetUnit::updateDistance(float distance) {
+    unsigned long echo = _distanceSensor.getLastPulseDuration();
+    bool empty = echo == 0 || echo > NO_ECHO_WIDTH;
+
+    if (_currentMode == DISTANCE_MODE) {
+        if (empty) {
+            _output.showMessage(TextId::DISTANCE_MODE, TextId::NO_OBJECT);
+        } else {
+            _output.showDistance(distance);
+        }
+    }
+
+    _sceneEmpty = empty;
+    _lastDistance = distance;
+}
+
+void FleetUnit::handleColorSample(const FusedSample& sample) {
+    bool inRange = sample.echoes > 0 && sample.distance <= SystemSettings::PROXIMITY_EXIT_THRESHOLD;
+    if (!inRange || !_proximity.isObjectPresent()) {
+        _colorValid = false;
+        return;
+    }
+
+    _red = sample.red;
+    _green = sample.green;
+    _blue = sample.blue;
+    _detectedColor = sample.colorId;
+    _colorValid = true;
+
+    _output.showColor(_detectedColor, _red, _green, _blue);
+
+    sendTelemetry();
+}
+
+void FleetUnit::sendTelemetry() {
+    TelemetryRecord record = {};
+    record.timestamp = millis();
+    unsigned long echo = _distanceSensor.getLastPulseDuration();
+    record.echoDuration = echo > 0xFFFF ? 0xFFFF : echo;
+    record.distance = constrain(_lastDistance * 10.0, 0, 0xFFFF);
+
+    if (_proximity.isObjectPresent()) {
+        record.status |= Telemetry::STATUS_OBJECT_IN_RANGE;
+    }
+    if (echo == 0 || echo > NO_ECHO_WIDTH) {
+        record.status |= Telemetry::STATUS_NO_ECHO;
+    }
+    if (_currentMode == COLOR_MODE) {
+        record.status |= Telemetry::STATUS_COLOR_MODE;
+        if (_colorValid) {
+            record.status |= Telemetry::STATUS_COLOR_VALID;
+            record.red = constrain(_red, 0, 255);
+            record.green = constrain(_green, 0, 255);
+            record.blue = constrain(_blue, 0, 255);
+            record.colorId = static_cast<uint8_t>(_detectedColor);
+        }
+    }
+    if (_load.getLevel() != LoadLevel::NORMAL) {
+        record.status |= Telemetry::STATUS_LOAD_SHED;
+    }
+    if (_overrunPending) {
+        record.status |= Telemetry::STATUS_OVERRUN;
+        _overrunPending = false;
+    }
+
+    Telemetry::captureStageTimings(record);
+    if (_telemetry.send(record)) {
+        _stats.records++;
+    } else {
+        _stats.droppedRecords++;
+    }
+}
+
+void FleetUnit::applyLoadLevel(LoadLevel level) {
+    unsigned long displayPeriod = DISPLAY_PERIOD;
+    if (level >= LoadLevel::SLOW_DISPLAY) {
+        displayPeriod *= LoadSettings::DISPLAY_SLOWDOWN;
+    }
+    _scheduler.setTaskPeriod(_displayTask, displayPeriod);
+
+    _leds.setEffectsEnabled(level < LoadLevel::NO_LED_EFFECTS);
+    _audio.setNoteLimit(level >= LoadLevel::BEEP_ONLY ? 1 : 0);
+
+    unsigned long channelInterval = SystemSettings::SENSOR_STABILIZATION_DELAY;
+    if (level >= LoadLevel::REDUCED_COLOR) {
+        channelInterval *= LoadSettings::COLOR_SLOWDOWN;
+    }
+    _pipeline.setChannelInterval(channelInterval);
+}
+
+void FleetUnit::sampleDistanceTask() {
+    activeUnit->sampleDistance();
+}
+
+void FleetUnit::runPipelineTask() {
+    activeUnit->runPipeline();
+}
+
+void FleetUnit::refreshDisplayTask() {
+    activeUnit->_output.render();
+}
+
+void FleetUnit::updateLedsTask() {
+    activeUnit->_leds.update();
+}
+
+void FleetUnit::updateAudioTask() {
+    activeUnit->_audio.update();
+}
+
+void FleetUnit::checkLoadTask() {
+    activeUnit->_load.update();
+}
+
+void FleetUnit::loadLevel(LoadLevel level) {
+    activeUnit->applyLoadLevel(level);
+}
+
+void FleetUnit::proximityEvent(ProximityEvent event, float) {
+    activeUnit->onProximityEvent(event);
+}
+
+void FleetUnit::overrun(uint8_t, unsigned long) {
+    activeUnit->_stats.overruns++;
+    activeUnit->_overrunPending = true;
+}
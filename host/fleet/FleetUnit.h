@@ -0,0 +1,176 @@
+/**
+ * @file FleetUnit.h
+ * @brief One complete detector unit in its own virtual device
+ * @author catalina
+ */
+
+#ifndef HOST_FLEET_UNIT_H
+#define HOST_FLEET_UNIT_H
+
+#include <VirtualDevice.h>
+
+#include "../sim/SimScene.h"
+#include "../sim/HcSr04Model.h"
+#include "../sim/Tcs230Model.h"
+
+#include <ColorSensor.h>
+#include <DistanceSensor.h>
+#include <AcquisitionPipeline.h>
+#include <ProximityMonitor.h>
+#include <DisplayManager.h>
+#include <AudioManager.h>
+#include <LedManager.h>
+#include <LoadMonitor.h>
+#include <OutputStage.h>
+#include <PowerManager.h>
+#include <Scheduler.h>
+#include <Telemetry.h>
+
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief What one unit did during a run
+ */
+struct FleetStats {
+    uint64_t loops = 0;
+    uint64_t pings = 0;             // Distance readings
+    uint64_t colorSamples = 0;      // Fused color samples
+    uint64_t records = 0;           // Telemetry records queued
+    uint64_t droppedRecords = 0;    // Telemetry records lost to a full buffer
+    uint64_t modeChanges = 0;
+    uint64_t overruns = 0;
+    uint64_t serialBytes = 0;
+    uint64_t i2cBytes = 0;
+    double virtualSeconds = 0.0;
+
+    uint64_t samples() const { return pings + colorSamples; }
+    void add(const FleetStats& other);
+};
+
+/**
+ * @class FleetUnit
+ * @brief The ColorDistanceSystem example as an object
+ *
+ * A sketch keeps its components and state in globals, so two copies of it
+ * cannot share a process. A unit owns a virtual device, a scene with its
+ * sensor models, every component of the example and the example's loop
+ * state, and runs the same setup(), loop() and task steps on them.
+ *
+ * The drivers keep their interrupt state per thread and the scheduler
+ * takes plain function pointers, so run() must execute a whole run on one
+ * thread; different units may run on different threads at the same time.
+ * Constructing a unit touches no hardware and may happen anywhere.
+ */
+class FleetUnit {
+public:
+    /**
+     * @brief Constructor
+     * @param id Unit number, also the seed of its scene and sensor noise
+     */
+    explicit FleetUnit(uint32_t id);
+
+    FleetUnit(const FleetUnit&) = delete;
+    FleetUnit& operator=(const FleetUnit&) = delete;
+
+    /**
+     * @brief Run setup() and then loop() until the virtual clock reaches the duration
+     * @param durationMs Virtual run time in ms, including setup()
+     */
+    void run(uint32_t durationMs);
+
+    /**
+     * @brief Choose whether the serial output is kept for serialOutput()
+     */
+    void setSerialCapture(bool capture) { _device.setSerialCapture(capture); }
+
+    const std::string& serialOutput() { return _device.serialOutput(); }
+    const FleetStats& getStats() const { return _stats; }
+    uint32_t getId() const { return _id; }
+
+    /**
+     * @brief Objects of random color, distance and timing passing by
+     *
+     * Every seed gives a different, repeatable scene, so units of one
+     * fleet do not switch modes in lockstep.
+     *
+     * @param seed Scene seed
+     */
+    static SimScene scriptedScene(uint32_t seed);
+
+private:
+    enum SystemMode {
+        DISTANCE_MODE,
+        COLOR_MODE
+    };
+
+    uint32_t _id;
+    VirtualDevice _device;
+    SimScene _scene;
+    HcSr04Model _echoModel;
+    Tcs230Model _colorModel;
+
+    ColorSensor _colorSensor;
+    DistanceSensor _distanceSensor;
+    DisplayManager _display;
+    AudioManager _audio;
+    LedManager _leds;
+    Scheduler _scheduler;
+    Telemetry _telemetry;
+    OutputStage _output;
+    AcquisitionPipeline _pipeline;
+    ProximityMonitor _proximity;
+    PowerManager _power;
+    LoadMonitor _load;
+
+    SystemMode _currentMode;
+    uint8_t _distanceTask;
+    uint8_t _pipelineTask;
+    uint8_t _displayTask;
+    uint8_t _ledTask;
+    uint8_t _audioTask;
+    uint8_t _loadTask;
+    float _lastDistance;
+    bool _sceneEmpty;
+    unsigned long _lastActivity;
+    int _red;
+    int _green;
+    int _blue;
+    ColorIdentifier _detectedColor;
+    bool _colorValid;
+    bool _overrunPending;
+
+    FleetStats _stats;
+
+    // Example logic, one method per sketch function
+    void setup();
+    void loop();
+    void onProximityEvent(ProximityEvent event);
+    void enterColorMode();
+    void leaveColorMode();
+    void startPipeline();
+    void showBanner(TextId top, TextId bottom);
+    void sampleDistance();
+    void runPipeline();
+    void updateDistance(float distance);
+    void updateStandby();
+    void enterStandby();
+    void leaveStandby();
+    bool isBusy();
+    void handleColorSample(const FusedSample& sample);
+    void sendTelemetry();
+    void applyLoadLevel(LoadLevel level);
+
+    // Scheduler and monitor callbacks, forwarded to the unit being run
+    static void sampleDistanceTask();
+    static void runPipelineTask();
+    static void refreshDisplayTask();
+    static void updateLedsTask();
+    static void updateAudioTask();
+    static void checkLoadTask();
+    static void loadLevel(LoadLevel level);
+    static void proximityEvent(ProximityEvent event, float distance);
+    static void overrun(uint8_t taskId, unsigned long lateness);
+};
+
+#endif // HOST_FLEET_UNIT_H
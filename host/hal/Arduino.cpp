@@ -0,0 +1,96 @@
+/**
+ * @file Arduino.cpp
+ * @brief Host-side Arduino core API routed to the current VirtualDevice
+ * @author catalina
+ */
+
+#include <Arduino.h>
+#include "VirtualDevice.h"
+
+unsigned long millis() {
+    return VirtualDevice::current().pollMillis();
+}
+
+unsigned long micros() {
+    VirtualDevice& device = VirtualDevice::current();
+    device.spend(device.costs().microsNs);
+    return static_cast<unsigned long>(device.nowNs() / 1000);
+}
+
+void delay(unsigned long ms) {
+    VirtualDevice& device = VirtualDevice::current();
+    uint64_t ns = static_cast<uint64_t>(ms) * 1000000;
+    device.stats().delayNs += ns;
+    device.spend(ns);
+}
+
+void delayMicroseconds(unsigned int us) {
+    VirtualDevice& device = VirtualDevice::current();
+    uint64_t ns = static_cast<uint64_t>(us) * 1000;
+    device.stats().delayNs += ns;
+    device.spend(ns);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    VirtualDevice::current().setPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    VirtualDevice::current().writePin(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+    return VirtualDevice::current().readPin(pin);
+}
+
+void analogWrite(uint8_t pin, int value) {
+    VirtualDevice::current().writeAnalog(pin, value);
+}
+
+int analogRead(uint8_t pin) {
+    return VirtualDevice::current().readAnalog(pin);
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout) {
+    return VirtualDevice::current().measurePulse(pin, state, timeout);
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+    VirtualDevice::current().startTone(pin, frequency, duration);
+}
+
+void noTone(uint8_t pin) {
+    VirtualDevice::current().stopTone(pin);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*isr)(), int mode) {
+    VirtualDevice::current().attachIsr(interruptNum, isr, mode);
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+    VirtualDevice::current().detachIsr(interruptNum);
+}
+
+void interrupts() {
+    VirtualDevice::current().setInterruptsEnabled(true);
+}
+
+void noInterrupts() {
+    VirtualDevice::current().setInterruptsEnabled(false);
+}
+
+long random(long howBig) {
+    if (howBig <= 0) return 0;
+    return static_cast<long>(VirtualDevice::current().rng()() % static_cast<unsigned long>(howBig));
+}
+
+long random(long howSmall, long howBig) {
+    if (howSmall >= howBig) return howSmall;
+    return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) {
+        VirtualDevice::current().rng().seed(static_cast<uint32_t>(seed));
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * @file Arduino.h
+ * @brief Host-side stand-in for the Arduino core API
+ * @author catalina
+ *
+ * Provides the subset of the Arduino core used by the library and the
+ * examples so they compile and run on a Linux host. All calls are routed
+ * to the VirtualDevice of the calling thread, which advances a virtual
+ * clock instead of waiting in real time.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+
+#include "WString.h"
+#include "Print.h"
+
+// Pin levels and modes
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+// Interrupt trigger modes
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+// Number bases for Print
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// Number of simulated digital pins
+#define NUM_DIGITAL_PINS 64
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Timing
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Digital and analog I/O
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+int analogRead(uint8_t pin);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000UL);
+
+// Tone generation
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+// Interrupts (every simulated pin can carry an external interrupt)
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t interruptNum, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void interrupts();
+void noInterrupts();
+
+// Math helpers
+template <typename T, typename U>
+inline typename std::common_type<T, U>::type min(T a, U b) { return a < b ? a : b; }
+
+template <typename T, typename U>
+inline typename std::common_type<T, U>::type max(T a, U b) { return a > b ? a : b; }
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// Random numbers
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+#include "HardwareSerial.h"
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,43 @@
+/**
+ * @file HardwareSerial.cpp
+ * @brief Host-side UART implementation
+ * @author catalina
+ */
+
+#include <Arduino.h>
+#include "VirtualDevice.h"
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) {
+    VirtualDevice::current().serialBegin(baud);
+}
+
+void HardwareSerial::end() {
+    VirtualDevice::current().serialBegin(0);
+}
+
+int HardwareSerial::available() {
+    return VirtualDevice::current().serialAvailable();
+}
+
+int HardwareSerial::peek() {
+    return VirtualDevice::current().serialPeek();
+}
+
+int HardwareSerial::read() {
+    return VirtualDevice::current().serialRead();
+}
+
+int HardwareSerial::availableForWrite() {
+    return VirtualDevice::current().serialAvailableForWrite();
+}
+
+void HardwareSerial::flush() {
+    VirtualDevice::current().serialFlush();
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+    VirtualDevice::current().serialWrite(value);
+    return 1;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file HardwareSerial.h
+ * @brief Host-side stand-in for the Arduino hardware UART
+ * @author catalina
+ */
+
+#ifndef HOST_HARDWARE_SERIAL_H
+#define HOST_HARDWARE_SERIAL_H
+
+#include "Print.h"
+
+/**
+ * @class HardwareSerial
+ * @brief Simulated UART with a baud-rate limited transmit buffer
+ *
+ * Bytes enter a 64-byte transmit buffer that drains at the configured baud
+ * rate in virtual time. Writing to a full buffer blocks (advances the
+ * virtual clock) exactly like the AVR core does. All state lives in the
+ * calling thread's VirtualDevice, so the global Serial object is shared
+ * safely between simulated devices.
+ */
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud);
+    void end();
+
+    int available();
+    int peek();
+    int read();
+    int availableForWrite() override;
+    void flush();
+
+    size_t write(uint8_t value) override;
+    using Print::write;
+
+    operator bool() const { return true; }
+
+    // Transmit buffer size of the AVR core
+    static const uint8_t TX_BUFFER_SIZE = 64;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_HARDWARE_SERIAL_H
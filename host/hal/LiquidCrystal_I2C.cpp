@@ -0,0 +1,152 @@
+/**
+ * @file LiquidCrystal_I2C.cpp
+ * @brief Host-side HD44780/PCF8574 LCD implementation
+ * @author catalina
+ */
+
+#include <LiquidCrystal_I2C.h>
+#include "VirtualDevice.h"
+
+namespace {
+    // PCF8574 backpack bit assignment
+    const uint8_t REGISTER_SELECT = 0x01;
+    const uint8_t ENABLE = 0x04;
+    const uint8_t BACKLIGHT = 0x08;
+
+    // HD44780 commands
+    const uint8_t CMD_CLEAR = 0x01;
+    const uint8_t CMD_HOME = 0x02;
+    const uint8_t CMD_ENTRY_MODE = 0x06;
+    const uint8_t CMD_DISPLAY_ON = 0x0C;
+    const uint8_t CMD_DISPLAY_OFF = 0x08;
+    const uint8_t CMD_FUNCTION_SET = 0x28;
+    const uint8_t CMD_SET_DDRAM = 0x80;
+
+    const uint8_t ROW_OFFSETS[] = { 0x00, 0x40, 0x14, 0x54 };
+}
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t address, uint8_t columns, uint8_t rows)
+    : _address(address),
+      _columns(columns),
+      _rows(rows),
+      _backlightMask(BACKLIGHT),
+      _cursorColumn(0),
+      _cursorRow(0) {
+}
+
+void LiquidCrystal_I2C::init() {
+    Wire.begin();
+    begin(_columns, _rows);
+}
+
+void LiquidCrystal_I2C::begin(uint8_t columns, uint8_t rows) {
+    _columns = columns;
+    _rows = rows;
+    VirtualDevice::current().lcd(_address, _columns, _rows);
+
+    // Power-on sequence of the HD44780 in 4-bit mode
+    delay(50);
+    expanderWrite(_backlightMask);
+    delay(1000);
+
+    write4bits(0x03 << 4);
+    delayMicroseconds(4500);
+    write4bits(0x03 << 4);
+    delayMicroseconds(4500);
+    write4bits(0x03 << 4);
+    delayMicroseconds(150);
+    write4bits(0x02 << 4);
+
+    command(CMD_FUNCTION_SET);
+    display();
+    clear();
+    command(CMD_ENTRY_MODE);
+    home();
+}
+
+void LiquidCrystal_I2C::clear() {
+    command(CMD_CLEAR);
+    delayMicroseconds(2000);
+
+    LcdPanel& panel = VirtualDevice::current().lcd(_address, _columns, _rows);
+    for (size_t i = 0; i < panel.lines.size(); i++) {
+        panel.lines[i].assign(panel.columns, ' ');
+    }
+    _cursorColumn = 0;
+    _cursorRow = 0;
+}
+
+void LiquidCrystal_I2C::home() {
+    command(CMD_HOME);
+    delayMicroseconds(2000);
+    _cursorColumn = 0;
+    _cursorRow = 0;
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t column, uint8_t row) {
+    if (row >= _rows) {
+        row = _rows - 1;
+    }
+    command(CMD_SET_DDRAM | (column + ROW_OFFSETS[row & 0x03]));
+    _cursorColumn = column;
+    _cursorRow = row;
+}
+
+void LiquidCrystal_I2C::backlight() {
+    _backlightMask = BACKLIGHT;
+    expanderWrite(0);
+    VirtualDevice::current().lcd(_address, _columns, _rows).backlight = true;
+}
+
+void LiquidCrystal_I2C::noBacklight() {
+    _backlightMask = 0;
+    expanderWrite(0);
+    VirtualDevice::current().lcd(_address, _columns, _rows).backlight = false;
+}
+
+void LiquidCrystal_I2C::display() {
+    command(CMD_DISPLAY_ON);
+    VirtualDevice::current().lcd(_address, _columns, _rows).displayOn = true;
+}
+
+void LiquidCrystal_I2C::noDisplay() {
+    command(CMD_DISPLAY_OFF);
+    VirtualDevice::current().lcd(_address, _columns, _rows).displayOn = false;
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t value) {
+    send(value, REGISTER_SELECT);
+
+    // Characters past the visible columns land in hidden DDRAM
+    LcdPanel& panel = VirtualDevice::current().lcd(_address, _columns, _rows);
+    if (_cursorRow < panel.lines.size() && _cursorColumn < panel.columns) {
+        panel.lines[_cursorRow][_cursorColumn] = static_cast<char>(value);
+    }
+    _cursorColumn++;
+    return 1;
+}
+
+void LiquidCrystal_I2C::command(uint8_t value) {
+    send(value, 0);
+}
+
+void LiquidCrystal_I2C::send(uint8_t value, uint8_t mode) {
+    write4bits((value & 0xF0) | mode);
+    write4bits(((value << 4) & 0xF0) | mode);
+}
+
+void LiquidCrystal_I2C::write4bits(uint8_t value) {
+    expanderWrite(value);
+
+    // Latch the nibble with a pulse on the enable line
+    expanderWrite(value | ENABLE);
+    delayMicroseconds(1);
+    expanderWrite(value & ~ENABLE);
+    delayMicroseconds(50);
+}
+
+void LiquidCrystal_I2C::expanderWrite(uint8_t data) {
+    Wire.beginTransmission(_address);
+    Wire.write(data | _backlightMask);
+    Wire.endTransmission();
+}
@@ -0,0 +1,54 @@
+/**
+ * @file LiquidCrystal_I2C.h
+ * @brief Host-side stand-in for the HD44780 LCD behind a PCF8574 I2C backpack
+ * @author catalina
+ */
+
+#ifndef HOST_LIQUID_CRYSTAL_I2C_H
+#define HOST_LIQUID_CRYSTAL_I2C_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+/**
+ * @class LiquidCrystal_I2C
+ * @brief Simulated character LCD
+ *
+ * Generates the same I2C traffic as the real library (three expander
+ * writes per nibble in 4-bit mode) so display code pays realistic bus time,
+ * and mirrors the visible characters into the LcdPanel of the calling
+ * thread's VirtualDevice for inspection.
+ */
+class LiquidCrystal_I2C : public Print {
+public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t columns, uint8_t rows);
+
+    void init();
+    void begin(uint8_t columns, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t column, uint8_t row);
+    void backlight();
+    void noBacklight();
+    void display();
+    void noDisplay();
+
+    size_t write(uint8_t value) override;
+    using Print::write;
+
+private:
+    uint8_t _address;
+    uint8_t _columns;
+    uint8_t _rows;
+    uint8_t _backlightMask;
+    uint8_t _cursorColumn;
+    uint8_t _cursorRow;
+
+    // Helper methods
+    void command(uint8_t value);
+    void send(uint8_t value, uint8_t mode);
+    void write4bits(uint8_t value);
+    void expanderWrite(uint8_t data);
+};
+
+#endif // HOST_LIQUID_CRYSTAL_I2C_H
@@ -0,0 +1,131 @@
+/**
+ * @file Print.cpp
+ * @brief Host-side Print base class implementation
+ * @author catalina
+ */
+
+#include "Print.h"
+
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    for (size_t i = 0; i < size; i++) {
+        written += write(buffer[i]);
+    }
+    return written;
+}
+
+size_t Print::write(const char* text) {
+    if (text == nullptr) return 0;
+    return write(reinterpret_cast<const uint8_t*>(text), strlen(text));
+}
+
+size_t Print::print(const char* text) {
+    return write(text);
+}
+
+size_t Print::print(const String& text) {
+    return write(reinterpret_cast<const uint8_t*>(text.c_str()), text.length());
+}
+
+size_t Print::print(const __FlashStringHelper* text) {
+    // Flash reads are ordinary reads on the host
+    return write(reinterpret_cast<const char*>(text));
+}
+
+size_t Print::print(char c) {
+    return write(static_cast<uint8_t>(c));
+}
+
+size_t Print::print(int value, int base) {
+    return print(static_cast<long>(value), base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(long value, int base) {
+    if (base == 10 && value < 0) {
+        size_t written = print('-');
+        return written + printNumber(static_cast<unsigned long>(-value), 10);
+    }
+    return printNumber(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return write(buffer);
+}
+
+size_t Print::println() {
+    return write("\r\n");
+}
+
+size_t Print::println(const char* text) {
+    size_t written = print(text);
+    return written + println();
+}
+
+size_t Print::println(const String& text) {
+    size_t written = print(text);
+    return written + println();
+}
+
+size_t Print::println(const __FlashStringHelper* text) {
+    size_t written = print(text);
+    return written + println();
+}
+
+size_t Print::println(char c) {
+    size_t written = print(c);
+    return written + println();
+}
+
+size_t Print::println(int value, int base) {
+    size_t written = print(value, base);
+    return written + println();
+}
+
+size_t Print::println(unsigned int value, int base) {
+    size_t written = print(value, base);
+    return written + println();
+}
+
+size_t Print::println(long value, int base) {
+    size_t written = print(value, base);
+    return written + println();
+}
+
+size_t Print::println(unsigned long value, int base) {
+    size_t written = print(value, base);
+    return written + println();
+}
+
+size_t Print::println(double value, int digits) {
+    size_t written = print(value, digits);
+    return written + println();
+}
+
+size_t Print::printNumber(unsigned long value, int base) {
+    if (base < 2) base = 10;
+
+    char buffer[8 * sizeof(unsigned long) + 1];
+    char* cursor = &buffer[sizeof(buffer) - 1];
+    *cursor = '\0';
+
+    do {
+        unsigned long digit = value % base;
+        value /= base;
+        *--cursor = static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    } while (value != 0);
+
+    return write(cursor);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file Print.h
+ * @brief Host-side stand-in for the Arduino Print base class
+ * @author catalina
+ */
+
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "WString.h"
+
+/**
+ * @class Print
+ * @brief Character output base class shared by Serial and the LCD
+ *
+ * Derived classes only implement write(uint8_t); the formatting helpers
+ * follow the Arduino core (two decimals for floats by default).
+ */
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* text);
+
+    // Bytes that can be written without blocking (0 = unknown), as in the AVR core
+    virtual int availableForWrite() { return 0; }
+
+    size_t print(const char* text);
+    size_t print(const String& text);
+    size_t print(const __FlashStringHelper* text);
+    size_t print(char c);
+    size_t print(int value, int base = 10);
+    size_t print(unsigned int value, int base = 10);
+    size_t print(long value, int base = 10);
+    size_t print(unsigned long value, int base = 10);
+    size_t print(double value, int digits = 2);
+
+    size_t println();
+    size_t println(const char* text);
+    size_t println(const String& text);
+    size_t println(const __FlashStringHelper* text);
+    size_t println(char c);
+    size_t println(int value, int base = 10);
+    size_t println(unsigned int value, int base = 10);
+    size_t println(long value, int base = 10);
+    size_t println(unsigned long value, int base = 10);
+    size_t println(double value, int digits = 2);
+
+private:
+    size_t printNumber(unsigned long value, int base);
+};
+
+#endif // HOST_PRINT_H
@@ -0,0 +1,578 @@
+/**
+ * @file VirtualDevice.cpp
+ * @brief Virtual-time microcontroller model implementation
+ * @author catalina
+ */
+
+#include "VirtualDevice.h"
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+namespace {
+    thread_local VirtualDevice* currentDevice = nullptr;
+
+    VirtualDevice& defaultDevice() {
+        static thread_local VirtualDevice device;
+        return device;
+    }
+}
+
+VirtualDevice::VirtualDevice()
+    : _nowNs(0),
+      _idlePolls(0),
+      _idleFastForward(true),
+      _rng(1),
+      _pulseProvider(nullptr),
+      _interruptsEnabled(true),
+      _inIsr(false),
+      _timerIsr(nullptr),
+      _timerPeriodNs(0),
+      _timerStartNs(0),
+      _timerHalted(false),
+      _sleepMode(SLEEP_MODE_IDLE),
+      _sleepEnabled(false),
+      _watchdogNs(0),
+      _watchdogStartNs(0),
+      _tonePin(0),
+      _toneFrequency(0),
+      _toneEndNs(0),
+      _serialBaud(0),
+      _serialQueued(0),
+      _serialDrainNs(0),
+      _serialCapture(true),
+      _serialEcho(nullptr),
+      _i2cBytes(0) {
+}
+
+VirtualDevice& VirtualDevice::current() {
+    return currentDevice != nullptr ? *currentDevice : defaultDevice();
+}
+
+VirtualDevice::Scope::Scope(VirtualDevice& device)
+    : _previous(currentDevice) {
+    currentDevice = &device;
+}
+
+VirtualDevice::Scope::~Scope() {
+    currentDevice = _previous;
+}
+
+void VirtualDevice::spend(uint64_t ns) {
+    advanceTo(_nowNs + ns);
+}
+
+void VirtualDevice::advanceTo(uint64_t timeNs) {
+    if (timeNs <= _nowNs) {
+        return;
+    }
+
+    processEvents(timeNs);
+}
+
+unsigned long VirtualDevice::pollMillis() {
+    spend(_costs.millisNs);
+
+    if (_idleFastForward && ++_idlePolls > IDLE_POLL_LIMIT) {
+        uint64_t nextMillisecond = (_nowNs / 1000000 + 1) * 1000000;
+        processEvents(nextMillisecond, true);
+    }
+    return static_cast<unsigned long>(_nowNs / 1000000);
+}
+
+void VirtualDevice::setPinMode(uint8_t pin, uint8_t mode) {
+    _idlePolls = 0;
+    if (pin >= NUM_DIGITAL_PINS) return;
+
+    _pins[pin].mode = mode;
+    if (mode == INPUT_PULLUP) {
+        _pins[pin].value = HIGH;
+    }
+    spend(_costs.pinModeNs);
+}
+
+void VirtualDevice::writePin(uint8_t pin, uint8_t value) {
+    _idlePolls = 0;
+    if (pin >= NUM_DIGITAL_PINS) return;
+
+    uint8_t level = value != LOW ? HIGH : LOW;
+    _pins[pin].value = level;
+    _pins[pin].pwm = level == HIGH ? 255 : 0;
+    _stats.digitalWrites++;
+
+    for (size_t i = 0; i < _observers.size(); i++) {
+        _observers[i]->onPinWrite(pin, level, _nowNs);
+    }
+    spend(_costs.digitalWriteNs);
+}
+
+int VirtualDevice::readPin(uint8_t pin) {
+    _idlePolls = 0;
+    if (pin >= NUM_DIGITAL_PINS) return LOW;
+
+    _stats.digitalReads++;
+    spend(_costs.digitalReadNs);
+
+    const PinState& state = _pins[pin];
+    if (state.source != nullptr) {
+        return state.source->level(_nowNs) ? HIGH : LOW;
+    }
+    return state.value;
+}
+
+void VirtualDevice::writeAnalog(uint8_t pin, int value) {
+    _idlePolls = 0;
+    if (pin >= NUM_DIGITAL_PINS) return;
+
+    uint8_t duty = static_cast<uint8_t>(constrain(value, 0, 255));
+    _pins[pin].pwm = duty;
+    _pins[pin].value = duty >= 128 ? HIGH : LOW;
+    _stats.analogWrites++;
+
+    for (size_t i = 0; i < _observers.size(); i++) {
+        _observers[i]->onPinWrite(pin, _pins[pin].value, _nowNs);
+    }
+    spend(_costs.analogWriteNs);
+}
+
+int VirtualDevice::readAnalog(uint8_t pin) {
+    _idlePolls = 0;
+    spend(_costs.analogReadNs);
+    return pin < NUM_DIGITAL_PINS ? _pins[pin].analogInput : 0;
+}
+
+void VirtualDevice::setAnalogInput(uint8_t pin, int value) {
+    if (pin < NUM_DIGITAL_PINS) {
+        _pins[pin].analogInput = value;
+    }
+}
+
+uint8_t VirtualDevice::pinMode(uint8_t pin) const {
+    return pin < NUM_DIGITAL_PINS ? _pins[pin].mode : 0;
+}
+
+uint8_t VirtualDevice::outputLevel(uint8_t pin) const {
+    return pin < NUM_DIGITAL_PINS ? _pins[pin].value : 0;
+}
+
+uint8_t VirtualDevice::pwmValue(uint8_t pin) const {
+    return pin < NUM_DIGITAL_PINS ? _pins[pin].pwm : 0;
+}
+
+unsigned long VirtualDevice::measurePulse(uint8_t pin, uint8_t state, unsigned long timeoutUs) {
+    _idlePolls = 0;
+    _stats.pulseInCalls++;
+    spend(_costs.pulseInSetupNs);
+
+    uint64_t start = _nowNs;
+    unsigned long providedUs;
+    if (_pulseProvider != nullptr && _pulseProvider->nextPulse(pin, state, providedUs)) {
+        if (providedUs == 0) {
+            _stats.pulseInTimeouts++;
+        }
+        spend(static_cast<uint64_t>(providedUs == 0 ? timeoutUs : providedUs) * 1000);
+        _stats.pulseInWaitNs += _nowNs - start;
+        return providedUs;
+    }
+
+    uint64_t deadline = start + static_cast<uint64_t>(timeoutUs) * 1000;
+    SignalSource* source = pin < NUM_DIGITAL_PINS ? _pins[pin].source : nullptr;
+    bool wanted = state != LOW;
+
+    // Without a model the pin never changes: the call always times out
+    if (source == nullptr) {
+        advanceTo(deadline);
+        _stats.pulseInTimeouts++;
+        _stats.pulseInWaitNs += _nowNs - start;
+        return 0;
+    }
+
+    uint64_t t = start;
+
+    // Wait for any pulse already in progress to end, then for the pulse to start
+    for (int phase = 0; phase < 2; phase++) {
+        bool waitWhile = phase == 0 ? wanted : !wanted;
+        while (source->level(t) == waitWhile) {
+            uint64_t edge = source->nextEdge(t);
+            if (edge == SignalSource::NEVER || edge > deadline) {
+                advanceTo(deadline);
+                _stats.pulseInTimeouts++;
+                _stats.pulseInWaitNs += _nowNs - start;
+                return 0;
+            }
+            t = edge;
+        }
+    }
+
+    uint64_t pulseStart = t;
+    uint64_t pulseEnd = source->nextEdge(t);
+    if (pulseEnd == SignalSource::NEVER || pulseEnd > deadline) {
+        advanceTo(deadline);
+        _stats.pulseInTimeouts++;
+        _stats.pulseInWaitNs += _nowNs - start;
+        return 0;
+    }
+
+    advanceTo(pulseEnd);
+    _stats.pulseInWaitNs += _nowNs - start;
+    return static_cast<unsigned long>((pulseEnd - pulseStart) / 1000);
+}
+
+void VirtualDevice::attachSource(uint8_t pin, SignalSource* source) {
+    if (pin >= NUM_DIGITAL_PINS) return;
+
+    _pins[pin].source = source;
+    for (size_t i = 0; i < _observers.size(); i++) {
+        if (_observers[i] == source) return;
+    }
+    _observers.push_back(source);
+}
+
+void VirtualDevice::detachSource(uint8_t pin) {
+    if (pin >= NUM_DIGITAL_PINS || _pins[pin].source == nullptr) return;
+
+    SignalSource* source = _pins[pin].source;
+    _pins[pin].source = nullptr;
+
+    // Keep observing writes while the model still drives another pin
+    for (uint8_t i = 0; i < NUM_DIGITAL_PINS; i++) {
+        if (_pins[i].source == source) return;
+    }
+    for (size_t i = 0; i < _observers.size(); i++) {
+        if (_observers[i] == source) {
+            _observers.erase(_observers.begin() + i);
+            return;
+        }
+    }
+}
+
+void VirtualDevice::attachIsr(uint8_t pin, void (*isr)(), int mode) {
+    detachIsr(pin);
+
+    IsrEntry entry;
+    entry.pin = pin;
+    entry.isr = isr;
+    entry.mode = mode;
+    entry.scanFrom = _nowNs;
+    _isrs.push_back(entry);
+}
+
+void VirtualDevice::detachIsr(uint8_t pin) {
+    for (size_t i = 0; i < _isrs.size(); i++) {
+        if (_isrs[i].pin == pin) {
+            _isrs.erase(_isrs.begin() + i);
+            return;
+        }
+    }
+}
+
+void VirtualDevice::setInterruptsEnabled(bool enabled) {
+    _interruptsEnabled = enabled;
+
+    // Edges latched while interrupts were off are serviced right away
+    if (enabled && !_inIsr) {
+        processEvents(_nowNs);
+    }
+}
+
+void VirtualDevice::startTimer(uint64_t periodNs, void (*isr)()) {
+    _timerIsr = isr;
+    _timerPeriodNs = periodNs;
+    _timerStartNs = _nowNs;
+}
+
+void VirtualDevice::setTimerPeriod(uint64_t periodNs) {
+    _timerPeriodNs = periodNs;
+}
+
+void VirtualDevice::stopTimer() {
+    _timerIsr = nullptr;
+}
+
+void VirtualDevice::startTone(uint8_t pin, unsigned int frequency, unsigned long durationMs) {
+    _idlePolls = 0;
+    _stats.toneCalls++;
+    _tonePin = pin;
+    _toneFrequency = frequency;
+    _toneEndNs = durationMs > 0 ? _nowNs + static_cast<uint64_t>(durationMs) * 1000000 : UINT64_MAX;
+    spend(_costs.toneNs);
+}
+
+void VirtualDevice::stopTone(uint8_t pin) {
+    _idlePolls = 0;
+    if (pin == _tonePin) {
+        _toneFrequency = 0;
+    }
+    spend(_costs.toneNs / 2);
+}
+
+unsigned int VirtualDevice::toneFrequency(uint8_t pin) const {
+    if (pin != _tonePin || _nowNs >= _toneEndNs) {
+        return 0;
+    }
+    return _toneFrequency;
+}
+
+void VirtualDevice::serialBegin(unsigned long baud) {
+    _serialBaud = baud;
+    _serialQueued = 0;
+    _serialDrainNs = _nowNs;
+}
+
+void VirtualDevice::serialWrite(uint8_t value) {
+    _idlePolls = 0;
+    _stats.serialBytes++;
+
+    if (_serialCapture) {
+        _serialOutput.push_back(static_cast<char>(value));
+    }
+    if (_serialEcho != nullptr) {
+        fputc(value, _serialEcho);
+    }
+    if (_serialBaud == 0) {
+        return;
+    }
+
+    // Block until the transmit buffer has room, like the AVR core does
+    drainSerial();
+    if (_serialQueued >= HardwareSerial::TX_BUFFER_SIZE) {
+        uint64_t byteNs = 10000000000ULL / _serialBaud;
+        uint64_t blockedFrom = _nowNs;
+        advanceTo(_serialDrainNs + byteNs);
+        drainSerial();
+        _stats.serialBlockedNs += _nowNs - blockedFrom;
+    }
+
+    _serialQueued++;
+    spend(_costs.serialByteNs);
+}
+
+int VirtualDevice::serialAvailableForWrite() {
+    drainSerial();
+    return HardwareSerial::TX_BUFFER_SIZE - _serialQueued;
+}
+
+void VirtualDevice::serialFlush() {
+    if (_serialBaud == 0) return;
+
+    drainSerial();
+    uint64_t byteNs = 10000000000ULL / _serialBaud;
+    advanceTo(_serialDrainNs + byteNs * _serialQueued);
+    drainSerial();
+}
+
+void VirtualDevice::injectSerialInput(const std::string& data) {
+    _serialInput += data;
+}
+
+int VirtualDevice::serialAvailable() const {
+    return static_cast<int>(_serialInput.size());
+}
+
+int VirtualDevice::serialPeek() const {
+    return _serialInput.empty() ? -1 : static_cast<uint8_t>(_serialInput[0]);
+}
+
+int VirtualDevice::serialRead() {
+    _idlePolls = 0;
+    if (_serialInput.empty()) return -1;
+
+    int value = static_cast<uint8_t>(_serialInput[0]);
+    _serialInput.erase(0, 1);
+    return value;
+}
+
+void VirtualDevice::i2cBegin(uint8_t address) {
+    (void)address;
+    _i2cBytes = 1; // Address byte
+}
+
+void VirtualDevice::i2cWrite(uint8_t value) {
+    (void)value;
+    _i2cBytes++;
+}
+
+void VirtualDevice::i2cEnd() {
+    _idlePolls = 0;
+    // Nine bit times per byte (eight data bits plus ACK), plus start and stop
+    uint64_t busNs = (static_cast<uint64_t>(_i2cBytes) * 9 + 2) * 1000000000ULL / _costs.i2cClockHz;
+
+    _stats.i2cTransmissions++;
+    _stats.i2cBytes += _i2cBytes;
+    _stats.i2cBusyNs += busNs;
+    _i2cBytes = 0;
+    spend(busNs);
+}
+
+LcdPanel& VirtualDevice::lcd(uint8_t address, uint8_t columns, uint8_t rows) {
+    for (size_t i = 0; i < _lcds.size(); i++) {
+        if (_lcds[i].address == address) {
+            return _lcds[i];
+        }
+    }
+
+    LcdPanel panel;
+    panel.address = address;
+    panel.columns = columns;
+    panel.rows = rows;
+    panel.lines.assign(rows, std::string(columns, ' '));
+    _lcds.push_back(panel);
+    return _lcds.back();
+}
+
+void VirtualDevice::sleepCpu() {
+    if (!_sleepEnabled) {
+        return;
+    }
+    _idlePolls = 0;
+    _stats.sleeps++;
+    uint64_t start = _nowNs;
+
+    if (_sleepMode == SLEEP_MODE_IDLE) {
+        uint64_t overflow = (_nowNs / TIMER0_OVERFLOW_NS + 1) * TIMER0_OVERFLOW_NS;
+        processEvents(overflow, true);
+        _stats.idleSleepNs += _nowNs - start;
+        return;
+    }
+
+    uint64_t wake = _nowNs + MAX_SLEEP_NS;
+    if (_watchdogNs > 0) {
+        uint64_t periods = (_nowNs - _watchdogStartNs) / _watchdogNs + 1;
+        wake = _watchdogStartNs + periods * _watchdogNs;
+    }
+    // Timer1 resumes its period where it stood
+    _timerHalted = true;
+    processEvents(wake, true);
+    _timerHalted = false;
+    _timerStartNs += _nowNs - start;
+    if (_watchdogNs > 0 && _nowNs >= wake) {
+        _watchdogStartNs = wake;
+    }
+    _stats.powerDownNs += _nowNs - start;
+}
+
+void VirtualDevice::armWatchdog(uint64_t periodNs) {
+    _watchdogNs = periodNs;
+    _watchdogStartNs = _nowNs;
+}
+
+const LcdPanel* VirtualDevice::findLcd(uint8_t address) const {
+    for (size_t i = 0; i < _lcds.size(); i++) {
+        if (_lcds[i].address == address) {
+            return &_lcds[i];
+        }
+    }
+    return nullptr;
+}
+
+void VirtualDevice::processEvents(uint64_t targetNs, bool stopAtInterrupt) {
+    // Interrupt handlers run with interrupts disabled and cannot nest
+    if (_inIsr || !_interruptsEnabled || (_isrs.empty() && _timerIsr == nullptr)) {
+        if (targetNs > _nowNs) _nowNs = targetNs;
+        return;
+    }
+
+    for (;;) {
+        // Find the earliest pending interrupt up to the target time
+        uint64_t limitNs = targetNs > _nowNs ? targetNs : _nowNs;
+        size_t next = _isrs.size();
+        uint64_t nextTime = SignalSource::NEVER;
+        for (size_t i = 0; i < _isrs.size(); i++) {
+            uint64_t edge = nextMatchingEdge(_isrs[i], limitNs);
+            if (edge < nextTime) {
+                nextTime = edge;
+                next = i;
+            }
+        }
+
+        // The pin interrupts have the higher priority and win a tie
+        bool timer = false;
+        if (_timerIsr != nullptr && !_timerHalted) {
+            uint64_t match = _timerStartNs + _timerPeriodNs;
+            if (match <= limitNs && match < nextTime) {
+                nextTime = match;
+                timer = true;
+            }
+        }
+
+        if (!timer && next == _isrs.size()) {
+            break;
+        }
+
+        if (nextTime > _nowNs) _nowNs = nextTime;
+
+        void (*isr)();
+        if (timer) {
+            // The counter restarts at every match, before the handler
+            // runs; matches missed with interrupts off make one request
+            uint64_t start = nextTime;
+            if (_nowNs > start) {
+                start += (_nowNs - start) / _timerPeriodNs * _timerPeriodNs;
+            }
+            _timerStartNs = start;
+            isr = _timerIsr;
+        } else {
+            _isrs[next].scanFrom = nextTime;
+            isr = _isrs[next].isr;
+        }
+
+        _inIsr = true;
+        isr();
+        _inIsr = false;
+        _stats.interruptsFired++;
+
+        // Give a polling sketch the chance to see what the handler changed
+        if (stopAtInterrupt) {
+            _idlePolls = 0;
+            return;
+        }
+    }
+
+    if (targetNs > _nowNs) _nowNs = targetNs;
+    for (size_t i = 0; i < _isrs.size(); i++) {
+        if (_isrs[i].scanFrom < _nowNs) _isrs[i].scanFrom = _nowNs;
+    }
+}
+
+uint64_t VirtualDevice::nextMatchingEdge(const IsrEntry& entry, uint64_t limitNs) {
+    return findEdge(entry.pin, entry.mode, entry.scanFrom, limitNs);
+}
+
+uint64_t VirtualDevice::findEdge(uint8_t pin, int mode, uint64_t fromNs, uint64_t limitNs) {
+    SignalSource* source = pin < NUM_DIGITAL_PINS ? _pins[pin].source : nullptr;
+    if (source == nullptr) {
+        return SignalSource::NEVER;
+    }
+
+    uint64_t t = fromNs;
+    for (;;) {
+        t = source->nextEdge(t);
+        if (t == SignalSource::NEVER || t > limitNs) {
+            return SignalSource::NEVER;
+        }
+
+        bool high = source->level(t);
+        if (mode == CHANGE || (mode == RISING && high) || (mode == FALLING && !high)) {
+            return t;
+        }
+    }
+}
+
+void VirtualDevice::drainSerial() {
+    if (_serialBaud == 0) return;
+
+    if (_serialQueued == 0) {
+        _serialDrainNs = _nowNs;
+        return;
+    }
+
+    uint64_t byteNs = 10000000000ULL / _serialBaud;
+    uint64_t sent = (_nowNs - _serialDrainNs) / byteNs;
+    if (sent >= _serialQueued) {
+        _serialQueued = 0;
+        _serialDrainNs = _nowNs;
+    } else {
+        _serialQueued -= static_cast<uint8_t>(sent);
+        _serialDrainNs += sent * byteNs;
+    }
+}
@@ -0,0 +1,373 @@
+/**
+ * @file VirtualDevice.h
+ * @brief Virtual-time microcontroller model behind the host Arduino HAL
+ * @author catalina
+ */
+
+#ifndef HOST_VIRTUAL_DEVICE_H
+#define HOST_VIRTUAL_DEVICE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @class SignalSource
+ * @brief Model that drives a simulated input pin
+ *
+ * A source describes its output as a function of virtual time and is told
+ * about every pin the sketch writes, so it can react to trigger and select
+ * lines. Times are in nanoseconds of virtual time.
+ */
+class SignalSource {
+public:
+    virtual ~SignalSource() {}
+
+    /**
+     * @brief Get the driven level at a point in time
+     * @param timeNs Virtual time in ns
+     * @return true for HIGH
+     */
+    virtual bool level(uint64_t timeNs) = 0;
+
+    /**
+     * @brief Find the next level change strictly after a point in time
+     * @param timeNs Virtual time in ns
+     * @return Time of the next edge, or NEVER if the level stays constant
+     */
+    virtual uint64_t nextEdge(uint64_t timeNs) = 0;
+
+    /**
+     * @brief Observe an output pin write made by the sketch
+     * @param pin Pin number
+     * @param value Written level
+     * @param timeNs Virtual time of the write in ns
+     */
+    virtual void onPinWrite(uint8_t pin, uint8_t value, uint64_t timeNs) {
+        (void)pin; (void)value; (void)timeNs;
+    }
+
+    static const uint64_t NEVER = UINT64_MAX;
+};
+
+/**
+ * @class PulseProvider
+ * @brief Answers pulseIn() calls directly instead of simulating the pin
+ *
+ * Used to replay recorded pulse widths: the provider decides the result
+ * and the clock advances by the returned width, with no edge search.
+ */
+class PulseProvider {
+public:
+    virtual ~PulseProvider() {}
+
+    /**
+     * @brief Supply the result of a pulseIn() call
+     * @param pin Measured pin
+     * @param state Measured level
+     * @param widthUs Pulse width in µs to return (0 = timeout)
+     * @return false to fall back to the attached signal source
+     */
+    virtual bool nextPulse(uint8_t pin, uint8_t state, unsigned long& widthUs) = 0;
+};
+
+/**
+ * @brief Virtual execution cost of the core API on a 16 MHz AVR
+ *
+ * Pure computation is not modelled; only I/O calls and bus traffic
+ * consume virtual time.
+ */
+struct CostModel {
+    uint32_t pinModeNs = 4000;
+    uint32_t digitalWriteNs = 3200;
+    uint32_t digitalReadNs = 3000;
+    uint32_t analogWriteNs = 5000;
+    uint32_t analogReadNs = 112000;
+    uint32_t millisNs = 1500;
+    uint32_t microsNs = 3500;
+    uint32_t pulseInSetupNs = 10000;
+    uint32_t toneNs = 20000;
+    uint32_t serialByteNs = 5000;
+    uint32_t i2cClockHz = 100000;
+};
+
+/**
+ * @brief Counters of everything the sketch did to the hardware
+ */
+struct DeviceStats {
+    uint64_t digitalWrites = 0;
+    uint64_t digitalReads = 0;
+    uint64_t analogWrites = 0;
+    uint64_t pulseInCalls = 0;
+    uint64_t pulseInTimeouts = 0;
+    uint64_t pulseInWaitNs = 0;
+    uint64_t delayNs = 0;
+    uint64_t toneCalls = 0;
+    uint64_t i2cTransmissions = 0;
+    uint64_t i2cBytes = 0;
+    uint64_t i2cBusyNs = 0;
+    uint64_t serialBytes = 0;
+    uint64_t serialBlockedNs = 0;
+    uint64_t interruptsFired = 0;
+    uint64_t sleeps = 0;
+    uint64_t idleSleepNs = 0;
+    uint64_t powerDownNs = 0;        // Any mode that stops the CPU and Timer0 clocks
+};
+
+/**
+ * @brief Visible state of a simulated character LCD
+ */
+struct LcdPanel {
+    uint8_t address = 0;
+    uint8_t columns = 0;
+    uint8_t rows = 0;
+    bool backlight = false;
+    bool displayOn = true;
+    std::vector<std::string> lines;
+};
+
+/**
+ * @class VirtualDevice
+ * @brief Complete state of one simulated board
+ *
+ * Each thread works on its own current device, so independent simulated
+ * boards can run in parallel without sharing state. The clock only moves
+ * when the sketch calls into the HAL, which makes delay() and pulseIn()
+ * free in host time.
+ */
+class VirtualDevice {
+public:
+    VirtualDevice();
+
+    /**
+     * @brief Get the device the calling thread is simulating
+     * @return Current device (a per-thread default if none was selected)
+     */
+    static VirtualDevice& current();
+
+    /**
+     * @class Scope
+     * @brief Makes a device current for the calling thread while in scope
+     */
+    class Scope {
+    public:
+        explicit Scope(VirtualDevice& device);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        VirtualDevice* _previous;
+    };
+
+    // Time
+    uint64_t nowNs() const { return _nowNs; }
+    void spend(uint64_t ns);
+    void advanceTo(uint64_t timeNs);
+
+    /**
+     * @brief Read the millisecond clock on behalf of millis()
+     *
+     * When the sketch only polls the clock without touching any I/O it is
+     * spinning in a wait loop; after a few such polls the clock jumps to the
+     * next millisecond (or the next interrupt, whichever comes first). This
+     * keeps busy-wait loops from dominating host run time without changing
+     * anything the sketch can observe.
+     *
+     * @return Virtual time in ms
+     */
+    unsigned long pollMillis();
+
+    /**
+     * @brief Enable or disable fast-forwarding of idle clock polling
+     */
+    void setIdleFastForward(bool enabled) { _idleFastForward = enabled; }
+
+    // Clock polls without I/O after which the clock is fast-forwarded
+    static const uint32_t IDLE_POLL_LIMIT = 16;
+
+    // Pins
+    void setPinMode(uint8_t pin, uint8_t mode);
+    void writePin(uint8_t pin, uint8_t value);
+    int readPin(uint8_t pin);
+    void writeAnalog(uint8_t pin, int value);
+    int readAnalog(uint8_t pin);
+    void setAnalogInput(uint8_t pin, int value);
+    uint8_t pinMode(uint8_t pin) const;
+    uint8_t outputLevel(uint8_t pin) const;
+    uint8_t pwmValue(uint8_t pin) const;
+    unsigned long measurePulse(uint8_t pin, uint8_t state, unsigned long timeoutUs);
+
+    /**
+     * @brief Find the next edge of an input pin without moving the clock
+     *
+     * Lets a caller wait for the edge in its own way (see host/coro).
+     *
+     * @param pin Input pin
+     * @param mode RISING, FALLING or CHANGE
+     * @param fromNs Search strictly after this time
+     * @param limitNs Latest time of interest
+     * @return Time of the edge, or SignalSource::NEVER if none by limitNs
+     */
+    uint64_t findEdge(uint8_t pin, int mode, uint64_t fromNs, uint64_t limitNs);
+
+    /**
+     * @brief Let a model drive an input pin and observe all pin writes
+     * @param pin Input pin driven by the model
+     * @param source Model (not owned; must outlive the attachment)
+     */
+    void attachSource(uint8_t pin, SignalSource* source);
+    void detachSource(uint8_t pin);
+
+    /**
+     * @brief Let a provider answer pulseIn() calls
+     * @param provider Provider (not owned), or nullptr to simulate the pins again
+     */
+    void setPulseProvider(PulseProvider* provider) { _pulseProvider = provider; }
+
+    // Interrupts
+    void attachIsr(uint8_t pin, void (*isr)(), int mode);
+    void detachIsr(uint8_t pin);
+    void setInterruptsEnabled(bool enabled);
+    bool inIsr() const { return _inIsr; }
+
+    /**
+     * @brief Start Timer1 in CTC mode with its compare interrupt
+     *
+     * The handler runs every period like an attached interrupt. A period
+     * set from the handler applies to the period that has just begun, as
+     * writing OCR1A does on the board. Timer1 stops in power-down.
+     *
+     * @param periodNs Time between compare matches in ns
+     * @param isr Compare match handler
+     */
+    void startTimer(uint64_t periodNs, void (*isr)());
+    void setTimerPeriod(uint64_t periodNs);
+    void stopTimer();
+    bool timerRunning() const { return _timerIsr != nullptr; }
+
+    // Sleep modes and watchdog (see avr/sleep.h and avr/wdt.h)
+    void setSleepMode(uint8_t mode) { _sleepMode = mode; }
+    void setSleepEnabled(bool enabled) { _sleepEnabled = enabled; }
+
+    /**
+     * @brief Sleep on behalf of sleep_cpu()
+     *
+     * Does nothing unless sleep is enabled. Idle sleep lasts until the next
+     * Timer0 overflow; deeper modes stop Timer0 and last until the watchdog
+     * times out (MAX_SLEEP_NS when it is off). Both end at the first
+     * attached interrupt, which runs before sleepCpu() returns.
+     */
+    void sleepCpu();
+
+    /**
+     * @brief Start or stop the watchdog wake timer
+     * @param periodNs Timeout in ns, 0 to stop it
+     */
+    void armWatchdog(uint64_t periodNs);
+    void resetWatchdog() { _watchdogStartNs = _nowNs; }
+
+    // Timer0 overflow period with the core's prescaler of 64 at 16 MHz
+    static const uint64_t TIMER0_OVERFLOW_NS = 1024000;
+
+    // Longest deep sleep without a watchdog (the board would never wake)
+    static const uint64_t MAX_SLEEP_NS = 8192000000ULL;
+
+    // Tone generator
+    void startTone(uint8_t pin, unsigned int frequency, unsigned long durationMs);
+    void stopTone(uint8_t pin);
+    unsigned int toneFrequency(uint8_t pin) const;
+
+    // Serial port
+    void serialBegin(unsigned long baud);
+    void serialWrite(uint8_t value);
+    int serialAvailableForWrite();
+    void serialFlush();
+    void injectSerialInput(const std::string& data);
+    int serialAvailable() const;
+    int serialPeek() const;
+    int serialRead();
+    std::string& serialOutput() { return _serialOutput; }
+    void setSerialCapture(bool capture) { _serialCapture = capture; }
+    void setSerialEcho(FILE* stream) { _serialEcho = stream; }
+
+    // I2C bus
+    void i2cBegin(uint8_t address);
+    void i2cWrite(uint8_t value);
+    void i2cEnd();
+
+    // LCD panels
+    LcdPanel& lcd(uint8_t address, uint8_t columns, uint8_t rows);
+    const LcdPanel* findLcd(uint8_t address) const;
+
+    // Cost model, statistics and randomness
+    CostModel& costs() { return _costs; }
+    DeviceStats& stats() { return _stats; }
+    void resetStats() { _stats = DeviceStats(); }
+    std::mt19937& rng() { return _rng; }
+
+private:
+    struct PinState {
+        uint8_t mode = 0;
+        uint8_t value = 0;
+        uint8_t pwm = 0;
+        int analogInput = 0;
+        SignalSource* source = nullptr;
+    };
+
+    struct IsrEntry {
+        uint8_t pin;
+        void (*isr)();
+        int mode;
+        uint64_t scanFrom;
+    };
+
+    uint64_t _nowNs;
+    uint32_t _idlePolls;
+    bool _idleFastForward;
+    CostModel _costs;
+    DeviceStats _stats;
+    std::mt19937 _rng;
+
+    PinState _pins[64];
+    std::vector<SignalSource*> _observers;
+    PulseProvider* _pulseProvider;
+
+    std::vector<IsrEntry> _isrs;
+    bool _interruptsEnabled;
+    bool _inIsr;
+
+    void (*_timerIsr)();
+    uint64_t _timerPeriodNs;
+    uint64_t _timerStartNs;         // Start of the running period
+    bool _timerHalted;              // Clock stopped (power-down)
+
+    uint8_t _sleepMode;
+    bool _sleepEnabled;
+    uint64_t _watchdogNs;
+    uint64_t _watchdogStartNs;
+
+    uint8_t _tonePin;
+    unsigned int _toneFrequency;
+    uint64_t _toneEndNs;
+
+    unsigned long _serialBaud;
+    uint8_t _serialQueued;
+    uint64_t _serialDrainNs;
+    bool _serialCapture;
+    FILE* _serialEcho;
+    std::string _serialOutput;
+    std::string _serialInput;
+
+    uint8_t _i2cBytes;
+
+    std::vector<LcdPanel> _lcds;
+
+    // Helper methods
+    void processEvents(uint64_t targetNs, bool stopAtInterrupt = false);
+    uint64_t nextMatchingEdge(const IsrEntry& entry, uint64_t limitNs);
+    void drainSerial();
+};
+
+#endif // HOST_VIRTUAL_DEVICE_H
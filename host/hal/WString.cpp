@@ -0,0 +1,75 @@
+/**
+ * @file WString.cpp
+ * @brief Host-side Arduino String implementation
+ * @author catalina
+ */
+
+#include "WString.h"
+
+#include <stdio.h>
+
+namespace {
+    std::string formatInteger(unsigned long value, bool negative, unsigned char base) {
+        if (base < 2) base = 10;
+
+        std::string digits;
+        do {
+            unsigned long digit = value % base;
+            value /= base;
+            digits.insert(digits.begin(), static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10));
+        } while (value != 0);
+
+        return negative ? "-" + digits : digits;
+    }
+
+    std::string formatDecimal(double value, unsigned char decimalPlaces) {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimalPlaces, value);
+        return buffer;
+    }
+}
+
+String::String(int value, unsigned char base)
+    : String(static_cast<long>(value), base) {
+}
+
+String::String(unsigned int value, unsigned char base)
+    : String(static_cast<unsigned long>(value), base) {
+}
+
+String::String(long value, unsigned char base)
+    : _text(base == 10 && value < 0
+                ? formatInteger(static_cast<unsigned long>(-value), true, base)
+                : formatInteger(static_cast<unsigned long>(value), false, base)) {
+}
+
+String::String(unsigned long value, unsigned char base)
+    : _text(formatInteger(value, false, base)) {
+}
+
+String::String(float value, unsigned char decimalPlaces)
+    : _text(formatDecimal(value, decimalPlaces)) {
+}
+
+String::String(double value, unsigned char decimalPlaces)
+    : _text(formatDecimal(value, decimalPlaces)) {
+}
+
+String String::substring(unsigned int from) const {
+    return substring(from, length());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from >= _text.length()) {
+        return String();
+    }
+    if (to > _text.length()) {
+        to = _text.length();
+    }
+    return String(_text.substr(from, to - from));
+}
@@ -0,0 +1,81 @@
+/**
+ * @file WString.h
+ * @brief Host-side stand-in for the Arduino String class
+ * @author catalina
+ */
+
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <string>
+
+#include "avr/pgmspace.h"
+
+// Marks a string in flash; F("text") makes one from a literal
+class __FlashStringHelper;
+#define F(text) (reinterpret_cast<const __FlashStringHelper*>(PSTR(text)))
+
+/**
+ * @class String
+ * @brief Arduino-compatible dynamic string backed by std::string
+ */
+class String {
+public:
+    String(const char* text = "") : _text(text != nullptr ? text : "") {}
+    String(const std::string& text) : _text(text) {}
+    String(const __FlashStringHelper* text) : String(reinterpret_cast<const char*>(text)) {}
+    explicit String(char c) : _text(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    unsigned int length() const { return _text.length(); }
+    const char* c_str() const { return _text.c_str(); }
+    char charAt(unsigned int index) const { return index < _text.length() ? _text[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+
+    String& operator+=(const String& other) { _text += other._text; return *this; }
+    String& operator+=(const char* other) { _text += other; return *this; }
+    String& operator+=(const __FlashStringHelper* other) { return *this += reinterpret_cast<const char*>(other); }
+    String& operator+=(char c) { _text += c; return *this; }
+
+    bool operator==(const String& other) const { return _text == other._text; }
+    bool operator!=(const String& other) const { return _text != other._text; }
+    bool operator==(const char* other) const { return _text == other; }
+    bool operator!=(const char* other) const { return _text != other; }
+
+private:
+    std::string _text;
+};
+
+inline String operator+(const String& lhs, const String& rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const String& lhs, const char* rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const String& lhs, const __FlashStringHelper* rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const char* lhs, const String& rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+#endif // HOST_WSTRING_H
@@ -0,0 +1,34 @@
+/**
+ * @file Wire.cpp
+ * @brief Host-side I2C master implementation
+ * @author catalina
+ */
+
+#include <Wire.h>
+#include "VirtualDevice.h"
+
+TwoWire Wire;
+
+void TwoWire::begin() {
+}
+
+void TwoWire::setClock(uint32_t frequency) {
+    if (frequency > 0) {
+        VirtualDevice::current().costs().i2cClockHz = frequency;
+    }
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    VirtualDevice::current().i2cBegin(address);
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    VirtualDevice::current().i2cEnd();
+    return 0; // Success
+}
+
+size_t TwoWire::write(uint8_t value) {
+    VirtualDevice::current().i2cWrite(value);
+    return 1;
+}
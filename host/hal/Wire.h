@@ -0,0 +1,34 @@
+/**
+ * @file Wire.h
+ * @brief Host-side stand-in for the Arduino I2C (TWI) library
+ * @author catalina
+ */
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+/**
+ * @class TwoWire
+ * @brief Simulated I2C master
+ *
+ * Transmissions are not delivered anywhere; they only cost virtual bus time
+ * (9 bit times per byte plus start/stop) and are counted in the calling
+ * thread's VirtualDevice so drivers can be profiled by bytes on the bus.
+ */
+class TwoWire : public Print {
+public:
+    void begin();
+    void setClock(uint32_t frequency);
+
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true);
+
+    size_t write(uint8_t value) override;
+    using Print::write;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,32 @@
+/**
+ * @file pgmspace.h
+ * @brief Host-side stand-in for avr/pgmspace.h
+ * @author catalina
+ *
+ * The host has a single address space, so PROGMEM data stays where the
+ * compiler puts it and the *_P functions are the ordinary ones. Code
+ * written against this header reads flash correctly on the AVR as well.
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(text) (text)
+
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t*>(address))
+#define pgm_read_word(address) (*reinterpret_cast<const uint16_t*>(address))
+#define pgm_read_dword(address) (*reinterpret_cast<const uint32_t*>(address))
+#define pgm_read_ptr(address) (*reinterpret_cast<const void* const*>(address))
+
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define memcpy_P memcpy
+
+#endif // HOST_AVR_PGMSPACE_H
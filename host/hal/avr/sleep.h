@@ -0,0 +1,52 @@
+/**
+ * @file sleep.h
+ * @brief Host-side stand-in for avr/sleep.h
+ * @author catalina
+ *
+ * sleep_cpu() hands the rest of the sleep to the virtual device: in idle
+ * mode the clock runs to the next Timer0 overflow, in the deeper modes to
+ * the watchdog timeout. An attached interrupt ends either sleep early; on
+ * the board an edge interrupt such as the echo capture cannot end a
+ * power-down, so sketches must not power down while one is expected.
+ */
+
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#include <stdint.h>
+#include "../VirtualDevice.h"
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_ADC 1
+#define SLEEP_MODE_PWR_DOWN 2
+#define SLEEP_MODE_PWR_SAVE 3
+#define SLEEP_MODE_STANDBY 6
+#define SLEEP_MODE_EXT_STANDBY 7
+
+inline void set_sleep_mode(uint8_t mode) {
+    VirtualDevice::current().setSleepMode(mode);
+}
+
+inline void sleep_enable() {
+    VirtualDevice::current().setSleepEnabled(true);
+}
+
+inline void sleep_disable() {
+    VirtualDevice::current().setSleepEnabled(false);
+}
+
+inline void sleep_cpu() {
+    VirtualDevice::current().sleepCpu();
+}
+
+inline void sleep_mode() {
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+}
+
+// The brown-out detector is not modelled
+inline void sleep_bod_disable() {
+}
+
+#endif // HOST_AVR_SLEEP_H
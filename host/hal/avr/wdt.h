@@ -0,0 +1,39 @@
+/**
+ * @file wdt.h
+ * @brief Host-side stand-in for avr/wdt.h
+ * @author catalina
+ *
+ * The virtual watchdog only wakes the CPU from sleep; it never resets the
+ * device. Timeouts are the nominal 16 ms << n of the 128 kHz oscillator.
+ */
+
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#include <stdint.h>
+#include "../VirtualDevice.h"
+
+#define WDTO_15MS 0
+#define WDTO_30MS 1
+#define WDTO_60MS 2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_4S 8
+#define WDTO_8S 9
+
+inline void wdt_enable(uint8_t timeout) {
+    VirtualDevice::current().armWatchdog(16000000ULL << timeout);
+}
+
+inline void wdt_disable() {
+    VirtualDevice::current().armWatchdog(0);
+}
+
+inline void wdt_reset() {
+    VirtualDevice::current().resetWatchdog();
+}
+
+#endif // HOST_AVR_WDT_H
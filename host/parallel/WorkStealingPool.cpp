@@ -0,0 +1,131 @@
+/**
+ * @file WorkStealingPool.cpp
+ * @brief Work-stealing thread pool implementation
+ * @author catalina
+ */
+
+#include "WorkStealingPool.h"
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : _nextQueue(0),
+      _pending(0),
+      _steals(0),
+      _stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        _queues.emplace_back(new Queue());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        _workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(Job job) {
+    size_t index = _nextQueue++ % _queues.size();
+    _pending++;
+    {
+        std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+        _queues[index]->jobs.push_back(std::move(job));
+    }
+
+    // Taking the sleep lock orders this notify after a worker's last empty check
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    _workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    _allDone.wait(lock, [this] { return _pending.load() == 0; });
+}
+
+void WorkStealingPool::parallelFor(size_t count, size_t chunk,
+                                   const std::function<void(size_t index, size_t worker)>& body) {
+    if (chunk == 0) {
+        chunk = 1;
+    }
+    for (size_t begin = 0; begin < count; begin += chunk) {
+        size_t end = begin + chunk < count ? begin + chunk : count;
+        submit([&body, begin, end](size_t worker) {
+            for (size_t i = begin; i < end; i++) {
+                body(i, worker);
+            }
+        });
+    }
+    wait();
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    for (;;) {
+        Job job;
+        if (takeJob(index, job)) {
+            job(index);
+            if (--_pending == 0) {
+                std::lock_guard<std::mutex> lock(_sleepMutex);
+                _allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        if (_stopping) {
+            return;
+        }
+        // Recheck under the lock: a job may have been queued since takeJob() looked
+        _workAvailable.wait(lock, [this] {
+            if (_stopping) {
+                return true;
+            }
+            for (const std::unique_ptr<Queue>& queue : _queues) {
+                std::lock_guard<std::mutex> queueLock(queue->mutex);
+                if (!queue->jobs.empty()) {
+                    return true;
+                }
+            }
+            return false;
+        });
+    }
+}
+
+bool WorkStealingPool::takeJob(size_t index, Job& job) {
+    // Own deque first, newest job (warm caches)
+    {
+        Queue& own = *_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+
+    // Then steal the oldest job of another worker
+    for (size_t offset = 1; offset < _queues.size(); offset++) {
+        Queue& victim = *_queues[(index + offset) % _queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            _steals++;
+            return true;
+        }
+    }
+    return false;
+}
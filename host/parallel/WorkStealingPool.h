@@ -0,0 +1,92 @@
+/**
+ * @file WorkStealingPool.h
+ * @brief Thread pool with per-worker deques and work stealing
+ * @author catalina
+ */
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * @brief Runs independent jobs on all cores
+ *
+ * Every worker owns a deque. Jobs are dealt round-robin onto the deques;
+ * a worker takes jobs from the back of its own deque and, when that runs
+ * dry, steals from the front of another worker's deque. Uneven job costs
+ * therefore even out without a central queue every worker contends on.
+ */
+class WorkStealingPool {
+public:
+    // Job body; the argument is the index of the worker running it
+    typedef std::function<void(size_t worker)> Job;
+
+    /**
+     * @brief Start the workers
+     * @param threads Number of workers (0 = one per hardware thread)
+     */
+    explicit WorkStealingPool(size_t threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Queue a job
+     */
+    void submit(Job job);
+
+    /**
+     * @brief Block until every submitted job has finished
+     */
+    void wait();
+
+    /**
+     * @brief Run body(i) for i in [0, count), split into chunks of jobs, and wait
+     *
+     * @param count Number of iterations
+     * @param chunk Iterations per job
+     * @param body Loop body; gets the iteration and the worker index
+     */
+    void parallelFor(size_t count, size_t chunk, const std::function<void(size_t index, size_t worker)>& body);
+
+    size_t size() const { return _workers.size(); }
+
+    /**
+     * @brief Get the number of jobs run by a worker other than the one they were dealt to
+     */
+    size_t getStealCount() const { return _steals.load(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::thread> _workers;
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::atomic<size_t> _nextQueue;
+    std::atomic<size_t> _pending;
+    std::atomic<size_t> _steals;
+    std::atomic<bool> _stopping;
+
+    // Sleeping workers and wait() callers park here
+    std::mutex _sleepMutex;
+    std::condition_variable _workAvailable;
+    std::condition_variable _allDone;
+
+    void workerLoop(size_t index);
+    bool takeJob(size_t index, Job& job);
+};
+
+#endif // WORK_STEALING_POOL_H
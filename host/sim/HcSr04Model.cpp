@@ -0,0 +1,86 @@
+/**
+ * @file HcSr04Model.cpp
+ * @brief Simulated HC-SR04 ultrasonic ranging module implementation
+ * @author catalina
+ */
+
+#include "HcSr04Model.h"
+
+#include <Arduino.h>
+
+HcSr04Model::HcSr04Model(const SimScene& scene, uint8_t trigPin, uint8_t echoPin)
+    : _scene(scene),
+      _trigPin(trigPin),
+      _echoPin(echoPin),
+      _speedOfSound(0.0343f),
+      _noiseUs(0.0f),
+      _rng(1),
+      _trigHigh(false),
+      _trigRiseNs(0),
+      _echoStartNs(0),
+      _echoEndNs(0),
+      _pingCount(0) {
+}
+
+void HcSr04Model::attach(VirtualDevice& device) {
+    device.attachSource(_echoPin, this);
+}
+
+void HcSr04Model::setTemperature(float temperatureC) {
+    _speedOfSound = (331.3f + 0.606f * temperatureC) / 10000.0f;
+}
+
+void HcSr04Model::setNoise(float sigmaUs, uint32_t seed) {
+    _noiseUs = sigmaUs;
+    _rng.seed(seed);
+}
+
+bool HcSr04Model::level(uint64_t timeNs) {
+    return timeNs >= _echoStartNs && timeNs < _echoEndNs;
+}
+
+uint64_t HcSr04Model::nextEdge(uint64_t timeNs) {
+    if (timeNs < _echoStartNs) return _echoStartNs;
+    if (timeNs < _echoEndNs) return _echoEndNs;
+    return NEVER;
+}
+
+void HcSr04Model::onPinWrite(uint8_t pin, uint8_t value, uint64_t timeNs) {
+    if (pin != _trigPin) return;
+
+    if (value == HIGH) {
+        if (!_trigHigh) {
+            _trigHigh = true;
+            _trigRiseNs = timeNs;
+        }
+        return;
+    }
+
+    if (!_trigHigh) return;
+    _trigHigh = false;
+
+    // Too short a trigger pulse, or a measurement still running
+    if (timeNs - _trigRiseNs < 10000 || timeNs < _echoEndNs) {
+        return;
+    }
+
+    _pingCount++;
+    _echoStartNs = timeNs + BURST_DELAY_NS;
+
+    float distance = _scene.at(timeNs).distanceCm;
+    if (distance <= SimScene::NO_OBJECT || distance > MAX_RANGE_CM) {
+        _echoEndNs = _echoStartNs + NO_ECHO_WIDTH_NS;
+        return;
+    }
+    if (distance < MIN_RANGE_CM) {
+        distance = MIN_RANGE_CM;
+    }
+
+    float widthUs = 2.0f * distance / _speedOfSound;
+    if (_noiseUs > 0.0f) {
+        std::normal_distribution<float> jitter(0.0f, _noiseUs);
+        widthUs += jitter(_rng);
+        if (widthUs < 1.0f) widthUs = 1.0f;
+    }
+    _echoEndNs = _echoStartNs + static_cast<uint64_t>(widthUs * 1000.0f);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file HcSr04Model.h
+ * @brief Simulated HC-SR04 ultrasonic ranging module
+ * @author catalina
+ */
+
+#ifndef HC_SR04_MODEL_H
+#define HC_SR04_MODEL_H
+
+#include <VirtualDevice.h>
+#include "SimScene.h"
+#include "../../src/Configuration/SensorConfig.h"
+
+/**
+ * @class HcSr04Model
+ * @brief Echo pin model driven by the trigger pin and the scene distance
+ *
+ * A trigger pulse of at least 10 µs starts a measurement. After the burst
+ * delay the echo pin goes HIGH for the round-trip time of sound to the
+ * object in the scene; without an object it stays HIGH for the module's
+ * 38 ms timeout. Triggers during a running measurement are ignored, as on
+ * the real module.
+ */
+class HcSr04Model : public SignalSource {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param scene Scene providing the object distance (not owned)
+     * @param trigPin Trigger pin watched by the model
+     * @param echoPin Echo pin driven by the model
+     */
+    HcSr04Model(const SimScene& scene,
+                uint8_t trigPin = PinConfig::DistanceSensor::TRIG,
+                uint8_t echoPin = PinConfig::DistanceSensor::ECHO);
+
+    /**
+     * @brief Attach the model to a device's echo pin
+     */
+    void attach(VirtualDevice& device);
+
+    /**
+     * @brief Set the air temperature used for the speed of sound
+     * @param temperatureC Temperature in Celsius
+     */
+    void setTemperature(float temperatureC);
+
+    /**
+     * @brief Add Gaussian jitter to every echo
+     * @param sigmaUs Standard deviation of the echo width in µs
+     * @param seed Random seed
+     */
+    void setNoise(float sigmaUs, uint32_t seed = 1);
+
+    /**
+     * @brief Get the number of measurements started by trigger pulses
+     */
+    uint32_t getPingCount() const { return _pingCount; }
+
+    bool level(uint64_t timeNs) override;
+    uint64_t nextEdge(uint64_t timeNs) override;
+    void onPinWrite(uint8_t pin, uint8_t value, uint64_t timeNs) override;
+
+    // Module timing
+    static const uint32_t BURST_DELAY_NS = 460000;
+    static const uint32_t NO_ECHO_WIDTH_NS = 38000000;
+    static constexpr float MIN_RANGE_CM = 2.0f;
+    static constexpr float MAX_RANGE_CM = 400.0f;
+
+private:
+    const SimScene& _scene;
+    uint8_t _trigPin;
+    uint8_t _echoPin;
+    float _speedOfSound; // cm/µs
+    float _noiseUs;
+    std::mt19937 _rng;
+
+    bool _trigHigh;
+    uint64_t _trigRiseNs;
+    uint64_t _echoStartNs;
+    uint64_t _echoEndNs;
+    uint32_t _pingCount;
+};
+
+#endif // HC_SR04_MODEL_H
@@ -0,0 +1,95 @@
+/**
+ * @file SimScene.cpp
+ * @brief Scripted scene implementation
+ * @author catalina
+ */
+
+#include "SimScene.h"
+
+SimScene::SimScene()
+    : _totalNs(0),
+      _loop(true) {
+}
+
+void SimScene::addSegment(uint32_t durationMs, float startCm, float endCm, float red, float green, float blue) {
+    Segment segment;
+    segment.startNs = _totalNs;
+    segment.durationNs = static_cast<uint64_t>(durationMs) * 1000000;
+    segment.startCm = startCm;
+    segment.endCm = endCm;
+    segment.red = red;
+    segment.green = green;
+    segment.blue = blue;
+
+    _segments.push_back(segment);
+    _totalNs += segment.durationNs;
+}
+
+void SimScene::hold(uint32_t durationMs, float distanceCm, float red, float green, float blue) {
+    addSegment(durationMs, distanceCm, distanceCm, red, green, blue);
+}
+
+void SimScene::empty(uint32_t durationMs) {
+    addSegment(durationMs, NO_OBJECT, NO_OBJECT, 0.0f, 0.0f, 0.0f);
+}
+
+void SimScene::setScript(const std::function<SceneState(uint64_t)>& script) {
+    _script = script;
+}
+
+SceneState SimScene::at(uint64_t timeNs) const {
+    if (_script) {
+        return _script(timeNs);
+    }
+
+    SceneState state = { NO_OBJECT, 0.0f, 0.0f, 0.0f };
+    if (_segments.empty() || _totalNs == 0) {
+        return state;
+    }
+
+    if (timeNs >= _totalNs) {
+        if (!_loop) {
+            const Segment& last = _segments.back();
+            state.distanceCm = last.endCm;
+            state.red = last.red;
+            state.green = last.green;
+            state.blue = last.blue;
+            return state;
+        }
+        timeNs %= _totalNs;
+    }
+
+    // Segments are few; a linear scan is cheaper than keeping an index
+    for (size_t i = 0; i < _segments.size(); i++) {
+        const Segment& segment = _segments[i];
+        if (timeNs < segment.startNs + segment.durationNs) {
+            float progress = static_cast<float>(timeNs - segment.startNs) / segment.durationNs;
+            state.distanceCm = segment.startCm + (segment.endCm - segment.startCm) * progress;
+            state.red = segment.red;
+            state.green = segment.green;
+            state.blue = segment.blue;
+            return state;
+        }
+    }
+
+    return state;
+}
+
+SimScene SimScene::demo() {
+    SimScene scene;
+
+    scene.empty(3000);
+    scene.addSegment(4000, 80.0f, 6.0f, 0.9f, 0.15f, 0.1f);   // Red object approaching
+    scene.hold(6000, 6.0f, 0.9f, 0.15f, 0.1f);
+    scene.addSegment(2000, 6.0f, 60.0f, 0.9f, 0.15f, 0.1f);
+    scene.empty(2000);
+    scene.addSegment(3000, 45.0f, 5.0f, 0.1f, 0.85f, 0.2f);   // Green object
+    scene.hold(6000, 5.0f, 0.1f, 0.85f, 0.2f);
+    scene.addSegment(2000, 5.0f, 30.0f, 0.1f, 0.85f, 0.2f);
+    scene.addSegment(3000, 30.0f, 4.0f, 0.1f, 0.2f, 0.9f);    // Blue object
+    scene.hold(6000, 4.0f, 0.1f, 0.2f, 0.9f);
+    scene.addSegment(1500, 4.0f, 120.0f, 0.1f, 0.2f, 0.9f);
+    scene.empty(2000);
+
+    return scene;
+}
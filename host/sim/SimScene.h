@@ -0,0 +1,103 @@
+/**
+ * @file SimScene.h
+ * @brief Scripted scene in front of the simulated sensors
+ * @author catalina
+ */
+
+#ifndef SIM_SCENE_H
+#define SIM_SCENE_H
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief What the sensors see at one instant
+ *
+ * Reflectances are 0.0 (absorbs the channel) to 1.0 (white reference).
+ * A distance of NO_OBJECT means nothing is in range of either sensor.
+ */
+struct SceneState {
+    float distanceCm;
+    float red;
+    float green;
+    float blue;
+};
+
+/**
+ * @class SimScene
+ * @brief Timeline of objects moving in front of the sensors
+ *
+ * A scene is either a list of segments (constant color, distance moving
+ * linearly from a start to an end value) or an arbitrary function of
+ * virtual time. Segment timelines loop by default so long runs keep
+ * exercising every case.
+ */
+class SimScene {
+public:
+    SimScene();
+
+    /**
+     * @brief Append a segment to the timeline
+     *
+     * @param durationMs Segment length in ms
+     * @param startCm Distance at the start of the segment
+     * @param endCm Distance at the end of the segment
+     * @param red Red reflectance (0.0-1.0)
+     * @param green Green reflectance (0.0-1.0)
+     * @param blue Blue reflectance (0.0-1.0)
+     */
+    void addSegment(uint32_t durationMs, float startCm, float endCm, float red, float green, float blue);
+
+    /**
+     * @brief Append a segment with a static object
+     */
+    void hold(uint32_t durationMs, float distanceCm, float red, float green, float blue);
+
+    /**
+     * @brief Append a segment with nothing in range
+     */
+    void empty(uint32_t durationMs);
+
+    /**
+     * @brief Replace the timeline by an arbitrary function of virtual time (ns)
+     */
+    void setScript(const std::function<SceneState(uint64_t)>& script);
+
+    /**
+     * @brief Choose whether the segment timeline repeats
+     */
+    void setLoop(bool loop) { _loop = loop; }
+
+    /**
+     * @brief Get the scene at a point in virtual time
+     * @param timeNs Virtual time in ns
+     * @return Scene state
+     */
+    SceneState at(uint64_t timeNs) const;
+
+    /**
+     * @brief Objects of each color passing in front of the sensors
+     */
+    static SimScene demo();
+
+    static constexpr float NO_OBJECT = 0.0f;
+
+private:
+    struct Segment {
+        uint64_t startNs;
+        uint64_t durationNs;
+        float startCm;
+        float endCm;
+        float red;
+        float green;
+        float blue;
+    };
+
+    std::vector<Segment> _segments;
+    uint64_t _totalNs;
+    bool _loop;
+    std::function<SceneState(uint64_t)> _script;
+};
+
+#endif // SIM_SCENE_H
@@ -0,0 +1,155 @@
+/**
+ * @file Tcs230Model.cpp
+ * @brief Simulated TCS230 color-light-to-frequency converter implementation
+ * @author catalina
+ */
+
+#include "Tcs230Model.h"
+
+#include <Arduino.h>
+
+namespace {
+    enum Channel { CHANNEL_RED, CHANNEL_GREEN, CHANNEL_BLUE, CHANNEL_CLEAR };
+
+    // Pulse widths at 20% scaling for a white reference and for darkness
+    const float BRIGHT_PULSE_US[] = {
+        CalibrationSettings::ColorSensor::RED_MIN,
+        CalibrationSettings::ColorSensor::GREEN_MIN,
+        CalibrationSettings::ColorSensor::BLUE_MIN,
+        CalibrationSettings::ColorSensor::RED_MIN
+    };
+    const float DARK_PULSE_US[] = {
+        CalibrationSettings::ColorSensor::RED_MAX,
+        CalibrationSettings::ColorSensor::GREEN_MAX,
+        CalibrationSettings::ColorSensor::BLUE_MAX,
+        CalibrationSettings::ColorSensor::GREEN_MAX
+    };
+}
+
+Tcs230Model::Tcs230Model(const SimScene& scene, uint8_t s0Pin, uint8_t s1Pin, uint8_t s2Pin,
+                         uint8_t s3Pin, uint8_t outPin)
+    : _scene(scene),
+      _pins{ s0Pin, s1Pin, s2Pin, s3Pin, outPin },
+      _levels{ LOW, LOW, LOW, LOW },
+      _noise(0.0f),
+      _darkPulseUs(0.0f),
+      _rng(1),
+      _originNs(0),
+      _halfPeriodNs(0) {
+}
+
+void Tcs230Model::attach(VirtualDevice& device) {
+    device.attachSource(_pins[4], this);
+}
+
+void Tcs230Model::setNoise(float sigmaFraction, uint32_t seed) {
+    _noise = sigmaFraction;
+    _rng.seed(seed);
+}
+
+void Tcs230Model::setDarkPulse(float pulseUs) {
+    _darkPulseUs = pulseUs;
+}
+
+float Tcs230Model::getFrequency() const {
+    return _halfPeriodNs > 0 ? 1e9f / (2.0f * _halfPeriodNs) : 0.0f;
+}
+
+bool Tcs230Model::level(uint64_t timeNs) {
+    refresh(timeNs);
+    if (_halfPeriodNs == 0) {
+        return false;
+    }
+
+    uint64_t period = 2 * _halfPeriodNs;
+    uint64_t phase = timeNs >= _originNs
+        ? (timeNs - _originNs) % period
+        : (period - (_originNs - timeNs) % period) % period;
+    return phase < _halfPeriodNs;
+}
+
+uint64_t Tcs230Model::nextEdge(uint64_t timeNs) {
+    refresh(timeNs);
+    if (_halfPeriodNs == 0) {
+        return NEVER;
+    }
+
+    uint64_t period = 2 * _halfPeriodNs;
+    uint64_t phase = timeNs >= _originNs
+        ? (timeNs - _originNs) % period
+        : (period - (_originNs - timeNs) % period) % period;
+    return phase < _halfPeriodNs
+        ? timeNs + (_halfPeriodNs - phase)
+        : timeNs + (period - phase);
+}
+
+void Tcs230Model::onPinWrite(uint8_t pin, uint8_t value, uint64_t timeNs) {
+    for (uint8_t i = 0; i < 4; i++) {
+        if (_pins[i] == pin && _levels[i] != value) {
+            _levels[i] = value;
+            reanchor(timeNs);
+            return;
+        }
+    }
+}
+
+void Tcs230Model::reanchor(uint64_t timeNs) {
+    _originNs = timeNs;
+    float frequency = computeFrequency(timeNs);
+    _halfPeriodNs = frequency > 0.0f ? static_cast<uint64_t>(1e9f / (2.0f * frequency)) : 0;
+}
+
+void Tcs230Model::refresh(uint64_t timeNs) {
+    if (timeNs < _originNs + RESAMPLE_NS) {
+        return;
+    }
+
+    // Move the origin to the last period boundary so the waveform stays continuous
+    uint64_t origin = timeNs;
+    if (_halfPeriodNs > 0) {
+        uint64_t period = 2 * _halfPeriodNs;
+        origin = _originNs + (timeNs - _originNs) / period * period;
+    }
+    reanchor(origin);
+}
+
+float Tcs230Model::computeFrequency(uint64_t timeNs) {
+    // S0/S1 select the output scaling in percent
+    static const float SCALING_PERCENT[] = { 0.0f, 2.0f, 20.0f, 100.0f };
+    float scaling = SCALING_PERCENT[(_levels[0] << 1) | _levels[1]];
+    if (scaling == 0.0f) {
+        return 0.0f; // Powered down
+    }
+
+    // S2/S3 select the photodiode type
+    static const Channel FILTERS[] = { CHANNEL_RED, CHANNEL_BLUE, CHANNEL_CLEAR, CHANNEL_GREEN };
+    Channel channel = FILTERS[(_levels[2] << 1) | _levels[3]];
+
+    SceneState scene = _scene.at(timeNs);
+    float reflectance;
+    switch (channel) {
+        case CHANNEL_RED: reflectance = scene.red; break;
+        case CHANNEL_GREEN: reflectance = scene.green; break;
+        case CHANNEL_BLUE: reflectance = scene.blue; break;
+        default: reflectance = (scene.red + scene.green + scene.blue) / 3.0f; break;
+    }
+
+    // Reflected light falls off with the square of the distance
+    float gain = 0.0f;
+    if (scene.distanceCm > SimScene::NO_OBJECT) {
+        gain = scene.distanceCm <= FULL_SIGNAL_RANGE_CM
+            ? 1.0f
+            : (FULL_SIGNAL_RANGE_CM * FULL_SIGNAL_RANGE_CM) / (scene.distanceCm * scene.distanceCm);
+    }
+
+    float brightHz = 1e6f / (2.0f * BRIGHT_PULSE_US[channel]);
+    float darkHz = 1e6f / (2.0f * (_darkPulseUs > 0.0f ? _darkPulseUs : DARK_PULSE_US[channel]));
+    float frequency = darkHz + (brightHz - darkHz) * constrain(reflectance * gain, 0.0f, 1.0f);
+
+    if (_noise > 0.0f) {
+        std::normal_distribution<float> jitter(1.0f, _noise);
+        frequency *= max(jitter(_rng), 0.1f);
+    }
+
+    return frequency * scaling / 20.0f;
+}
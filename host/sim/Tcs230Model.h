@@ -0,0 +1,99 @@
+/**
+ * @file Tcs230Model.h
+ * @brief Simulated TCS230 color-light-to-frequency converter
+ * @author catalina
+ */
+
+#ifndef TCS230_MODEL_H
+#define TCS230_MODEL_H
+
+#include <VirtualDevice.h>
+#include "SimScene.h"
+#include "../../src/Configuration/SensorConfig.h"
+
+/**
+ * @class Tcs230Model
+ * @brief OUT pin model driven by the select lines and the scene color
+ *
+ * OUT is a 50% duty square wave whose frequency is linear in the light
+ * reaching the selected photodiodes. The per-channel frequency range is
+ * taken from the default calibration, so a white reference at close range
+ * reads as the calibrated minimum pulse width and darkness as the maximum.
+ * S0/S1 scale the frequency (S0=S1=LOW powers the output down) and S2/S3
+ * select the red, green, blue or clear photodiodes.
+ */
+class Tcs230Model : public SignalSource {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param scene Scene providing the object color and distance (not owned)
+     * @param s0Pin S0 frequency scaling selection pin
+     * @param s1Pin S1 frequency scaling selection pin
+     * @param s2Pin S2 photodiode selection pin
+     * @param s3Pin S3 photodiode selection pin
+     * @param outPin Output frequency pin driven by the model
+     */
+    Tcs230Model(const SimScene& scene,
+                uint8_t s0Pin = PinConfig::ColorSensor::S0,
+                uint8_t s1Pin = PinConfig::ColorSensor::S1,
+                uint8_t s2Pin = PinConfig::ColorSensor::S2,
+                uint8_t s3Pin = PinConfig::ColorSensor::S3,
+                uint8_t outPin = PinConfig::ColorSensor::OUT);
+
+    /**
+     * @brief Attach the model to a device's OUT pin
+     */
+    void attach(VirtualDevice& device);
+
+    /**
+     * @brief Add Gaussian frequency jitter
+     * @param sigmaFraction Standard deviation relative to the frequency
+     * @param seed Random seed
+     */
+    void setNoise(float sigmaFraction, uint32_t seed = 1);
+
+    /**
+     * @brief Set the pulse width of darkness on every channel
+     *
+     * A real TCS230 facing a black surface drops to a few Hz, far below
+     * the calibrated maximum, and pulseIn() then waits for most of a
+     * period. The default keeps darkness at the calibrated maximum.
+     *
+     * @param pulseUs LOW time at 20% scaling in µs (0 = calibrated maximum)
+     */
+    void setDarkPulse(float pulseUs);
+
+    /**
+     * @brief Get the current output frequency in Hz (0 when powered down)
+     */
+    float getFrequency() const;
+
+    bool level(uint64_t timeNs) override;
+    uint64_t nextEdge(uint64_t timeNs) override;
+    void onPinWrite(uint8_t pin, uint8_t value, uint64_t timeNs) override;
+
+    // Object distance up to which the sensor sees the full reflected light
+    static constexpr float FULL_SIGNAL_RANGE_CM = 8.0f;
+
+    // Interval after which the scene is sampled again
+    static const uint64_t RESAMPLE_NS = 1000000;
+
+private:
+    const SimScene& _scene;
+    uint8_t _pins[5];
+    uint8_t _levels[4];
+    float _noise;
+    float _darkPulseUs;
+    std::mt19937 _rng;
+
+    uint64_t _originNs;
+    uint64_t _halfPeriodNs;
+
+    // Helper methods
+    void reanchor(uint64_t timeNs);
+    void refresh(uint64_t timeNs);
+    float computeFrequency(uint64_t timeNs);
+};
+
+#endif // TCS230_MODEL_H
@@ -0,0 +1,35 @@
+/**
+ * @file TelemetryCapture.cpp
+ * @brief Captured serial telemetry parser implementation
+ * @author catalina
+ */
+
+#include "TelemetryCapture.h"
+
+#include <stdio.h>
+
+TelemetryCapture::TelemetryCapture() {
+}
+
+bool TelemetryCapture::load(const char* path) {
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        data.insert(data.end(), chunk, chunk + count);
+    }
+    fclose(in);
+
+    parse(data);
+    return true;
+}
+
+void TelemetryCapture::parse(const std::vector<uint8_t>& data) {
+    _stream.feed(data.data(), data.size(), _frames);
+    _stream.finish(_frames);
+}
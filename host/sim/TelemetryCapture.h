@@ -0,0 +1,51 @@
+/**
+ * @file TelemetryCapture.h
+ * @brief Parser for a captured serial telemetry stream
+ * @author catalina
+ */
+
+#ifndef TELEMETRY_CAPTURE_H
+#define TELEMETRY_CAPTURE_H
+
+#include "TelemetryStream.h"
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @class TelemetryCapture
+ * @brief Splits a raw serial capture into readings and raw samples
+ *
+ * The parser resynchronises on the frame sync bytes and rejects frames with
+ * a bad CRC, so text interleaved in the capture is skipped. Each parse()
+ * is a complete stream; use TelemetryStream for bytes still arriving.
+ */
+class TelemetryCapture {
+public:
+    TelemetryCapture();
+
+    /**
+     * @brief Parse a capture file
+     * @param path File with the raw serial bytes
+     * @return false if the file could not be read
+     */
+    bool load(const char* path);
+
+    /**
+     * @brief Parse captured bytes, appending to what was parsed before
+     */
+    void parse(const std::vector<uint8_t>& data);
+
+    const std::vector<TelemetryRecord>& readings() const { return _frames.readings; }
+    const std::vector<TelemetrySample>& samples() const { return _frames.samples; }
+
+    unsigned long getBadFrames() const { return _stream.getBadFrames(); }
+    unsigned long getSkippedBytes() const { return _stream.getSkippedBytes(); }
+    unsigned long getSequenceGaps() const { return _stream.getSequenceGaps(); }
+
+private:
+    TelemetryStream _stream;
+    TelemetryBatch _frames;
+};
+
+#endif // TELEMETRY_CAPTURE_H
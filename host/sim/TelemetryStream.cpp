@@ -0,0 +1,98 @@
+/**
+ * @file TelemetryStream.cpp
+ * @brief Incremental serial telemetry decoder implementation
+ * @author catalina
+ */
+
+#include "TelemetryStream.h"
+
+TelemetryStream::TelemetryStream()
+    : _badFrames(0),
+      _skippedBytes(0),
+      _sequenceGaps(0),
+      _lastSequence(-1) {
+}
+
+void TelemetryStream::feed(const uint8_t* data, size_t size, TelemetryBatch& batch) {
+    if (_pending.empty()) {
+        size_t used = scan(data, size, false, batch);
+        _pending.assign(data + used, data + size);
+        return;
+    }
+
+    _pending.insert(_pending.end(), data, data + size);
+    size_t used = scan(_pending.data(), _pending.size(), false, batch);
+    _pending.erase(_pending.begin(), _pending.begin() + used);
+}
+
+void TelemetryStream::finish(TelemetryBatch& batch) {
+    scan(_pending.data(), _pending.size(), true, batch);
+    _pending.clear();
+}
+
+size_t TelemetryStream::scan(const uint8_t* data, size_t size, bool final, TelemetryBatch& batch) {
+    size_t i = 0;
+    while (i + 3 <= size) {
+        if (data[i] != Telemetry::SYNC_1 || data[i + 1] != Telemetry::SYNC_2) {
+            _skippedBytes++;
+            i++;
+            continue;
+        }
+
+        uint8_t frameSize = Telemetry::getFrameSize(data[i + 2]);
+        if (frameSize != 0 && i + frameSize > size && !final) {
+            // The rest of the frame comes with the next chunk
+            return i;
+        }
+        if (frameSize == 0 || i + frameSize > size) {
+            _badFrames++;
+            _skippedBytes++;
+            i++;
+            continue;
+        }
+
+        bool valid = false;
+        if (data[i + 2] == Telemetry::TYPE_READING) {
+            TelemetryRecord record;
+            valid = Telemetry::decode(&data[i], record);
+            if (valid) {
+                checkSequence(record.sequence);
+                batch.readings.push_back(record);
+            }
+        } else {
+            TelemetrySample sample;
+            valid = Telemetry::decodeSample(&data[i], sample);
+            if (valid) {
+                checkSequence(sample.sequence);
+                batch.samples.push_back(sample);
+            }
+        }
+
+        if (!valid) {
+            // Sync bytes inside text or a damaged frame: resynchronise one byte on
+            _badFrames++;
+            _skippedBytes++;
+            i++;
+            continue;
+        }
+        i += frameSize;
+    }
+
+    if (final) {
+        _skippedBytes += size - i;
+        return size;
+    }
+    // A sync byte at the very end may start the next frame
+    while (i < size && data[i] != Telemetry::SYNC_1) {
+        _skippedBytes++;
+        i++;
+    }
+    return i;
+}
+
+void TelemetryStream::checkSequence(uint8_t sequence) {
+    if (_lastSequence >= 0 && sequence != static_cast<uint8_t>(_lastSequence + 1)) {
+        _sequenceGaps++;
+    }
+    _lastSequence = sequence;
+}
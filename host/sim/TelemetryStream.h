@@ -0,0 +1,74 @@
+/**
+ * @file TelemetryStream.h
+ * @brief Incremental decoder for a serial telemetry stream
+ * @author catalina
+ */
+
+#ifndef TELEMETRY_STREAM_H
+#define TELEMETRY_STREAM_H
+
+#include "../../src/Telemetry/Telemetry.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief Frames decoded from one or more chunks of a stream
+ */
+struct TelemetryBatch {
+    std::vector<TelemetryRecord> readings;
+    std::vector<TelemetrySample> samples;
+
+    void clear() {
+        readings.clear();
+        samples.clear();
+    }
+
+    bool empty() const { return readings.empty() && samples.empty(); }
+};
+
+/**
+ * @class TelemetryStream
+ * @brief Splits serial bytes into frames as they arrive
+ *
+ * Chunks may end anywhere, also inside a frame: the start of an unfinished
+ * frame is kept until the next chunk completes it. Like TelemetryCapture,
+ * the decoder resynchronises on the sync bytes, so text and damaged frames
+ * are skipped, and counts sequence gaps across readings and samples.
+ */
+class TelemetryStream {
+public:
+    TelemetryStream();
+
+    /**
+     * @brief Decode a chunk, appending its complete frames to a batch
+     * @param data Received bytes
+     * @param size Number of bytes
+     * @param batch Destination
+     */
+    void feed(const uint8_t* data, size_t size, TelemetryBatch& batch);
+
+    /**
+     * @brief End the stream: whatever is still pending is skipped
+     * @param batch Destination for frames found in the pending bytes
+     */
+    void finish(TelemetryBatch& batch);
+
+    unsigned long getBadFrames() const { return _badFrames; }
+    unsigned long getSkippedBytes() const { return _skippedBytes; }
+    unsigned long getSequenceGaps() const { return _sequenceGaps; }
+    size_t getPendingBytes() const { return _pending.size(); }
+
+private:
+    std::vector<uint8_t> _pending;  // Unfinished frame from the last chunk
+    unsigned long _badFrames;
+    unsigned long _skippedBytes;
+    unsigned long _sequenceGaps;
+    int _lastSequence;
+
+    size_t scan(const uint8_t* data, size_t size, bool final, TelemetryBatch& batch);
+    void checkSequence(uint8_t sequence);
+};
+
+#endif // TELEMETRY_STREAM_H
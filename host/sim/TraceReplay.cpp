@@ -0,0 +1,72 @@
+/**
+ * @file TraceReplay.cpp
+ * @brief Recorded pulse width replay implementation
+ * @author catalina
+ */
+
+#include "TraceReplay.h"
+
+#include <Arduino.h>
+
+TraceReplay::TraceReplay(uint8_t echoPin, uint8_t s2Pin, uint8_t s3Pin, uint8_t outPin)
+    : _echoPin(echoPin),
+      _s2Pin(s2Pin),
+      _s3Pin(s3Pin),
+      _outPin(outPin),
+      _device(nullptr),
+      _underruns(0) {
+    rewind();
+}
+
+void TraceReplay::add(const TraceSample& sample) {
+    uint8_t channel = static_cast<uint8_t>(sample.channel);
+    if (channel >= CHANNEL_COUNT) {
+        return;
+    }
+    _samples.push_back(sample);
+    _channels[channel].push_back(sample.value);
+}
+
+void TraceReplay::attach(VirtualDevice& device) {
+    _device = &device;
+    device.setPulseProvider(this);
+}
+
+void TraceReplay::rewind() {
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        _cursors[i] = 0;
+    }
+    _underruns = 0;
+}
+
+bool TraceReplay::nextPulse(uint8_t pin, uint8_t state, unsigned long& widthUs) {
+    (void)state;
+
+    TraceChannel channel;
+    if (pin == _echoPin) {
+        channel = TraceChannel::ECHO;
+    } else if (pin == _outPin && _device != nullptr) {
+        // Same select-line decoding as the TCS230 (the clear photodiode is never traced)
+        bool s2 = _device->outputLevel(_s2Pin) == HIGH;
+        bool s3 = _device->outputLevel(_s3Pin) == HIGH;
+        if (!s2) {
+            channel = s3 ? TraceChannel::COLOR_BLUE : TraceChannel::COLOR_RED;
+        } else if (s3) {
+            channel = TraceChannel::COLOR_GREEN;
+        } else {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    uint8_t index = static_cast<uint8_t>(channel);
+    if (_cursors[index] >= _channels[index].size()) {
+        _underruns++;
+        widthUs = 0;
+        return true;
+    }
+
+    widthUs = _channels[index][_cursors[index]++];
+    return true;
+}
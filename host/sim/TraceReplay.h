@@ -0,0 +1,84 @@
+/**
+ * @file TraceReplay.h
+ * @brief Feeds recorded pulse widths back into the sensor drivers
+ * @author catalina
+ */
+
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <VirtualDevice.h>
+#include "../../src/Configuration/SensorConfig.h"
+#include "../../src/SensorTrace/SensorTrace.h"
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief One recorded raw driver input
+ */
+struct TraceSample {
+    uint64_t timestamp;     // µs
+    TraceChannel channel;
+    uint16_t value;         // Pulse width in µs
+};
+
+/**
+ * @class TraceReplay
+ * @brief Answers the drivers' pulseIn() calls from a recorded trace
+ *
+ * Echo measurements get the next recorded echo width; color measurements
+ * get the next recorded width of the channel selected by S2/S3 at the time
+ * of the call. No pin is simulated, so replay runs as fast as the driver
+ * code itself.
+ */
+class TraceReplay : public PulseProvider {
+public:
+    TraceReplay(uint8_t echoPin = PinConfig::DistanceSensor::ECHO,
+                uint8_t s2Pin = PinConfig::ColorSensor::S2,
+                uint8_t s3Pin = PinConfig::ColorSensor::S3,
+                uint8_t outPin = PinConfig::ColorSensor::OUT);
+
+    /**
+     * @brief Append a recorded sample
+     */
+    void add(const TraceSample& sample);
+
+    /**
+     * @brief Answer pulseIn() calls on a device from now on
+     */
+    void attach(VirtualDevice& device);
+
+    /**
+     * @brief Rewind every channel to its first sample
+     */
+    void rewind();
+
+    /**
+     * @brief Get all samples in recording order
+     */
+    const std::vector<TraceSample>& samples() const { return _samples; }
+
+    /**
+     * @brief Get the number of pulseIn() calls that found their channel exhausted
+     */
+    uint32_t getUnderruns() const { return _underruns; }
+
+    bool nextPulse(uint8_t pin, uint8_t state, unsigned long& widthUs) override;
+
+private:
+    static const uint8_t CHANNEL_COUNT = static_cast<uint8_t>(TraceChannel::CHANNEL_COUNT);
+
+    uint8_t _echoPin;
+    uint8_t _s2Pin;
+    uint8_t _s3Pin;
+    uint8_t _outPin;
+    VirtualDevice* _device;
+
+    std::vector<TraceSample> _samples;
+    std::vector<uint16_t> _channels[CHANNEL_COUNT];
+    size_t _cursors[CHANNEL_COUNT];
+    uint32_t _underruns;
+};
+
+#endif // TRACE_REPLAY_H
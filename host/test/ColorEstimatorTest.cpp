@@ -0,0 +1,95 @@
+/**
+ * @file ColorEstimatorTest.cpp
+ * @brief Checks of the sequential color decision against the noisy TCS230 model
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <VirtualDevice.h>
+#include <SimScene.h>
+#include <Tcs230Model.h>
+
+#include <ColorEstimator.h>
+#include <ColorSensor.h>
+
+namespace {
+    // Sequential detection of a surface held in front of the sensor, with
+    // the channel frequencies jittered by the given fraction
+    ColorIdentifier detectSequential(ColorEstimator& estimator, float red, float green, float blue, float noise) {
+        VirtualDevice device;
+        VirtualDevice::Scope scope(device);
+        SimScene scene;
+        scene.hold(10000, 3.0f, red, green, blue);
+        Tcs230Model model(scene);
+        model.setNoise(noise, 7);
+        model.attach(device);
+
+        ColorSensor sensor;
+        sensor.begin();
+        return sensor.detectColorSequential(estimator, SystemSettings::COLOR_MAX_SAMPLES);
+    }
+}
+
+TEST_CASE(meanAndVarianceOfTheReadings) {
+    ColorEstimator estimator;
+    CHECK(estimator.getColor() == ColorIdentifier::NONE);
+
+    estimator.add(200, 40, 10);
+    CHECK(estimator.getMargin() == 0.0f);
+    CHECK(!estimator.isConfident());
+
+    estimator.add(210, 50, 20);
+    estimator.add(220, 60, 30);
+    CHECK(estimator.getCount() == 3);
+    CHECK_NEAR(estimator.getMean(ColorSensor::CHANNEL_RED), 210.0f, 0.01f);
+    CHECK_NEAR(estimator.getMean(ColorSensor::CHANNEL_BLUE), 20.0f, 0.01f);
+    CHECK_NEAR(estimator.getVariance(ColorSensor::CHANNEL_GREEN), 100.0f, 0.01f);
+    CHECK(estimator.getColor() == ColorIdentifier::RED);
+
+    estimator.reset();
+    CHECK(estimator.getCount() == 0);
+    CHECK(estimator.getMean(ColorSensor::CHANNEL_RED) == 0.0f);
+}
+
+TEST_CASE(clearColorStopsAfterMinSamples) {
+    ColorEstimator estimator;
+    CHECK(detectSequential(estimator, 0.9f, 0.15f, 0.1f, 0.03f) == ColorIdentifier::RED);
+    CHECK(estimator.isConfident());
+    CHECK(estimator.getCount() == ColorEstimator::MIN_SAMPLES);
+
+    CHECK(detectSequential(estimator, 0.1f, 0.2f, 0.9f, 0.03f) == ColorIdentifier::BLUE);
+    CHECK(estimator.getCount() == ColorEstimator::MIN_SAMPLES);
+}
+
+TEST_CASE(darkAndGreySurfacesAreNoColor) {
+    ColorEstimator estimator;
+
+    // Every channel below the threshold; the noise on the long dark pulses
+    // takes a few more readings to rule out a color
+    CHECK(detectSequential(estimator, 0.0f, 0.0f, 0.0f, 0.03f) == ColorIdentifier::NONE);
+    CHECK(estimator.isConfident());
+    CHECK(estimator.getCount() < SystemSettings::COLOR_MAX_SAMPLES);
+    for (uint8_t channel = ColorSensor::CHANNEL_RED; channel <= ColorSensor::CHANNEL_BLUE; channel++) {
+        CHECK(estimator.getMean(channel) < SystemSettings::COLOR_DETECTION_THRESHOLD);
+    }
+
+    // Bright, but no channel leads
+    CHECK(detectSequential(estimator, 0.8f, 0.8f, 0.8f, 0.03f) == ColorIdentifier::NONE);
+    CHECK(estimator.isConfident());
+    CHECK(estimator.getCount() == ColorEstimator::MIN_SAMPLES);
+}
+
+TEST_CASE(borderlineColorRunsToTheCap) {
+    // Red leads green by about the threshold, so the noise can tip it either way
+    ColorEstimator estimator;
+    detectSequential(estimator, 0.4f, 0.25f, 0.05f, 0.05f);
+    CHECK(!estimator.isConfident());
+    CHECK(estimator.getCount() == SystemSettings::COLOR_MAX_SAMPLES);
+
+    // A clearer lead settles before the cap, but after the minimum
+    CHECK(detectSequential(estimator, 0.45f, 0.25f, 0.05f, 0.05f) == ColorIdentifier::RED);
+    CHECK(estimator.isConfident());
+    CHECK(estimator.getCount() > ColorEstimator::MIN_SAMPLES);
+    CHECK(estimator.getCount() < SystemSettings::COLOR_MAX_SAMPLES);
+}
@@ -0,0 +1,236 @@
+/**
+ * @file DriverTest.cpp
+ * @brief Checks of what the output drivers do to the simulated board
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <VirtualDevice.h>
+
+#include <AudioManager.h>
+#include <DisplayManager.h>
+#include <LedManager.h>
+#include <OutputStage.h>
+
+namespace {
+    const uint16_t lowMelody[] = { 262, 294, 330, 349 };
+    const uint16_t highMelody[] = { 1760 };
+    const uint8_t quarterNotes[] = { 4, 4, 4, 4 };
+
+    // Time an output pin spends high over a span of virtual time
+    class DutyProbe : public SignalSource {
+    public:
+        explicit DutyProbe(uint8_t pin) : _pin(pin), _high(false), _sinceNs(0), _highNs(0) {}
+
+        bool level(uint64_t) override { return false; }
+        uint64_t nextEdge(uint64_t) override { return NEVER; }
+
+        void onPinWrite(uint8_t pin, uint8_t value, uint64_t timeNs) override {
+            if (pin != _pin) {
+                return;
+            }
+            if (_high) {
+                _highNs += timeNs - _sinceNs;
+            }
+            _high = value == HIGH;
+            _sinceNs = timeNs;
+        }
+
+        void restart(uint64_t timeNs) {
+            _sinceNs = timeNs;
+            _highNs = 0;
+        }
+
+        double duty(uint64_t startNs, uint64_t endNs) const {
+            uint64_t high = _highNs + (_high ? endNs - _sinceNs : 0);
+            return static_cast<double>(high) / (endNs - startNs);
+        }
+
+    private:
+        uint8_t _pin;
+        bool _high;
+        uint64_t _sinceNs;
+        uint64_t _highNs;
+    };
+
+    // Pin with no model behind it; only observes the writes
+    const uint8_t PROBE_PIN = 40;
+}
+
+TEST_CASE(displayShowsDistance) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    DisplayManager display;
+    display.begin();
+
+    display.displayDistance(12.34f);
+    const LcdPanel* panel = device.findLcd(0x27);
+    if (!CHECK(panel != nullptr && panel->lines.size() == 2)) {
+        return;
+    }
+    CHECK(panel->lines[0].compare(0, 9, "Distance:") == 0);
+    CHECK(panel->lines[1].find("12.3 cm") != std::string::npos);
+    CHECK(panel->backlight);
+
+    display.setBacklight(false);
+    CHECK(!panel->backlight);
+}
+
+TEST_CASE(colorReadoutOnlyOnTallDisplays) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    DisplayManager small;
+    DisplayManager tall(0x26, 20, 4);
+    LedManager leds;
+    AudioManager audio;
+    small.begin();
+    tall.begin();
+    OutputStage smallStage(small, leds, audio, 1);
+    OutputStage tallStage(tall, leds, audio, 1);
+
+    smallStage.showColor(ColorIdentifier::RED, 200, 35, 7);
+    tallStage.showColor(ColorIdentifier::RED, 200, 35, 7);
+    smallStage.render();
+    tallStage.render();
+
+    const LcdPanel* smallPanel = device.findLcd(0x27);
+    const LcdPanel* tallPanel = device.findLcd(0x26);
+    if (!CHECK(smallPanel != nullptr && tallPanel != nullptr && tallPanel->lines.size() == 4)) {
+        return;
+    }
+    CHECK(smallPanel->lines[1].find("Red") != std::string::npos);
+    CHECK(tallPanel->lines[1].find("Red") != std::string::npos);
+    CHECK(tallPanel->lines[2].find("R:200 G:35 B:7") != std::string::npos);
+    CHECK(smallPanel->lines.size() == 2);
+}
+
+TEST_CASE(colorAfterPulseLightsTheLed) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    DisplayManager display;
+    LedManager leds;
+    AudioManager audio;
+    display.begin();
+    leds.begin();
+    OutputStage output(display, leds, audio, 1);
+
+    // Color mode starts with a green pulse; a green object must then light the LED
+    output.pulseLed(ColorIdentifier::GREEN, 2);
+    delay(300);
+    output.showColor(ColorIdentifier::GREEN, 20, 200, 30);
+    for (int i = 0; i < 150; i++) {
+        delay(20);
+        leds.update();
+    }
+    CHECK(!leds.isEffectActive());
+    CHECK(SoftPwm::read(PinConfig::LEDs::GREEN) == 255);
+    CHECK(device.outputLevel(PinConfig::LEDs::GREEN) == HIGH);
+}
+
+TEST_CASE(ledsLightOneColorAtATime) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    LedManager leds;
+    leds.begin();
+
+    leds.setLed(ColorIdentifier::RED);
+    CHECK(device.outputLevel(PinConfig::LEDs::RED) == HIGH);
+    CHECK(device.outputLevel(PinConfig::LEDs::GREEN) == LOW);
+
+    leds.setLed(ColorIdentifier::GREEN);
+    CHECK(device.outputLevel(PinConfig::LEDs::RED) == LOW);
+    CHECK(device.outputLevel(PinConfig::LEDs::GREEN) == HIGH);
+    CHECK(!leds.isModulating());
+
+    leds.allOff();
+    CHECK(device.outputLevel(PinConfig::LEDs::GREEN) == LOW);
+}
+
+TEST_CASE(dimmedLedHasMatchingDuty) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    DutyProbe probe(PinConfig::LEDs::YELLOW);
+    device.attachSource(PROBE_PIN, &probe);
+    LedManager leds;
+    leds.begin();
+
+    const uint8_t levels[] = { 16, 64, 200 };
+    for (uint8_t level : levels) {
+        leds.setLed(ColorIdentifier::NONE, level);
+        CHECK(leds.isModulating());
+        uint64_t start = device.nowNs();
+        probe.restart(start);
+        delay(500);
+        CHECK_NEAR(probe.duty(start, device.nowNs()), level / 255.0, 0.005);
+    }
+
+    leds.setLed(ColorIdentifier::NONE, 255);
+    CHECK(!leds.isModulating());
+}
+
+TEST_CASE(ledPulseRunsWithoutTheCaller) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    LedManager leds;
+    leds.begin();
+
+    leds.startPulse(ColorIdentifier::RED, 1, 1000);
+    delay(500);
+    CHECK(SoftPwm::read(PinConfig::LEDs::RED) > 240);
+    CHECK(leds.update());
+    delay(520);
+    CHECK(!leds.update());
+    CHECK(SoftPwm::read(PinConfig::LEDs::RED) == 0);
+    CHECK(!leds.isModulating());
+}
+
+TEST_CASE(queuedSoundPlaysWithoutBlocking) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    AudioManager audio;
+    audio.begin();
+
+    uint64_t start = device.nowNs();
+    CHECK(audio.queueMelody(lowMelody, quarterNotes, 4));
+    audio.update();
+    CHECK(device.nowNs() - start < 1000000);
+    CHECK(device.toneFrequency(PinConfig::BUZZER) == lowMelody[0]);
+
+    for (int i = 0; i < 400 && audio.isPlaying(); i++) {
+        delay(10);
+        audio.update();
+    }
+    CHECK(!audio.isPlaying());
+    CHECK(device.toneFrequency(PinConfig::BUZZER) == 0);
+}
+
+TEST_CASE(higherPriorityPreempts) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    AudioManager audio;
+    audio.begin();
+
+    audio.queueMelody(lowMelody, quarterNotes, 4, AudioManager::PRIORITY_LOW);
+    audio.update();
+    delay(50);
+    audio.queueMelody(highMelody, quarterNotes, 1, AudioManager::PRIORITY_CRITICAL);
+    audio.update();
+    CHECK(device.toneFrequency(PinConfig::BUZZER) == highMelody[0]);
+}
+
+TEST_CASE(staleSoundsExpire) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    AudioManager audio;
+    audio.begin();
+
+    audio.queueMelody(lowMelody, quarterNotes, 4, AudioManager::PRIORITY_HIGH);
+    audio.update();
+    CHECK(audio.queueMelody(highMelody, quarterNotes, 1, AudioManager::PRIORITY_LOW, 100));
+    CHECK(audio.getQueuedCount() == 1);
+    delay(200);
+    audio.update();
+    CHECK(audio.getQueuedCount() == 0);
+    CHECK(audio.getDroppedCount() == 1);
+}
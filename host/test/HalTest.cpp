@@ -0,0 +1,158 @@
+/**
+ * @file HalTest.cpp
+ * @brief Checks of the virtual-time Arduino HAL
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+#include <VirtualDevice.h>
+#include <Wire.h>
+
+namespace {
+    // Square wave with a fixed high and low time, starting high at 0
+    class SquareWave : public SignalSource {
+    public:
+        SquareWave(uint64_t highNs, uint64_t lowNs) : _highNs(highNs), _lowNs(lowNs) {}
+
+        bool level(uint64_t timeNs) override {
+            return timeNs % (_highNs + _lowNs) < _highNs;
+        }
+
+        uint64_t nextEdge(uint64_t timeNs) override {
+            uint64_t period = _highNs + _lowNs;
+            uint64_t start = timeNs - timeNs % period;
+            return timeNs % period < _highNs ? start + _highNs : start + period;
+        }
+
+    private:
+        uint64_t _highNs;
+        uint64_t _lowNs;
+    };
+
+    uint32_t risingEdges = 0;
+
+    void countRisingEdge() {
+        risingEdges++;
+    }
+}
+
+TEST_CASE(delayAdvancesTheClock) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+
+    unsigned long start = micros();
+    delay(250);
+    CHECK(micros() - start >= 250000);
+    CHECK(micros() - start < 250100);
+    CHECK(millis() >= 250);
+
+    start = micros();
+    delayMicroseconds(40);
+    CHECK(micros() - start >= 40);
+}
+
+TEST_CASE(ioCallsCostVirtualTime) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    pinMode(13, OUTPUT);
+
+    uint64_t start = device.nowNs();
+    for (int i = 0; i < 100; i++) {
+        digitalWrite(13, i & 1);
+    }
+    CHECK(device.nowNs() - start == 100ULL * device.costs().digitalWriteNs);
+    CHECK(device.stats().digitalWrites == 100);
+    CHECK(device.outputLevel(13) == HIGH);
+}
+
+TEST_CASE(pulseInMeasuresTheDrivenPin) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SquareWave wave(120000, 380000); // 120 µs high, 380 µs low
+    device.attachSource(9, &wave);
+    pinMode(9, INPUT);
+
+    CHECK(pulseIn(9, HIGH) == 120);
+    CHECK(pulseIn(9, LOW) == 380);
+    CHECK(device.stats().pulseInCalls == 2);
+}
+
+TEST_CASE(pulseInTimesOut) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    pinMode(9, INPUT);
+
+    unsigned long start = micros();
+    CHECK(pulseIn(9, HIGH, 5000) == 0);
+    CHECK(micros() - start >= 5000);
+    CHECK(device.stats().pulseInTimeouts == 1);
+}
+
+TEST_CASE(interruptsFireOnEdgesDuringDelay) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SquareWave wave(500000, 500000); // 1 kHz
+    device.attachSource(2, &wave);
+    risingEdges = 0;
+
+    attachInterrupt(digitalPinToInterrupt(2), countRisingEdge, RISING);
+    delay(10);
+    detachInterrupt(digitalPinToInterrupt(2));
+    CHECK(risingEdges >= 9 && risingEdges <= 11);
+
+    delay(10);
+    CHECK(risingEdges <= 11);
+}
+
+TEST_CASE(toneEndsAfterItsDuration) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+
+    tone(8, 440, 100);
+    CHECK(device.toneFrequency(8) == 440);
+    delay(150);
+    CHECK(device.toneFrequency(8) == 0);
+
+    tone(8, 880);
+    delay(1000);
+    CHECK(device.toneFrequency(8) == 880);
+    noTone(8);
+    CHECK(device.toneFrequency(8) == 0);
+}
+
+TEST_CASE(timerRunsInVirtualTime) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    risingEdges = 0;
+
+    device.startTimer(1000000, countRisingEdge); // 1 ms
+    delay(20);
+    CHECK(risingEdges == 20);
+    device.stopTimer();
+    delay(20);
+    CHECK(risingEdges == 20);
+}
+
+TEST_CASE(lcdPanelShowsPrintedText) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+
+    Wire.begin();
+    LiquidCrystal_I2C lcd(0x27, 16, 2);
+    lcd.init();
+    lcd.backlight();
+    lcd.setCursor(0, 1);
+    lcd.print("Hello");
+
+    const LcdPanel* panel = device.findLcd(0x27);
+    if (!CHECK(panel != nullptr)) {
+        return;
+    }
+    CHECK(panel->backlight);
+    CHECK(panel->lines.size() == 2);
+    CHECK(panel->lines[1].compare(0, 5, "Hello") == 0);
+    CHECK(device.stats().i2cBytes > 0);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file LoadMonitorTest.cpp
+ * @brief Checks of overload detection and stepwise load shedding in virtual time
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <VirtualDevice.h>
+
+#include <LoadMonitor.h>
+
+namespace {
+    const unsigned long LATE = LoadSettings::OVERLOAD_LATENESS + 1;
+    const unsigned long ON_TIME = 2;
+
+    // Levels passed to the callback, in order
+    LoadLevel changes[16];
+    uint8_t changeCount = 0;
+
+    void onLevel(LoadLevel level) {
+        if (changeCount < sizeof(changes) / sizeof(changes[0])) {
+            changes[changeCount++] = level;
+        }
+    }
+
+    // One window of task starts, the latest as late as given
+    LoadLevel window(LoadMonitor& monitor, unsigned long worst) {
+        monitor.recordLateness(ON_TIME);
+        monitor.recordLateness(worst);
+        delay(LoadSettings::WINDOW);
+        return monitor.update();
+    }
+
+    // Windows of the same lateness; returns the level after the last
+    LoadLevel windows(LoadMonitor& monitor, uint8_t count, unsigned long worst) {
+        LoadLevel level = monitor.getLevel();
+        for (uint8_t i = 0; i < count; i++) {
+            level = window(monitor, worst);
+        }
+        return level;
+    }
+}
+
+TEST_CASE(stepsUpAfterOverloadedWindows) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    changeCount = 0;
+    LoadMonitor monitor;
+    monitor.setLevelCallback(onLevel);
+    monitor.begin();
+
+    // A start exactly at the limit is not an overload
+    CHECK(windows(monitor, 4, LoadSettings::OVERLOAD_LATENESS) == LoadLevel::NORMAL);
+
+    // One overloaded window is a burst; a calm one in between starts over
+    CHECK(window(monitor, LATE) == LoadLevel::NORMAL);
+    CHECK(window(monitor, ON_TIME) == LoadLevel::NORMAL);
+    CHECK(windows(monitor, LoadSettings::OVERLOAD_WINDOWS - 1, LATE) == LoadLevel::NORMAL);
+    CHECK(window(monitor, LATE) == LoadLevel::SLOW_DISPLAY);
+    CHECK(monitor.getLastWorst() == LATE);
+
+    // Each further run of overloaded windows sheds one more level, up to the last
+    CHECK(windows(monitor, LoadSettings::OVERLOAD_WINDOWS, LATE) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(windows(monitor, 10 * LoadSettings::OVERLOAD_WINDOWS, LATE) == LoadLevel::REDUCED_COLOR);
+
+    CHECK(changeCount == 4);
+    CHECK(changes[0] == LoadLevel::SLOW_DISPLAY);
+    CHECK(changes[3] == LoadLevel::REDUCED_COLOR);
+    CHECK(monitor.getChangeCount() == 4);
+}
+
+TEST_CASE(stepsDownAfterCalmWindows) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    LoadMonitor monitor;
+    monitor.begin();
+
+    CHECK(windows(monitor, 2 * LoadSettings::OVERLOAD_WINDOWS, LATE) == LoadLevel::NO_LED_EFFECTS);
+
+    // One level per RECOVERY_WINDOWS calm windows; an overloaded one resets the count
+    CHECK(windows(monitor, LoadSettings::RECOVERY_WINDOWS - 1, ON_TIME) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(window(monitor, LATE) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(windows(monitor, LoadSettings::RECOVERY_WINDOWS - 1, ON_TIME) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(window(monitor, ON_TIME) == LoadLevel::SLOW_DISPLAY);
+    CHECK(windows(monitor, LoadSettings::RECOVERY_WINDOWS, ON_TIME) == LoadLevel::NORMAL);
+    CHECK(windows(monitor, LoadSettings::RECOVERY_WINDOWS, ON_TIME) == LoadLevel::NORMAL);
+}
+
+TEST_CASE(relapseDoublesTheRecoveryWait) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    LoadMonitor monitor;
+    monitor.begin();
+
+    const uint8_t recovery = LoadSettings::RECOVERY_WINDOWS;
+    CHECK(windows(monitor, 2 * LoadSettings::OVERLOAD_WINDOWS, LATE) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(windows(monitor, recovery, ON_TIME) == LoadLevel::SLOW_DISPLAY);
+
+    // The load comes back as soon as the level is restored
+    CHECK(windows(monitor, LoadSettings::OVERLOAD_WINDOWS, LATE) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(windows(monitor, 2 * recovery - 1, ON_TIME) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(window(monitor, ON_TIME) == LoadLevel::SLOW_DISPLAY);
+
+    // And again: four times the calm windows
+    CHECK(windows(monitor, LoadSettings::OVERLOAD_WINDOWS, LATE) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(windows(monitor, 4 * recovery - 1, ON_TIME) == LoadLevel::NO_LED_EFFECTS);
+    CHECK(window(monitor, ON_TIME) == LoadLevel::SLOW_DISPLAY);
+
+    // Back at NORMAL the wait starts over
+    CHECK(windows(monitor, 4 * recovery, ON_TIME) == LoadLevel::NORMAL);
+    CHECK(windows(monitor, LoadSettings::OVERLOAD_WINDOWS, LATE) == LoadLevel::SLOW_DISPLAY);
+    CHECK(windows(monitor, recovery, ON_TIME) == LoadLevel::NORMAL);
+}
+
+TEST_CASE(timeIsAccountedPerLevel) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    LoadMonitor monitor;
+    monitor.begin();
+
+    // Two windows at NORMAL, six at SLOW_DISPLAY, two back at NORMAL
+    windows(monitor, LoadSettings::OVERLOAD_WINDOWS, LATE);
+    windows(monitor, LoadSettings::RECOVERY_WINDOWS, ON_TIME);
+    windows(monitor, 2, ON_TIME);
+
+    const unsigned long span = LoadSettings::WINDOW;
+    CHECK_NEAR(monitor.getTime(LoadLevel::NORMAL), (LoadSettings::OVERLOAD_WINDOWS + 2) * span, 2);
+    CHECK_NEAR(monitor.getTime(LoadLevel::SLOW_DISPLAY), LoadSettings::RECOVERY_WINDOWS * span, 2);
+    CHECK(monitor.getTime(LoadLevel::NO_LED_EFFECTS) == 0);
+    CHECK(monitor.getTime(LoadLevel::LEVEL_COUNT) == 0);
+    CHECK(monitor.getChangeCount() == 2);
+
+    // The current level keeps counting between windows
+    delay(100);
+    CHECK_NEAR(monitor.getTime(LoadLevel::NORMAL), (LoadSettings::OVERLOAD_WINDOWS + 2) * span + 100, 2);
+
+    monitor.reset();
+    CHECK(monitor.getTime(LoadLevel::SLOW_DISPLAY) == 0);
+    CHECK(monitor.getTime(LoadLevel::NORMAL) <= 1);
+    CHECK(monitor.getChangeCount() == 0);
+}
@@ -0,0 +1,148 @@
+/**
+ * @file MotionTrackerTest.cpp
+ * @brief Checks of the alpha-beta velocity and time-to-collision tracker
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <MotionTracker.h>
+
+namespace {
+    // Reading interval of the distance sketch in ms
+    const unsigned long PERIOD = 50;
+
+    // Alert thresholds of DistanceMeasurement.ino in ms
+    const unsigned long TTC_CRITICAL = 1000;
+    const unsigned long TTC_WARNING = 2500;
+
+    // Feed a constant-speed ramp; returns the time after the last reading
+    unsigned long feedRamp(MotionTracker& tracker, float start, float speed, int readings, unsigned long time) {
+        for (int i = 0; i < readings; i++) {
+            tracker.update(start + speed * (i * PERIOD) / 1000.0f, time);
+            time += PERIOD;
+        }
+        return time;
+    }
+}
+
+TEST_CASE(velocityConvergesOnARamp) {
+    MotionTracker tracker;
+
+    // One reading is not a track yet
+    CHECK(!tracker.update(150.0f, 0));
+    CHECK(!tracker.isTracking());
+    CHECK(tracker.getTimeToCollision() == MotionTracker::NO_COLLISION);
+
+    // 30 cm/s towards the sensor for two seconds
+    MotionTracker ramp;
+    unsigned long time = feedRamp(ramp, 150.0f, -30.0f, 40, 0);
+    CHECK(ramp.isTracking());
+    CHECK_NEAR(ramp.getVelocity(), -30.0f, 1.0f);
+
+    float distance = 150.0f - 30.0f * (time - PERIOD) / 1000.0f;
+    CHECK_NEAR(ramp.getDistance(), distance, 0.5f);
+
+    // Distance over closing speed
+    float expected = distance / 30.0f * 1000.0f;
+    CHECK_NEAR(static_cast<float>(ramp.getTimeToCollision()), expected, expected * 0.05f);
+
+    // Receding objects never collide
+    MotionTracker away;
+    feedRamp(away, 20.0f, 30.0f, 40, 0);
+    CHECK_NEAR(away.getVelocity(), 30.0f, 1.0f);
+    CHECK(away.getTimeToCollision() == MotionTracker::NO_COLLISION);
+}
+
+TEST_CASE(stillObjectNeverAlerts) {
+    MotionTracker tracker;
+
+    // Half a centimetre of jitter around 40 cm
+    unsigned long time = 0;
+    for (int i = 0; i < 100; i++) {
+        tracker.update(i % 2 == 0 ? 40.25f : 39.75f, time);
+        CHECK(tracker.getTimeToCollision() > TTC_WARNING);
+        time += PERIOD;
+    }
+    CHECK(tracker.isTracking());
+    CHECK_NEAR(tracker.getVelocity(), 0.0f, 2.0f);
+    CHECK_NEAR(tracker.getDistance(), 40.0f, 0.5f);
+}
+
+TEST_CASE(alertThresholdsFollowTheApproach) {
+    MotionTracker tracker;
+
+    // At 40 cm/s the warning is due at 100 cm and the critical alert at 40 cm
+    float warningAt = 0.0f;
+    float criticalAt = 0.0f;
+    unsigned long time = 0;
+    for (int i = 0; i < 100; i++) {
+        float distance = 200.0f - 40.0f * (i * PERIOD) / 1000.0f;
+        if (distance < 5.0f) {
+            break;
+        }
+        tracker.update(distance, time);
+        unsigned long timeToCollision = tracker.getTimeToCollision();
+        if (warningAt == 0.0f && timeToCollision <= TTC_WARNING) {
+            warningAt = distance;
+        }
+        if (criticalAt == 0.0f && timeToCollision <= TTC_CRITICAL) {
+            criticalAt = distance;
+        }
+        time += PERIOD;
+    }
+    CHECK_NEAR(warningAt, 100.0f, 10.0f);
+    CHECK_NEAR(criticalAt, 40.0f, 4.0f);
+
+    // Too slow to ever be an alert: 1 cm/s is below MIN_CLOSING_SPEED
+    MotionTracker slow;
+    feedRamp(slow, 30.0f, -1.0f, 100, 0);
+    CHECK(slow.getTimeToCollision() == MotionTracker::NO_COLLISION);
+}
+
+TEST_CASE(outliersRestartTheTrack) {
+    MotionTracker tracker;
+    unsigned long time = feedRamp(tracker, 150.0f, -30.0f, 40, 0);
+    CHECK(tracker.getVelocity() < -25.0f);
+
+    // A reading inside the gate only nudges the estimate
+    float predicted = tracker.getDistance() - 30.0f * PERIOD / 1000.0f;
+    CHECK(tracker.update(predicted + 10.0f, time));
+    CHECK(tracker.isTracking());
+    time += PERIOD;
+
+    // Beyond the gate it is another object: no velocity, no alert
+    CHECK(!tracker.update(predicted + 60.0f, time));
+    CHECK(!tracker.isTracking());
+    CHECK(tracker.getVelocity() == 0.0f);
+    CHECK_NEAR(tracker.getDistance(), predicted + 60.0f, 0.1f);
+    CHECK(tracker.getTimeToCollision() == MotionTracker::NO_COLLISION);
+
+    // A lost echo drops the track altogether
+    feedRamp(tracker, 80.0f, -30.0f, 10, time + PERIOD);
+    CHECK(tracker.isTracking());
+    CHECK(!tracker.update(0.0f, time + 11 * PERIOD));
+    CHECK(!tracker.isTracking());
+    CHECK(tracker.getDistance() == 0.0f);
+}
+
+TEST_CASE(gapRestartsTheTrack) {
+    MotionTracker tracker;
+    unsigned long time = feedRamp(tracker, 150.0f, -30.0f, 40, 0);
+    float distance = tracker.getDistance();
+
+    // A gap of exactly MAX_GAP still extends the track
+    time += MotionTracker::MAX_GAP - PERIOD;
+    CHECK(tracker.update(distance - 30.0f, time));
+    CHECK(tracker.isTracking());
+
+    // A longer one restarts it at the new reading
+    time += MotionTracker::MAX_GAP + 1;
+    CHECK(!tracker.update(60.0f, time));
+    CHECK(!tracker.isTracking());
+    CHECK(tracker.getVelocity() == 0.0f);
+
+    // The new track converges like the first one
+    feedRamp(tracker, 60.0f, -20.0f, 40, time + PERIOD);
+    CHECK_NEAR(tracker.getVelocity(), -20.0f, 1.0f);
+}
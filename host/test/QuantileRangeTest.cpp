@@ -0,0 +1,100 @@
+/**
+ * @file QuantileRangeTest.cpp
+ * @brief Checks of the streaming P² percentile range
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <QuantileRange.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+    // Pulse widths of one channel: normal around 500 µs
+    std::vector<int> makeReadings(size_t count, uint32_t seed) {
+        std::mt19937 random(seed);
+        std::normal_distribution<float> pulse(500.0f, 50.0f);
+        std::vector<int> readings;
+        for (size_t i = 0; i < count; i++) {
+            readings.push_back(static_cast<int>(pulse(random) + 0.5f));
+        }
+        return readings;
+    }
+
+    // Exact nearest-rank percentile
+    int percentile(std::vector<int> readings, float fraction) {
+        std::sort(readings.begin(), readings.end());
+        size_t rank = static_cast<size_t>(fraction * (readings.size() - 1) + 0.5f);
+        return readings[rank];
+    }
+}
+
+TEST_CASE(rangeMatchesTheTailPercentiles) {
+    const float tail = 0.02f;
+    std::vector<int> readings = makeReadings(2000, 1);
+    QuantileRange range(tail);
+    for (int reading : readings) {
+        range.add(reading);
+    }
+
+    // Within a tenth of a standard deviation of the exact percentiles
+    CHECK(range.getCount() == readings.size());
+    CHECK_NEAR(range.getLow(), percentile(readings, tail), 5);
+    CHECK_NEAR(range.getHigh(), percentile(readings, 1.0f - tail), 5);
+    CHECK(range.getMin() <= range.getLow());
+    CHECK(range.getMax() >= range.getHigh());
+    CHECK(range.getConfidence() >= CalibrationSettings::ColorSensor::QUANTILE_CONFIDENCE);
+}
+
+TEST_CASE(spikesDoNotMoveTheRange) {
+    std::vector<int> readings = makeReadings(2000, 2);
+    QuantileRange clean;
+    QuantileRange spiked;
+
+    // One pulseIn() timeout and one long glitch in every 500 readings, far
+    // fewer than the tails hold; the first among the start-up readings
+    for (size_t i = 0; i < readings.size(); i++) {
+        clean.add(readings[i]);
+        spiked.add(readings[i]);
+        if (i % 500 == 3) {
+            spiked.add(0);
+        }
+        if (i % 500 == 253) {
+            spiked.add(30000);
+        }
+
+        // A single glitch stretches the ends but does not reach them
+        if (i == 300) {
+            CHECK(spiked.getMin() > 0);
+            CHECK(spiked.getMax() < 30000);
+        }
+    }
+
+    CHECK_NEAR(spiked.getLow(), clean.getLow(), 5);
+    CHECK_NEAR(spiked.getHigh(), clean.getHigh(), 5);
+    CHECK_NEAR(spiked.getLow(), percentile(readings, 0.02f), 8);
+    CHECK_NEAR(spiked.getHigh(), percentile(readings, 0.98f), 8);
+}
+
+TEST_CASE(fewReadingsUseTheNearestRank) {
+    QuantileRange range;
+    CHECK(range.getLow() == 0);
+    CHECK(range.getHigh() == 0);
+
+    const int readings[] = { 40, 10, 30, 20, 50 };
+    for (int reading : readings) {
+        range.add(reading);
+    }
+    CHECK(range.getMin() == 10);
+    CHECK(range.getMax() == 50);
+    CHECK(range.getLow() == 10);
+    CHECK(range.getHigh() == 50);
+    CHECK(range.getConfidence() == 0);
+
+    range.reset();
+    CHECK(range.getCount() == 0);
+    CHECK(range.getMax() == 0);
+}
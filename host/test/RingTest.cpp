@@ -0,0 +1,157 @@
+/**
+ * @file RingTest.cpp
+ * @brief Checks of SpscRing ordering, wraparound, full/empty handling and
+ *        cross-thread delivery
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <SpscRing.h>
+
+#include <thread>
+
+namespace {
+    struct RingItem {
+        uint32_t sequence;
+        uint32_t check;
+    };
+
+    uint32_t checksum(uint32_t sequence) {
+        return sequence * 2654435761u ^ 0x5A5A5A5Au;
+    }
+
+    RingItem makeItem(uint32_t sequence) {
+        RingItem item = { sequence, checksum(sequence) };
+        return item;
+    }
+
+    // A producer thread pushes a checksummed sequence while this thread
+    // pops it; returns the items lost, duplicated, corrupted or out of order
+    template <uint8_t CAPACITY>
+    uint32_t crossThreadErrors(uint32_t items) {
+        SpscRing<RingItem, CAPACITY> ring;
+
+        std::thread producer([&] {
+            for (uint32_t sequence = 0; sequence < items; sequence++) {
+                while (!ring.push(makeItem(sequence))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        uint32_t errors = 0;
+        uint32_t expected = 0;
+        RingItem item;
+        while (expected < items) {
+            if (!ring.pop(item)) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (item.sequence != expected || item.check != checksum(item.sequence)) {
+                errors++;
+            }
+            expected = item.sequence + 1;
+        }
+        producer.join();
+        return errors + (ring.isEmpty() ? 0 : 1);
+    }
+}
+
+TEST_CASE(emptyRingPopsNothing) {
+    SpscRing<RingItem, 4> ring;
+    RingItem item;
+    CHECK(ring.isEmpty());
+    CHECK(ring.size() == 0);
+    CHECK(!ring.pop(item));
+    CHECK(ring.getOverflowCount() == 0);
+}
+
+TEST_CASE(itemsComeOutInOrder) {
+    SpscRing<RingItem, 8> ring;
+    for (uint32_t i = 0; i < 5; i++) {
+        CHECK(ring.push(makeItem(i)));
+    }
+    CHECK(ring.size() == 5);
+
+    RingItem item;
+    for (uint32_t i = 0; i < 5; i++) {
+        CHECK(ring.pop(item) && item.sequence == i && item.check == checksum(i));
+    }
+    CHECK(ring.isEmpty());
+}
+
+TEST_CASE(fullRingRefusesAndCounts) {
+    SpscRing<RingItem, 8> ring;
+    for (uint32_t i = 0; i < 8; i++) {
+        CHECK(ring.push(makeItem(i)));
+    }
+    CHECK(!ring.push(makeItem(8)));
+    CHECK(!ring.push(makeItem(9)));
+    CHECK(ring.size() == 8);
+    CHECK(ring.getOverflowCount() == 2);
+
+    // The refused items did not overwrite the oldest ones
+    RingItem item;
+    CHECK(ring.pop(item) && item.sequence == 0);
+    CHECK(ring.push(makeItem(10)));
+    CHECK(!ring.push(makeItem(11)));
+    CHECK(ring.getOverflowCount() == 3);
+}
+
+TEST_CASE(indicesWrapPast256) {
+    // Both indices pass 255 many times; every slot stays usable
+    SpscRing<RingItem, 128> ring;
+    RingItem item;
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    bool ordered = true;
+    for (int round = 0; round < 20; round++) {
+        while (ring.push(makeItem(next))) {
+            next++;
+        }
+        ordered &= ring.size() == 128;
+        for (int i = 0; i < 100; i++) {
+            ordered &= ring.pop(item) && item.sequence == expected++;
+        }
+    }
+    while (ring.pop(item)) {
+        ordered &= item.sequence == expected++;
+    }
+    CHECK(ordered);
+    CHECK(expected == next);
+    CHECK(next > 256 * 5);
+}
+
+TEST_CASE(smallRingWrapsOneAtATime) {
+    SpscRing<uint8_t, 2> ring;
+    uint8_t value;
+    bool ordered = true;
+    for (int i = 0; i < 1000; i++) {
+        ordered &= ring.push(static_cast<uint8_t>(i));
+        ordered &= ring.size() == 1;
+        ordered &= ring.pop(value) && value == static_cast<uint8_t>(i);
+    }
+    CHECK(ordered);
+    CHECK(ring.isEmpty());
+    CHECK(ring.getOverflowCount() == 0);
+}
+
+TEST_CASE(clearDropsEverything) {
+    SpscRing<RingItem, 4> ring;
+    ring.push(makeItem(1));
+    ring.push(makeItem(2));
+    ring.clear();
+    CHECK(ring.isEmpty());
+
+    RingItem item;
+    CHECK(!ring.pop(item));
+    CHECK(ring.push(makeItem(3)));
+    CHECK(ring.pop(item) && item.sequence == 3);
+}
+
+TEST_CASE(crossThreadDeliveryIsExact) {
+    CHECK(crossThreadErrors<4>(200000) == 0);
+    CHECK(crossThreadErrors<16>(500000) == 0);
+    CHECK(crossThreadErrors<128>(1000000) == 0);
+}
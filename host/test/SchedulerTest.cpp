@@ -0,0 +1,206 @@
+/**
+ * @file SchedulerTest.cpp
+ * @brief Checks of the EDF task scheduler in virtual time
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <VirtualDevice.h>
+
+#include <Scheduler.h>
+
+#include <string.h>
+
+namespace {
+    // Order in which the task steps ran
+    char runOrder[16];
+    uint8_t runCount = 0;
+
+    // Last overrun reported through the callback
+    uint8_t overrunTask = Scheduler::INVALID_TASK;
+    unsigned long overrunLateness = 0;
+    uint8_t overrunReports = 0;
+
+    void record(char name) {
+        if (runCount < sizeof(runOrder) - 1) {
+            runOrder[runCount++] = name;
+            runOrder[runCount] = '\0';
+        }
+    }
+
+    void stepA() { record('A'); }
+    void stepB() { record('B'); }
+    void stepC() { record('C'); }
+
+    void onOverrun(uint8_t taskId, unsigned long lateness) {
+        overrunTask = taskId;
+        overrunLateness = lateness;
+        overrunReports++;
+    }
+
+    void resetRecords() {
+        runOrder[0] = '\0';
+        runCount = 0;
+        overrunTask = Scheduler::INVALID_TASK;
+        overrunLateness = 0;
+        overrunReports = 0;
+    }
+}
+
+TEST_CASE(earliestDeadlineRunsFirst) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    resetRecords();
+    Scheduler scheduler;
+
+    // Registration order is the reverse of the deadline order
+    scheduler.addTask(stepA, 100, 80);
+    scheduler.addTask(stepB, 100, 40);
+    scheduler.addTask(stepC, 100, 10);
+
+    // One step per call, however many tasks are due
+    CHECK(scheduler.run());
+    CHECK(runCount == 1);
+    while (scheduler.run()) {
+    }
+    CHECK(strcmp(runOrder, "CBA") == 0);
+    CHECK(scheduler.getOverrunCount(0) == 0);
+}
+
+TEST_CASE(releaseFollowsThePeriod) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    resetRecords();
+    Scheduler scheduler;
+
+    scheduler.addTask(stepA, 20, 0, 5);
+    CHECK(!scheduler.run());
+
+    delay(5);
+    CHECK(scheduler.run());
+    CHECK(!scheduler.run());
+
+    // The next release is one period after the previous one, not after the run
+    unsigned long idle = scheduler.getIdleTime();
+    CHECK(idle >= 19 && idle <= 20);
+    delay(idle);
+    CHECK(scheduler.run());
+    CHECK(runCount == 2);
+}
+
+TEST_CASE(missedReleasesAreSkipped) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    resetRecords();
+    Scheduler scheduler;
+
+    scheduler.addTask(stepA, 10, 0, 10);
+
+    // Five releases pass without a run; only one step catches up
+    delay(65);
+    CHECK(scheduler.run());
+    CHECK(!scheduler.run());
+    CHECK(runCount == 1);
+
+    // The next release is a full period after the late run
+    unsigned long idle = scheduler.getIdleTime();
+    CHECK(idle >= 9 && idle <= 10);
+}
+
+TEST_CASE(latenessOfEveryStartIsKept) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    resetRecords();
+    Scheduler scheduler;
+    scheduler.setOverrunCallback(onOverrun);
+
+    // Late but within the deadline: lateness counts, no overrun
+    scheduler.addTask(stepA, 100, 50, 10);
+    delay(40);
+    CHECK(scheduler.run());
+    CHECK(scheduler.getLastLateness() >= 30 && scheduler.getLastLateness() <= 31);
+    CHECK(scheduler.getOverrunCount(0) == 0);
+    CHECK(overrunReports == 0);
+
+    // On time
+    delay(scheduler.getIdleTime());
+    CHECK(scheduler.run());
+    CHECK(scheduler.getLastLateness() <= 1);
+}
+
+TEST_CASE(overrunIsReported) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    resetRecords();
+    Scheduler scheduler;
+    scheduler.setOverrunCallback(onOverrun);
+
+    scheduler.addTask(stepA, 100);
+    uint8_t late = scheduler.addTask(stepB, 100, 10);
+
+    // B starts 25 ms after its release, 15 ms past its deadline
+    delay(25);
+    CHECK(scheduler.run());
+    CHECK(strcmp(runOrder, "B") == 0);
+    CHECK(overrunReports == 1);
+    CHECK(overrunTask == late);
+    CHECK(overrunLateness >= 15 && overrunLateness <= 16);
+    CHECK(scheduler.getOverrunCount(late) == 1);
+
+    // A is late too, but still within its one-period deadline
+    CHECK(scheduler.run());
+    CHECK(overrunReports == 1);
+    CHECK(scheduler.getOverrunCount(0) == 0);
+
+    // Without a callback the overrun is still counted
+    scheduler.setOverrunCallback(nullptr);
+    delay(scheduler.getIdleTime() + 30);
+    while (scheduler.run()) {
+    }
+    CHECK(overrunReports == 1);
+    CHECK(scheduler.getOverrunCount(late) == 2);
+}
+
+TEST_CASE(oneShotAndDisabledTasksDoNotRun) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    resetRecords();
+    Scheduler scheduler;
+
+    uint8_t once = scheduler.addTask(stepA, 0);
+    uint8_t off = scheduler.addTask(stepB, 10);
+    scheduler.disableTask(off);
+
+    CHECK(scheduler.run());
+    CHECK(!scheduler.isTaskEnabled(once));
+    delay(50);
+    CHECK(!scheduler.run());
+    CHECK(strcmp(runOrder, "A") == 0);
+
+    scheduler.enableTask(off, 5);
+    CHECK(scheduler.isTaskEnabled(off));
+    delay(5);
+    CHECK(scheduler.run());
+    CHECK(strcmp(runOrder, "AB") == 0);
+}
+
+TEST_CASE(idleTimeWithNothingEnabled) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    resetRecords();
+    Scheduler scheduler;
+
+    CHECK(scheduler.getIdleTime() == Scheduler::NO_RELEASE);
+    CHECK(!scheduler.run());
+
+    uint8_t task = scheduler.addTask(stepA, 100, 0, 40);
+    unsigned long idle = scheduler.getIdleTime();
+    CHECK(idle >= 39 && idle <= 40);
+
+    scheduler.disableTask(task);
+    CHECK(scheduler.getIdleTime() == Scheduler::NO_RELEASE);
+
+    scheduler.enableTask(task);
+    CHECK(scheduler.getIdleTime() == 0);
+}
@@ -0,0 +1,261 @@
+/**
+ * @file SimTest.cpp
+ * @brief Checks of the HC-SR04 and TCS230 models through the real drivers
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <VirtualDevice.h>
+#include <SimScene.h>
+#include <HcSr04Model.h>
+#include <Tcs230Model.h>
+
+#include <ColorSensor.h>
+#include <ColorSensorArray.h>
+#include <DistanceSensor.h>
+#include <ProximityMonitor.h>
+
+namespace {
+    float measureDistance(float distanceCm) {
+        VirtualDevice device;
+        VirtualDevice::Scope scope(device);
+        SimScene scene;
+        scene.hold(10000, distanceCm, 0.5f, 0.5f, 0.5f);
+        HcSr04Model model(scene);
+        model.attach(device);
+
+        DistanceSensor sensor;
+        sensor.begin();
+        return sensor.getDistance();
+    }
+
+    ColorIdentifier detectColor(float red, float green, float blue) {
+        VirtualDevice device;
+        VirtualDevice::Scope scope(device);
+        SimScene scene;
+        scene.hold(10000, 3.0f, red, green, blue);
+        Tcs230Model model(scene);
+        model.attach(device);
+
+        ColorSensor sensor;
+        sensor.begin();
+        return sensor.detectColor();
+    }
+}
+
+TEST_CASE(echoMatchesObjectDistance) {
+    CHECK_NEAR(measureDistance(5.0f), 5.0, 0.2);
+    CHECK_NEAR(measureDistance(20.0f), 20.0, 0.2);
+    CHECK_NEAR(measureDistance(150.0f), 150.0, 0.5);
+}
+
+TEST_CASE(echoFollowsAMovingObject) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SimScene scene;
+    scene.addSegment(1000, 10.0f, 50.0f, 0.5f, 0.5f, 0.5f);
+    HcSr04Model model(scene);
+    model.attach(device);
+
+    DistanceSensor sensor;
+    sensor.begin();
+    float first = sensor.getDistance();
+    delay(500);
+    float later = sensor.getDistance();
+    CHECK_NEAR(first, 10.0, 0.5);
+    CHECK_NEAR(later, 30.0, 1.0);
+    CHECK(model.getPingCount() == 2);
+}
+
+TEST_CASE(noObjectGivesTheFullTimeout) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SimScene scene;
+    scene.empty(10000);
+    HcSr04Model model(scene);
+    model.attach(device);
+
+    DistanceSensor sensor;
+    sensor.begin();
+    CHECK(sensor.getDistance() > HcSr04Model::MAX_RANGE_CM);
+    CHECK(!sensor.isObjectDetected());
+}
+
+TEST_CASE(speedOfSoundFollowsTemperature) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SimScene scene;
+    scene.hold(10000, 100.0f, 0.5f, 0.5f, 0.5f);
+    HcSr04Model model(scene);
+    model.setTemperature(35.0f);
+    model.attach(device);
+
+    DistanceSensor sensor;
+    sensor.begin();
+    float uncompensated = sensor.getDistance();
+    sensor.calibrateForTemperature(35.0f);
+    float compensated = sensor.getDistance();
+    CHECK(uncompensated < 99.0f); // Sound is faster in warm air
+    CHECK_NEAR(compensated, 100.0, 0.5);
+}
+
+TEST_CASE(colorFrequencyFollowsTheFilter) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SimScene scene;
+    scene.hold(10000, 3.0f, 0.9f, 0.1f, 0.1f);
+    Tcs230Model model(scene);
+    model.attach(device);
+
+    ColorSensor sensor;
+    sensor.begin();
+    int red = 0;
+    int green = 0;
+    int blue = 0;
+    sensor.readRawValues(red, green, blue);
+
+    // A red surface gives the shortest red pulses
+    CHECK(red > 0);
+    CHECK(red < green);
+    CHECK(red < blue);
+}
+
+TEST_CASE(colorsAreClassified) {
+    CHECK(detectColor(0.9f, 0.15f, 0.1f) == ColorIdentifier::RED);
+    CHECK(detectColor(0.1f, 0.85f, 0.2f) == ColorIdentifier::GREEN);
+    CHECK(detectColor(0.1f, 0.2f, 0.9f) == ColorIdentifier::BLUE);
+    CHECK(detectColor(1.0f, 1.0f, 1.0f) == ColorIdentifier::NONE);
+}
+
+TEST_CASE(distantObjectsReflectLess) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SimScene scene;
+    scene.hold(1000, 3.0f, 1.0f, 1.0f, 1.0f);
+    scene.hold(1000, 3.0f * Tcs230Model::FULL_SIGNAL_RANGE_CM, 1.0f, 1.0f, 1.0f);
+    Tcs230Model model(scene);
+    model.attach(device);
+
+    ColorSensor sensor;
+    sensor.begin();
+    int near = sensor.readChannel(ColorSensor::CHANNEL_RED);
+    delay(1500);
+    int far = sensor.readChannel(ColorSensor::CHANNEL_RED);
+    CHECK(near > 0);
+    CHECK(far > near);
+}
+
+TEST_CASE(sensorArrayReadsEveryHeadInOneGate) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SimScene redScene;
+    redScene.hold(10000, 3.0f, 0.9f, 0.15f, 0.1f);
+    SimScene blueScene;
+    blueScene.hold(10000, 3.0f, 0.1f, 0.2f, 0.9f);
+
+    // Two heads on the shared select pins; the third has nothing on its OUT pin
+    using namespace PinConfig::ColorSensor;
+    Tcs230Model redModel(redScene, S0, S1, S2, S3, OUT);
+    Tcs230Model blueModel(blueScene, S0, S1, S2, S3, 10);
+    redModel.attach(device);
+    blueModel.attach(device);
+    ColorSensor heads[] = {
+        ColorSensor(S0, S1, S2, S3, OUT),
+        ColorSensor(S0, S1, S2, S3, 10),
+        ColorSensor(S0, S1, S2, S3, 14)
+    };
+    ColorSensorArray array(heads, 3);
+    array.begin();
+    CHECK(array.getHeadCount() == 3);
+
+    const Tcs230Model* models[] = { &redModel, &blueModel };
+    const uint8_t channels[] = { ColorSensor::CHANNEL_RED, ColorSensor::CHANNEL_GREEN, ColorSensor::CHANNEL_BLUE };
+    for (uint8_t channel : channels) {
+        int widths[3];
+        array.readChannel(channel, widths);
+        for (uint8_t i = 0; i < 2; i++) {
+            // Edges in the gate at the 2% frequency, widths as pulseIn() sees them at 20%
+            float frequency = models[i]->getFrequency();
+            CHECK_NEAR(array.getLastEdgeCount(i), frequency * SystemSettings::COLOR_GATE_TIME / 1000.0f, 1.0f);
+            float width = 1e6f / (2.0f * frequency * 10.0f);
+            CHECK_NEAR(widths[i], width, width * 0.02f + 1.0f);
+        }
+        CHECK(array.getLastEdgeCount(2) == 0);
+        CHECK(widths[2] == 0);
+    }
+
+    // Each head keeps to its own surface
+    ColorIdentifier colors[3];
+    array.detectColors(colors);
+    CHECK(colors[0] == ColorIdentifier::RED);
+    CHECK(colors[1] == ColorIdentifier::BLUE);
+    CHECK(colors[2] == ColorIdentifier::NONE);
+}
+
+TEST_CASE(proximityChangesOnceEachWay) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    SimScene scene;
+    scene.addSegment(1500, 20.0f, 5.0f, 0.5f, 0.5f, 0.5f);
+    scene.hold(500, 5.0f, 0.5f, 0.5f, 0.5f);
+    scene.addSegment(1500, 5.0f, 20.0f, 0.5f, 0.5f, 0.5f);
+    HcSr04Model model(scene);
+    model.attach(device);
+
+    DistanceSensor sensor;
+    sensor.begin();
+    ProximityMonitor monitor(sensor);
+
+    // Walk in past 10 cm and back out past 12 cm, one reading every 50 ms
+    int arrivals = 0;
+    int departures = 0;
+    float arrivedAt = 0.0f;
+    float leftAt = 0.0f;
+    while (device.nowNs() < 3500000000ULL) {
+        ProximityEvent event = monitor.poll();
+        if (event == ProximityEvent::ARRIVED) {
+            arrivals++;
+            arrivedAt = monitor.getLastDistance();
+        } else if (event == ProximityEvent::LEFT) {
+            departures++;
+            leftAt = monitor.getLastDistance();
+        }
+        delay(50);
+    }
+    CHECK(arrivals == 1);
+    CHECK(departures == 1);
+
+    // The second reading past each threshold confirms the change
+    CHECK(arrivedAt <= 10.0f && arrivedAt > 9.0f);
+    CHECK(leftAt > 12.0f && leftAt < 13.0f);
+    CHECK(!monitor.isObjectPresent());
+}
+
+TEST_CASE(proximityIgnoresJitterAndSingleReadings) {
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    DistanceSensor sensor;
+    ProximityMonitor monitor(sensor);
+
+    // A single close reading is not an arrival, and no echo counts as far
+    CHECK(monitor.update(8.0f) == ProximityEvent::NONE);
+    CHECK(monitor.update(0.0f) == ProximityEvent::NONE);
+    CHECK(monitor.update(8.0f) == ProximityEvent::NONE);
+    CHECK(monitor.update(15.0f) == ProximityEvent::NONE);
+    CHECK(!monitor.isObjectPresent());
+
+    CHECK(monitor.update(9.0f) == ProximityEvent::NONE);
+    CHECK(monitor.update(9.5f) == ProximityEvent::ARRIVED);
+
+    // Jitter between the thresholds, or one far reading at a time, keeps it
+    const float jitter[] = { 9.8f, 11.9f, 10.5f, 13.0f, 11.0f, 0.0f, 9.9f, 12.0f };
+    for (float distance : jitter) {
+        CHECK(monitor.update(distance) == ProximityEvent::NONE);
+    }
+    CHECK(monitor.isObjectPresent());
+
+    CHECK(monitor.update(12.5f) == ProximityEvent::NONE);
+    CHECK(monitor.update(0.0f) == ProximityEvent::LEFT);
+    CHECK(!monitor.isObjectPresent());
+}
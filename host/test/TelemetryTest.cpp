@@ -0,0 +1,182 @@
+/**
+ * @file TelemetryTest.cpp
+ * @brief Checks of the telemetry frame layout, CRC, queueing and decoding
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <Telemetry.h>
+#include <TelemetryStream.h>
+
+#include <string.h>
+#include <vector>
+
+namespace {
+    // Port that keeps every byte and takes as many as it is told to
+    class CapturePort : public Print {
+    public:
+        explicit CapturePort(int room = 1 << 20) : room(room) {}
+
+        size_t write(uint8_t value) override {
+            bytes.push_back(value);
+            return 1;
+        }
+        using Print::write;
+
+        int availableForWrite() override { return room; }
+
+        std::vector<uint8_t> bytes;
+        int room;
+    };
+
+    TelemetryRecord makeRecord(uint32_t timestamp) {
+        TelemetryRecord record = {};
+        record.timestamp = timestamp;
+        record.echoDuration = 1234;
+        record.distance = 210;
+        record.status = Telemetry::STATUS_OBJECT_IN_RANGE | Telemetry::STATUS_COLOR_VALID;
+        record.red = 200;
+        record.green = 30;
+        record.blue = 7;
+        record.colorId = 1;
+        record.distanceTime = 0x0102;
+        record.colorTime = 0x0304;
+        record.displayTime = 0x0506;
+        return record;
+    }
+}
+
+TEST_CASE(crcMatchesCcittFalse) {
+    // Check value of CRC-16/CCITT-FALSE
+    const char* text = "123456789";
+    CHECK(Telemetry::crc16(reinterpret_cast<const uint8_t*>(text), 9) == 0x29B1);
+
+    const uint8_t empty[1] = { 0 };
+    CHECK(Telemetry::crc16(empty, 0) == 0xFFFF);
+}
+
+TEST_CASE(readingFrameLayout) {
+    TelemetryRecord record = makeRecord(0x11223344);
+    record.sequence = 9;
+    record.dropped = 0xBEEF;
+    uint8_t frame[Telemetry::FRAME_SIZE];
+    Telemetry::encode(record, frame);
+
+    CHECK(Telemetry::FRAME_SIZE == 27);
+    CHECK(frame[0] == 0xA5 && frame[1] == 0x5A);
+    CHECK(frame[2] == Telemetry::TYPE_READING);
+    CHECK(frame[3] == 9);
+    CHECK(frame[4] == 0x44 && frame[5] == 0x33 && frame[6] == 0x22 && frame[7] == 0x11);
+    CHECK(frame[8] == (1234 & 0xFF) && frame[9] == (1234 >> 8));
+    CHECK(frame[12] == record.status);
+    CHECK(frame[13] == 200 && frame[14] == 30 && frame[15] == 7 && frame[16] == 1);
+    CHECK(frame[23] == 0xEF && frame[24] == 0xBE);
+
+    uint16_t crc = Telemetry::crc16(frame + 2, 1 + Telemetry::PAYLOAD_SIZE);
+    CHECK(frame[25] == (crc & 0xFF) && frame[26] == (crc >> 8));
+
+    TelemetryRecord decoded;
+    CHECK(Telemetry::decode(frame, decoded));
+    CHECK(decoded.sequence == 9 && decoded.timestamp == record.timestamp);
+    CHECK(decoded.echoDuration == 1234 && decoded.distance == 210 && decoded.status == record.status);
+    CHECK(decoded.red == 200 && decoded.green == 30 && decoded.blue == 7 && decoded.colorId == 1);
+    CHECK(decoded.distanceTime == 0x0102 && decoded.colorTime == 0x0304 && decoded.displayTime == 0x0506);
+    CHECK(decoded.dropped == 0xBEEF);
+
+    // Any flipped bit fails the CRC
+    frame[10] ^= 0x08;
+    CHECK(!Telemetry::decode(frame, decoded));
+}
+
+TEST_CASE(sampleFrameLayout) {
+    TelemetrySample sample = { 3, 1000000, 2, 0x4321 };
+    uint8_t frame[Telemetry::SAMPLE_FRAME_SIZE];
+    Telemetry::encodeSample(sample, frame);
+
+    CHECK(Telemetry::SAMPLE_FRAME_SIZE == 13);
+    CHECK(frame[2] == Telemetry::TYPE_SAMPLE);
+    CHECK(frame[8] == 2);
+    CHECK(frame[9] == 0x21 && frame[10] == 0x43);
+    CHECK(Telemetry::getFrameSize(Telemetry::TYPE_SAMPLE) == 13);
+    CHECK(Telemetry::getFrameSize(0x7F) == 0);
+
+    TelemetrySample decoded;
+    CHECK(Telemetry::decodeSample(frame, decoded));
+    CHECK(decoded.sequence == 3 && decoded.timestamp == 1000000 && decoded.value == 0x4321);
+}
+
+TEST_CASE(streamDecodesWhatWasSent) {
+    CapturePort port;
+    Telemetry telemetry(port);
+
+    // Text between frames, as from a banner, is skipped
+    const char* banner = "Color and Distance Detection System\r\n";
+    port.bytes.insert(port.bytes.end(), banner, banner + strlen(banner));
+
+    for (uint32_t i = 0; i < 40; i++) {
+        TelemetryRecord record = makeRecord(i * 100);
+        CHECK(telemetry.send(record));
+        if (i % 4 == 0) {
+            CHECK(telemetry.sendSample(1, i * 100000UL, 70000));
+        }
+        telemetry.pump();
+    }
+    CHECK(telemetry.getPendingBytes() == 0);
+
+    // Chunks end inside frames
+    TelemetryStream stream;
+    TelemetryBatch batch;
+    for (size_t offset = 0; offset < port.bytes.size(); offset += 11) {
+        size_t size = port.bytes.size() - offset < 11 ? port.bytes.size() - offset : 11;
+        stream.feed(port.bytes.data() + offset, size, batch);
+    }
+    stream.finish(batch);
+
+    CHECK(batch.readings.size() == 40);
+    CHECK(batch.samples.size() == 10);
+    CHECK(stream.getBadFrames() == 0);
+    CHECK(stream.getSequenceGaps() == 0);
+    CHECK(stream.getSkippedBytes() == strlen(banner));
+
+    bool intact = true;
+    for (size_t i = 0; i < batch.readings.size(); i++) {
+        const TelemetryRecord& record = batch.readings[i];
+        intact &= record.timestamp == i * 100 && record.echoDuration == 1234 && record.dropped == 0;
+    }
+    CHECK(intact);
+    CHECK(batch.samples[0].value == 0xFFFF); // Saturated
+}
+
+TEST_CASE(fullBufferDropsAndCounts) {
+    CapturePort port(0);
+    Telemetry telemetry(port);
+
+    // 127 usable bytes hold four 27-byte frames
+    for (uint32_t i = 0; i < 4; i++) {
+        TelemetryRecord record = makeRecord(i);
+        CHECK(telemetry.send(record));
+    }
+    TelemetryRecord record = makeRecord(4);
+    CHECK(!telemetry.send(record));
+    CHECK(telemetry.getDroppedCount() == 1);
+    CHECK(telemetry.getPendingBytes() == 4 * Telemetry::FRAME_SIZE);
+    CHECK(telemetry.pump() == 0);
+
+    // Once the port drains, the next record reports the loss
+    port.room = 1 << 20;
+    telemetry.pump();
+    record = makeRecord(5);
+    CHECK(telemetry.send(record));
+    telemetry.pump();
+
+    TelemetryStream stream;
+    TelemetryBatch batch;
+    stream.feed(port.bytes.data(), port.bytes.size(), batch);
+    stream.finish(batch);
+    if (!CHECK(batch.readings.size() == 5)) {
+        return;
+    }
+    CHECK(batch.readings[4].dropped == 1);
+    CHECK(stream.getSequenceGaps() == 1);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file TestHarness.cpp
+ * @brief Test registry and runner for the host test executables
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+    struct TestCase {
+        const char* name;
+        void (*run)();
+    };
+
+    std::vector<TestCase>& registry() {
+        static std::vector<TestCase> tests;
+        return tests;
+    }
+
+    uint32_t failedChecks = 0;
+}
+
+TestRegistrar::TestRegistrar(const char* name, void (*run)()) {
+    registry().push_back({ name, run });
+}
+
+bool testCheck(bool condition, const char* expression, const char* file, int line) {
+    if (!condition) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        failedChecks++;
+    }
+    return condition;
+}
+
+bool testCheckNear(double actual, double expected, double tolerance,
+                   const char* expression, const char* file, int line) {
+    bool condition = fabs(actual - expected) <= tolerance;
+    if (!condition) {
+        fprintf(stderr, "%s:%d: check failed: %s (%g, expected %g +/- %g)\n",
+                file, line, expression, actual, expected, tolerance);
+        failedChecks++;
+    }
+    return condition;
+}
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    uint32_t run = 0;
+    uint32_t failed = 0;
+
+    for (const TestCase& test : registry()) {
+        if (filter != nullptr && strstr(test.name, filter) == nullptr) {
+            continue;
+        }
+        uint32_t before = failedChecks;
+        test.run();
+        run++;
+        bool passed = failedChecks == before;
+        failed += passed ? 0 : 1;
+        printf("%-48s %s\n", test.name, passed ? "ok" : "FAILED");
+    }
+
+    printf("%u tests, %u failed\n", run, failed);
+    return failed > 0 || run == 0 ? 1 : 0;
+}
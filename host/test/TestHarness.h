@@ -0,0 +1,46 @@
+/**
+ * @file TestHarness.h
+ * @brief Minimal self-registering checks for the host test executables
+ * @author catalina
+ */
+
+#ifndef HOST_TEST_HARNESS_H
+#define HOST_TEST_HARNESS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Register a test function under a name
+ *
+ * Used through TEST_CASE; every test executable links TestHarness.cpp,
+ * whose main() runs the registered tests in order (or only those whose
+ * name contains the first command-line argument) and returns non-zero
+ * if any check failed.
+ */
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*run)());
+};
+
+/**
+ * @brief Record the outcome of one check
+ * @return The condition, so a test can stop early on a failed precondition
+ */
+bool testCheck(bool condition, const char* expression, const char* file, int line);
+
+/**
+ * @brief Record a comparison of two numbers within a tolerance
+ */
+bool testCheckNear(double actual, double expected, double tolerance,
+                   const char* expression, const char* file, int line);
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    testCheckNear((actual), (expected), (tolerance), #actual " ~ " #expected, __FILE__, __LINE__)
+
+#endif // HOST_TEST_HARNESS_H
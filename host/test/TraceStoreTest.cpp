@@ -0,0 +1,206 @@
+/**
+ * @file TraceStoreTest.cpp
+ * @brief Round trip of the memory-mapped columnar trace store
+ * @author catalina
+ */
+
+#include "TestHarness.h"
+
+#include <TraceStore.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    // Temporary file removed when the test ends
+    class TempFile {
+    public:
+        TempFile() {
+            char path[] = "/tmp/trace_store_test_XXXXXX";
+            int fd = mkstemp(path);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            _path = path;
+        }
+
+        ~TempFile() { unlink(_path.c_str()); }
+
+        const char* path() const { return _path.c_str(); }
+
+    private:
+        std::string _path;
+    };
+
+    // Alternating echo and color rows, several of them sharing a timestamp
+    std::vector<TraceRow> makeRows(size_t count) {
+        std::vector<TraceRow> rows;
+        uint64_t timestamp = 1000;
+        for (size_t i = 0; i < count; i++) {
+            TraceRow row = {};
+            row.timestamp = timestamp;
+            if (i % 2 == 0) {
+                row.echo = static_cast<uint16_t>(580 + i % 300);
+                row.status = TraceStore::ROW_ECHO;
+            } else {
+                row.red = static_cast<uint16_t>(100 + i % 50);
+                row.green = static_cast<uint16_t>(200 + i % 70);
+                row.blue = static_cast<uint16_t>(300 + i % 90);
+                row.label = static_cast<uint8_t>(i % 4);
+                row.status = TraceStore::ROW_COLOR | TraceStore::ROW_LABELLED;
+            }
+            rows.push_back(row);
+            timestamp += i % 5 == 0 ? 0 : 1500;
+        }
+        return rows;
+    }
+
+    // Reference search over every row
+    TraceRange scanRange(const std::vector<TraceRow>& rows, uint64_t fromUs, uint64_t toUs) {
+        TraceRange range = { rows.size(), rows.size() };
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (rows[i].timestamp >= fromUs && range.begin == rows.size()) {
+                range.begin = i;
+            }
+            if (rows[i].timestamp >= toUs) {
+                range.end = i;
+                break;
+            }
+        }
+        if (range.end < range.begin) {
+            range.end = range.begin;
+        }
+        return range;
+    }
+}
+
+TEST_CASE(writerRejectsOlderRows) {
+    TraceStoreWriter writer(16);
+    TraceRow row = {};
+    row.timestamp = 500;
+    CHECK(writer.append(row));
+    CHECK(writer.append(row));
+    row.timestamp = 499;
+    CHECK(!writer.append(row));
+    CHECK(writer.rowCount() == 2);
+    CHECK(writer.lastTimestamp() == 500);
+}
+
+TEST_CASE(rowsSurviveTheRoundTrip) {
+    const uint32_t blockRows = 16;
+    std::vector<TraceRow> rows = makeRows(1000);
+    TraceStoreWriter writer(blockRows);
+    for (const TraceRow& row : rows) {
+        writer.append(row);
+    }
+    TempFile file;
+    if (!CHECK(writer.write(file.path()))) {
+        return;
+    }
+
+    CHECK(TraceStore::isTraceStore(file.path()));
+    TraceStore store;
+    if (!CHECK(store.open(file.path()))) {
+        return;
+    }
+    CHECK(store.rowCount() == rows.size());
+    CHECK(store.blockRows() == blockRows);
+    CHECK(store.blockCount() == (rows.size() + blockRows - 1) / blockRows);
+    CHECK(store.all().size() == rows.size());
+
+    bool same = true;
+    for (size_t i = 0; i < rows.size(); i++) {
+        TraceRow row = store.row(i);
+        same = same && row.timestamp == rows[i].timestamp && row.echo == rows[i].echo
+            && row.red == rows[i].red && row.green == rows[i].green && row.blue == rows[i].blue
+            && row.label == rows[i].label && row.status == rows[i].status;
+    }
+    CHECK(same);
+
+    // Every column starts on a 64-byte boundary of the mapping
+    CHECK(reinterpret_cast<uintptr_t>(store.timestamps()) % 64 == 0);
+    CHECK(reinterpret_cast<uintptr_t>(store.echo()) % 64 == 0);
+    CHECK(reinterpret_cast<uintptr_t>(store.status()) % 64 == 0);
+
+    // The block index brackets the rows of each block
+    const TraceBlock* blocks = store.blocks();
+    CHECK(blocks[0].firstTimestamp == rows[0].timestamp);
+    CHECK(blocks[1].firstTimestamp == rows[blockRows].timestamp);
+    CHECK(blocks[store.blockCount() - 1].lastTimestamp == rows.back().timestamp);
+}
+
+TEST_CASE(findRangeMatchesAScan) {
+    std::vector<TraceRow> rows = makeRows(1000);
+    TraceStoreWriter writer(16);
+    for (const TraceRow& row : rows) {
+        writer.append(row);
+    }
+    TempFile file;
+    writer.write(file.path());
+    TraceStore store;
+    if (!CHECK(store.open(file.path()))) {
+        return;
+    }
+
+    // Bounds on, between, before and after the timestamps, within a block
+    // and across many of them
+    const uint64_t first = rows.front().timestamp;
+    const uint64_t last = rows.back().timestamp;
+    const uint64_t bounds[][2] = {
+        { 0, first }, { 0, first + 1 }, { first, last + 1 }, { last, last + 1 }, { last + 1, last + 100 },
+        { 25000, 26000 }, { 25001, 240001 }, { 100000, 100000 }, { 300000, 200000 }
+    };
+    for (const auto& bound : bounds) {
+        TraceRange found = store.findRange(bound[0], bound[1]);
+        TraceRange expected = scanRange(rows, bound[0], bound[1]);
+        if (expected.empty()) {
+            CHECK(found.empty());
+        } else {
+            CHECK(found.begin == expected.begin && found.end == expected.end);
+        }
+    }
+
+    // Every row timestamp as a lower bound picks the first of its duplicates
+    bool same = true;
+    for (size_t i = 0; i < rows.size(); i += 7) {
+        uint64_t timestamp = rows[i].timestamp;
+        TraceRange found = store.findRange(timestamp, timestamp + 1);
+        TraceRange expected = scanRange(rows, timestamp, timestamp + 1);
+        same = same && found.begin == expected.begin && found.end == expected.end;
+    }
+    CHECK(same);
+}
+
+TEST_CASE(damagedFilesAreRejected) {
+    std::vector<TraceRow> rows = makeRows(100);
+    TraceStoreWriter writer(16);
+    for (const TraceRow& row : rows) {
+        writer.append(row);
+    }
+    TempFile file;
+    writer.write(file.path());
+
+    TraceStore store;
+    CHECK(!store.open("/nonexistent/trace.store"));
+    CHECK(!store.error().empty());
+
+    // Cut the columns off
+    if (!CHECK(truncate(file.path(), sizeof(TraceStoreHeader) + 8) == 0)) {
+        return;
+    }
+    CHECK(!store.open(file.path()));
+    CHECK(!store.error().empty());
+    CHECK(store.rowCount() == 0);
+
+    // Not a trace file at all
+    FILE* text = fopen(file.path(), "w");
+    if (text != nullptr) {
+        fputs("timestamp,echo\n", text);
+        fclose(text);
+    }
+    CHECK(!TraceStore::isTraceStore(file.path()));
+    CHECK(!store.open(file.path()));
+}
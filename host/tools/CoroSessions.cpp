@@ -0,0 +1,189 @@
+/**
+ * @file CoroSessions.cpp
+ * @brief Runs many sensor sessions as coroutines on one thread
+ * @author catalina
+ *
+ * Usage:
+ *   coro_sessions [--sessions N] [--seconds S]
+ *
+ * Every session is a virtual device with its own scripted scene (see
+ * FleetUnit::scriptedScene()) and a coroutine written as straight-line
+ * code: ping every DISTANCE_PERIOD, take a color sample while an object is
+ * near and sound a chime, in a second coroutine, when a new color shows
+ * up. All sessions share one EventLoop on the main thread; a session
+ * waiting for an echo, a settling channel or its next ping only holds its
+ * coroutine frames.
+ *
+ * The report gives the aggregate sample rate in host time and the frame
+ * memory per session, next to the size of the session's device and
+ * drivers.
+ */
+
+#include "../coro/AsyncSensors.h"
+#include "../coro/EventLoop.h"
+#include "../fleet/FleetUnit.h"
+#include "../sim/HcSr04Model.h"
+#include "../sim/SimScene.h"
+#include "../sim/Tcs230Model.h"
+
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+    // Same ping rate as the ColorDistanceSystem example
+    const unsigned long DISTANCE_PERIOD = 100;   // ms
+
+    struct Session {
+        VirtualDevice device;
+        SimScene scene;
+        HcSr04Model echoModel;
+        Tcs230Model colorModel;
+        DistanceSensor distanceSensor;
+        ColorSensor colorSensor;
+        AudioManager audio;
+
+        uint64_t pings = 0;
+        uint64_t colorSamples = 0;
+        uint64_t sounds = 0;
+        uint64_t droppedSounds = 0;
+
+        explicit Session(uint32_t id)
+            : scene(FleetUnit::scriptedScene(id)),
+              echoModel(scene),
+              colorModel(scene) {
+            echoModel.setNoise(8.0f, id + 1);
+            colorModel.setNoise(0.02f, id + 1);
+            echoModel.attach(device);
+            colorModel.attach(device);
+            device.rng().seed(id + 1);
+            device.setSerialCapture(false);
+        }
+    };
+
+    Task<void> chime(Session& session, uint8_t effect) {
+        AsyncAudio audio(session.audio);
+        if (co_await audio.play(effect)) {
+            session.sounds++;
+        } else {
+            session.droppedSounds++;
+        }
+    }
+
+    Task<void> inspect(Session& session, uint64_t endNs) {
+        session.distanceSensor.begin();
+        session.colorSensor.begin();
+        session.audio.begin();
+        session.colorSensor.setCalibration(
+            CalibrationSettings::ColorSensor::RED_MIN,
+            CalibrationSettings::ColorSensor::RED_MAX,
+            CalibrationSettings::ColorSensor::GREEN_MIN,
+            CalibrationSettings::ColorSensor::GREEN_MAX,
+            CalibrationSettings::ColorSensor::BLUE_MIN,
+            CalibrationSettings::ColorSensor::BLUE_MAX
+        );
+
+        AsyncDistance distance(session.distanceSensor);
+        AsyncColor color(session.colorSensor);
+        ColorIdentifier shown = ColorIdentifier::NONE;
+
+        while (session.device.nowNs() < endNs) {
+            float cm = co_await distance.measure();
+            session.pings++;
+
+            if (cm > 0 && cm <= SystemSettings::PROXIMITY_THRESHOLD) {
+                ColorReading reading = co_await color.sample();
+                session.colorSamples++;
+                if (reading.colorId != ColorIdentifier::NONE && reading.colorId != shown) {
+                    shown = reading.colorId;
+                    EventLoop::current().spawn(session.device, chime(session, AudioManager::SOUND_SUCCESS));
+                }
+            } else {
+                shown = ColorIdentifier::NONE;
+            }
+            co_await waitMs(DISTANCE_PERIOD);
+        }
+    }
+
+    int usage(const char* program) {
+        fprintf(stderr, "Usage: %s [--sessions N] [--seconds S]\n", program);
+        return 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t sessionCount = 1000;
+    uint32_t seconds = 60;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessionCount = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtoul(argv[++i], nullptr, 10);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (sessionCount == 0 || seconds == 0) {
+        return usage(argv[0]);
+    }
+
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (size_t i = 0; i < sessionCount; i++) {
+        sessions.emplace_back(new Session(i));
+    }
+
+    EventLoop loop;
+    uint64_t endNs = static_cast<uint64_t>(seconds) * 1000000000ULL;
+    for (const std::unique_ptr<Session>& session : sessions) {
+        loop.spawn(session->device, inspect(*session, endNs));
+    }
+
+    // Every session is suspended at its first wake once the loop has run
+    // them all a little way
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t resumes = loop.run(1000000);
+    size_t suspendedBytes = FrameStats::current().liveBytes;
+    resumes += loop.run();
+    double hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t pings = 0;
+    uint64_t colorSamples = 0;
+    uint64_t sounds = 0;
+    uint64_t droppedSounds = 0;
+    double virtualSeconds = 0.0;
+    for (const std::unique_ptr<Session>& session : sessions) {
+        pings += session->pings;
+        colorSamples += session->colorSamples;
+        sounds += session->sounds;
+        droppedSounds += session->droppedSounds;
+        virtualSeconds += session->device.nowNs() / 1e9;
+    }
+    uint64_t samples = pings + colorSamples;
+    const FrameStats& frames = FrameStats::current();
+
+    printf("sessions:         %zu on 1 thread\n", sessionCount);
+    printf("virtual time:     %.1f s (%.1f s per session)\n", virtualSeconds, virtualSeconds / sessionCount);
+    printf("host time:        %.3f s\n", hostSeconds);
+    printf("speedup:          %.0fx real time\n", hostSeconds > 0.0 ? virtualSeconds / hostSeconds : 0.0);
+    printf("samples:          %llu (%llu pings, %llu color)\n",
+           static_cast<unsigned long long>(samples),
+           static_cast<unsigned long long>(pings),
+           static_cast<unsigned long long>(colorSamples));
+    printf("samples/s:        %.0f\n", hostSeconds > 0.0 ? samples / hostSeconds : 0.0);
+    printf("sounds:           %llu played, %llu dropped\n",
+           static_cast<unsigned long long>(sounds),
+           static_cast<unsigned long long>(droppedSounds));
+    printf("resumptions:      %llu\n", static_cast<unsigned long long>(resumes));
+    printf("frames:           %zu B per suspended session, %zu B peak in all\n",
+           suspendedBytes / sessionCount, frames.peakBytes);
+    printf("session state:    %zu B (device %zu B)\n", sizeof(Session), sizeof(VirtualDevice));
+    if (loop.running() != 0 || frames.liveFrames != 0) {
+        fprintf(stderr, "%zu tasks, %zu frames left over\n", loop.running(), frames.liveFrames);
+        return 1;
+    }
+    return 0;
+}
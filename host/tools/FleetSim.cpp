@@ -0,0 +1,180 @@
+/**
+ * @file FleetSim.cpp
+ * @brief Runs a fleet of independent detector units across all cores
+ * @author catalina
+ *
+ * Usage:
+ *   fleet_sim [--units N] [--seconds S] [--threads N] [--scaling]
+ *             [--capture DIR]
+ *
+ * Every unit is a complete ColorDistanceSystem (see FleetUnit) with its
+ * own virtual clock, scripted scene and sensor noise. Units are dealt to a
+ * work-stealing pool one job each and run for S seconds of virtual time.
+ * The aggregate rate is simulated sensor samples (pings and fused color
+ * samples) per second of host time.
+ *
+ * --scaling repeats the run on 1, 2, 4, ... threads up to --threads and
+ * prints the speedup of each. Units share no state, so every repetition
+ * must produce the same totals; a mismatch is reported as an error.
+ *
+ * --capture writes the serial stream of unit i to DIR/unit_<i>.bin, ready
+ * for telemetry_decode or a log collector under test.
+ */
+
+#include "../fleet/FleetUnit.h"
+#include "../parallel/WorkStealingPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct FleetRun {
+        size_t threads = 0;
+        double hostSeconds = 0.0;
+        FleetStats totals;
+    };
+
+    int usage(const char* program) {
+        fprintf(stderr,
+                "Usage: %s [--units N] [--seconds S] [--threads N] [--scaling] [--capture DIR]\n",
+                program);
+        return 1;
+    }
+
+    FleetRun runFleet(size_t units, uint32_t seconds, size_t threads, const char* captureDir) {
+        std::vector<std::unique_ptr<FleetUnit>> fleet;
+        for (size_t i = 0; i < units; i++) {
+            fleet.emplace_back(new FleetUnit(i));
+            fleet.back()->setSerialCapture(captureDir != nullptr);
+        }
+
+        WorkStealingPool pool(threads);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        pool.parallelFor(units, 1, [&](size_t index, size_t) {
+            fleet[index]->run(seconds * 1000);
+        });
+
+        FleetRun result;
+        result.threads = pool.size();
+        result.hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (const std::unique_ptr<FleetUnit>& unit : fleet) {
+            result.totals.add(unit->getStats());
+        }
+
+        if (captureDir != nullptr) {
+            for (const std::unique_ptr<FleetUnit>& unit : fleet) {
+                std::string path = std::string(captureDir) + "/unit_" + std::to_string(unit->getId()) + ".bin";
+                FILE* capture = fopen(path.c_str(), "wb");
+                if (capture == nullptr) {
+                    fprintf(stderr, "cannot write %s\n", path.c_str());
+                    continue;
+                }
+                fwrite(unit->serialOutput().data(), 1, unit->serialOutput().size(), capture);
+                fclose(capture);
+            }
+        }
+        return result;
+    }
+
+    double samplesPerSecond(const FleetRun& run) {
+        return run.hostSeconds > 0.0 ? run.totals.samples() / run.hostSeconds : 0.0;
+    }
+
+    bool sameTotals(const FleetStats& a, const FleetStats& b) {
+        return a.loops == b.loops && a.pings == b.pings && a.colorSamples == b.colorSamples
+            && a.records == b.records && a.serialBytes == b.serialBytes && a.i2cBytes == b.i2cBytes;
+    }
+
+    void printRun(size_t units, const FleetRun& run) {
+        const FleetStats& totals = run.totals;
+        printf("units:            %zu on %zu threads\n", units, run.threads);
+        printf("virtual time:     %.1f s (%.1f s per unit)\n", totals.virtualSeconds,
+               units > 0 ? totals.virtualSeconds / units : 0.0);
+        printf("host time:        %.3f s\n", run.hostSeconds);
+        printf("speedup:          %.0fx real time\n",
+               run.hostSeconds > 0.0 ? totals.virtualSeconds / run.hostSeconds : 0.0);
+        printf("samples:          %llu (%llu pings, %llu color)\n",
+               static_cast<unsigned long long>(totals.samples()),
+               static_cast<unsigned long long>(totals.pings),
+               static_cast<unsigned long long>(totals.colorSamples));
+        printf("samples/s:        %.0f\n", samplesPerSecond(run));
+        printf("telemetry:        %llu records, %llu dropped, %llu serial bytes\n",
+               static_cast<unsigned long long>(totals.records),
+               static_cast<unsigned long long>(totals.droppedRecords),
+               static_cast<unsigned long long>(totals.serialBytes));
+        printf("mode changes:     %llu\n", static_cast<unsigned long long>(totals.modeChanges));
+        printf("overruns:         %llu\n", static_cast<unsigned long long>(totals.overruns));
+        printf("i2c bytes:        %llu\n", static_cast<unsigned long long>(totals.i2cBytes));
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t units = 32;
+    uint32_t seconds = 600;
+    size_t threads = 0;
+    bool scaling = false;
+    const char* captureDir = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--units") == 0 && i + 1 < argc) {
+            units = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            captureDir = argv[++i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (units == 0 || seconds == 0) {
+        return usage(argv[0]);
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (!scaling) {
+        printRun(units, runFleet(units, seconds, threads, captureDir));
+        return 0;
+    }
+
+    std::vector<size_t> counts;
+    for (size_t count = 1; count < threads; count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(threads);
+
+    printf("%8s %10s %14s %8s %11s\n", "threads", "host s", "samples/s", "speedup", "efficiency");
+    FleetRun baseline;
+    bool consistent = true;
+    for (size_t count : counts) {
+        FleetRun run = runFleet(units, seconds, count, nullptr);
+        if (count == counts.front()) {
+            baseline = run;
+        }
+        consistent = consistent && sameTotals(run.totals, baseline.totals);
+
+        double speedup = run.hostSeconds > 0.0 ? baseline.hostSeconds / run.hostSeconds : 0.0;
+        printf("%8zu %10.3f %14.0f %7.2fx %10.0f%%\n", run.threads, run.hostSeconds,
+               samplesPerSecond(run), speedup, 100.0 * speedup / run.threads);
+    }
+    printf("\n");
+    printRun(units, baseline);
+
+    if (!consistent) {
+        fprintf(stderr, "totals differ between thread counts: units are sharing state\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,370 @@
+/**
+ * @file ParamSweep.cpp
+ * @brief Tunes detection thresholds and calibration against labelled traces
+ * @author catalina
+ *
+ * Usage:
+ *   param_sweep [--trials N] [--seed S] [--grid] [--threads N]
+ *               [--header OUT.h] TRACE.ddt [TRACE.ddt ...]
+ *
+ * Every trial is one parameter set: the color detection threshold, the six
+ * color calibration bounds, the proximity threshold and the number of pings
+ * averaged per distance. Trials are scored against the labelled rows of the
+ * traces (import --label or trace_store simulate) and run in parallel on a
+ * work-stealing pool. Color rows go through the real
+ * ColorSensor::convertToRGB and classifyColor; echo rows are converted to
+ * distances once with the real DistanceSensor, then averaged and compared
+ * with the proximity threshold per trial.
+ *
+ * The best set is printed and, with --header, written as a settings header
+ * that can replace the defaults in SensorConfig.h.
+ */
+
+#include "../parallel/WorkStealingPool.h"
+#include "../sim/TraceReplay.h"
+#include "../trace/TraceStore.h"
+
+#include <ColorSensor.h>
+#include <DistanceSensor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+    struct Parameters {
+        int colorThreshold;
+        int calibration[6];     // RED_MIN, RED_MAX, GREEN_MIN, GREEN_MAX, BLUE_MIN, BLUE_MAX
+        float proximityCm;
+        uint8_t samples;
+    };
+
+    struct Score {
+        double colorAccuracy;
+        double proximityF1;
+        double combined;
+    };
+
+    // Labelled color reading
+    struct ColorCase {
+        int raw[3];
+        uint8_t label;
+    };
+
+    // Labelled ping; distance from the real driver, 0 for no echo
+    struct EchoCase {
+        float distanceCm;
+        bool present;
+    };
+
+    struct Dataset {
+        std::vector<ColorCase> colors;
+        std::vector<EchoCase> echoes;
+    };
+
+    const char* const CALIBRATION_NAMES[6] = {
+        "RED_MIN", "RED_MAX", "GREEN_MIN", "GREEN_MAX", "BLUE_MIN", "BLUE_MAX"
+    };
+
+    const uint8_t MAX_SAMPLES = 5;
+
+    int usage(const char* program) {
+        fprintf(stderr,
+                "Usage: %s [--trials N] [--seed S] [--grid] [--threads N] [--header OUT.h] TRACE.ddt...\n",
+                program);
+        return 1;
+    }
+
+    Parameters defaults() {
+        Parameters parameters;
+        parameters.colorThreshold = SystemSettings::COLOR_DETECTION_THRESHOLD;
+        parameters.calibration[0] = CalibrationSettings::ColorSensor::RED_MIN;
+        parameters.calibration[1] = CalibrationSettings::ColorSensor::RED_MAX;
+        parameters.calibration[2] = CalibrationSettings::ColorSensor::GREEN_MIN;
+        parameters.calibration[3] = CalibrationSettings::ColorSensor::GREEN_MAX;
+        parameters.calibration[4] = CalibrationSettings::ColorSensor::BLUE_MIN;
+        parameters.calibration[5] = CalibrationSettings::ColorSensor::BLUE_MAX;
+        parameters.proximityCm = SystemSettings::PROXIMITY_THRESHOLD;
+        parameters.samples = 1;
+        return parameters;
+    }
+
+    bool loadTrace(const char* path, Dataset& dataset, std::vector<TraceSample>& echoSamples,
+                   std::vector<bool>& echoLabels) {
+        TraceStore store;
+        if (!store.open(path)) {
+            fprintf(stderr, "%s: %s\n", path, store.error().c_str());
+            return false;
+        }
+
+        // Later files continue after the earlier ones so the replay stays in order
+        uint64_t offset = echoSamples.empty() ? 0 : echoSamples.back().timestamp + 1;
+        const uint8_t* status = store.status();
+        for (size_t i = 0; i < store.rowCount(); i++) {
+            if (!(status[i] & TraceStore::ROW_LABELLED)) {
+                continue;
+            }
+            if (status[i] & TraceStore::ROW_ECHO) {
+                TraceSample sample;
+                sample.timestamp = offset + store.timestamps()[i];
+                sample.channel = TraceChannel::ECHO;
+                sample.value = store.echo()[i];
+                echoSamples.push_back(sample);
+                echoLabels.push_back(store.labels()[i] != 0);
+            } else if (status[i] & TraceStore::ROW_COLOR) {
+                ColorCase colorCase;
+                colorCase.raw[0] = store.red()[i];
+                colorCase.raw[1] = store.green()[i];
+                colorCase.raw[2] = store.blue()[i];
+                colorCase.label = store.labels()[i];
+                dataset.colors.push_back(colorCase);
+            }
+        }
+        return true;
+    }
+
+    // Pings are converted once; only the averaging differs between trials
+    void convertEchoes(const std::vector<TraceSample>& samples, const std::vector<bool>& labels,
+                       Dataset& dataset) {
+        TraceReplay replay;
+        for (const TraceSample& sample : samples) {
+            replay.add(sample);
+        }
+
+        VirtualDevice device;
+        VirtualDevice::Scope scope(device);
+        device.setSerialCapture(false);
+        replay.attach(device);
+
+        DistanceSensor sensor;
+        sensor.begin();
+        for (size_t i = 0; i < samples.size(); i++) {
+            EchoCase echoCase;
+            echoCase.distanceCm = sensor.getDistance();
+            echoCase.present = labels[i];
+            dataset.echoes.push_back(echoCase);
+        }
+    }
+
+    // The drivers read micros() for profiling, so every worker needs a device
+    VirtualDevice& workerDevice() {
+        thread_local VirtualDevice device;
+        return device;
+    }
+
+    Score evaluate(const Dataset& dataset, const Parameters& parameters) {
+        VirtualDevice::Scope scope(workerDevice());
+
+        ColorSensor sensor;
+        sensor.setCalibration(parameters.calibration[0], parameters.calibration[1],
+                              parameters.calibration[2], parameters.calibration[3],
+                              parameters.calibration[4], parameters.calibration[5]);
+        sensor.setDetectionThreshold(parameters.colorThreshold);
+
+        size_t correct = 0;
+        for (const ColorCase& colorCase : dataset.colors) {
+            int red, green, blue;
+            sensor.convertToRGB(colorCase.raw[0], colorCase.raw[1], colorCase.raw[2], red, green, blue);
+            correct += static_cast<uint8_t>(sensor.classifyColor(red, green, blue)) == colorCase.label;
+        }
+
+        // getDistance(samples) averages consecutive pings; so does the window here
+        size_t truePositives = 0, falsePositives = 0, falseNegatives = 0;
+        float window = 0.0f;
+        for (size_t i = 0; i < dataset.echoes.size(); i++) {
+            window += dataset.echoes[i].distanceCm;
+            if (i >= parameters.samples) {
+                window -= dataset.echoes[i - parameters.samples].distanceCm;
+            }
+            uint8_t count = std::min<size_t>(i + 1, parameters.samples);
+            float distance = window / count;
+            bool detected = distance > 0 && distance <= parameters.proximityCm;
+            bool present = dataset.echoes[i].present;
+            truePositives += detected && present;
+            falsePositives += detected && !present;
+            falseNegatives += !detected && present;
+        }
+
+        Score score;
+        score.colorAccuracy = dataset.colors.empty() ? 1.0
+            : static_cast<double>(correct) / dataset.colors.size();
+        size_t denominator = 2 * truePositives + falsePositives + falseNegatives;
+        score.proximityF1 = denominator == 0 ? 1.0 : 2.0 * truePositives / denominator;
+        score.combined = (score.colorAccuracy + score.proximityF1) / 2.0;
+        return score;
+    }
+
+    // Calibration bounds within ±50 % of the defaults, with max above min
+    std::vector<Parameters> randomTrials(size_t count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+        std::uniform_int_distribution<int> threshold(5, 60);
+        std::uniform_real_distribution<float> proximity(5.0f, 20.0f);
+        std::uniform_int_distribution<int> samples(1, MAX_SAMPLES);
+
+        Parameters base = defaults();
+        std::vector<Parameters> trials(1, base);
+        while (trials.size() < count) {
+            Parameters trial;
+            trial.colorThreshold = threshold(rng);
+            for (int i = 0; i < 6; i += 2) {
+                trial.calibration[i] = static_cast<int>(base.calibration[i] * scale(rng));
+                trial.calibration[i + 1] = std::max(trial.calibration[i] + 10,
+                    static_cast<int>(base.calibration[i + 1] * scale(rng)));
+            }
+            trial.proximityCm = proximity(rng);
+            trial.samples = samples(rng);
+            trials.push_back(trial);
+        }
+        return trials;
+    }
+
+    // Full grid over thresholds and averaging, with the calibration ranges stretched together
+    std::vector<Parameters> gridTrials() {
+        const float stretches[] = { 0.8f, 0.9f, 1.0f, 1.1f, 1.2f };
+        Parameters base = defaults();
+        std::vector<Parameters> trials;
+        for (int threshold = 5; threshold <= 60; threshold += 5) {
+            for (float stretch : stretches) {
+                for (float proximity = 5.0f; proximity <= 20.0f; proximity += 1.0f) {
+                    for (uint8_t samples = 1; samples <= MAX_SAMPLES; samples++) {
+                        Parameters trial = base;
+                        trial.colorThreshold = threshold;
+                        for (int i = 0; i < 6; i += 2) {
+                            int span = base.calibration[i + 1] - base.calibration[i];
+                            trial.calibration[i + 1] = base.calibration[i] + static_cast<int>(span * stretch);
+                        }
+                        trial.proximityCm = proximity;
+                        trial.samples = samples;
+                        trials.push_back(trial);
+                    }
+                }
+            }
+        }
+        return trials;
+    }
+
+    void printParameters(const char* title, const Parameters& parameters, const Score& score) {
+        printf("%s: score %.4f (color accuracy %.4f, proximity F1 %.4f)\n", title,
+               score.combined, score.colorAccuracy, score.proximityF1);
+        printf("  COLOR_DETECTION_THRESHOLD = %d\n", parameters.colorThreshold);
+        for (int i = 0; i < 6; i++) {
+            printf("  %-9s = %d\n", CALIBRATION_NAMES[i], parameters.calibration[i]);
+        }
+        printf("  PROXIMITY_THRESHOLD = %.1f cm\n", parameters.proximityCm);
+        printf("  DISTANCE_SAMPLES = %u\n", parameters.samples);
+    }
+
+    bool writeHeader(const char* path, const Parameters& parameters, const Score& score) {
+        FILE* out = fopen(path, "w");
+        if (out == nullptr) {
+            return false;
+        }
+
+        const char* name = strrchr(path, '/');
+        fprintf(out,
+                "/**\n"
+                " * @file %s\n"
+                " * @brief Settings tuned by param_sweep against labelled traces\n"
+                " *\n"
+                " * Score %.4f (color accuracy %.4f, proximity F1 %.4f).\n"
+                " */\n\n"
+                "#ifndef TUNED_SETTINGS_H\n"
+                "#define TUNED_SETTINGS_H\n\n"
+                "#include <stdint.h>\n\n"
+                "namespace TunedSettings {\n"
+                "    namespace ColorSensor {\n",
+                name != nullptr ? name + 1 : path, score.combined, score.colorAccuracy, score.proximityF1);
+        for (int i = 0; i < 6; i++) {
+            fprintf(out, "        constexpr int %s = %d;\n", CALIBRATION_NAMES[i], parameters.calibration[i]);
+        }
+        fprintf(out,
+                "    }\n\n"
+                "    constexpr int COLOR_DETECTION_THRESHOLD = %d;\n"
+                "    constexpr float PROXIMITY_THRESHOLD = %.1f; // cm\n"
+                "    constexpr uint8_t DISTANCE_SAMPLES = %u;\n"
+                "}\n\n"
+                "#endif // TUNED_SETTINGS_H\n",
+                parameters.colorThreshold, parameters.proximityCm, parameters.samples);
+        return fclose(out) == 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t trialCount = 10000;
+    uint32_t seed = 1;
+    bool grid = false;
+    size_t threads = 0;
+    const char* headerPath = nullptr;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trials") == 0 && i + 1 < argc) {
+            trialCount = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--grid") == 0) {
+            grid = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--header") == 0 && i + 1 < argc) {
+            headerPath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            return usage(argv[0]);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty() || trialCount == 0) {
+        return usage(argv[0]);
+    }
+
+    Dataset dataset;
+    std::vector<TraceSample> echoSamples;
+    std::vector<bool> echoLabels;
+    for (const char* path : paths) {
+        if (!loadTrace(path, dataset, echoSamples, echoLabels)) {
+            return 1;
+        }
+    }
+    convertEchoes(echoSamples, echoLabels, dataset);
+    if (dataset.colors.empty() && dataset.echoes.empty()) {
+        fprintf(stderr, "no labelled rows in the input\n");
+        return 1;
+    }
+
+    std::vector<Parameters> trials = grid ? gridTrials() : randomTrials(trialCount, seed);
+    std::vector<Score> scores(trials.size());
+
+    WorkStealingPool pool(threads);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pool.parallelFor(trials.size(), 16, [&](size_t index, size_t) {
+        scores[index] = evaluate(dataset, trials[index]);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Ties go to the earlier trial, so the defaults win unless beaten
+    size_t best = 0;
+    for (size_t i = 1; i < trials.size(); i++) {
+        if (scores[i].combined > scores[best].combined) {
+            best = i;
+        }
+    }
+
+    printf("%zu color rows, %zu echo rows\n", dataset.colors.size(), dataset.echoes.size());
+    printf("%zu trials on %zu threads in %.3f s (%.0f trials/s, %zu steals)\n", trials.size(),
+           pool.size(), seconds, seconds > 0.0 ? trials.size() / seconds : 0.0, pool.getStealCount());
+    Parameters base = defaults();
+    printParameters("defaults", base, evaluate(dataset, base));
+    printParameters("best", trials[best], scores[best]);
+
+    if (headerPath != nullptr && !writeHeader(headerPath, trials[best], scores[best])) {
+        fprintf(stderr, "cannot write %s\n", headerPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+# Estimates the SRAM that flash-resident strings save on an AVR.
+#
+# A plain string literal is copied from flash into SRAM at startup; one in
+# PROGMEM (a TextTable entry or an F("...") literal) stays in flash. The
+# report scans the sources and sums the bytes of every such literal,
+# terminator included, per file. Empty literals are left out, since the
+# compiler merges them with any other empty string. This is an estimate
+# from the text, not a measurement: duplicates the linker would merge
+# count twice, and literals with escaped quotes are missed. avr-size on an
+# AVR build gives the actual .data size.
+#
+# Usage: cmake -DSOURCE_DIR=<repo> -P SramReport.cmake
+
+file(GLOB_RECURSE sources
+    ${SOURCE_DIR}/src/*.cpp
+    ${SOURCE_DIR}/src/*.h
+    ${SOURCE_DIR}/examples/*.ino)
+list(SORT sources)
+
+set(total 0)
+set(count 0)
+foreach(source ${sources})
+    file(READ ${source} text)
+
+    # PROGMEM = "..." definitions and F("...") literals, without escapes
+    string(REGEX MATCHALL "PROGMEM = \"[^\"]*\"|F\\(\"[^\"]*\"\\)" literals "${text}")
+
+    set(bytes 0)
+    foreach(literal ${literals})
+        string(REGEX REPLACE "^[^\"]*\"([^\"]*)\".*$" "\\1" body "${literal}")
+        string(LENGTH "${body}" length)
+        if(length EQUAL 0)
+            continue()
+        endif()
+        math(EXPR bytes "${bytes} + ${length} + 1")
+        math(EXPR count "${count} + 1")
+    endforeach()
+
+    if(bytes GREATER 0)
+        file(RELATIVE_PATH name ${SOURCE_DIR} ${source})
+        message(STATUS "  ${name}: ~${bytes} bytes")
+        math(EXPR total "${total} + ${bytes}")
+    endif()
+endforeach()
+
+message(STATUS "Flash strings (estimate): ${count} literals, ~${total} bytes of SRAM freed")
@@ -0,0 +1,320 @@
+/**
+ * @file TelemetryAggregatorMain.cpp
+ * @brief Collects telemetry from many serial ports into statistics and a record log
+ * @author catalina
+ *
+ * Usage:
+ *   telemetry_aggregator [--store DIR] [--seconds S] [--interval S] [--baud B] PORT...
+ *   telemetry_aggregator --emulate N [--speed X] [--store DIR] [--seconds S] [--interval S]
+ *
+ * Reads every port on one thread (see TelemetryAggregator) while the main
+ * thread prints the fleet's reading rate, latency percentiles and errors
+ * every interval from the lock-free per-device counters. With --store,
+ * every reading is appended to the record log in DIR. Runs until
+ * interrupted, or for S seconds.
+ *
+ * --emulate opens N ptys instead of ports and replays on each the
+ * telemetry of a simulated unit (FleetUnit, one minute recorded per unit)
+ * at X times its reading rate. At the end every reading sent must have
+ * arrived and, with --store, be in the log; anything missing is reported
+ * as an error.
+ */
+
+#include "../collector/PtyEmulator.h"
+#include "../collector/RecordLog.h"
+#include "../collector/TelemetryAggregator.h"
+#include "../fleet/FleetUnit.h"
+#include "../parallel/WorkStealingPool.h"
+#include "../sim/TelemetryCapture.h"
+
+#include <atomic>
+#include <chrono>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace {
+    // Virtual run time recorded per emulated unit
+    const uint32_t RECORDING_TIME = 60000;   // ms
+
+    volatile sig_atomic_t interrupted = 0;
+
+    void onSignal(int) {
+        interrupted = 1;
+    }
+
+    int usage(const char* program) {
+        fprintf(stderr,
+                "Usage: %s [--store DIR] [--seconds S] [--interval S] [--baud B] PORT...\n"
+                "       %s --emulate N [--speed X] [--store DIR] [--seconds S] [--interval S]\n",
+                program, program);
+        return 1;
+    }
+
+    uint64_t monotonicNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    double threadCpuSeconds(std::thread& thread) {
+        clockid_t clock;
+        struct timespec time;
+        if (pthread_getcpuclockid(thread.native_handle(), &clock) != 0 || clock_gettime(clock, &time) != 0) {
+            return 0.0;
+        }
+        return time.tv_sec + time.tv_nsec / 1e9;
+    }
+
+    DeviceSnapshot fleetSnapshot(const TelemetryAggregator& aggregator) {
+        uint64_t now = monotonicNs();
+        DeviceSnapshot total;
+        total.timeNs = now;
+        for (size_t i = 0; i < aggregator.deviceCount(); i++) {
+            total.add(aggregator.counters(i).snapshot(now));
+        }
+        return total;
+    }
+
+    // One minute of a simulated unit's readings, timestamps from 0
+    std::vector<TelemetryRecord> recordUnit(uint32_t id, uint32_t& durationMs) {
+        FleetUnit unit(id);
+        unit.setSerialCapture(true);
+        unit.run(RECORDING_TIME);
+
+        const std::string& output = unit.serialOutput();
+        TelemetryCapture capture;
+        capture.parse(std::vector<uint8_t>(output.begin(), output.end()));
+        std::vector<TelemetryRecord> readings = capture.readings();
+        if (readings.empty()) {
+            durationMs = 0;
+            return readings;
+        }
+
+        uint32_t first = readings.front().timestamp;
+        for (TelemetryRecord& record : readings) {
+            record.timestamp -= first;
+        }
+        durationMs = RECORDING_TIME - first;
+        return readings;
+    }
+
+    bool startEmulator(PtyEmulator& emulator, size_t devices) {
+        std::vector<std::vector<TelemetryRecord>> recordings(devices);
+        std::vector<uint32_t> durations(devices);
+        WorkStealingPool pool;
+        pool.parallelFor(devices, 1, [&](size_t index, size_t) {
+            recordings[index] = recordUnit(index, durations[index]);
+        });
+
+        for (size_t i = 0; i < devices; i++) {
+            if (emulator.addDevice(recordings[i], durations[i]) < 0) {
+                fprintf(stderr, "unit %zu: %s\n", i, emulator.error().c_str());
+                return false;
+            }
+        }
+        emulator.start();
+        return true;
+    }
+
+    void printInterval(double seconds, const TelemetryAggregator& aggregator,
+                       const DeviceSnapshot& now, const DeviceSnapshot& before, double cpuShare) {
+        printf("%7.1f s  %zu/%zu ports  %8.0f readings/s  p50 %llu us  p99 %llu us  "
+               "bad %llu  gaps %llu  cpu %.1f%%\n",
+               seconds, aggregator.openCount(), aggregator.deviceCount(), now.readingRate(before),
+               static_cast<unsigned long long>(now.latencyPercentile(0.5)),
+               static_cast<unsigned long long>(now.latencyPercentile(0.99)),
+               static_cast<unsigned long long>(now.badFrames),
+               static_cast<unsigned long long>(now.sequenceGaps), 100.0 * cpuShare);
+        fflush(stdout);
+    }
+
+    void printSummary(const TelemetryAggregator& aggregator, const DeviceSnapshot& total,
+                      double hostSeconds, double cpuSeconds) {
+        static const char* const COLOR_NAMES[DeviceSnapshot::COLOR_CLASSES] = { "none", "red", "green", "blue" };
+
+        printf("\nports:            %zu (%zu still open)\n", aggregator.deviceCount(), aggregator.openCount());
+        printf("readings:         %llu (%.0f/s), %llu samples, %llu bytes\n",
+               static_cast<unsigned long long>(total.readings), total.readings / hostSeconds,
+               static_cast<unsigned long long>(total.samples),
+               static_cast<unsigned long long>(total.bytes));
+        printf("latency:          p50 %llu us, p99 %llu us, p99.9 %llu us\n",
+               static_cast<unsigned long long>(total.latencyPercentile(0.5)),
+               static_cast<unsigned long long>(total.latencyPercentile(0.99)),
+               static_cast<unsigned long long>(total.latencyPercentile(0.999)));
+        printf("errors:           %llu bad frames, %llu bytes skipped, %llu sequence gaps, "
+               "%llu dropped on the devices\n",
+               static_cast<unsigned long long>(total.badFrames),
+               static_cast<unsigned long long>(total.skippedBytes),
+               static_cast<unsigned long long>(total.sequenceGaps),
+               static_cast<unsigned long long>(total.droppedRecords));
+        printf("aggregator cpu:   %.3f s (%.1f%% of one core)\n", cpuSeconds, 100.0 * cpuSeconds / hostSeconds);
+
+        printf("colors:          ");
+        for (size_t i = 0; i < DeviceSnapshot::COLOR_CLASSES; i++) {
+            printf(" %s %llu", COLOR_NAMES[i], static_cast<unsigned long long>(total.colors[i]));
+        }
+        printf("\ndistance:         no echo %llu\n", static_cast<unsigned long long>(total.noEcho));
+        for (size_t i = 0; i < DeviceSnapshot::DISTANCE_BUCKETS; i++) {
+            if (total.distance[i] == 0) {
+                continue;
+            }
+            if (i + 1 < DeviceSnapshot::DISTANCE_BUCKETS) {
+                printf("  %3zu-%3zu cm      %llu\n", i * 10, i * 10 + 10, static_cast<unsigned long long>(total.distance[i]));
+            } else {
+                printf("  beyond %3zu cm   %llu\n", i * 10, static_cast<unsigned long long>(total.distance[i]));
+            }
+        }
+    }
+
+    // The log must hold every reading, and its index must find the rows of any time range
+    bool checkStore(const char* directory, uint64_t readings) {
+        RecordLog log;
+        if (!log.open(directory)) {
+            fprintf(stderr, "%s\n", log.error().c_str());
+            return false;
+        }
+
+        size_t rows = log.rowCount();
+        bool ok = rows >= readings;
+        if (rows > 0) {
+            uint64_t first = log.row(0).timeNs;
+            uint64_t middle = first + (log.row(rows - 1).timeNs - first) / 2;
+            TraceRange early = log.findRange(0, middle);
+            TraceRange late = log.findRange(middle, UINT64_MAX);
+            ok = ok && early.end == late.begin && late.end == rows
+                && (early.empty() || log.row(early.end - 1).timeNs < middle)
+                && (late.empty() || log.row(late.begin).timeNs >= middle);
+        }
+        printf("store:            %zu rows in %s/readings.log%s\n", rows, directory, ok ? "" : " (MISMATCH)");
+        return ok;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<const char*> ports;
+    const char* storeDir = nullptr;
+    double seconds = 0.0;
+    double interval = 1.0;
+    unsigned long baud = 9600;
+    size_t emulated = 0;
+    double speed = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--store") == 0 && i + 1 < argc) {
+            storeDir = argv[++i];
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+            baud = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--emulate") == 0 && i + 1 < argc) {
+            emulated = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            ports.push_back(argv[i]);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if ((ports.empty() == (emulated == 0)) || interval <= 0.0 || speed <= 0.0) {
+        return usage(argv[0]);
+    }
+
+    RecordLogWriter store;
+    if (storeDir != nullptr && !store.open(storeDir)) {
+        fprintf(stderr, "%s\n", store.error().c_str());
+        return 1;
+    }
+    uint64_t storedBefore = store.rowCount();
+
+    PtyEmulator emulator(speed);
+    if (emulated > 0) {
+        if (!startEmulator(emulator, emulated)) {
+            return 1;
+        }
+        for (size_t i = 0; i < emulator.deviceCount(); i++) {
+            ports.push_back(emulator.device(i).path().c_str());
+        }
+    }
+
+    TelemetryAggregator aggregator(storeDir != nullptr ? &store : nullptr);
+    for (const char* port : ports) {
+        if (aggregator.addPort(port, baud) < 0) {
+            fprintf(stderr, "%s\n", aggregator.error().c_str());
+            return 1;
+        }
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    std::atomic<bool> collecting(true);
+    std::atomic<double> collectorCpu(0.0);
+    std::thread collector([&]() {
+        while (collecting.load(std::memory_order_relaxed) && aggregator.openCount() > 0) {
+            aggregator.poll(100);
+        }
+        struct timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        collectorCpu = time.tv_sec + time.tv_nsec / 1e9;
+    });
+
+    uint64_t start = monotonicNs();
+    DeviceSnapshot last = fleetSnapshot(aggregator);
+    double lastCpu = 0.0;
+    for (int tick = 1; !interrupted && aggregator.openCount() > 0; tick++) {
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+            std::chrono::nanoseconds(start + static_cast<uint64_t>(tick * interval * 1e9))));
+        DeviceSnapshot now = fleetSnapshot(aggregator);
+        double cpu = threadCpuSeconds(collector);
+        double elapsed = (now.timeNs - start) / 1e9;
+        printInterval(elapsed, aggregator, now, last, (cpu - lastCpu) / ((now.timeNs - last.timeNs) / 1e9));
+        last = now;
+        lastCpu = cpu;
+        if (seconds > 0.0 && elapsed >= seconds) {
+            break;
+        }
+    }
+
+    // Let everything the emulated devices sent arrive before stopping
+    uint64_t sent = 0;
+    if (emulated > 0) {
+        emulator.stop();
+        sent = emulator.getSentCount();
+        uint64_t deadline = monotonicNs() + 2000000000ULL;
+        while (fleetSnapshot(aggregator).readings < sent && monotonicNs() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    collecting = false;
+    collector.join();
+    emulator.close();
+    double hostSeconds = (monotonicNs() - start) / 1e9;
+    double cpuSeconds = collectorCpu;
+
+    DeviceSnapshot total = fleetSnapshot(aggregator);
+    printSummary(aggregator, total, hostSeconds, cpuSeconds);
+
+    bool ok = true;
+    if (storeDir != nullptr) {
+        store.close();
+        ok = checkStore(storeDir, storedBefore + total.readings);
+    }
+    if (emulated > 0) {
+        printf("emulator:         %llu readings sent\n", static_cast<unsigned long long>(sent));
+        if (total.readings != sent) {
+            fprintf(stderr, "%llu readings sent but %llu received\n",
+                    static_cast<unsigned long long>(sent), static_cast<unsigned long long>(total.readings));
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file TraceReplayMain.cpp
+ * @brief Runs recorded sensor inputs through the driver and classifier code
+ * @author catalina
+ *
+ * Usage: trace_replay [--temperature C] capture.bin|trace.ddt > outputs.csv
+ *
+ * The input is either a serial stream recorded with tracing enabled (send
+ * 't' to ColorDistanceSystem) or a columnar trace file. Every recorded echo goes through
+ * DistanceSensor::getDistance() and every complete red/green/blue set
+ * through ColorSensor::readChannel(), convertToRGB() and classifyColor()
+ * of this build. Diffing the output of two builds shows exactly which
+ * readings a change affects.
+ */
+
+#include <Arduino.h>
+#include <VirtualDevice.h>
+#include <ColorSensor.h>
+#include <DistanceSensor.h>
+
+#include "../sim/TelemetryCapture.h"
+#include "../sim/TraceReplay.h"
+#include "../trace/TraceStore.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+    void addSample(TraceReplay& replay, uint64_t timestamp, TraceChannel channel, uint16_t value) {
+        TraceSample sample;
+        sample.timestamp = timestamp;
+        sample.channel = channel;
+        sample.value = value;
+        replay.add(sample);
+    }
+
+    bool loadSamples(const char* path, TraceReplay& replay) {
+        if (TraceStore::isTraceStore(path)) {
+            TraceStore store;
+            if (!store.open(path)) {
+                fprintf(stderr, "%s: %s\n", path, store.error().c_str());
+                return false;
+            }
+
+            // A color row stands for its three channel reads in the usual order
+            for (size_t i = 0; i < store.rowCount(); i++) {
+                uint64_t timestamp = store.timestamps()[i];
+                if (store.status()[i] & TraceStore::ROW_ECHO) {
+                    addSample(replay, timestamp, TraceChannel::ECHO, store.echo()[i]);
+                } else if (store.status()[i] & TraceStore::ROW_COLOR) {
+                    addSample(replay, timestamp, TraceChannel::COLOR_RED, store.red()[i]);
+                    addSample(replay, timestamp, TraceChannel::COLOR_GREEN, store.green()[i]);
+                    addSample(replay, timestamp, TraceChannel::COLOR_BLUE, store.blue()[i]);
+                }
+            }
+            return true;
+        }
+
+        TelemetryCapture capture;
+        if (!capture.load(path)) {
+            fprintf(stderr, "cannot open %s\n", path);
+            return false;
+        }
+        for (const TelemetrySample& recorded : capture.samples()) {
+            addSample(replay, recorded.timestamp, static_cast<TraceChannel>(recorded.channel), recorded.value);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    float temperature = 22.0f;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--temperature") == 0 && i + 1 < argc) {
+            temperature = atof(argv[++i]);
+        } else if (path == nullptr && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--temperature C] capture.bin\n", argv[0]);
+            return 1;
+        }
+    }
+    if (path == nullptr) {
+        fprintf(stderr, "Usage: %s [--temperature C] capture.bin\n", argv[0]);
+        return 1;
+    }
+
+    TraceReplay replay;
+    if (!loadSamples(path, replay)) {
+        return 1;
+    }
+
+    VirtualDevice device;
+    VirtualDevice::Scope scope(device);
+    device.setSerialCapture(false);
+    replay.attach(device);
+
+    DistanceSensor distanceSensor;
+    ColorSensor colorSensor;
+    distanceSensor.begin();
+    colorSensor.begin();
+    distanceSensor.calibrateForTemperature(temperature);
+    colorSensor.setCalibration(
+        CalibrationSettings::ColorSensor::RED_MIN,
+        CalibrationSettings::ColorSensor::RED_MAX,
+        CalibrationSettings::ColorSensor::GREEN_MIN,
+        CalibrationSettings::ColorSensor::GREEN_MAX,
+        CalibrationSettings::ColorSensor::BLUE_MIN,
+        CalibrationSettings::ColorSensor::BLUE_MAX
+    );
+
+    std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+
+    printf("timestamp_us,kind,distance_cm,red,green,blue,color\n");
+    int raw[3] = { 0, 0, 0 };
+    bool haveChannel[3] = { false, false, false };
+    unsigned long distances = 0;
+    unsigned long colors = 0;
+
+    for (const TraceSample& sample : replay.samples()) {
+        if (sample.channel == TraceChannel::ECHO) {
+            float distance = distanceSensor.getDistance();
+            printf("%llu,distance,%.2f,,,,\n", static_cast<unsigned long long>(sample.timestamp), distance);
+            distances++;
+            continue;
+        }
+
+        // Color channels are read in the recorded order; a set is complete at blue
+        uint8_t channel = static_cast<uint8_t>(sample.channel) - static_cast<uint8_t>(TraceChannel::COLOR_RED);
+        raw[channel] = colorSensor.readChannel(channel);
+        haveChannel[channel] = true;
+        if (sample.channel != TraceChannel::COLOR_BLUE || !haveChannel[0] || !haveChannel[1]) {
+            continue;
+        }
+
+        int red, green, blue;
+        colorSensor.convertToRGB(raw[0], raw[1], raw[2], red, green, blue);
+        ColorIdentifier color = colorSensor.classifyColor(red, green, blue);
+        printf("%llu,color,,%d,%d,%d,%s\n", static_cast<unsigned long long>(sample.timestamp),
+               red, green, blue, String(ColorSensor::getColorName(color)).c_str());
+        haveChannel[0] = haveChannel[1] = haveChannel[2] = false;
+        colors++;
+    }
+
+    double hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - hostStart).count();
+    fprintf(stderr, "%zu samples replayed in %.3f s: %lu distances, %lu colors, %u underruns\n",
+            replay.samples().size(), hostSeconds, distances, colors, replay.getUnderruns());
+    return 0;
+}
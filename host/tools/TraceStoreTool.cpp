@@ -0,0 +1,363 @@
+/**
+ * @file TraceStoreTool.cpp
+ * @brief Builds, inspects and scans columnar trace files
+ * @author catalina
+ *
+ * Usage:
+ *   trace_store import [--label ID] OUT.ddt CAPTURE.bin [CAPTURE.bin ...]
+ *   trace_store info FILE.ddt
+ *   trace_store dump [--from US] [--to US] FILE.ddt
+ *   trace_store scan FILE.ddt
+ *   trace_store synth ROWS OUT.ddt
+ *   trace_store simulate [--noise SIGMA] [--seed N] SECONDS OUT.ddt
+ *
+ * import converts serial captures recorded with tracing enabled; each
+ * further capture is appended after the end of the previous one. scan
+ * reads every column once and reports the achieved bandwidth. synth
+ * writes a large synthetic trace for sizing and bandwidth tests. simulate
+ * runs the real drivers against the demo scene and labels every row with
+ * the scene's ground truth, giving labelled data for the tuning tools.
+ */
+
+#include "../trace/TraceImport.h"
+#include "../trace/TraceStore.h"
+#include "../sim/HcSr04Model.h"
+#include "../sim/Tcs230Model.h"
+
+#include <Arduino.h>
+#include <ColorSensor.h>
+#include <DistanceSensor.h>
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+    int usage(const char* program) {
+        fprintf(stderr,
+                "Usage: %s import [--label ID] OUT.ddt CAPTURE.bin...\n"
+                "       %s info FILE.ddt\n"
+                "       %s dump [--from US] [--to US] FILE.ddt\n"
+                "       %s scan FILE.ddt\n"
+                "       %s synth ROWS OUT.ddt\n"
+                "       %s simulate [--noise SIGMA] [--seed N] SECONDS OUT.ddt\n",
+                program, program, program, program, program, program);
+        return 1;
+    }
+
+    bool openStore(TraceStore& store, const char* path) {
+        if (!store.open(path)) {
+            fprintf(stderr, "%s: %s\n", path, store.error().c_str());
+            return false;
+        }
+        return true;
+    }
+
+    int runImport(int argc, char** argv) {
+        TraceImportOptions options;
+        int i = 2;
+        if (i + 1 < argc && strcmp(argv[i], "--label") == 0) {
+            options.labelled = true;
+            options.label = static_cast<uint8_t>(atoi(argv[i + 1]));
+            i += 2;
+        }
+        if (i + 1 >= argc) {
+            return usage(argv[0]);
+        }
+
+        const char* outPath = argv[i++];
+        TraceStoreWriter writer;
+        for (; i < argc; i++) {
+            TelemetryCapture capture;
+            if (!capture.load(argv[i])) {
+                fprintf(stderr, "cannot open %s\n", argv[i]);
+                return 1;
+            }
+            size_t rows = importCapture(writer, capture, options);
+            fprintf(stderr, "%s: %zu rows\n", argv[i], rows);
+        }
+
+        if (!writer.write(outPath)) {
+            fprintf(stderr, "cannot write %s\n", outPath);
+            return 1;
+        }
+        fprintf(stderr, "%s: %zu rows written\n", outPath, writer.rowCount());
+        return 0;
+    }
+
+    int runInfo(const char* path) {
+        TraceStore store;
+        if (!openStore(store, path)) {
+            return 1;
+        }
+
+        size_t echoRows = 0, colorRows = 0, labelled = 0;
+        const uint8_t* status = store.status();
+        for (size_t i = 0; i < store.rowCount(); i++) {
+            echoRows += (status[i] & TraceStore::ROW_ECHO) != 0;
+            colorRows += (status[i] & TraceStore::ROW_COLOR) != 0;
+            labelled += (status[i] & TraceStore::ROW_LABELLED) != 0;
+        }
+
+        printf("file size:   %zu bytes\n", store.fileSize());
+        printf("rows:        %zu (%zu echo, %zu color, %zu labelled)\n", store.rowCount(), echoRows, colorRows, labelled);
+        printf("blocks:      %zu x %u rows\n", store.blockCount(), store.blockRows());
+        if (store.rowCount() > 0) {
+            printf("time range:  %llu .. %llu us\n",
+                   static_cast<unsigned long long>(store.timestamps()[0]),
+                   static_cast<unsigned long long>(store.timestamps()[store.rowCount() - 1]));
+        }
+        return 0;
+    }
+
+    int runDump(int argc, char** argv) {
+        uint64_t from = 0;
+        uint64_t to = UINT64_MAX;
+        const char* path = nullptr;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+                from = strtoull(argv[++i], nullptr, 10);
+            } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+                to = strtoull(argv[++i], nullptr, 10);
+            } else if (path == nullptr) {
+                path = argv[i];
+            } else {
+                return usage(argv[0]);
+            }
+        }
+        if (path == nullptr) {
+            return usage(argv[0]);
+        }
+
+        TraceStore store;
+        if (!openStore(store, path)) {
+            return 1;
+        }
+
+        TraceRange range = store.findRange(from, to);
+        printf("timestamp_us,echo_us,red_us,green_us,blue_us,label,status\n");
+        for (size_t i = range.begin; i < range.end; i++) {
+            TraceRow row = store.row(i);
+            printf("%llu,%u,%u,%u,%u,%u,%u\n", static_cast<unsigned long long>(row.timestamp),
+                   row.echo, row.red, row.green, row.blue, row.label, row.status);
+        }
+        return 0;
+    }
+
+    int runScan(const char* path) {
+        TraceStore store;
+        if (!openStore(store, path)) {
+            return 1;
+        }
+
+        // One pass over every column; the sums keep the reads from being optimised away
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        size_t rows = store.rowCount();
+        uint64_t timeSum = 0, widthSum = 0, flagSum = 0;
+        const uint64_t* timestamps = store.timestamps();
+        const uint16_t* echo = store.echo();
+        const uint16_t* red = store.red();
+        const uint16_t* green = store.green();
+        const uint16_t* blue = store.blue();
+        const uint8_t* labels = store.labels();
+        const uint8_t* status = store.status();
+        for (size_t i = 0; i < rows; i++) {
+            timeSum += timestamps[i];
+        }
+        for (size_t i = 0; i < rows; i++) {
+            widthSum += echo[i] + red[i] + green[i] + blue[i];
+        }
+        for (size_t i = 0; i < rows; i++) {
+            flagSum += labels[i] + status[i];
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double bytes = static_cast<double>(rows) * sizeof(TraceRow::timestamp)
+            + rows * 4.0 * sizeof(uint16_t) + rows * 2.0;
+        printf("rows:        %zu\n", rows);
+        printf("scanned:     %.1f MB in %.3f s (%.2f GB/s)\n", bytes / 1e6, seconds,
+               seconds > 0.0 ? bytes / seconds / 1e9 : 0.0);
+        printf("checksum:    %llu\n", static_cast<unsigned long long>(timeSum ^ widthSum ^ flagSum));
+        return 0;
+    }
+
+    int runSynth(const char* rowsText, const char* path) {
+        uint64_t rows = strtoull(rowsText, nullptr, 10);
+        TraceStoreWriter writer;
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> jitter(-40, 40);
+
+        // A 100 ms echo cadence with a color sample every 200 ms, like ColorDistanceSystem
+        uint64_t timestamp = 0;
+        for (uint64_t i = 0; i < rows; i++) {
+            TraceRow row = {};
+            row.timestamp = timestamp;
+            if (i % 3 == 2) {
+                row.red = 60 + jitter(rng);
+                row.green = 150 + jitter(rng);
+                row.blue = 120 + jitter(rng);
+                row.status = TraceStore::ROW_COLOR;
+            } else {
+                row.echo = 1200 + jitter(rng);
+                row.status = TraceStore::ROW_ECHO;
+            }
+            writer.append(row);
+            timestamp += 66667;
+        }
+
+        if (!writer.write(path)) {
+            fprintf(stderr, "cannot write %s\n", path);
+            return 1;
+        }
+        return 0;
+    }
+
+    // Ground truth of the simulated scene while a trace is recorded
+    struct SimulationRecorder {
+        const SimScene* scene;
+        TraceStoreWriter* writer;
+        uint16_t color[3];
+        uint8_t haveColor;
+    };
+
+    thread_local SimulationRecorder* activeRecorder = nullptr;
+
+    uint8_t trueColor(const SceneState& state) {
+        // The TCS230 only sees an object within the proximity zone
+        if (state.distanceCm <= SimScene::NO_OBJECT || state.distanceCm > SystemSettings::PROXIMITY_THRESHOLD) {
+            return static_cast<uint8_t>(ColorIdentifier::NONE);
+        }
+        const float margin = 0.2f;
+        if (state.red > state.green + margin && state.red > state.blue + margin) {
+            return static_cast<uint8_t>(ColorIdentifier::RED);
+        } else if (state.green > state.red + margin && state.green > state.blue + margin) {
+            return static_cast<uint8_t>(ColorIdentifier::GREEN);
+        } else if (state.blue > state.red + margin && state.blue > state.green + margin) {
+            return static_cast<uint8_t>(ColorIdentifier::BLUE);
+        }
+        return static_cast<uint8_t>(ColorIdentifier::NONE);
+    }
+
+    void recordSimulatedSample(TraceChannel channel, unsigned long timestamp, unsigned long value) {
+        SimulationRecorder& recorder = *activeRecorder;
+        SceneState state = recorder.scene->at(static_cast<uint64_t>(timestamp) * 1000);
+        uint16_t width = value > 0xFFFF ? 0xFFFF : value;
+
+        TraceRow row = {};
+        row.timestamp = timestamp;
+        if (channel == TraceChannel::ECHO) {
+            // Echo label: 1 if an object really is inside the proximity zone
+            row.echo = width;
+            row.status = TraceStore::ROW_ECHO | TraceStore::ROW_LABELLED;
+            row.label = state.distanceCm > SimScene::NO_OBJECT
+                && state.distanceCm <= SystemSettings::PROXIMITY_THRESHOLD;
+            recorder.writer->append(row);
+            return;
+        }
+
+        uint8_t index = static_cast<uint8_t>(channel) - static_cast<uint8_t>(TraceChannel::COLOR_RED);
+        recorder.color[index] = width;
+        recorder.haveColor |= 1 << index;
+        if (channel != TraceChannel::COLOR_BLUE || recorder.haveColor != 0x07) {
+            return;
+        }
+
+        row.red = recorder.color[0];
+        row.green = recorder.color[1];
+        row.blue = recorder.color[2];
+        row.label = trueColor(state);
+        row.status = TraceStore::ROW_COLOR | TraceStore::ROW_LABELLED;
+        recorder.writer->append(row);
+        recorder.haveColor = 0;
+    }
+
+    int runSimulate(int argc, char** argv) {
+        float noise = 0.02f;
+        uint32_t seed = 1;
+        int i = 2;
+        for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+            if (strcmp(argv[i], "--noise") == 0) {
+                noise = atof(argv[i + 1]);
+            } else if (strcmp(argv[i], "--seed") == 0) {
+                seed = strtoul(argv[i + 1], nullptr, 10);
+            } else {
+                return usage(argv[0]);
+            }
+        }
+        if (i + 2 != argc) {
+            return usage(argv[0]);
+        }
+        unsigned long seconds = strtoul(argv[i], nullptr, 10);
+        const char* path = argv[i + 1];
+
+        SimScene scene = SimScene::demo();
+        VirtualDevice device;
+        VirtualDevice::Scope scope(device);
+        device.setSerialCapture(false);
+        HcSr04Model echoModel(scene);
+        Tcs230Model colorModel(scene);
+        echoModel.setNoise(noise * 100.0f, seed);
+        colorModel.setNoise(noise, seed + 1);
+        echoModel.attach(device);
+        colorModel.attach(device);
+
+        TraceStoreWriter writer;
+        SimulationRecorder recorder = { &scene, &writer, { 0, 0, 0 }, 0 };
+        activeRecorder = &recorder;
+        SensorTrace::setSink(recordSimulatedSample);
+
+        DistanceSensor distanceSensor;
+        ColorSensor colorSensor;
+        distanceSensor.begin();
+        colorSensor.begin();
+
+        // ColorDistanceSystem's cadence: a ping every 100 ms, a color channel every 200 ms
+        uint8_t channel = 0;
+        for (unsigned long step = 0; step < seconds * 10; step++) {
+            unsigned long start = millis();
+            distanceSensor.getDistance();
+            if (step % 2 == 0) {
+                colorSensor.readChannel(channel);
+                channel = (channel + 1) % 3;
+            }
+            SensorTrace::flush();
+            while (millis() - start < 100) {
+                delay(1);
+            }
+        }
+
+        SensorTrace::setSink(nullptr);
+        activeRecorder = nullptr;
+
+        if (!writer.write(path)) {
+            fprintf(stderr, "cannot write %s\n", path);
+            return 1;
+        }
+        fprintf(stderr, "%s: %zu rows written\n", path, writer.rowCount());
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        return usage(argv[0]);
+    }
+
+    const char* command = argv[1];
+    if (strcmp(command, "import") == 0) {
+        return runImport(argc, argv);
+    } else if (strcmp(command, "info") == 0) {
+        return runInfo(argv[2]);
+    } else if (strcmp(command, "dump") == 0) {
+        return runDump(argc, argv);
+    } else if (strcmp(command, "scan") == 0) {
+        return runScan(argv[2]);
+    } else if (strcmp(command, "synth") == 0 && argc > 3) {
+        return runSynth(argv[2], argv[3]);
+    } else if (strcmp(command, "simulate") == 0) {
+        return runSimulate(argc, argv);
+    }
+    return usage(argv[0]);
+}
@@ -0,0 +1,84 @@
+/**
+ * @file TraceImport.cpp
+ * @brief Serial capture to trace store conversion implementation
+ * @author catalina
+ */
+
+#include "TraceImport.h"
+
+#include "../../src/SensorTrace/SensorTrace.h"
+
+namespace {
+    // Echo pulses longer than this are the sensor's no-echo timeout (beyond 4 m)
+    const uint16_t NO_ECHO_WIDTH = 30000;
+}
+
+size_t importCapture(TraceStoreWriter& writer, const TelemetryCapture& capture, const TraceImportOptions& options) {
+    const std::vector<TelemetrySample>& samples = capture.samples();
+    if (samples.empty()) {
+        return 0;
+    }
+
+    // Shift so the first sample lands on startUs, or just after what the writer holds
+    uint64_t first = samples.front().timestamp;
+    uint64_t base = options.startUs;
+    if (base == 0 && writer.rowCount() > 0 && writer.lastTimestamp() >= first) {
+        base = writer.lastTimestamp() + 1;
+    }
+    int64_t shift = base > 0 ? static_cast<int64_t>(base - first) : 0;
+
+    uint64_t wraps = 0;
+    uint32_t previous = samples.front().timestamp;
+    uint16_t color[3] = { 0, 0, 0 };
+    uint8_t haveColor = 0;
+    size_t appended = 0;
+
+    for (const TelemetrySample& sample : samples) {
+        if (sample.timestamp < previous) {
+            wraps++;
+        }
+        previous = sample.timestamp;
+
+        TraceRow row = {};
+        row.timestamp = (wraps << 32) + sample.timestamp + shift;
+
+        TraceChannel channel = static_cast<TraceChannel>(sample.channel);
+        if (channel == TraceChannel::ECHO) {
+            row.echo = sample.value;
+            row.status = TraceStore::ROW_ECHO;
+            if (sample.value == 0 || sample.value > NO_ECHO_WIDTH) {
+                row.status |= TraceStore::ROW_NO_ECHO;
+            }
+        } else if (channel == TraceChannel::COLOR_RED || channel == TraceChannel::COLOR_GREEN
+                   || channel == TraceChannel::COLOR_BLUE) {
+            uint8_t index = sample.channel - static_cast<uint8_t>(TraceChannel::COLOR_RED);
+            color[index] = sample.value;
+            haveColor |= 1 << index;
+            if (channel != TraceChannel::COLOR_BLUE) {
+                continue;
+            }
+            if (haveColor != 0x07) {
+                // Blue without a full set before it: the recording started mid-sample
+                haveColor = 0;
+                continue;
+            }
+
+            row.red = color[0];
+            row.green = color[1];
+            row.blue = color[2];
+            row.status = TraceStore::ROW_COLOR;
+            if (options.labelled) {
+                row.label = options.label;
+                row.status |= TraceStore::ROW_LABELLED;
+            }
+            haveColor = 0;
+        } else {
+            continue;
+        }
+
+        if (writer.append(row)) {
+            appended++;
+        }
+    }
+    return appended;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file TraceImport.h
+ * @brief Conversion of serial captures into trace store rows
+ * @author catalina
+ */
+
+#ifndef TRACE_IMPORT_H
+#define TRACE_IMPORT_H
+
+#include "TraceStore.h"
+#include "../sim/TelemetryCapture.h"
+
+/**
+ * @brief Options for importing a capture
+ */
+struct TraceImportOptions {
+    bool labelled = false;      // Mark color rows with a ground-truth label
+    uint8_t label = 0;          // ColorIdentifier of the object in front of the sensor
+    uint64_t startUs = 0;       // Timestamp of the first row (0 = keep recorded time)
+};
+
+/**
+ * @brief Append the raw samples of a capture as trace rows
+ *
+ * The device's 32-bit µs timestamps are unwrapped into 64 bits. Every echo
+ * sample becomes an echo row; every complete red, green, blue sequence
+ * becomes one color row stamped with the time of its last channel.
+ *
+ * @param writer Destination
+ * @param capture Parsed capture
+ * @param options Import options
+ * @return Number of rows appended
+ */
+size_t importCapture(TraceStoreWriter& writer, const TelemetryCapture& capture, const TraceImportOptions& options);
+
+#endif // TRACE_IMPORT_H
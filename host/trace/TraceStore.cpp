@@ -0,0 +1,268 @@
+/**
+ * @file TraceStore.cpp
+ * @brief Memory-mapped columnar trace store implementation
+ * @author catalina
+ */
+
+#include "TraceStore.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char MAGIC[8] = { 'D', 'D', 'T', 'R', 'A', 'C', 'E', '1' };
+    const uint64_t COLUMN_ALIGNMENT = 64;
+
+    const size_t COLUMN_WIDTHS[COLUMN_COUNT] = {
+        sizeof(uint64_t),   // timestamp
+        sizeof(uint16_t),   // echo
+        sizeof(uint16_t),   // red
+        sizeof(uint16_t),   // green
+        sizeof(uint16_t),   // blue
+        sizeof(uint8_t),    // label
+        sizeof(uint8_t)     // status
+    };
+
+    uint64_t alignUp(uint64_t offset) {
+        return (offset + COLUMN_ALIGNMENT - 1) & ~(COLUMN_ALIGNMENT - 1);
+    }
+
+    bool writeAt(FILE* out, uint64_t offset, const void* data, size_t size) {
+        // Zero padding up to the offset keeps the file free of garbage
+        long position = ftell(out);
+        while (position >= 0 && static_cast<uint64_t>(position) < offset) {
+            if (fputc(0, out) == EOF) {
+                return false;
+            }
+            position++;
+        }
+        return size == 0 || fwrite(data, 1, size, out) == size;
+    }
+}
+
+TraceStoreWriter::TraceStoreWriter(uint32_t blockRows)
+    : _blockRows(blockRows > 0 ? blockRows : DEFAULT_BLOCK_ROWS) {
+}
+
+bool TraceStoreWriter::append(const TraceRow& row) {
+    if (!_timestamps.empty() && row.timestamp < _timestamps.back()) {
+        return false;
+    }
+
+    _timestamps.push_back(row.timestamp);
+    _echo.push_back(row.echo);
+    _red.push_back(row.red);
+    _green.push_back(row.green);
+    _blue.push_back(row.blue);
+    _labels.push_back(row.label);
+    _status.push_back(row.status);
+    return true;
+}
+
+bool TraceStoreWriter::write(const char* path) const {
+    uint64_t rows = _timestamps.size();
+
+    TraceStoreHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = TraceStore::VERSION;
+    header.blockRows = _blockRows;
+    header.rowCount = rows;
+    header.blockCount = (rows + _blockRows - 1) / _blockRows;
+    header.indexOffset = alignUp(sizeof(header));
+
+    uint64_t offset = alignUp(header.indexOffset + header.blockCount * sizeof(TraceBlock));
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        header.columnOffsets[column] = offset;
+        offset = alignUp(offset + rows * COLUMN_WIDTHS[column]);
+    }
+
+    std::vector<TraceBlock> blocks(header.blockCount);
+    for (uint64_t b = 0; b < header.blockCount; b++) {
+        uint64_t first = b * _blockRows;
+        uint64_t last = std::min(first + _blockRows, rows) - 1;
+        blocks[b].firstTimestamp = _timestamps[first];
+        blocks[b].lastTimestamp = _timestamps[last];
+    }
+
+    FILE* out = fopen(path, "wb");
+    if (out == nullptr) {
+        return false;
+    }
+
+    const void* columns[COLUMN_COUNT] = {
+        _timestamps.data(), _echo.data(), _red.data(), _green.data(),
+        _blue.data(), _labels.data(), _status.data()
+    };
+
+    bool ok = writeAt(out, 0, &header, sizeof(header))
+        && writeAt(out, header.indexOffset, blocks.data(), blocks.size() * sizeof(TraceBlock));
+    for (int column = 0; ok && column < COLUMN_COUNT; column++) {
+        ok = writeAt(out, header.columnOffsets[column], columns[column], rows * COLUMN_WIDTHS[column]);
+    }
+    ok = ok && writeAt(out, offset, nullptr, 0);
+
+    return fclose(out) == 0 && ok;
+}
+
+TraceStore::TraceStore()
+    : _fd(-1),
+      _mapping(nullptr),
+      _size(0),
+      _header(nullptr),
+      _blocks(nullptr),
+      _timestamps(nullptr),
+      _echo(nullptr),
+      _red(nullptr),
+      _green(nullptr),
+      _blue(nullptr),
+      _labels(nullptr),
+      _status(nullptr) {
+}
+
+TraceStore::~TraceStore() {
+    close();
+}
+
+bool TraceStore::open(const char* path) {
+    close();
+
+    _fd = ::open(path, O_RDONLY);
+    if (_fd < 0) {
+        _error = std::string("cannot open ") + path;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(_fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(TraceStoreHeader)) {
+        _error = "file too small for a trace header";
+        close();
+        return false;
+    }
+    _size = info.st_size;
+
+    _mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (_mapping == MAP_FAILED) {
+        _mapping = nullptr;
+        _error = "mmap failed";
+        close();
+        return false;
+    }
+    madvise(_mapping, _size, MADV_SEQUENTIAL);
+
+    const TraceStoreHeader* header = static_cast<const TraceStoreHeader*>(_mapping);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+        || header->blockRows == 0) {
+        _error = "not a trace store file";
+        close();
+        return false;
+    }
+
+    // Every column and the index must lie inside the file
+    uint64_t rows = header->rowCount;
+    bool fits = header->blockCount == (rows + header->blockRows - 1) / header->blockRows
+        && header->indexOffset + header->blockCount * sizeof(TraceBlock) <= _size;
+    for (int column = 0; fits && column < COLUMN_COUNT; column++) {
+        fits = header->columnOffsets[column] % COLUMN_ALIGNMENT == 0
+            && header->columnOffsets[column] + rows * COLUMN_WIDTHS[column] <= _size;
+    }
+    if (!fits) {
+        _error = "truncated or corrupt trace store file";
+        close();
+        return false;
+    }
+
+    const uint8_t* base = static_cast<const uint8_t*>(_mapping);
+    _header = header;
+    _blocks = reinterpret_cast<const TraceBlock*>(base + header->indexOffset);
+    _timestamps = reinterpret_cast<const uint64_t*>(base + header->columnOffsets[COLUMN_TIMESTAMP]);
+    _echo = reinterpret_cast<const uint16_t*>(base + header->columnOffsets[COLUMN_ECHO]);
+    _red = reinterpret_cast<const uint16_t*>(base + header->columnOffsets[COLUMN_RED]);
+    _green = reinterpret_cast<const uint16_t*>(base + header->columnOffsets[COLUMN_GREEN]);
+    _blue = reinterpret_cast<const uint16_t*>(base + header->columnOffsets[COLUMN_BLUE]);
+    _labels = base + header->columnOffsets[COLUMN_LABEL];
+    _status = base + header->columnOffsets[COLUMN_STATUS];
+    return true;
+}
+
+void TraceStore::close() {
+    if (_mapping != nullptr) {
+        munmap(_mapping, _size);
+        _mapping = nullptr;
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+    _size = 0;
+    _header = nullptr;
+    _blocks = nullptr;
+    _timestamps = nullptr;
+    _echo = nullptr;
+    _red = nullptr;
+    _green = nullptr;
+    _blue = nullptr;
+    _labels = nullptr;
+    _status = nullptr;
+}
+
+TraceRow TraceStore::row(size_t index) const {
+    TraceRow row;
+    row.timestamp = _timestamps[index];
+    row.echo = _echo[index];
+    row.red = _red[index];
+    row.green = _green[index];
+    row.blue = _blue[index];
+    row.label = _labels[index];
+    row.status = _status[index];
+    return row;
+}
+
+TraceRange TraceStore::all() const {
+    TraceRange range;
+    range.begin = 0;
+    range.end = rowCount();
+    return range;
+}
+
+TraceRange TraceStore::findRange(uint64_t fromUs, uint64_t toUs) const {
+    TraceRange range;
+    range.begin = lowerBound(fromUs);
+    range.end = std::max(range.begin, lowerBound(toUs));
+    return range;
+}
+
+bool TraceStore::isTraceStore(const char* path) {
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    bool match = fread(magic, 1, sizeof(magic), in) == sizeof(magic)
+        && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+    fclose(in);
+    return match;
+}
+
+size_t TraceStore::lowerBound(uint64_t timestamp) const {
+    size_t blocks = blockCount();
+    if (blocks == 0) {
+        return 0;
+    }
+
+    // First block that ends at or after the timestamp
+    const TraceBlock* block = std::lower_bound(_blocks, _blocks + blocks, timestamp,
+        [](const TraceBlock& entry, uint64_t value) { return entry.lastTimestamp < value; });
+    if (block == _blocks + blocks) {
+        return rowCount();
+    }
+
+    size_t first = static_cast<size_t>(block - _blocks) * _header->blockRows;
+    size_t last = std::min(first + _header->blockRows, rowCount());
+    return std::lower_bound(_timestamps + first, _timestamps + last, timestamp) - _timestamps;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file TraceStore.h
+ * @brief Memory-mapped columnar store for recorded sensor traces
+ * @author catalina
+ */
+
+#ifndef TRACE_STORE_H
+#define TRACE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One row of a trace: an echo measurement or a complete color sample
+ *
+ * Echo rows leave the pulse width columns at zero and color rows leave the
+ * echo column at zero; the status flags say which kind a row is.
+ */
+struct TraceRow {
+    uint64_t timestamp;     // µs, unwrapped and non-decreasing
+    uint16_t echo;          // Echo pulse width in µs
+    uint16_t red;           // TCS230 pulse widths in µs
+    uint16_t green;
+    uint16_t blue;
+    uint8_t label;          // ColorIdentifier (ground truth when ROW_LABELLED)
+    uint8_t status;         // ROW_* flags
+};
+
+/**
+ * @brief Column identifiers, in file order
+ */
+enum TraceColumn {
+    COLUMN_TIMESTAMP = 0,
+    COLUMN_ECHO,
+    COLUMN_RED,
+    COLUMN_GREEN,
+    COLUMN_BLUE,
+    COLUMN_LABEL,
+    COLUMN_STATUS,
+    COLUMN_COUNT
+};
+
+/**
+ * @brief File header (little-endian)
+ *
+ * The file is: header | block index | one array per column, each starting
+ * on a 64-byte boundary. Block b covers rows [b * blockRows, (b + 1) *
+ * blockRows) and its index entry holds the first and last timestamp of
+ * those rows, so a time range is found without touching the columns.
+ */
+struct TraceStoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockRows;
+    uint64_t rowCount;
+    uint64_t blockCount;
+    uint64_t indexOffset;
+    uint64_t columnOffsets[COLUMN_COUNT];
+};
+
+/**
+ * @brief Block index entry
+ */
+struct TraceBlock {
+    uint64_t firstTimestamp;
+    uint64_t lastTimestamp;
+};
+
+/**
+ * @brief Half-open row range [begin, end)
+ */
+struct TraceRange {
+    size_t begin;
+    size_t end;
+
+    size_t size() const { return end - begin; }
+    bool empty() const { return end <= begin; }
+};
+
+/**
+ * @class TraceStoreWriter
+ * @brief Collects rows and writes them as a columnar trace file
+ */
+class TraceStoreWriter {
+public:
+    explicit TraceStoreWriter(uint32_t blockRows = DEFAULT_BLOCK_ROWS);
+
+    /**
+     * @brief Append a row
+     * @return false if the row is older than the previous one
+     */
+    bool append(const TraceRow& row);
+
+    /**
+     * @brief Write all rows to a file
+     * @return false if the file could not be written
+     */
+    bool write(const char* path) const;
+
+    size_t rowCount() const { return _timestamps.size(); }
+    uint64_t lastTimestamp() const { return _timestamps.empty() ? 0 : _timestamps.back(); }
+
+    static const uint32_t DEFAULT_BLOCK_ROWS = 4096;
+
+private:
+    uint32_t _blockRows;
+    std::vector<uint64_t> _timestamps;
+    std::vector<uint16_t> _echo;
+    std::vector<uint16_t> _red;
+    std::vector<uint16_t> _green;
+    std::vector<uint16_t> _blue;
+    std::vector<uint8_t> _labels;
+    std::vector<uint8_t> _status;
+};
+
+/**
+ * @class TraceStore
+ * @brief Read-only, zero-copy view of a trace file
+ *
+ * The file is mapped into memory; the column accessors point straight
+ * into the mapping, so scanning a column runs at memory (or page cache)
+ * bandwidth and nothing is copied or parsed per row.
+ */
+class TraceStore {
+public:
+    TraceStore();
+    ~TraceStore();
+
+    TraceStore(const TraceStore&) = delete;
+    TraceStore& operator=(const TraceStore&) = delete;
+
+    /**
+     * @brief Map a trace file
+     * @param path File to open
+     * @return false if the file is missing, truncated or not a trace file
+     */
+    bool open(const char* path);
+
+    /**
+     * @brief Unmap the file
+     */
+    void close();
+
+    /**
+     * @brief Get the reason the last open() failed
+     */
+    const std::string& error() const { return _error; }
+
+    size_t rowCount() const { return _header != nullptr ? _header->rowCount : 0; }
+    size_t blockCount() const { return _header != nullptr ? _header->blockCount : 0; }
+    uint32_t blockRows() const { return _header != nullptr ? _header->blockRows : 0; }
+    size_t fileSize() const { return _size; }
+
+    // Column arrays, rowCount() entries each
+    const uint64_t* timestamps() const { return _timestamps; }
+    const uint16_t* echo() const { return _echo; }
+    const uint16_t* red() const { return _red; }
+    const uint16_t* green() const { return _green; }
+    const uint16_t* blue() const { return _blue; }
+    const uint8_t* labels() const { return _labels; }
+    const uint8_t* status() const { return _status; }
+    const TraceBlock* blocks() const { return _blocks; }
+
+    /**
+     * @brief Assemble one row (copies; use the columns for bulk scans)
+     */
+    TraceRow row(size_t index) const;
+
+    /**
+     * @brief Get all rows
+     */
+    TraceRange all() const;
+
+    /**
+     * @brief Find the rows with fromUs <= timestamp < toUs
+     *
+     * Whole blocks outside the range are skipped through the block index;
+     * only the two boundary blocks are searched.
+     */
+    TraceRange findRange(uint64_t fromUs, uint64_t toUs) const;
+
+    /**
+     * @brief Check whether a file starts with the trace store magic
+     */
+    static bool isTraceStore(const char* path);
+
+    // Row kinds and flags
+    static const uint8_t ROW_ECHO = 0x01;
+    static const uint8_t ROW_COLOR = 0x02;
+    static const uint8_t ROW_LABELLED = 0x04;
+    static const uint8_t ROW_NO_ECHO = 0x08;
+
+    static const uint32_t VERSION = 1;
+
+private:
+    int _fd;
+    void* _mapping;
+    size_t _size;
+    std::string _error;
+
+    const TraceStoreHeader* _header;
+    const TraceBlock* _blocks;
+    const uint64_t* _timestamps;
+    const uint16_t* _echo;
+    const uint16_t* _red;
+    const uint16_t* _green;
+    const uint16_t* _blue;
+    const uint8_t* _labels;
+    const uint8_t* _status;
+
+    size_t lowerBound(uint64_t timestamp) const;
+};
+
+#endif // TRACE_STORE_H
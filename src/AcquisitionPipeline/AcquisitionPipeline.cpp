@@ -0,0 +1,138 @@
+/**
+ * @file AcquisitionPipeline.cpp
+ * @brief Overlapped distance and color acquisition implementation
+ * @author catalina
+ */
+
+#include "AcquisitionPipeline.h"
+
+AcquisitionPipeline::AcquisitionPipeline(DistanceSensor& distanceSensor, ColorSensor& colorSensor)
+    : _distanceSensor(distanceSensor),
+      _colorSensor(colorSensor),
+      _sample(),
+      _lastDistance(0.0),
+      _channelInterval(SystemSettings::SENSOR_STABILIZATION_DELAY * 1000UL),
+      _colorRange(SystemSettings::PROXIMITY_THRESHOLD),
+      _nextCapture(0),
+      _nextPing(0),
+      _channel(0),
+      _windowStart(0),
+      _distanceSum(0.0),
+      _offsetSum(0),
+      _echoes(0) {
+}
+
+void AcquisitionPipeline::reset(unsigned long startDelay) {
+    stop();
+    _channel = 0;
+    _nextPing = micros();
+    _nextCapture = _nextPing + startDelay * 1000UL;
+}
+
+void AcquisitionPipeline::stop() {
+    if (_distanceSensor.isPingActive()) {
+        _distanceSensor.finishPing();
+    }
+}
+
+uint8_t AcquisitionPipeline::update() {
+    uint8_t events = 0;
+    
+    if (_distanceSensor.isPingComplete()) {
+        collectPing();
+        events |= PING_READY;
+    }
+    
+    // The sample completes once the echo of the last channel's ping is in
+    if (_channel == 3) {
+        if (!_distanceSensor.isPingActive()) {
+            completeSample();
+            events |= SAMPLE_READY;
+        }
+        return events;
+    }
+    
+    // Nothing to read a color from: start over once an object is back
+    bool objectInRange = _lastDistance > 0 && _lastDistance <= _colorRange;
+    if (!objectInRange) {
+        _channel = 0;
+    }
+    
+    unsigned long now = micros();
+    if (objectInRange && static_cast<long>(now - _nextCapture) >= 0) {
+        if (_channel == 0) {
+            _windowStart = now;
+            _distanceSum = 0.0;
+            _offsetSum = 0;
+            _echoes = 0;
+        }
+        
+        // Send the ping first so its echo is in flight during the capture
+        sendPing(now);
+        captureChannel();
+    } else {
+        // Ping while the color filter settles
+        sendPing(now);
+    }
+    
+    return events;
+}
+
+const FusedSample& AcquisitionPipeline::getSample() const {
+    return _sample;
+}
+
+float AcquisitionPipeline::getLastDistance() const {
+    return _lastDistance;
+}
+
+void AcquisitionPipeline::setChannelInterval(unsigned long interval) {
+    _channelInterval = interval * 1000UL;
+}
+
+void AcquisitionPipeline::setColorRange(float distance) {
+    _colorRange = distance;
+}
+
+void AcquisitionPipeline::sendPing(unsigned long now) {
+    if (_distanceSensor.isPingActive() || static_cast<long>(now - _nextPing) < 0) {
+        return;
+    }
+    
+    _distanceSensor.startPing();
+    _nextPing = _distanceSensor.getPingTime() + PING_INTERVAL;
+}
+
+void AcquisitionPipeline::collectPing() {
+    _lastDistance = _distanceSensor.finishPing();
+    
+    // Only pings sent since the red capture describe the current sample
+    unsigned long offset = _distanceSensor.getPingTime() - _windowStart;
+    if (_channel > 0 && static_cast<long>(offset) >= 0 && _lastDistance > 0) {
+        _distanceSum += _lastDistance;
+        _offsetSum += offset;
+        _echoes++;
+    }
+}
+
+void AcquisitionPipeline::captureChannel() {
+    _sample.colorTime[_channel] = micros();
+    _sample.raw[_channel] = _colorSensor.readChannel(_channel);
+    _nextCapture = _sample.colorTime[_channel] + _channelInterval;
+    _channel++;
+}
+
+void AcquisitionPipeline::completeSample() {
+    _colorSensor.convertToRGB(_sample.raw[0], _sample.raw[1], _sample.raw[2],
+                              _sample.red, _sample.green, _sample.blue);
+    _sample.colorId = _colorSensor.classifyColor(_sample.red, _sample.green, _sample.blue);
+    
+    _sample.echoes = _echoes;
+    _sample.distance = _echoes > 0 ? _distanceSum / _echoes : 0.0;
+    _sample.distanceTime = _echoes > 0 ? _windowStart + _offsetSum / _echoes : 0;
+    _sample.timestamp = micros();
+    
+    // Like back-to-back readRawValues() calls, red follows blue right away
+    _channel = 0;
+    _nextCapture = _sample.timestamp;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file AcquisitionPipeline.h
+ * @brief Overlapped distance and color acquisition
+ * @author catalina
+ */
+
+#ifndef ACQUISITION_PIPELINE_H
+#define ACQUISITION_PIPELINE_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+#include "../ColorSensor/ColorSensor.h"
+#include "../DistanceSensor/DistanceSensor.h"
+
+/**
+ * @brief One time-aligned reading of both sensors
+ * 
+ * The distance is the mean of the echoes whose pings were sent while the
+ * three color channels were captured, so both halves describe the same
+ * stretch of time. All times are micros() values.
+ */
+struct FusedSample {
+    unsigned long timestamp;        // Completion of the sample
+    float distance;                 // cm, mean over the window (0 = no echo)
+    unsigned long distanceTime;     // Mean trigger time of the averaged pings
+    uint8_t echoes;                 // Number of echoes averaged
+    int raw[3];                     // Raw pulse widths (red, green, blue)
+    int red;                        // Calibrated RGB (0-255)
+    int green;
+    int blue;
+    ColorIdentifier colorId;
+    unsigned long colorTime[3];     // Capture time of each channel
+};
+
+/**
+ * @class AcquisitionPipeline
+ * @brief Runs the ultrasonic and color sensors side by side
+ * 
+ * Both sensors spend nearly all their time waiting: the HC-SR04 on the
+ * echo, the TCS230 on its filter settling between channels. update() is a
+ * short non-blocking step. Pings are timed by the echo interrupt (see
+ * DistanceSensor::startPing()), so a channel capture runs while an echo is
+ * in flight, and pings go out every PING_INTERVAL while the color filter
+ * settles. One fused sample completes per color triple, so the combined
+ * rate is that of the color sensor alone, with several pings per sample.
+ * 
+ * Channels are only captured while the latest echo puts an object within
+ * the color range; without one the TCS230 output is meaningless and a
+ * capture can block for the full pulseIn() timeout. The sample restarts
+ * with red once an object comes back.
+ * 
+ * An echo edge that arrives during a channel capture delays the capture
+ * loop by the few µs the interrupt takes, which is well below the pulse
+ * width resolution the color classification needs.
+ */
+class AcquisitionPipeline {
+public:
+    /**
+     * @brief Constructor
+     * 
+     * @param distanceSensor Initialised distance sensor (echo on an interrupt pin)
+     * @param colorSensor Initialised and calibrated color sensor
+     */
+    AcquisitionPipeline(DistanceSensor& distanceSensor, ColorSensor& colorSensor);
+    
+    /**
+     * @brief Start a new sample with the red channel
+     * 
+     * Pings start right away; the first channel capture after a delay.
+     * 
+     * @param startDelay Time in ms before the first channel capture
+     */
+    void reset(unsigned long startDelay = 0);
+    
+    /**
+     * @brief Abandon any ping in flight and release the echo interrupt
+     * 
+     * Call before using the distance sensor's blocking methods again. An
+     * abandoned echo keeps the HC-SR04 busy for up to PING_TIMEOUT, during
+     * which it ignores new triggers.
+     */
+    void stop();
+    
+    /**
+     * @brief Run one non-blocking pipeline step
+     * 
+     * @return PING_READY and/or SAMPLE_READY flags for what completed
+     */
+    uint8_t update();
+    
+    /**
+     * @brief Get the latest completed fused sample
+     */
+    const FusedSample& getSample() const;
+    
+    /**
+     * @brief Get the distance of the latest ping
+     * @return Distance in cm (0 = no echo)
+     */
+    float getLastDistance() const;
+    
+    /**
+     * @brief Set the time between channel captures
+     * @param interval Filter settling time in ms
+     */
+    void setChannelInterval(unsigned long interval);
+    
+    /**
+     * @brief Set the distance within which colors are captured
+     * @param distance Range in cm
+     */
+    void setColorRange(float distance);
+    
+    // update() events
+    static const uint8_t PING_READY = 0x01;
+    static const uint8_t SAMPLE_READY = 0x02;
+    
+    // Minimum time between pings, so an echo never overlaps the next ping
+    static const unsigned long PING_INTERVAL = 60000; // µs
+    
+private:
+    DistanceSensor& _distanceSensor;
+    ColorSensor& _colorSensor;
+    
+    FusedSample _sample;
+    float _lastDistance;
+    
+    // Schedule in micros()
+    unsigned long _channelInterval;
+    float _colorRange;
+    unsigned long _nextCapture;
+    unsigned long _nextPing;
+    
+    // Sample under construction
+    uint8_t _channel;           // Next channel; 3 = waiting for the last echo
+    unsigned long _windowStart;
+    float _distanceSum;
+    unsigned long _offsetSum;
+    uint8_t _echoes;
+    
+    // Helper methods
+    void sendPing(unsigned long now);
+    void collectPing();
+    void captureChannel();
+    void completeSample();
+};
+
+#endif // ACQUISITION_PIPELINE_H
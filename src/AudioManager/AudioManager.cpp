@@ -5,6 +5,7 @@
  */
 
 #include "AudioManager.h"
+#include "../Configuration/SensorConfig.h"
 
 // Predefined melodies
 namespace {
@@ -27,9 +28,21 @@ namespace {
     const uint8_t alertDurations[] = { 8, 8, 16, 8, 4 };
 }
 
+AudioManager::AudioManager()
+    : AudioManager(PinConfig::BUZZER) {
+}
+
 AudioManager::AudioManager(uint8_t pin)
     : _pin(pin),
-      _isPlaying(false) {
+      _isPlaying(false),
+      _queuedCount(0),
+      _droppedCount(0),
+      _hasCurrent(false),
+      _noteIndex(0),
+      _noteLimit(0),
+      _inGap(false),
+      _phaseStart(0),
+      _phaseDuration(0) {
 }
 
 void AudioManager::begin() {
@@ -38,6 +51,8 @@ void AudioManager::begin() {
 }
 
 void AudioManager::playTone(uint16_t frequency, uint32_t duration) {
+    PROFILE_STAGE(AUDIO);
+    
     _isPlaying = true;
     
     if (frequency > 0) {
@@ -55,10 +70,13 @@ void AudioManager::playTone(uint16_t frequency, uint32_t duration) {
 
 void AudioManager::stopTone() {
     noTone(_pin);
+    _hasCurrent = false;
     _isPlaying = false;
 }
 
 void AudioManager::playMelody(const uint16_t* melody, const uint8_t* durations, uint8_t noteCount, float tempo) {
+    PROFILE_STAGE(AUDIO);
+    
     _isPlaying = true;
     
     for (int i = 0; i < noteCount; i++) {
@@ -97,6 +115,208 @@ bool AudioManager::isPlaying() {
     return _isPlaying;
 }
 
+bool AudioManager::queueMelody(const uint16_t* melody, const uint8_t* durations, uint8_t noteCount,
+                               uint8_t priority, uint16_t timeToLive, float tempo) {
+    if (melody == nullptr || durations == nullptr || noteCount == 0) {
+        return false;
+    }
+    
+    unsigned long now = millis();
+    
+    // Coalesce with the melody that is already playing
+    if (_hasCurrent && _current.melody == melody) {
+        if (priority > _current.priority) {
+            _current.priority = priority;
+        }
+        return true;
+    }
+    
+    // Coalesce with a pending request for the same melody
+    for (uint8_t i = 0; i < _queuedCount; i++) {
+        if (_queue[i].melody == melody) {
+            if (priority > _queue[i].priority) {
+                _queue[i].priority = priority;
+            }
+            _queue[i].queuedAt = now;
+            _queue[i].timeToLive = timeToLive;
+            return true;
+        }
+    }
+    
+    // Make room by evicting the lowest-priority request if the queue is full
+    if (_queuedCount >= QUEUE_CAPACITY) {
+        uint8_t lowest = 0;
+        for (uint8_t i = 1; i < _queuedCount; i++) {
+            if (_queue[i].priority < _queue[lowest].priority) {
+                lowest = i;
+            }
+        }
+        
+        if (_queue[lowest].priority >= priority) {
+            _droppedCount++;
+            return false; // Nothing less important to replace
+        }
+        
+        removeQueued(lowest);
+        _droppedCount++;
+    }
+    
+    SoundRequest& request = _queue[_queuedCount++];
+    request.melody = melody;
+    request.durations = durations;
+    request.noteCount = noteCount;
+    request.priority = priority;
+    request.tempo = tempo;
+    request.queuedAt = now;
+    request.timeToLive = timeToLive;
+    
+    return true;
+}
+
+bool AudioManager::queueSound(uint8_t effect, uint8_t priority, uint16_t timeToLive) {
+    switch (effect) {
+        case SOUND_SUCCESS:
+            return queueMelody(successMelody, successDurations,
+                               sizeof(successMelody) / sizeof(successMelody[0]), priority, timeToLive);
+        case SOUND_ERROR:
+            return queueMelody(errorMelody, errorDurations,
+                               sizeof(errorMelody) / sizeof(errorMelody[0]), priority, timeToLive);
+        case SOUND_ALERT:
+            return queueMelody(alertMelody, alertDurations,
+                               sizeof(alertMelody) / sizeof(alertMelody[0]), priority, timeToLive);
+        default:
+            return false; // Unknown effect
+    }
+}
+
+void AudioManager::update() {
+    PROFILE_STAGE(AUDIO);
+    
+    unsigned long now = millis();
+    
+    // Discard requests that waited too long
+    expireQueued(now);
+    
+    // Preempt the current melody if something more important is waiting
+    int8_t next = findHighestPriority();
+    if (_hasCurrent && next >= 0 && _queue[next].priority > _current.priority) {
+        noTone(_pin);
+        _hasCurrent = false;
+        _droppedCount++;
+    }
+    
+    // Start the next melody if idle
+    if (!_hasCurrent) {
+        if (next < 0) {
+            _isPlaying = false;
+            return;
+        }
+        
+        _current = _queue[next];
+        removeQueued(next);
+        startCurrent(now);
+        return;
+    }
+    
+    // Advance through the notes of the current melody
+    if (now - _phaseStart < _phaseDuration) {
+        return;
+    }
+    
+    if (!_inGap) {
+        // Note finished, brief pause before the next one
+        _inGap = true;
+        _phaseStart = now;
+        _phaseDuration = _phaseDuration * 0.3;
+        return;
+    }
+    
+    _noteIndex++;
+    bool limited = _noteLimit > 0 && _noteIndex >= _noteLimit;
+    if (_noteIndex < _current.noteCount && !limited) {
+        startNote(now);
+    } else {
+        _hasCurrent = false;
+        _isPlaying = _queuedCount > 0;
+    }
+}
+
+void AudioManager::clearQueue() {
+    if (_hasCurrent) {
+        noTone(_pin);
+    }
+    
+    _hasCurrent = false;
+    _queuedCount = 0;
+    _isPlaying = false;
+}
+
+uint8_t AudioManager::getQueuedCount() const {
+    return _queuedCount;
+}
+
+uint16_t AudioManager::getDroppedCount() const {
+    return _droppedCount;
+}
+
+void AudioManager::setNoteLimit(uint8_t limit) {
+    _noteLimit = limit;
+}
+
+void AudioManager::removeQueued(uint8_t index) {
+    // Keep queue order so equal priorities play first-in, first-out
+    for (uint8_t i = index; i + 1 < _queuedCount; i++) {
+        _queue[i] = _queue[i + 1];
+    }
+    _queuedCount--;
+}
+
+void AudioManager::expireQueued(unsigned long now) {
+    uint8_t i = 0;
+    while (i < _queuedCount) {
+        if (now - _queue[i].queuedAt > _queue[i].timeToLive) {
+            removeQueued(i);
+            _droppedCount++;
+        } else {
+            i++;
+        }
+    }
+}
+
+int8_t AudioManager::findHighestPriority() const {
+    int8_t best = -1;
+    for (uint8_t i = 0; i < _queuedCount; i++) {
+        if (best < 0 || _queue[i].priority > _queue[best].priority) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void AudioManager::startCurrent(unsigned long now) {
+    _hasCurrent = true;
+    _isPlaying = true;
+    _noteIndex = 0;
+    startNote(now);
+}
+
+void AudioManager::startNote(unsigned long now) {
+    // Calculate note duration
+    unsigned long noteDuration = 1000 / _current.durations[_noteIndex] / _current.tempo;
+    uint16_t frequency = _current.melody[_noteIndex];
+    
+    if (frequency == 0) {
+        // Rest - no tone
+        noTone(_pin);
+    } else {
+        tone(_pin, frequency, noteDuration);
+    }
+    
+    _inGap = false;
+    _phaseStart = now;
+    _phaseDuration = noteDuration;
+}
+
 void AudioManager::playNote(uint16_t frequency, uint32_t duration) {
     if (frequency == 0) {
         // Rest - no tone
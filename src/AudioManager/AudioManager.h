@@ -9,6 +9,7 @@
 
 #include <Arduino.h>
 #include "../Configuration/PitchesDefinitions.h"
+#include "../Profiler/Profiler.h"
 
 /**
  * @class AudioManager
@@ -16,15 +17,26 @@
  * 
  * This class provides methods to play tones, melodies and sound effects
  * on a speaker or buzzer connected to an Arduino pin.
+ * 
+ * Besides the blocking play methods, sounds can be queued with a priority
+ * and played back without blocking by calling update() from loop(). A
+ * higher-priority sound preempts the one currently playing, a sound that is
+ * already queued or playing is coalesced instead of being added twice, and
+ * queued sounds that wait longer than their time-to-live are discarded.
  */
 class AudioManager {
 public:
+    /**
+     * @brief Constructor for the buzzer on PinConfig::BUZZER
+     */
+    AudioManager();
+    
     /**
      * @brief Constructor
      * 
      * @param pin Output pin connected to the speaker/buzzer
      */
-    AudioManager(uint8_t pin = PinConfig::BUZZER);
+    explicit AudioManager(uint8_t pin);
     
     /**
      * @brief Initialize the audio system
@@ -83,12 +95,120 @@ public:
      */
     bool isPlaying();
     
+    /**
+     * @brief Queue a melody for non-blocking playback
+     * 
+     * If the same melody is already queued or playing, the request is merged
+     * with it (priority raised, time-to-live refreshed). A melody with a higher
+     * priority than the one currently playing preempts it on the next update().
+     * 
+     * @param melody Array of note frequencies
+     * @param durations Array of note durations (4 = quarter note, 8 = eighth note, etc.)
+     * @param noteCount Number of notes in the melody
+     * @param priority Priority level (PRIORITY_LOW to PRIORITY_CRITICAL)
+     * @param timeToLive Time in ms the melody may wait in the queue before it is discarded
+     * @param tempo Tempo multiplier (1.0 = normal speed)
+     * @return true if the melody was queued or merged, false if it was dropped
+     */
+    bool queueMelody(const uint16_t* melody, const uint8_t* durations, uint8_t noteCount,
+                     uint8_t priority = PRIORITY_NORMAL, uint16_t timeToLive = 2000, float tempo = 1.0);
+    
+    /**
+     * @brief Queue one of the predefined sound effects
+     * 
+     * @param effect Sound effect (SOUND_SUCCESS, SOUND_ERROR or SOUND_ALERT)
+     * @param priority Priority level (PRIORITY_LOW to PRIORITY_CRITICAL)
+     * @param timeToLive Time in ms the sound may wait in the queue before it is discarded
+     * @return true if the sound was queued or merged, false if it was dropped
+     */
+    bool queueSound(uint8_t effect, uint8_t priority, uint16_t timeToLive = 2000);
+    
+    /**
+     * @brief Advance non-blocking playback
+     * 
+     * Must be called frequently from loop(). Starts the next queued sound,
+     * handles preemption and expiry and moves through the notes of the
+     * current melody.
+     */
+    void update();
+    
+    /**
+     * @brief Stop queued playback and discard all pending sounds
+     */
+    void clearQueue();
+    
+    /**
+     * @brief Get the number of sounds waiting in the queue
+     * @return Number of pending sounds
+     */
+    uint8_t getQueuedCount() const;
+    
+    /**
+     * @brief Get the number of sounds discarded because they expired or were preempted
+     * @return Number of dropped sounds
+     */
+    uint16_t getDroppedCount() const;
+    
+    /**
+     * @brief Limit how many notes of each melody are played
+     * 
+     * Applies to queued playback, including the melody already playing.
+     * A limit of 1 turns every melody into a single beep.
+     * 
+     * @param limit Maximum notes per melody (0 = no limit)
+     */
+    void setNoteLimit(uint8_t limit);
+    
+    // Sound effects
+    static const uint8_t SOUND_SUCCESS = 0;
+    static const uint8_t SOUND_ERROR = 1;
+    static const uint8_t SOUND_ALERT = 2;
+    
+    // Priority levels
+    static const uint8_t PRIORITY_LOW = 0;
+    static const uint8_t PRIORITY_NORMAL = 1;
+    static const uint8_t PRIORITY_HIGH = 2;
+    static const uint8_t PRIORITY_CRITICAL = 3;
+    
+    // Maximum number of pending sounds
+    static const uint8_t QUEUE_CAPACITY = 4;
+    
 private:
+    // Queued sound request
+    struct SoundRequest {
+        const uint16_t* melody;
+        const uint8_t* durations;
+        uint8_t noteCount;
+        uint8_t priority;
+        float tempo;
+        unsigned long queuedAt;
+        uint16_t timeToLive;
+    };
+    
     uint8_t _pin;
     bool _isPlaying;
     
+    // Sound queue
+    SoundRequest _queue[QUEUE_CAPACITY];
+    uint8_t _queuedCount;
+    uint16_t _droppedCount;
+    
+    // Non-blocking playback state
+    SoundRequest _current;
+    bool _hasCurrent;
+    uint8_t _noteIndex;
+    uint8_t _noteLimit;     // 0 = whole melodies
+    bool _inGap;
+    unsigned long _phaseStart;
+    unsigned long _phaseDuration;
+    
     // Internal helper methods
     void playNote(uint16_t frequency, uint32_t duration);
+    void removeQueued(uint8_t index);
+    void expireQueued(unsigned long now);
+    int8_t findHighestPriority() const;
+    void startCurrent(unsigned long now);
+    void startNote(unsigned long now);
 };
 
 #endif // AUDIO_MANAGER_H
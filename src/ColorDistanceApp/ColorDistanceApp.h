@@ -0,0 +1,527 @@
+/**
+ * @file ColorDistanceApp.h
+ * @brief Logic of the color and distance system, independent of how its drivers are held
+ * @author catalina
+ */
+
+#ifndef COLOR_DISTANCE_APP_H
+#define COLOR_DISTANCE_APP_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+#include "../Configuration/PitchesDefinitions.h"
+#include "../ColorSensor/ColorSensor.h"
+#include "../DistanceSensor/DistanceSensor.h"
+#include "../DisplayManager/DisplayManager.h"
+#include "../AudioManager/AudioManager.h"
+#include "../LedManager/LedManager.h"
+#include "../AcquisitionPipeline/AcquisitionPipeline.h"
+#include "../ProximityMonitor/ProximityMonitor.h"
+#include "../OutputStage/OutputStage.h"
+#include "../Profiler/Profiler.h"
+#include "../Telemetry/Telemetry.h"
+#include "../SensorTrace/SensorTrace.h"
+#include "../PowerManager/PowerManager.h"
+#include "../LoadMonitor/LoadMonitor.h"
+
+/**
+ * @brief Tasks of the system, in the id order the sketches register them
+ */
+enum class ColorDistanceTask : uint8_t {
+    DISTANCE,
+    PIPELINE,
+    DISPLAY,
+    LED,
+    AUDIO,
+    COMMAND,
+    LOAD,
+    TASK_COUNT
+};
+
+/**
+ * @class ColorDistanceApp
+ * @brief Distance mode, color mode, standby, load shedding and telemetry
+ * 
+ * An object in range switches from distance mode (a ping every 100 ms) to
+ * color mode, where AcquisitionPipeline runs both sensors side by side
+ * until the object leaves. The display, LEDs and buzzer are driven through
+ * OutputStage, readings go out as Telemetry records, and PowerManager and
+ * LoadMonitor put the unit to sleep or shed work.
+ * 
+ * The sketch supplies the drivers and the task scheduler through Board, a
+ * type with these static members:
+ * 
+ *   ColorSensor& colorSensor(), DistanceSensor& distanceSensor(),
+ *   DisplayManager& display(), LedManager& leds(), AudioManager& audio()
+ *   void begin()                  Initialize the drivers
+ *   void start(OverrunCallback)   Release every task
+ *   bool run()                    Run the most urgent due task
+ *   unsigned long getLastLateness(), unsigned long getIdleTime()
+ *   void enableTask(ColorDistanceTask, unsigned long startDelay = 0)
+ *   void disableTask(ColorDistanceTask)
+ *   void setTaskPeriod(ColorDistanceTask, unsigned long period)
+ * 
+ * The task steps and periods are public so the board can register them.
+ * Everything is static, so the steps and callbacks are plain functions,
+ * and a board with inline members costs no calls.
+ * 
+ * @tparam Board Driver and scheduler access of the sketch
+ */
+template <typename Board>
+class ColorDistanceApp {
+public:
+    typedef void (*OverrunCallback)(uint8_t taskId, unsigned long lateness);
+    
+    // Task periods in ms
+    static const unsigned long DISTANCE_PERIOD = 100;
+    static const unsigned long PIPELINE_PERIOD = 5;     // Polls echoes and channel captures
+    static const unsigned long DISPLAY_PERIOD = 250;
+    static const unsigned long LED_PERIOD = 20;
+    static const unsigned long AUDIO_PERIOD = 10;
+    static const unsigned long COMMAND_PERIOD = 100;
+    static const unsigned long LOAD_PERIOD = LoadSettings::WINDOW;
+    
+    // LED and audio steps may wait behind one display refresh without audible or visible lag
+    static const unsigned long EFFECT_DEADLINE = 100;   // ms
+    
+    // Echo times are latched by the interrupt, so pipeline steps may wait as well
+    static const unsigned long PIPELINE_DEADLINE = 100; // ms
+    
+    /**
+     * @brief Start the drivers and the tasks; called from setup()
+     */
+    static void setup() {
+        Serial.begin(9600);
+        Serial.println(F("Color and Distance Detection System"));
+        
+        // Initialize all drivers
+        Board::begin();
+        
+        // Calibrate distance sensor for room temperature
+        Board::distanceSensor().calibrateForTemperature(22.0); // 22°C
+        
+        // Show startup message
+        Board::display().displayMessage(TextId::SYSTEM_STARTING, 0, true);
+        Board::display().displayMessage(TextId::PLEASE_WAIT, 1, true);
+        
+        // Load sensor calibration values
+        Board::colorSensor().setCalibration(
+            CalibrationSettings::ColorSensor::RED_MIN,
+            CalibrationSettings::ColorSensor::RED_MAX,
+            CalibrationSettings::ColorSensor::GREEN_MIN,
+            CalibrationSettings::ColorSensor::GREEN_MAX,
+            CalibrationSettings::ColorSensor::BLUE_MIN,
+            CalibrationSettings::ColorSensor::BLUE_MAX
+        );
+        
+        // Startup animation
+        Board::leds().blinkLed(ColorIdentifier::RED, 1);
+        Board::leds().blinkLed(ColorIdentifier::GREEN, 1);
+        Board::leds().blinkLed(ColorIdentifier::NONE, 1); // Yellow
+        Board::audio().playSuccessSound();
+        
+        delay(1000);
+        Board::display().clear();
+        Board::display().displayMessage(TextId::READY, 0, true);
+        delay(1000);
+        
+        // Release the tasks; each one is a short step, never a blocking wait
+        Board::start(reportOverrun);
+        
+        // Announce each newly presented color
+        _state.output.setDetectionMelody(DETECTION_MELODY, DETECTION_DURATIONS, DETECTION_NOTES);
+        
+        // The pipeline takes over from the distance task in color mode
+        Board::disableTask(ColorDistanceTask::PIPELINE);
+        
+        // Colors are read for as long as the object is present
+        _state.proximity.setEventCallback(onProximityEvent);
+        _state.pipeline.setColorRange(SystemSettings::PROXIMITY_EXIT_THRESHOLD);
+        
+        // Time in each power state and load level counts from here
+        _state.power.begin();
+        _state.load.setLevelCallback(applyLoadLevel);
+        _state.load.begin();
+        _state.lastActivity = millis();
+    }
+    
+    /**
+     * @brief Run one task step or sleep; called from loop()
+     */
+    static void loop() {
+        // Turn raw readings queued by the drivers into telemetry samples
+        SensorTrace::flush();
+        
+        // Hand queued telemetry to the UART as far as it has room
+        _state.telemetry.pump();
+        
+        // Run the most urgent due task; loop latency is bounded by one task step.
+        // How late it started tells the load monitor whether the loop keeps up.
+        // With nothing due, sleep until the next release or an echo interrupt
+        if (Board::run()) {
+            _state.load.recordLateness(Board::getLastLateness());
+        } else {
+            _state.power.sleep(Board::getIdleTime(), isBusy());
+        }
+    }
+    
+    // Task steps
+    
+    static void sampleDistance() {
+        // An arrival switches to color mode through onProximityEvent()
+        _state.proximity.poll();
+        updateDistance(_state.proximity.getLastDistance());
+        updateStandby();
+        sendTelemetry();
+    }
+    
+    static void runPipeline() {
+        uint8_t events = _state.pipeline.update();
+        
+        // The pipeline's pings feed the monitor; nothing is measured twice
+        if (events & AcquisitionPipeline::PING_READY) {
+            updateDistance(_state.pipeline.getLastDistance());
+            _state.proximity.update(_state.lastDistance);
+            sendTelemetry();
+        }
+        
+        if (events & AcquisitionPipeline::SAMPLE_READY) {
+            handleColorSample(_state.pipeline.getSample());
+        }
+    }
+    
+    static void refreshDisplay() {
+        _state.output.render();
+    }
+    
+    static void updateLeds() {
+        Board::leds().update();
+    }
+    
+    static void updateAudio() {
+        Board::audio().update();
+    }
+    
+    static void handleCommands() {
+        // 'p' prints the stage timing histograms, 'r' resets them,
+        // 't' starts or stops recording the raw sensor inputs,
+        // 'o' prints the applied and suppressed output updates,
+        // 'e' prints the time in each power state and the current estimate,
+        // 'l' prints the load level and the time at each level.
+        // The printed dumps are debug text on the telemetry port (see endFrames())
+        while (Serial.available() > 0) {
+            char command = Serial.read();
+            if (command == 'p') {
+                endFrames();
+                Profiler::dump(Serial);
+            } else if (command == 'r') {
+                Profiler::reset();
+            } else if (command == 't') {
+                SensorTrace::setSink(SensorTrace::isRecording() ? nullptr : sendTraceSample);
+            } else if (command == 'o') {
+                endFrames();
+                _state.output.dump(Serial);
+            } else if (command == 'e') {
+                endFrames();
+                _state.power.dump(Serial);
+            } else if (command == 'l') {
+                endFrames();
+                _state.load.dump(Serial);
+            }
+        }
+    }
+    
+    static void checkLoad() {
+        _state.load.update();
+    }
+    
+private:
+    // Echo pulses longer than this are the sensor's no-echo timeout (beyond 4 m)
+    static const unsigned long NO_ECHO_WIDTH = 30000;   // µs
+    
+    static const unsigned long BANNER_TIME = 1000;      // ms a mode banner stays on screen
+    
+    // Melody for color detection notification
+    static const uint8_t DETECTION_NOTES = 8;
+    static const uint16_t DETECTION_MELODY[DETECTION_NOTES];
+    static const uint8_t DETECTION_DURATIONS[DETECTION_NOTES];
+    
+    enum SystemMode {
+        DISTANCE_MODE,
+        COLOR_MODE
+    };
+    
+    // Everything the system keeps besides the drivers
+    struct State {
+        State()
+            : telemetry(Serial),
+              output(Board::display(), Board::leds(), Board::audio()),
+              pipeline(Board::distanceSensor(), Board::colorSensor()),
+              proximity(Board::distanceSensor()),
+              power(Board::display(), &Board::colorSensor()),
+              currentMode(DISTANCE_MODE),
+              lastDistance(0.0),
+              sceneEmpty(true),
+              red(0),
+              green(0),
+              blue(0),
+              detectedColor(ColorIdentifier::NONE),
+              colorValid(false),
+              lastActivity(0),
+              overrunPending(false) {
+        }
+        
+        Telemetry telemetry;
+        
+        // All display, LED and buzzer updates go through the output stage
+        OutputStage output;
+        
+        // Color mode runs both sensors side by side
+        AcquisitionPipeline pipeline;
+        
+        // Object arrival and departure switch between the modes
+        ProximityMonitor proximity;
+        
+        // Sleeps between tasks; the color sensor and backlight power down when nothing is near
+        PowerManager power;
+        
+        // Sheds display refreshes, LED effects, melody notes and color captures while tasks start late
+        LoadMonitor load;
+        
+        SystemMode currentMode;
+        
+        // Latest measurements
+        float lastDistance;
+        bool sceneEmpty;
+        int red;
+        int green;
+        int blue;
+        ColorIdentifier detectedColor;
+        bool colorValid;
+        
+        // millis() of the last reading within PowerSettings::STANDBY_RANGE
+        unsigned long lastActivity;
+        
+        // A task overran since the last telemetry record
+        bool overrunPending;
+    };
+    
+    static State _state;
+    
+    static bool isBusy() {
+        // Color captures are polled, and telemetry, tones, LED effects and
+        // dimmed LEDs are paced by the timers, so these need the clocks running.
+        // The echo interrupt cannot wake the CPU from power-down either.
+        return _state.currentMode == COLOR_MODE || _state.telemetry.getPendingBytes() > 0 ||
+               Board::distanceSensor().isPingActive() ||
+               Board::audio().isPlaying() || Board::leds().isEffectActive() ||
+               Board::leds().isModulating();
+    }
+    
+    static void onProximityEvent(ProximityEvent event, float /*distance*/) {
+        if (event == ProximityEvent::ARRIVED && _state.currentMode == DISTANCE_MODE) {
+            enterColorMode();
+        } else if (event == ProximityEvent::LEFT && _state.currentMode == COLOR_MODE) {
+            leaveColorMode();
+        }
+    }
+    
+    static void enterColorMode() {
+        leaveStandby();
+        
+        // Briefly notify user that we're switching to color mode
+        showBanner(TextId::OBJECT_DETECTED, TextId::CHECKING_COLOR);
+        _state.output.showMessage(TextId::COLOR_MODE, TextId::READING);
+        _state.output.pulseLed(ColorIdentifier::GREEN, 2);
+        
+        _state.currentMode = COLOR_MODE;
+        startPipeline();
+    }
+    
+    static void leaveColorMode() {
+        showBanner(TextId::OBJECT_LEFT, TextId::DISTANCE_MODE);
+        _state.output.clearColor();
+        
+        _state.currentMode = DISTANCE_MODE;
+        _state.colorValid = false;
+        _state.pipeline.stop();
+        Board::disableTask(ColorDistanceTask::PIPELINE);
+        
+        // Give an abandoned echo time to end before the next blocking ping
+        Board::enableTask(ColorDistanceTask::DISTANCE, DISTANCE_PERIOD);
+    }
+    
+    static void showBanner(TextId top, TextId bottom) {
+        _state.output.showBanner(top, bottom, BANNER_TIME);
+        
+        // Render right away instead of waiting for the next display period
+        Board::enableTask(ColorDistanceTask::DISPLAY);
+    }
+    
+    static void updateStandby() {
+        // Anything within range keeps the unit awake; an empty scene lets it rest
+        if (_state.currentMode == COLOR_MODE ||
+            (!_state.sceneEmpty && _state.lastDistance < PowerSettings::STANDBY_RANGE)) {
+            _state.lastActivity = millis();
+            leaveStandby();
+        } else if (!_state.power.isStandby() && millis() - _state.lastActivity >= PowerSettings::STANDBY_DELAY) {
+            enterStandby();
+        }
+    }
+    
+    static void enterStandby() {
+        // Slow pings and no output tasks leave gaps long enough to power down
+        _state.power.setStandby(true);
+        Board::setTaskPeriod(ColorDistanceTask::DISTANCE, PowerSettings::STANDBY_PERIOD);
+        Board::disableTask(ColorDistanceTask::DISPLAY);
+        Board::disableTask(ColorDistanceTask::LED);
+        Board::disableTask(ColorDistanceTask::AUDIO);
+    }
+    
+    static void leaveStandby() {
+        if (!_state.power.isStandby()) {
+            return;
+        }
+        _state.power.setStandby(false);
+        Board::setTaskPeriod(ColorDistanceTask::DISTANCE, DISTANCE_PERIOD);
+        Board::enableTask(ColorDistanceTask::DISTANCE, DISTANCE_PERIOD);
+        Board::enableTask(ColorDistanceTask::DISPLAY);
+        Board::enableTask(ColorDistanceTask::LED);
+        Board::enableTask(ColorDistanceTask::AUDIO);
+    }
+    
+    static void startPipeline() {
+        // Pings continue at once; color captures start after the banner
+        _state.colorValid = false;
+        _state.pipeline.reset(BANNER_TIME);
+        Board::disableTask(ColorDistanceTask::DISTANCE);
+        Board::enableTask(ColorDistanceTask::PIPELINE);
+    }
+    
+    static void updateDistance(float distance) {
+        unsigned long echo = Board::distanceSensor().getLastPulseDuration();
+        bool empty = echo == 0 || echo > NO_ECHO_WIDTH;
+        
+        // The output stage redraws only when the shown reading changes
+        if (_state.currentMode == DISTANCE_MODE) {
+            if (empty) {
+                _state.output.showMessage(TextId::DISTANCE_MODE, TextId::NO_OBJECT);
+            } else {
+                _state.output.showDistance(distance);
+            }
+        }
+        
+        _state.sceneEmpty = empty;
+        _state.lastDistance = distance;
+    }
+    
+    static void handleColorSample(const FusedSample& sample) {
+        // The color belongs to the object only if the pings of the same window saw it
+        bool inRange = sample.echoes > 0 && sample.distance <= SystemSettings::PROXIMITY_EXIT_THRESHOLD;
+        if (!inRange || !_state.proximity.isObjectPresent()) {
+            _state.colorValid = false;
+            return;
+        }
+        
+        _state.red = sample.red;
+        _state.green = sample.green;
+        _state.blue = sample.blue;
+        _state.detectedColor = sample.colorId;
+        _state.colorValid = true;
+        
+        // LED, screen and melody follow only a change of the color class
+        _state.output.showColor(_state.detectedColor, _state.red, _state.green, _state.blue);
+        
+        sendTelemetry();
+    }
+    
+    // Send every queued frame before a text dump, so the text falls between
+    // frames: decoders skip it and lose no record. This blocks for up to a
+    // buffer's worth of bytes, which only a debug command may do
+    static void endFrames() {
+        while (_state.telemetry.getPendingBytes() > 0) {
+            _state.telemetry.pump();
+            Serial.flush();
+        }
+    }
+    
+    static void sendTraceSample(TraceChannel channel, unsigned long timestamp, unsigned long value) {
+        _state.telemetry.sendSample(static_cast<uint8_t>(channel), timestamp, value);
+    }
+    
+    static void sendTelemetry() {
+        // Binary record instead of text: 27 bytes, queued without blocking
+        TelemetryRecord record = {};
+        record.timestamp = millis();
+        unsigned long echo = Board::distanceSensor().getLastPulseDuration();
+        record.echoDuration = echo > 0xFFFF ? 0xFFFF : echo;
+        record.distance = constrain(_state.lastDistance * 10.0, 0, 0xFFFF);
+        
+        if (_state.proximity.isObjectPresent()) {
+            record.status |= Telemetry::STATUS_OBJECT_IN_RANGE;
+        }
+        if (echo == 0 || echo > NO_ECHO_WIDTH) {
+            record.status |= Telemetry::STATUS_NO_ECHO;
+        }
+        if (_state.currentMode == COLOR_MODE) {
+            record.status |= Telemetry::STATUS_COLOR_MODE;
+            if (_state.colorValid) {
+                record.status |= Telemetry::STATUS_COLOR_VALID;
+                record.red = constrain(_state.red, 0, 255);
+                record.green = constrain(_state.green, 0, 255);
+                record.blue = constrain(_state.blue, 0, 255);
+                record.colorId = static_cast<uint8_t>(_state.detectedColor);
+            }
+        }
+        if (_state.load.getLevel() != LoadLevel::NORMAL) {
+            record.status |= Telemetry::STATUS_LOAD_SHED;
+        }
+        if (_state.overrunPending) {
+            record.status |= Telemetry::STATUS_OVERRUN;
+            _state.overrunPending = false;
+        }
+        
+        Telemetry::captureStageTimings(record);
+        _state.telemetry.send(record);
+    }
+    
+    static void reportOverrun(uint8_t /*taskId*/, unsigned long /*lateness*/) {
+        // Text would corrupt the binary frames on the port; the next record carries a flag
+        _state.overrunPending = true;
+    }
+    
+    static void applyLoadLevel(LoadLevel level) {
+        // Every level keeps the shedding of the levels below it, and dropping a
+        // level restores what it shed
+        unsigned long displayPeriod = DISPLAY_PERIOD;
+        if (level >= LoadLevel::SLOW_DISPLAY) {
+            displayPeriod *= LoadSettings::DISPLAY_SLOWDOWN;
+        }
+        Board::setTaskPeriod(ColorDistanceTask::DISPLAY, displayPeriod);
+        
+        Board::leds().setEffectsEnabled(level < LoadLevel::NO_LED_EFFECTS);
+        Board::audio().setNoteLimit(level >= LoadLevel::BEEP_ONLY ? 1 : 0);
+        
+        unsigned long channelInterval = SystemSettings::SENSOR_STABILIZATION_DELAY;
+        if (level >= LoadLevel::REDUCED_COLOR) {
+            channelInterval *= LoadSettings::COLOR_SLOWDOWN;
+        }
+        _state.pipeline.setChannelInterval(channelInterval);
+    }
+};
+
+template <typename Board>
+const uint16_t ColorDistanceApp<Board>::DETECTION_MELODY[DETECTION_NOTES] = {
+    Notes::NOTE_C4, Notes::NOTE_G3, Notes::NOTE_G3, Notes::NOTE_A3,
+    Notes::NOTE_G3, 0, Notes::NOTE_B3, Notes::NOTE_C4
+};
+
+template <typename Board>
+const uint8_t ColorDistanceApp<Board>::DETECTION_DURATIONS[DETECTION_NOTES] = {
+    4, 8, 8, 4, 4, 4, 4, 4
+};
+
+template <typename Board>
+typename ColorDistanceApp<Board>::State ColorDistanceApp<Board>::_state;
+
+#endif // COLOR_DISTANCE_APP_H
@@ -0,0 +1,137 @@
+/**
+ * @file ColorEstimator.cpp
+ * @brief Sequential color classification implementation
+ * @author catalina
+ */
+
+#include "ColorEstimator.h"
+
+namespace {
+    const uint8_t CHANNELS = 3;
+    
+    // ColorIdentifier of each channel, in ColorSensor channel order
+    const ColorIdentifier CHANNEL_COLORS[CHANNELS] = {
+        ColorIdentifier::RED,
+        ColorIdentifier::GREEN,
+        ColorIdentifier::BLUE
+    };
+    
+    float larger(float a, float b) {
+        return a > b ? a : b;
+    }
+    
+    float smaller(float a, float b) {
+        return a < b ? a : b;
+    }
+}
+
+ColorEstimator::ColorEstimator(int threshold, float confidence)
+    : _threshold(threshold),
+      _confidence(confidence) {
+    reset();
+}
+
+void ColorEstimator::reset() {
+    _count = 0;
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        _mean[i] = 0.0f;
+        _squares[i] = 0.0f;
+    }
+}
+
+void ColorEstimator::add(int red, int green, int blue) {
+    if (_count == 0xFF) {
+        return;
+    }
+    _count++;
+    
+    const int values[CHANNELS] = { red, green, blue };
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        float delta = values[i] - _mean[i];
+        _mean[i] += delta / _count;
+        _squares[i] += delta * (values[i] - _mean[i]);
+    }
+}
+
+bool ColorEstimator::isConfident() const {
+    return _count >= MIN_SAMPLES && getMargin() >= _confidence;
+}
+
+ColorIdentifier ColorEstimator::getColor() const {
+    if (_count == 0) {
+        return ColorIdentifier::NONE;
+    }
+    
+    bool dark = _mean[0] < _threshold && _mean[1] < _threshold && _mean[2] < _threshold;
+    uint8_t top = leader();
+    bool leads = true;
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        if (i != top && _mean[top] <= _mean[i] + _threshold) {
+            leads = false;
+        }
+    }
+    return !dark && leads ? CHANNEL_COLORS[top] : ColorIdentifier::NONE;
+}
+
+float ColorEstimator::getMargin() const {
+    if (_count < 2) {
+        return 0.0f;
+    }
+    
+    // Every channel below the threshold: no color (dark)
+    float dark = 1e9f;
+    // Some channel at or above it: not dark
+    float lit = -1e9f;
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        float z = (_threshold - _mean[i]) / error(i);
+        dark = smaller(dark, z);
+        lit = larger(lit, -z);
+    }
+    
+    // The leading channel clears both others by the threshold, or fails to
+    uint8_t top = leader();
+    float leads = 1e9f;
+    float trails = -1e9f;
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        if (i == top) {
+            continue;
+        }
+        float z = (_mean[top] - _mean[i] - _threshold) / difference(top, i);
+        leads = smaller(leads, z);
+        trails = larger(trails, -z);
+    }
+    
+    // A color needs both "lit" and "leads"; no color needs either "dark" or "trails"
+    if (getColor() != ColorIdentifier::NONE) {
+        return smaller(lit, leads);
+    }
+    return larger(dark, trails);
+}
+
+float ColorEstimator::getMean(uint8_t channel) const {
+    return channel < CHANNELS ? _mean[channel] : 0.0f;
+}
+
+float ColorEstimator::getVariance(uint8_t channel) const {
+    return channel < CHANNELS && _count > 1 ? _squares[channel] / (_count - 1) : 0.0f;
+}
+
+float ColorEstimator::error(uint8_t channel) const {
+    return sqrt(larger(getVariance(channel), VARIANCE_FLOOR) / _count);
+}
+
+float ColorEstimator::difference(uint8_t first, uint8_t second) const {
+    // Channels are read at different times, so their noise is taken as independent
+    float variance = larger(getVariance(first), VARIANCE_FLOOR) + larger(getVariance(second), VARIANCE_FLOOR);
+    return sqrt(variance / _count);
+}
+
+uint8_t ColorEstimator::leader() const {
+    uint8_t top = 0;
+    for (uint8_t i = 1; i < CHANNELS; i++) {
+        if (_mean[i] > _mean[top]) {
+            top = i;
+        }
+    }
+    return top;
+}
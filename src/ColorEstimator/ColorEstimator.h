@@ -0,0 +1,123 @@
+/**
+ * @file ColorEstimator.h
+ * @brief Running RGB mean and variance with a sequential stopping rule
+ * @author catalina
+ */
+
+#ifndef COLOR_ESTIMATOR_H
+#define COLOR_ESTIMATOR_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+
+/**
+ * @class ColorEstimator
+ * @brief Decides when repeated color readings are enough to classify
+ * 
+ * Each add() updates the running mean and variance of the three calibrated
+ * channels (Welford's method: three means and three sums of squares, no
+ * stored readings). getColor() classifies the means with the rules of
+ * ColorSensor::classifyColor(): a channel wins if it leads both others by
+ * the threshold, and everything below the threshold is no color.
+ * 
+ * Those rules compare channel means, or differences of two, with the
+ * threshold. getMargin() is how far the means are from the nearest
+ * comparison that would change the result, in standard errors of that
+ * mean or difference. Once it reaches the confidence bound, more readings
+ * are unlikely to change the result. A clear-cut surface gets there after
+ * MIN_SAMPLES readings; one near a boundary needs more, up to whatever
+ * cap the caller sets.
+ * 
+ * Channel variances are floored at one count squared, so a run of
+ * identical readings does not count as infinitely precise.
+ */
+class ColorEstimator {
+public:
+    /**
+     * @brief Constructor
+     * 
+     * @param threshold Classification margin on the 0-255 scale (ColorSensor::getDetectionThreshold())
+     * @param confidence Standard errors the margin must reach
+     */
+    explicit ColorEstimator(
+        int threshold = SystemSettings::COLOR_DETECTION_THRESHOLD,
+        float confidence = SystemSettings::COLOR_CONFIDENCE
+    );
+    
+    /**
+     * @brief Forget all readings
+     */
+    void reset();
+    
+    /**
+     * @brief Add one calibrated reading
+     * 
+     * @param red Red value (0-255)
+     * @param green Green value (0-255)
+     * @param blue Blue value (0-255)
+     */
+    void add(int red, int green, int blue);
+    
+    /**
+     * @brief Check whether the classification has settled
+     * @return true once MIN_SAMPLES readings are in and the margin reaches the confidence bound
+     */
+    bool isConfident() const;
+    
+    /**
+     * @brief Classify the mean color
+     * @return ColorIdentifier of the means (NONE without readings)
+     */
+    ColorIdentifier getColor() const;
+    
+    /**
+     * @brief Get the distance of the means from the nearest decision boundary
+     * @return Margin in standard errors (0 with fewer than two readings)
+     */
+    float getMargin() const;
+    
+    /**
+     * @brief Get the mean of a channel
+     * @param channel ColorSensor::CHANNEL_RED, CHANNEL_GREEN or CHANNEL_BLUE
+     * @return Mean on the 0-255 scale
+     */
+    float getMean(uint8_t channel) const;
+    
+    /**
+     * @brief Get the sample variance of a channel
+     * @param channel ColorSensor::CHANNEL_RED, CHANNEL_GREEN or CHANNEL_BLUE
+     * @return Variance (0 with fewer than two readings)
+     */
+    float getVariance(uint8_t channel) const;
+    
+    /**
+     * @brief Get the number of readings added
+     */
+    uint8_t getCount() const { return _count; }
+    
+    /**
+     * @brief Set the classification margin
+     * @param threshold Margin on the 0-255 scale
+     */
+    void setThreshold(int threshold) { _threshold = threshold; }
+    
+    // Readings before the variance is trusted
+    static const uint8_t MIN_SAMPLES = 3;
+    
+    // Lowest variance assumed for a channel (one count squared)
+    static const uint8_t VARIANCE_FLOOR = 1;
+    
+private:
+    int _threshold;
+    float _confidence;
+    uint8_t _count;
+    float _mean[3];
+    float _squares[3];      // Sum of squared deviations from the mean
+    
+    // Helper methods
+    float error(uint8_t channel) const;
+    float difference(uint8_t first, uint8_t second) const;
+    uint8_t leader() const;
+};
+
+#endif // COLOR_ESTIMATOR_H
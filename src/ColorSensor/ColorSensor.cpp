@@ -17,7 +17,10 @@ ColorSensor::ColorSensor(uint8_t s0Pin, uint8_t s1Pin, uint8_t s2Pin, uint8_t s3
       _greenMin(CalibrationSettings::ColorSensor::GREEN_MIN),
       _greenMax(CalibrationSettings::ColorSensor::GREEN_MAX),
       _blueMin(CalibrationSettings::ColorSensor::BLUE_MIN),
-      _blueMax(CalibrationSettings::ColorSensor::BLUE_MAX) {
+      _blueMax(CalibrationSettings::ColorSensor::BLUE_MAX),
+      _detectionThreshold(SystemSettings::COLOR_DETECTION_THRESHOLD),
+      _calibrationConfidence(0),
+      _frequencyScaling(FREQUENCY_SCALING_20) {
 }
 
 void ColorSensor::begin(uint8_t frequencyScaling) {
@@ -41,7 +44,18 @@ void ColorSensor::setCalibration(int redMin, int redMax, int greenMin, int green
     _blueMax = blueMax;
 }
 
+void ColorSensor::setDetectionThreshold(int threshold) {
+    _detectionThreshold = threshold;
+}
+
+int ColorSensor::getDetectionThreshold() const {
+    return _detectionThreshold;
+}
+
 bool ColorSensor::runCalibration(unsigned long calibrationTime) {
+    // Keep the current calibration in case this run fails
+    int previous[] = { _redMin, _redMax, _greenMin, _greenMax, _blueMin, _blueMax };
+    
     // Initialize min/max values
     _redMin = 1000;
     _redMax = 0;
@@ -73,18 +87,65 @@ bool ColorSensor::runCalibration(unsigned long calibrationTime) {
     
     // Check if calibration produced valid ranges
     if (_redMax - _redMin < 10 || _greenMax - _greenMin < 10 || _blueMax - _blueMin < 10) {
+        setCalibration(previous[0], previous[1], previous[2], previous[3], previous[4], previous[5]);
         return false; // Calibration failed
     }
     
     return true; // Calibration succeeded
 }
 
+bool ColorSensor::runQuantileCalibration(unsigned long maxTime, uint8_t targetConfidence) {
+    QuantileRange red, green, blue;
+    
+    unsigned long startTime = millis();
+    uint8_t confidence = 0;
+    
+    while (millis() - startTime < maxTime) {
+        int rawRed = getRedPW();
+        int rawGreen = getGreenPW();
+        int rawBlue = getBluePW();
+        
+        // A timeout says nothing about the surface; leave it out
+        if (rawRed > 0) {
+            red.add(rawRed);
+        }
+        if (rawGreen > 0) {
+            green.add(rawGreen);
+        }
+        if (rawBlue > 0) {
+            blue.add(rawBlue);
+        }
+        
+        confidence = min(red.getConfidence(), min(green.getConfidence(), blue.getConfidence()));
+        if (confidence >= targetConfidence) {
+            break;
+        }
+        
+        delay(CalibrationSettings::ColorSensor::QUANTILE_INTERVAL);
+    }
+    
+    _calibrationConfidence = confidence;
+    
+    // Same acceptance rule as runCalibration(); keep the old values otherwise
+    if (red.getHigh() - red.getLow() < 10 || green.getHigh() - green.getLow() < 10
+        || blue.getHigh() - blue.getLow() < 10) {
+        return false;
+    }
+    
+    setCalibration(red.getLow(), red.getHigh(), green.getLow(), green.getHigh(), blue.getLow(), blue.getHigh());
+    return true;
+}
+
+uint8_t ColorSensor::getCalibrationConfidence() const {
+    return _calibrationConfidence;
+}
+
 void ColorSensor::readRawValues(int &red, int &green, int &blue) {
     red = getRedPW();
-    delay(SystemSettings::SENSOR_STABILIZATION_DELAY);
+    waitForStabilization();
     
     green = getGreenPW();
-    delay(SystemSettings::SENSOR_STABILIZATION_DELAY);
+    waitForStabilization();
     
     blue = getBluePW();
 }
@@ -95,6 +156,70 @@ void ColorSensor::readRGB(int &red, int &green, int &blue) {
     // Get raw values
     readRawValues(rawRed, rawGreen, rawBlue);
     
+    convertToRGB(rawRed, rawGreen, rawBlue, red, green, blue);
+}
+
+ColorIdentifier ColorSensor::detectColor() {
+    int red, green, blue;
+    readRGB(red, green, blue);
+    
+    return classifyColor(red, green, blue);
+}
+
+ColorIdentifier ColorSensor::detectColorSequential(ColorEstimator& estimator, uint8_t maxSamples) {
+    estimator.reset();
+    estimator.setThreshold(_detectionThreshold);
+    
+    int red, green, blue;
+    do {
+        readRGB(red, green, blue);
+        estimator.add(red, green, blue);
+    } while (!estimator.isConfident() && estimator.getCount() < maxSamples);
+    
+    return estimator.getColor();
+}
+
+ColorIdentifier ColorSensor::detectColorSequential(uint8_t maxSamples) {
+    ColorEstimator estimator(_detectionThreshold);
+    return detectColorSequential(estimator, maxSamples);
+}
+
+int ColorSensor::readChannel(uint8_t channel) {
+    switch (channel) {
+        case CHANNEL_RED:
+            return getRedPW();
+        case CHANNEL_GREEN:
+            return getGreenPW();
+        case CHANNEL_BLUE:
+            return getBluePW();
+        default:
+            return 0; // Invalid channel
+    }
+}
+
+void ColorSensor::selectChannel(uint8_t channel) {
+    // S2/S3: LOW/LOW red, HIGH/HIGH green, LOW/HIGH blue
+    switch (channel) {
+        case CHANNEL_RED:
+            digitalWrite(_s2Pin, LOW);
+            digitalWrite(_s3Pin, LOW);
+            break;
+        case CHANNEL_GREEN:
+            digitalWrite(_s2Pin, HIGH);
+            digitalWrite(_s3Pin, HIGH);
+            break;
+        case CHANNEL_BLUE:
+            digitalWrite(_s2Pin, LOW);
+            digitalWrite(_s3Pin, HIGH);
+            break;
+        default:
+            break;
+    }
+}
+
+void ColorSensor::convertToRGB(int rawRed, int rawGreen, int rawBlue, int &red, int &green, int &blue) const {
+    PROFILE_STAGE(COLOR_CLASSIFY);
+    
     // Map to 0-255 range
     red = map(rawRed, _redMin, _redMax, 255, 0);
     green = map(rawGreen, _greenMin, _greenMax, 255, 0);
@@ -106,72 +231,88 @@ void ColorSensor::readRGB(int &red, int &green, int &blue) {
     blue = constrain(blue, 0, 255);
 }
 
-ColorIdentifier ColorSensor::detectColor() {
-    int red, green, blue;
-    readRGB(red, green, blue);
+ColorIdentifier ColorSensor::classifyColor(int red, int green, int blue) const {
+    PROFILE_STAGE(COLOR_CLASSIFY);
     
     // Check if values are valid for detection
-    if (red < SystemSettings::COLOR_DETECTION_THRESHOLD && 
-        green < SystemSettings::COLOR_DETECTION_THRESHOLD && 
-        blue < SystemSettings::COLOR_DETECTION_THRESHOLD) {
+    if (red < _detectionThreshold && 
+        green < _detectionThreshold && 
+        blue < _detectionThreshold) {
         return ColorIdentifier::NONE;
     }
     
     // Determine dominant color
-    if (red > green + SystemSettings::COLOR_DETECTION_THRESHOLD && 
-        red > blue + SystemSettings::COLOR_DETECTION_THRESHOLD) {
+    if (red > green + _detectionThreshold && 
+        red > blue + _detectionThreshold) {
         return ColorIdentifier::RED;
-    } else if (green > red + SystemSettings::COLOR_DETECTION_THRESHOLD && 
-               green > blue + SystemSettings::COLOR_DETECTION_THRESHOLD) {
+    } else if (green > red + _detectionThreshold && 
+               green > blue + _detectionThreshold) {
         return ColorIdentifier::GREEN;
-    } else if (blue > red + SystemSettings::COLOR_DETECTION_THRESHOLD && 
-               blue > green + SystemSettings::COLOR_DETECTION_THRESHOLD) {
+    } else if (blue > red + _detectionThreshold && 
+               blue > green + _detectionThreshold) {
         return ColorIdentifier::BLUE;
     }
     
     return ColorIdentifier::NONE;
 }
 
-String ColorSensor::getColorName(ColorIdentifier colorId) {
+const __FlashStringHelper* ColorSensor::getColorName(ColorIdentifier colorId) {
     switch (colorId) {
         case ColorIdentifier::NONE:
-            return "No color";
+            return TextTable::get(TextId::COLOR_NONE);
         case ColorIdentifier::RED:
-            return "Red";
+            return TextTable::get(TextId::COLOR_RED);
         case ColorIdentifier::GREEN:
-            return "Green";
+            return TextTable::get(TextId::COLOR_GREEN);
         case ColorIdentifier::BLUE:
-            return "Blue";
+            return TextTable::get(TextId::COLOR_BLUE);
         default:
-            return "Unknown";
+            return TextTable::get(TextId::COLOR_UNKNOWN);
     }
 }
 
+void ColorSensor::waitForStabilization() {
+    PROFILE_STAGE(COLOR_STABILIZE);
+    delay(SystemSettings::SENSOR_STABILIZATION_DELAY);
+}
+
 int ColorSensor::getRedPW() {
+    PROFILE_STAGE(COLOR_ACQUIRE);
+    
     // Set sensor to read Red only
-    digitalWrite(_s2Pin, LOW);
-    digitalWrite(_s3Pin, LOW);
+    selectChannel(CHANNEL_RED);
     
     // Read the output Pulse Width
-    return pulseIn(_outPin, LOW);
+    int pulseWidth = pulseIn(_outPin, LOW);
+    TRACE_SAMPLE(COLOR_RED, pulseWidth);
+    
+    return pulseWidth;
 }
 
 int ColorSensor::getGreenPW() {
+    PROFILE_STAGE(COLOR_ACQUIRE);
+    
     // Set sensor to read Green only
-    digitalWrite(_s2Pin, HIGH);
-    digitalWrite(_s3Pin, HIGH);
+    selectChannel(CHANNEL_GREEN);
     
     // Read the output Pulse Width
-    return pulseIn(_outPin, LOW);
+    int pulseWidth = pulseIn(_outPin, LOW);
+    TRACE_SAMPLE(COLOR_GREEN, pulseWidth);
+    
+    return pulseWidth;
 }
 
 int ColorSensor::getBluePW() {
+    PROFILE_STAGE(COLOR_ACQUIRE);
+    
     // Set sensor to read Blue only
-    digitalWrite(_s2Pin, LOW);
-    digitalWrite(_s3Pin, HIGH);
+    selectChannel(CHANNEL_BLUE);
     
     // Read the output Pulse Width
-    return pulseIn(_outPin, LOW);
+    int pulseWidth = pulseIn(_outPin, LOW);
+    TRACE_SAMPLE(COLOR_BLUE, pulseWidth);
+    
+    return pulseWidth;
 }
 
 void ColorSensor::setFrequencyScaling(uint8_t scaling) {
@@ -196,5 +337,7 @@ void ColorSensor::setFrequencyScaling(uint8_t scaling) {
             // Default to 20%
             digitalWrite(_s0Pin, HIGH);
             digitalWrite(_s1Pin, LOW);
+            scaling = FREQUENCY_SCALING_20;
     }
+    _frequencyScaling = scaling;
 }
@@ -9,6 +9,11 @@
 
 #include <Arduino.h>
 #include "../Configuration/SensorConfig.h"
+#include "../ColorEstimator/ColorEstimator.h"
+#include "../Profiler/Profiler.h"
+#include "../QuantileRange/QuantileRange.h"
+#include "../SensorTrace/SensorTrace.h"
+#include "../TextTable/TextTable.h"
 
 /**
  * @class ColorSensor
@@ -66,6 +71,45 @@ public:
      */
     bool runCalibration(unsigned long calibrationTime = 5000);
 
+    /**
+     * @brief Run calibration on percentiles instead of the raw min/max values
+     * 
+     * Each channel feeds a QuantileRange, and the calibration range becomes
+     * the estimated QUANTILE_TAIL and 1 - QUANTILE_TAIL percentiles, so a
+     * spike or a timed-out reading cannot stretch it. Timeouts (0) are
+     * left out altogether. Calibration ends as soon as every channel
+     * reaches the target confidence, or when the time runs out.
+     * 
+     * @param maxTime Longest time in ms to spend on calibration
+     * @param targetConfidence Confidence (0-100) at which to end early
+     * @return true if calibration succeeded, false otherwise (previous values kept)
+     */
+    bool runQuantileCalibration(
+        unsigned long maxTime = 5000,
+        uint8_t targetConfidence = CalibrationSettings::ColorSensor::QUANTILE_CONFIDENCE
+    );
+
+    /**
+     * @brief Get the confidence reached by the last quantile calibration
+     * @return Lowest confidence of the three channels (0-100)
+     */
+    uint8_t getCalibrationConfidence() const;
+
+    /**
+     * @brief Set the margin a channel must lead the others by to count as dominant
+     * 
+     * Also the minimum level below which all channels count as no color.
+     * 
+     * @param threshold Margin on the 0-255 RGB scale
+     */
+    void setDetectionThreshold(int threshold);
+
+    /**
+     * @brief Get the color detection margin
+     * @return Margin on the 0-255 RGB scale
+     */
+    int getDetectionThreshold() const;
+
     /**
      * @brief Read raw pulse width values from the sensor
      * 
@@ -91,11 +135,95 @@ public:
     ColorIdentifier detectColor();
 
     /**
-     * @brief Get color name as string for display
-     * @param colorId ColorIdentifier to convert to string
-     * @return String representation of the color
+     * @brief Detect the color from as many readings as it takes to be sure
+     * 
+     * Takes RGB readings back to back, like repeated readRGB() calls, and
+     * feeds them to the estimator until its classification margin reaches
+     * the confidence bound (see ColorEstimator) or maxSamples readings are
+     * in. A clear-cut surface costs ColorEstimator::MIN_SAMPLES readings.
+     * 
+     * @param estimator Estimator to use; reset first, holds the means and count afterwards
+     * @param maxSamples Most readings to take
+     * @return ColorIdentifier of the mean color
+     */
+    ColorIdentifier detectColorSequential(ColorEstimator& estimator,
+                                          uint8_t maxSamples = SystemSettings::COLOR_MAX_SAMPLES);
+
+    /**
+     * @brief Detect the color from as many readings as it takes to be sure
+     * @param maxSamples Most readings to take
+     * @return ColorIdentifier of the mean color
+     */
+    ColorIdentifier detectColorSequential(uint8_t maxSamples = SystemSettings::COLOR_MAX_SAMPLES);
+
+    /**
+     * @brief Read the raw pulse width of a single channel
+     * 
+     * Lets callers spread an RGB acquisition over several steps, with the
+     * stabilization time between channels spent elsewhere.
+     * 
+     * @param channel Channel to read (CHANNEL_RED, CHANNEL_GREEN or CHANNEL_BLUE)
+     * @return Pulse width in microseconds (0 on timeout)
+     */
+    int readChannel(uint8_t channel);
+
+    /**
+     * @brief Select the photodiode filter without reading the output
+     * 
+     * For callers that time the output pulse themselves.
+     * 
+     * @param channel Channel to select (CHANNEL_RED, CHANNEL_GREEN or CHANNEL_BLUE)
+     */
+    void selectChannel(uint8_t channel);
+
+    /**
+     * @brief Get the pin the sensor output is read on
+     */
+    uint8_t getOutputPin() const { return _outPin; }
+
+    /**
+     * @brief Convert raw pulse widths to calibrated RGB values (0-255)
+     * 
+     * @param rawRed Red pulse width
+     * @param rawGreen Green pulse width
+     * @param rawBlue Blue pulse width
+     * @param red Reference to store red value
+     * @param green Reference to store green value
+     * @param blue Reference to store blue value
+     */
+    void convertToRGB(int rawRed, int rawGreen, int rawBlue, int &red, int &green, int &blue) const;
+
+    /**
+     * @brief Determine the dominant color of calibrated RGB values
+     * 
+     * @param red Red value (0-255)
+     * @param green Green value (0-255)
+     * @param blue Blue value (0-255)
+     * @return ColorIdentifier enum representing the detected color
+     */
+    ColorIdentifier classifyColor(int red, int green, int blue) const;
+
+    /**
+     * @brief Get color name for display
+     * @param colorId ColorIdentifier to name
+     * @return Flash pointer to the name (see TextTable)
+     */
+    static const __FlashStringHelper* getColorName(ColorIdentifier colorId);
+
+    /**
+     * @brief Set the output frequency scaling
+     * 
+     * FREQUENCY_SCALING_OFF powers the sensor down; readings time out
+     * until another scaling is set.
+     * 
+     * @param scaling One of the FREQUENCY_SCALING_* options
+     */
+    void setFrequencyScaling(uint8_t scaling);
+
+    /**
+     * @brief Get the output frequency scaling last set
      */
-    String getColorName(ColorIdentifier colorId);
+    uint8_t getFrequencyScaling() const { return _frequencyScaling; }
 
     // Frequency scaling options
     static const uint8_t FREQUENCY_SCALING_OFF = 0;
@@ -103,6 +231,11 @@ public:
     static const uint8_t FREQUENCY_SCALING_20 = 2;
     static const uint8_t FREQUENCY_SCALING_100 = 3;
 
+    // Photodiode channels
+    static const uint8_t CHANNEL_RED = 0;
+    static const uint8_t CHANNEL_GREEN = 1;
+    static const uint8_t CHANNEL_BLUE = 2;
+
 private:
     // Pin configuration
     uint8_t _s0Pin;
@@ -119,11 +252,20 @@ private:
     int _blueMin;
     int _blueMax;
 
+    // Classification margin
+    int _detectionThreshold;
+
+    // Confidence of the last quantile calibration
+    uint8_t _calibrationConfidence;
+
+    // Output frequency scaling (FREQUENCY_SCALING_OFF while powered down)
+    uint8_t _frequencyScaling;
+
     // Helper methods
+    void waitForStabilization();
     int getRedPW();
     int getGreenPW();
     int getBluePW();
-    void setFrequencyScaling(uint8_t scaling);
 };
 
 #endif // COLOR_SENSOR_H
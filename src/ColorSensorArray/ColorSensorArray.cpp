@@ -0,0 +1,236 @@
+/**
+ * @file ColorSensorArray.cpp
+ * @brief Several TCS230 heads read at once by counting output edges
+ * @author catalina
+ */
+
+#include "ColorSensorArray.h"
+
+namespace {
+    // Rising edges of one head while the gate is open
+    struct HeadEdges {
+        uint16_t count;
+        unsigned long first;    // micros() of the first edge
+        unsigned long last;     // micros() of the latest edge
+    };
+    
+    void countEdge(HeadEdges& edges, unsigned long now) {
+        if (edges.count == 0) {
+            edges.first = now;
+        }
+        edges.last = now;
+        edges.count++;
+    }
+
+#ifdef ARDUINO
+    // Heads on one pin-change group (port B, C or D on the ATmega328P)
+    struct PortHeads {
+        volatile uint8_t* input;
+        uint8_t mask;           // OUT pins of the heads on this port
+        uint8_t previous;       // Port state at the last change
+        uint8_t count;
+        uint8_t bits[ColorSensorArray::MAX_HEADS];
+        uint8_t heads[ColorSensorArray::MAX_HEADS];
+    };
+    
+    const uint8_t PORT_GROUPS = 3;
+    
+    HeadEdges headEdges[ColorSensorArray::MAX_HEADS];
+    PortHeads ports[PORT_GROUPS];
+    uint8_t groupMask;          // PCICR bits of the groups with heads
+    
+    // Any change on the port lands here; only rising OUT edges count
+    void countPortEdges(PortHeads& port) {
+        uint8_t value = *port.input;
+        uint8_t rising = value & ~port.previous & port.mask;
+        port.previous = value;
+        if (rising == 0) {
+            return;
+        }
+        
+        unsigned long now = micros();
+        for (uint8_t i = 0; i < port.count; i++) {
+            if (rising & port.bits[i]) {
+                countEdge(headEdges[port.heads[i]], now);
+            }
+        }
+    }
+#else
+    // On the host every simulated device thread counts its own edges
+    thread_local HeadEdges headEdges[ColorSensorArray::MAX_HEADS];
+    
+    template <uint8_t HEAD>
+    void onRisingEdge() {
+        countEdge(headEdges[HEAD], micros());
+    }
+    
+    void (* const EDGE_HANDLERS[])() = {
+        onRisingEdge<0>, onRisingEdge<1>, onRisingEdge<2>, onRisingEdge<3>
+    };
+    static_assert(sizeof(EDGE_HANDLERS) / sizeof(EDGE_HANDLERS[0]) == ColorSensorArray::MAX_HEADS,
+                  "One edge handler per head");
+#endif
+    
+    // Output frequency in percent of full scale for a scaling option
+    uint8_t scalingPercent(uint8_t scaling) {
+        switch (scaling) {
+            case ColorSensor::FREQUENCY_SCALING_2:
+                return 2;
+            case ColorSensor::FREQUENCY_SCALING_20:
+                return 20;
+            case ColorSensor::FREQUENCY_SCALING_100:
+                return 100;
+            default:
+                return 0;
+        }
+    }
+}
+
+#ifdef ARDUINO
+ISR(PCINT0_vect) {
+    countPortEdges(ports[0]);
+}
+
+ISR(PCINT1_vect) {
+    countPortEdges(ports[1]);
+}
+
+ISR(PCINT2_vect) {
+    countPortEdges(ports[2]);
+}
+#endif
+
+ColorSensorArray::ColorSensorArray(ColorSensor* heads, uint8_t headCount)
+    : _heads(heads),
+      _headCount(headCount < MAX_HEADS ? headCount : MAX_HEADS),
+      _scalingPercent(2),
+      _gateTime(SystemSettings::COLOR_GATE_TIME) {
+    for (uint8_t i = 0; i < MAX_HEADS; i++) {
+        _edges[i] = 0;
+    }
+}
+
+void ColorSensorArray::begin(uint8_t frequencyScaling) {
+    for (uint8_t i = 0; i < _headCount; i++) {
+        _heads[i].begin(frequencyScaling);
+    }
+    _scalingPercent = scalingPercent(frequencyScaling);
+
+#ifdef ARDUINO
+    // Route every OUT pin to its pin-change group; the groups stay
+    // disabled outside the gate
+    groupMask = 0;
+    for (uint8_t group = 0; group < PORT_GROUPS; group++) {
+        ports[group].mask = 0;
+        ports[group].count = 0;
+    }
+    for (uint8_t i = 0; i < _headCount; i++) {
+        uint8_t pin = _heads[i].getOutputPin();
+        if (digitalPinToPCICR(pin) == 0) {
+            continue; // No pin-change interrupt: the head reads 0
+        }
+        
+        PortHeads& port = ports[digitalPinToPCICRbit(pin)];
+        port.input = portInputRegister(digitalPinToPort(pin));
+        port.mask |= digitalPinToBitMask(pin);
+        port.bits[port.count] = digitalPinToBitMask(pin);
+        port.heads[port.count] = i;
+        port.count++;
+        
+        *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+        groupMask |= _BV(digitalPinToPCICRbit(pin));
+    }
+#endif
+}
+
+void ColorSensorArray::readChannel(uint8_t channel, int* widths) {
+    PROFILE_STAGE(COLOR_ACQUIRE);
+    
+    // One filter switch serves every head
+    _heads[0].selectChannel(channel);
+    
+    noInterrupts();
+    for (uint8_t i = 0; i < _headCount; i++) {
+        headEdges[i].count = 0;
+    }
+#ifdef ARDUINO
+    for (uint8_t group = 0; group < PORT_GROUPS; group++) {
+        if (ports[group].count > 0) {
+            ports[group].previous = *ports[group].input;
+        }
+    }
+    PCIFR = groupMask;
+    PCICR |= groupMask;
+#else
+    for (uint8_t i = 0; i < _headCount; i++) {
+        attachInterrupt(digitalPinToInterrupt(_heads[i].getOutputPin()), EDGE_HANDLERS[i], RISING);
+    }
+#endif
+    interrupts();
+    
+    delay(_gateTime);
+    
+    HeadEdges edges[MAX_HEADS];
+    noInterrupts();
+#ifdef ARDUINO
+    PCICR &= ~groupMask;
+#else
+    for (uint8_t i = 0; i < _headCount; i++) {
+        detachInterrupt(digitalPinToInterrupt(_heads[i].getOutputPin()));
+    }
+#endif
+    for (uint8_t i = 0; i < _headCount; i++) {
+        edges[i] = headEdges[i];
+    }
+    interrupts();
+    
+    for (uint8_t i = 0; i < _headCount; i++) {
+        _edges[i] = edges[i].count;
+        if (edges[i].count < 2 || _scalingPercent == 0) {
+            widths[i] = 0;
+            continue;
+        }
+        
+        // Half the mean period, as the head would show it at 20% scaling
+        unsigned long span = (edges[i].last - edges[i].first) * _scalingPercent;
+        unsigned long divisor = 2UL * 20 * (edges[i].count - 1);
+        widths[i] = (span + divisor / 2) / divisor;
+    }
+}
+
+void ColorSensorArray::readRawValues(int* red, int* green, int* blue) {
+    readChannel(ColorSensor::CHANNEL_RED, red);
+    readChannel(ColorSensor::CHANNEL_GREEN, green);
+    readChannel(ColorSensor::CHANNEL_BLUE, blue);
+}
+
+void ColorSensorArray::readRGB(int* red, int* green, int* blue) {
+    int rawRed[MAX_HEADS];
+    int rawGreen[MAX_HEADS];
+    int rawBlue[MAX_HEADS];
+    readRawValues(rawRed, rawGreen, rawBlue);
+    
+    // Every head maps through its own calibration
+    for (uint8_t i = 0; i < _headCount; i++) {
+        _heads[i].convertToRGB(rawRed[i], rawGreen[i], rawBlue[i], red[i], green[i], blue[i]);
+    }
+}
+
+void ColorSensorArray::detectColors(ColorIdentifier* colors) {
+    int red[MAX_HEADS];
+    int green[MAX_HEADS];
+    int blue[MAX_HEADS];
+    readRGB(red, green, blue);
+    
+    for (uint8_t i = 0; i < _headCount; i++) {
+        colors[i] = _heads[i].classifyColor(red[i], green[i], blue[i]);
+    }
+}
+
+void ColorSensorArray::setGateTime(unsigned long gateTime) {
+    _gateTime = gateTime;
+}
+
+uint16_t ColorSensorArray::getLastEdgeCount(uint8_t head) const {
+    return head < MAX_HEADS ? _edges[head] : 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file ColorSensorArray.h
+ * @brief Several TCS230 heads read at once by counting output edges
+ * @author catalina
+ */
+
+#ifndef COLOR_SENSOR_ARRAY_H
+#define COLOR_SENSOR_ARRAY_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+#include "../ColorSensor/ColorSensor.h"
+#include "../Profiler/Profiler.h"
+
+/**
+ * @class ColorSensorArray
+ * @brief Reads up to MAX_HEADS TCS230 heads that share S0-S3 in one pass
+ * 
+ * The heads are ColorSensor objects with the same select pins and their
+ * own OUT pins; each keeps its own calibration. Instead of one pulseIn()
+ * per head and channel, the array selects a filter once for all heads and
+ * opens a gate of COLOR_GATE_TIME. During the gate an interrupt times the
+ * rising edges on every OUT pin: pin-change interrupts on the AVR, so any
+ * pin works, and an external interrupt per pin on the host. The period is
+ * the time from the first to the last edge divided by the edges between
+ * them, so a handful of edges already gives the full resolution of
+ * micros().
+ * 
+ * Readings come back in the unit ColorSensor uses, the LOW time in µs at
+ * 20% scaling, whatever scaling the array runs at, so the existing
+ * calibration and classification apply unchanged. A head that sees fewer
+ * than two edges in a gate reads 0, like a pulseIn() timeout.
+ * 
+ * The default 2% scaling keeps a bright surface below about 2 kHz per
+ * head, which the pin-change handler follows on four heads at 16 MHz; at
+ * 20% it would miss edges. On the AVR the array owns the PCINT0-2
+ * vectors, so it cannot be combined with another library that does,
+ * such as SoftwareSerial.
+ */
+class ColorSensorArray {
+public:
+    /**
+     * @brief Constructor
+     * 
+     * @param heads Heads sharing the select pins (not owned, headCount entries)
+     * @param headCount Number of heads (at most MAX_HEADS)
+     */
+    ColorSensorArray(ColorSensor* heads, uint8_t headCount);
+    
+    /**
+     * @brief Initialize the heads and arm the edge interrupts
+     * @param frequencyScaling Output frequency scaling (ColorSensor::FREQUENCY_SCALING_*)
+     */
+    void begin(uint8_t frequencyScaling = ColorSensor::FREQUENCY_SCALING_2);
+    
+    /**
+     * @brief Measure one channel on every head at once
+     * 
+     * @param channel Channel to read (ColorSensor::CHANNEL_*)
+     * @param widths Pulse widths in µs at 20% scaling, one per head (0 = no output)
+     */
+    void readChannel(uint8_t channel, int* widths);
+    
+    /**
+     * @brief Read raw pulse widths of every head
+     * 
+     * One gate per channel; the filter is switched between gates only.
+     * 
+     * @param red Red pulse widths, one per head
+     * @param green Green pulse widths, one per head
+     * @param blue Blue pulse widths, one per head
+     */
+    void readRawValues(int* red, int* green, int* blue);
+    
+    /**
+     * @brief Read calibrated RGB values (0-255) of every head
+     * 
+     * @param red Red values, one per head
+     * @param green Green values, one per head
+     * @param blue Blue values, one per head
+     */
+    void readRGB(int* red, int* green, int* blue);
+    
+    /**
+     * @brief Detect the dominant color under every head
+     * @param colors Detected colors, one per head
+     */
+    void detectColors(ColorIdentifier* colors);
+    
+    /**
+     * @brief Set the time edges are counted for each channel
+     * @param gateTime Gate time in ms
+     */
+    void setGateTime(unsigned long gateTime);
+    
+    /**
+     * @brief Get the number of heads
+     */
+    uint8_t getHeadCount() const { return _headCount; }
+    
+    /**
+     * @brief Get the edges the last gate counted on a head
+     * @param head Head index
+     */
+    uint16_t getLastEdgeCount(uint8_t head) const;
+    
+    // Most heads one array reads
+    static const uint8_t MAX_HEADS = 4;
+    
+private:
+    ColorSensor* _heads;
+    uint8_t _headCount;
+    uint8_t _scalingPercent;
+    unsigned long _gateTime;
+    uint16_t _edges[MAX_HEADS];
+};
+
+#endif // COLOR_SENSOR_ARRAY_H
@@ -7,6 +7,8 @@
 #ifndef PITCHES_DEFINITIONS_H
 #define PITCHES_DEFINITIONS_H
 
+#include <stdint.h>
+
 namespace Notes {
     // Octave 0
     constexpr uint16_t NOTE_B0 = 31;
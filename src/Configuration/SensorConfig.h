@@ -7,6 +7,8 @@
 #ifndef SENSOR_CONFIG_H
 #define SENSOR_CONFIG_H
 
+#include <stdint.h>
+
 // Pin configuration
 namespace PinConfig {
     // Color sensor pins
@@ -45,6 +47,11 @@ namespace CalibrationSettings {
         constexpr int GREEN_MAX = 214;
         constexpr int BLUE_MIN = 25;
         constexpr int BLUE_MAX = 170;
+        
+        // Quantile calibration (ColorSensor::runQuantileCalibration)
+        constexpr float QUANTILE_TAIL = 0.02; // Fraction of readings ignored at each end of a range
+        constexpr uint8_t QUANTILE_CONFIDENCE = 90; // Confidence (0-100) that ends calibration early
+        constexpr unsigned int QUANTILE_INTERVAL = 20; // ms between readings
     }
 }
 
@@ -52,6 +59,13 @@ namespace CalibrationSettings {
 namespace SystemSettings {
     // Distance thresholds
     constexpr float PROXIMITY_THRESHOLD = 10.0; // cm
+    constexpr float PROXIMITY_EXIT_THRESHOLD = 12.0; // cm; an object leaves only beyond this
+    constexpr uint8_t PROXIMITY_DEBOUNCE = 2; // Consecutive readings to confirm arrival or departure
+    
+    // Motion tracking (alpha-beta filter on the distance stream)
+    constexpr float TRACKER_ALPHA = 0.5; // Distance correction gain
+    constexpr float TRACKER_BETA = 0.15; // Velocity correction gain
+    constexpr float TRACKER_GATE = 30.0; // cm; a larger prediction error restarts the track
     
     // Sensor reading delays
     constexpr unsigned int SENSOR_STABILIZATION_DELAY = 200; // ms
@@ -59,6 +73,43 @@ namespace SystemSettings {
     
     // Color detection thresholds
     constexpr int COLOR_DETECTION_THRESHOLD = 20; // Minimum RGB difference for color detection
+    constexpr uint8_t COLOR_DEBOUNCE = 2; // Consecutive samples before a new color is shown
+    
+    // Sequential color sampling (ColorSensor::detectColorSequential)
+    constexpr float COLOR_CONFIDENCE = 3.0; // Standard errors between the means and a decision boundary
+    constexpr uint8_t COLOR_MAX_SAMPLES = 12; // Readings before an ambiguous color is given up on
+    
+    // Multi-head edge counting (ColorSensorArray)
+    constexpr unsigned long COLOR_GATE_TIME = 20; // ms edges are counted per channel
+}
+
+// Power management (PowerManager)
+namespace PowerSettings {
+    // Standby while nothing is in range
+    constexpr unsigned long STANDBY_DELAY = 5000; // ms without an object before peripherals power down
+    constexpr unsigned long STANDBY_PERIOD = 500; // ms between distance readings in standby
+    constexpr float STANDBY_RANGE = 50.0; // cm; any reading closer keeps the peripherals powered
+    
+    // Typical supply currents at 5 V for the duty-cycle estimate, in mA
+    constexpr float MCU_ACTIVE_CURRENT = 12.0; // ATmega328P at 16 MHz
+    constexpr float MCU_IDLE_CURRENT = 3.5; // Idle sleep, timers running
+    constexpr float MCU_POWER_DOWN_CURRENT = 0.006; // Power-down with the watchdog running
+    constexpr float COLOR_SENSOR_CURRENT = 2.0; // TCS230 unless powered down
+    constexpr float BACKLIGHT_CURRENT = 20.0; // LCD backlight LED
+    constexpr float BASE_CURRENT = 3.0; // HC-SR04 and LCD controller, always powered
+}
+
+// Overload detection and load shedding (LoadMonitor)
+namespace LoadSettings {
+    constexpr unsigned long WINDOW = 500; // ms over which the worst task lateness is taken
+    constexpr unsigned long OVERLOAD_LATENESS = 100; // ms; a later task start overloads the window
+    constexpr uint8_t OVERLOAD_WINDOWS = 2; // Overloaded windows in a row before one more level is shed
+    constexpr uint8_t RECOVERY_WINDOWS = 6; // Calm windows before one level is restored
+    constexpr uint8_t MAX_RECOVERY_WINDOWS = 96; // Limit of the doubling after each relapse
+    
+    // Degraded rates
+    constexpr uint8_t DISPLAY_SLOWDOWN = 4; // Display refresh period multiplier
+    constexpr uint8_t COLOR_SLOWDOWN = 4; // Color channel interval multiplier
 }
 
 // Color definitions
@@ -22,6 +22,7 @@ void DisplayManager::begin(bool turnBacklightOn) {
 }
 
 void DisplayManager::clear() {
+    PROFILE_STAGE(DISPLAY_RENDER);
     _lcd.clear();
 }
 
@@ -34,39 +35,43 @@ void DisplayManager::setBacklight(bool on) {
 }
 
 void DisplayManager::displayMessage(const String& message, uint8_t row, bool alignCenter) {
-    if (row >= _rows) {
-        return; // Row out of range
-    }
+    PROFILE_STAGE(DISPLAY_RENDER);
     
-    _lcd.setCursor(0, row);
-    
-    // Clear the row first
-    for (int i = 0; i < _columns; i++) {
-        _lcd.print(" ");
+    if (startRow(row, message.length(), alignCenter)) {
+        _lcd.print(message);
     }
+}
+
+void DisplayManager::displayMessage(const __FlashStringHelper* message, uint8_t row, bool alignCenter) {
+    PROFILE_STAGE(DISPLAY_RENDER);
     
-    // Calculate position for center alignment
-    int startPos = 0;
-    if (alignCenter && message.length() < _columns) {
-        startPos = (_columns - message.length()) / 2;
+    if (startRow(row, strlen_P(reinterpret_cast<PGM_P>(message)), alignCenter)) {
+        _lcd.print(message);
     }
+}
+
+void DisplayManager::displayMessage(const char* message, uint8_t row, bool alignCenter) {
+    PROFILE_STAGE(DISPLAY_RENDER);
     
-    // Display the message
-    _lcd.setCursor(startPos, row);
-    _lcd.print(message);
+    if (startRow(row, strlen(message), alignCenter)) {
+        _lcd.print(message);
+    }
+}
+
+void DisplayManager::displayMessage(TextId text, uint8_t row, bool alignCenter) {
+    displayMessage(TextTable::get(text), row, alignCenter);
 }
 
 void DisplayManager::displayDistance(float distance, const String& unit) {
-    // Format: "Distance: XX.X cm"
+    // Format: "Distance:" above "XX.X cm"
     String distanceStr = String(distance, 1); // One decimal place
-    String message = "Distance: " + distanceStr + " " + unit;
     
-    displayMessage("Distance:", 0);
+    displayMessage(TextId::DISTANCE_LABEL, 0);
     displayMessage(distanceStr + " " + unit, 1, true);
 }
 
 void DisplayManager::displayColor(const String& colorName, const String& rgbValues) {
-    displayMessage("Color detected:", 0);
+    displayMessage(TextId::COLOR_DETECTED, 0);
     displayMessage(colorName, 1, true);
     
     // If RGB values are provided and we have more than 2 rows
@@ -75,6 +80,16 @@ void DisplayManager::displayColor(const String& colorName, const String& rgbValu
     }
 }
 
+void DisplayManager::displayColor(const __FlashStringHelper* colorName, const char* rgbValues) {
+    displayMessage(TextId::COLOR_DETECTED, 0);
+    displayMessage(colorName, 1, true);
+    
+    // If RGB values are provided and we have more than 2 rows
+    if (_rows > 2 && rgbValues != nullptr && rgbValues[0] != '\0') {
+        displayMessage(rgbValues, 2, true);
+    }
+}
+
 void DisplayManager::displayLabelValue(const String& label, const String& value, uint8_t row) {
     String message = label + ": " + value;
     
@@ -85,3 +100,25 @@ void DisplayManager::displayLabelValue(const String& label, const String& value,
     
     displayMessage(message, row);
 }
+
+bool DisplayManager::startRow(uint8_t row, unsigned int length, bool alignCenter) {
+    if (row >= _rows) {
+        return false; // Row out of range
+    }
+    
+    _lcd.setCursor(0, row);
+    
+    // Clear the row first
+    for (int i = 0; i < _columns; i++) {
+        _lcd.print(' ');
+    }
+    
+    // Calculate position for center alignment
+    int startPos = 0;
+    if (alignCenter && length < _columns) {
+        startPos = (_columns - length) / 2;
+    }
+    
+    _lcd.setCursor(startPos, row);
+    return true;
+}
@@ -10,6 +10,8 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include "../Profiler/Profiler.h"
+#include "../TextTable/TextTable.h"
 
 /**
  * @class DisplayManager
@@ -55,6 +57,35 @@ public:
      */
     void displayMessage(const String& message, uint8_t row = 0, bool alignCenter = false);
     
+    /**
+     * @brief Display a message kept in flash on the specified row
+     * 
+     * The message is streamed from flash to the LCD without a copy in SRAM.
+     * 
+     * @param message Message to display (an F() literal or TextTable::get())
+     * @param row Row number (0-based)
+     * @param alignCenter Whether to center-align the message
+     */
+    void displayMessage(const __FlashStringHelper* message, uint8_t row = 0, bool alignCenter = false);
+    
+    /**
+     * @brief Display a message held in a char buffer, without copying it
+     * 
+     * @param message Message to display
+     * @param row Row to display on (0-based)
+     * @param alignCenter Whether to center the text
+     */
+    void displayMessage(const char* message, uint8_t row = 0, bool alignCenter = false);
+    
+    /**
+     * @brief Display a text from the TextTable on the specified row
+     * 
+     * @param text Text id
+     * @param row Row number (0-based)
+     * @param alignCenter Whether to center-align the message
+     */
+    void displayMessage(TextId text, uint8_t row = 0, bool alignCenter = false);
+    
     /**
      * @brief Display distance measurement
      * 
@@ -71,6 +102,14 @@ public:
      */
     void displayColor(const String& colorName, const String& rgbValues = "");
     
+    /**
+     * @brief Display color detection result with a name kept in flash
+     * 
+     * @param colorName Color name (see ColorSensor::getColorName())
+     * @param rgbValues Optional RGB values, shown on displays with more than 2 rows
+     */
+    void displayColor(const __FlashStringHelper* colorName, const char* rgbValues = nullptr);
+    
     /**
      * @brief Print formatted value with label
      * 
@@ -80,10 +119,18 @@ public:
      */
     void displayLabelValue(const String& label, const String& value, uint8_t row = 0);
     
+    /**
+     * @brief Get the number of rows of the display
+     */
+    uint8_t getRows() const { return _rows; }
+    
 private:
     LiquidCrystal_I2C _lcd;
     uint8_t _columns;
     uint8_t _rows;
+    
+    // Helper methods
+    bool startRow(uint8_t row, unsigned int length, bool alignCenter);
 };
 
 #endif // DISPLAY_MANAGER_H
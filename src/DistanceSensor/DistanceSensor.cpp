@@ -6,10 +6,43 @@
 
 #include "DistanceSensor.h"
 
+namespace {
+    // Echo edges timed by the interrupt; one ping is in flight at a time.
+    // Only the interrupt touches the rising edge state; the widths of
+    // completed pulses reach the main loop through the ring.
+    struct EchoCapture {
+        uint8_t pin;
+        bool high;
+        unsigned long rise;
+        SpscRing<unsigned long, 4> pulses;
+    };
+    
+    // On the host every simulated device thread times its own echo
+#ifdef ARDUINO
+    EchoCapture echoCapture;
+#else
+    thread_local EchoCapture echoCapture;
+#endif
+    
+    void onEchoChange() {
+        unsigned long now = micros();
+        if (digitalRead(echoCapture.pin) == HIGH) {
+            echoCapture.rise = now;
+            echoCapture.high = true;
+        } else if (echoCapture.high) {
+            echoCapture.pulses.push(now - echoCapture.rise);
+            echoCapture.high = false;
+        }
+    }
+}
+
 DistanceSensor::DistanceSensor(uint8_t trigPin, uint8_t echoPin)
     : _trigPin(trigPin),
       _echoPin(echoPin),
-      _speedOfSound(0.0343) { // Default speed of sound in cm/µs at 20°C
+      _speedOfSound(0.0343), // Default speed of sound in cm/µs at 20°C
+      _lastPulseDuration(0),
+      _pingActive(false),
+      _pingTime(0) {
 }
 
 void DistanceSensor::begin() {
@@ -42,16 +75,7 @@ float DistanceSensor::getDistance(DistanceUnit unit, uint8_t samples) {
     // Calculate average
     float averageDistanceCm = totalDistance / samples;
     
-    // Convert to requested unit
-    switch (unit) {
-        case INCHES:
-            return averageDistanceCm / 2.54;
-        case MILLIMETERS:
-            return averageDistanceCm * 10.0;
-        case CENTIMETERS:
-        default:
-            return averageDistanceCm;
-    }
+    return convertDistance(averageDistanceCm, unit);
 }
 
 bool DistanceSensor::isObjectDetected(float threshold) {
@@ -69,7 +93,68 @@ void DistanceSensor::calibrateForTemperature(float temperatureC) {
     _speedOfSound = (331.3 + 0.606 * temperatureC) / 10000.0;
 }
 
+unsigned long DistanceSensor::getLastPulseDuration() const {
+    return _lastPulseDuration;
+}
+
+bool DistanceSensor::startPing() {
+    if (_pingActive) {
+        return false;
+    }
+    
+    // Arm the echo interrupt before the burst goes out
+    echoCapture.pin = _echoPin;
+    echoCapture.high = false;
+    echoCapture.pulses.clear();
+    attachInterrupt(digitalPinToInterrupt(_echoPin), onEchoChange, CHANGE);
+    
+    _pingActive = true;
+    _pingTime = micros();
+    triggerPing();
+    return true;
+}
+
+bool DistanceSensor::isPingComplete() const {
+    return _pingActive && (!echoCapture.pulses.isEmpty() || micros() - _pingTime > PING_TIMEOUT);
+}
+
+bool DistanceSensor::isPingActive() const {
+    return _pingActive;
+}
+
+float DistanceSensor::finishPing(DistanceUnit unit) {
+    detachInterrupt(digitalPinToInterrupt(_echoPin));
+    _pingActive = false;
+    
+    // The first pulse is the echo; later ones are reflections of it
+    unsigned long width;
+    return recordPulse(echoCapture.pulses.pop(width) ? width : 0, unit);
+}
+
+float DistanceSensor::recordPulse(unsigned long pulseDuration, DistanceUnit unit) {
+    _lastPulseDuration = pulseDuration;
+    TRACE_SAMPLE(ECHO, _lastPulseDuration);
+    
+    return convertDistance(_lastPulseDuration * _speedOfSound / 2.0, unit);
+}
+
+unsigned long DistanceSensor::getPingTime() const {
+    return _pingTime;
+}
+
 float DistanceSensor::measurePulseDuration() {
+    PROFILE_STAGE(DISTANCE_ACQUIRE);
+    
+    triggerPing();
+    
+    // Read the echo pin - pulse duration in microseconds
+    _lastPulseDuration = pulseIn(_echoPin, HIGH);
+    TRACE_SAMPLE(ECHO, _lastPulseDuration);
+    
+    return _lastPulseDuration;
+}
+
+void DistanceSensor::triggerPing() {
     // Clear the trigger pin
     digitalWrite(_trigPin, LOW);
     delayMicroseconds(2);
@@ -78,9 +163,16 @@ float DistanceSensor::measurePulseDuration() {
     digitalWrite(_trigPin, HIGH);
     delayMicroseconds(10);
     digitalWrite(_trigPin, LOW);
-    
-    // Read the echo pin - pulse duration in microseconds
-    float duration = pulseIn(_echoPin, HIGH);
-    
-    return duration;
+}
+
+float DistanceSensor::convertDistance(float distanceCm, DistanceUnit unit) const {
+    switch (unit) {
+        case INCHES:
+            return distanceCm / 2.54;
+        case MILLIMETERS:
+            return distanceCm * 10.0;
+        case CENTIMETERS:
+        default:
+            return distanceCm;
+    }
 }
@@ -9,6 +9,9 @@
 
 #include <Arduino.h>
 #include "../Configuration/SensorConfig.h"
+#include "../Profiler/Profiler.h"
+#include "../SensorTrace/SensorTrace.h"
+#include "../SpscRing/SpscRing.h"
 
 /**
  * @class DistanceSensor
@@ -19,6 +22,13 @@
  */
 class DistanceSensor {
 public:
+    // Distance units
+    enum DistanceUnit {
+        CENTIMETERS,
+        INCHES,
+        MILLIMETERS
+    };
+    
     /**
      * @brief Constructor with optional pin configuration
      * 
@@ -66,12 +76,76 @@ public:
      */
     void calibrateForTemperature(float temperatureC);
     
-    // Distance units
-    enum DistanceUnit {
-        CENTIMETERS,
-        INCHES,
-        MILLIMETERS
-    };
+    /**
+     * @brief Get the echo pulse width of the most recent ping
+     * 
+     * @return Pulse width in microseconds (0 if no ping was made yet)
+     */
+    unsigned long getLastPulseDuration() const;
+    
+    /**
+     * @brief Trigger a ping without waiting for the echo
+     * 
+     * The echo is timed by a pin change interrupt, so the echo pin must be
+     * interrupt capable (pin 2 or 3 on an Uno). The interrupt publishes
+     * each echo pulse into a lock-free ring; poll isPingComplete() and
+     * collect the result with finishPing(); other work can run meanwhile.
+     * 
+     * @return true if the ping was sent, false if one is still in flight
+     */
+    bool startPing();
+    
+    /**
+     * @brief Check whether the echo of the current ping has ended
+     * 
+     * @return true once the echo has ended or PING_TIMEOUT has passed
+     */
+    bool isPingComplete() const;
+    
+    /**
+     * @brief Check whether a ping is waiting to be collected
+     */
+    bool isPingActive() const;
+    
+    /**
+     * @brief Collect the result of a completed ping
+     * 
+     * @param unit Distance unit (default: centimeters)
+     * @return Distance in the specified unit, 0 if no echo was timed
+     */
+    float finishPing(DistanceUnit unit = CENTIMETERS);
+    
+    /**
+     * @brief Get the trigger time of the most recent non-blocking ping
+     * 
+     * @return micros() at the trigger
+     */
+    unsigned long getPingTime() const;
+    
+    /**
+     * @brief Send the trigger pulse without timing the echo
+     * 
+     * For callers that time the echo on getEchoPin() themselves and hand
+     * the width to recordPulse().
+     */
+    void triggerPing();
+    
+    /**
+     * @brief Take an echo pulse timed elsewhere as the latest reading
+     * 
+     * @param pulseDuration Echo pulse width in microseconds (0 = no echo)
+     * @param unit Distance unit (default: centimeters)
+     * @return Distance in the specified unit, 0 without an echo
+     */
+    float recordPulse(unsigned long pulseDuration, DistanceUnit unit = CENTIMETERS);
+    
+    /**
+     * @brief Get the pin the echo is read on
+     */
+    uint8_t getEchoPin() const { return _echoPin; }
+    
+    // Longest a non-blocking ping may take (the HC-SR04 gives up after ~38 ms)
+    static const unsigned long PING_TIMEOUT = 40000; // µs
     
 private:
     // Pin configuration
@@ -81,8 +155,16 @@ private:
     // Settings
     float _speedOfSound; // in cm/µs
     
+    // Last raw reading
+    unsigned long _lastPulseDuration;
+    
+    // Non-blocking ping state
+    bool _pingActive;
+    unsigned long _pingTime;
+    
     // Helper methods
     float measurePulseDuration();
+    float convertDistance(float distanceCm, DistanceUnit unit) const;
 };
 
 #endif // DISTANCE_SENSOR_H
@@ -9,43 +9,58 @@
 LedManager::LedManager(uint8_t redPin, uint8_t greenPin, uint8_t yellowPin)
     : _redPin(redPin),
       _greenPin(greenPin),
-      _yellowPin(yellowPin) {
+      _yellowPin(yellowPin),
+      _effect(EFFECT_NONE),
+      _effectPin(0),
+      _effectCount(0),
+      _effectOnTime(0),
+      _effectPeriod(0),
+      _effectStart(0),
+      _effectLevel(-1),
+      _effectsEnabled(true) {
 }
 
 void LedManager::begin() {
-    pinMode(_redPin, OUTPUT);
-    pinMode(_greenPin, OUTPUT);
-    pinMode(_yellowPin, OUTPUT);
+    SoftPwm::attach(_redPin);
+    SoftPwm::attach(_greenPin);
+    SoftPwm::attach(_yellowPin);
     
     // Ensure all LEDs are off at start
     allOff();
 }
 
 void LedManager::setLed(ColorIdentifier colorId, uint8_t brightness) {
+    PROFILE_STAGE(LED_RENDER);
+    
+    // A running blink or pulse would turn the LED off when it ends
+    stopEffect();
+    
     // Turn off all LEDs first
     allOff();
     
     // Set the specified LED
     uint8_t pin = getColorPin(colorId);
     if (pin != 0) {
-        analogWrite(pin, brightness);
+        SoftPwm::write(pin, brightness);
     }
 }
 
 void LedManager::allOff() {
-    analogWrite(_redPin, 0);
-    analogWrite(_greenPin, 0);
-    analogWrite(_yellowPin, 0);
+    SoftPwm::write(_redPin, 0);
+    SoftPwm::write(_greenPin, 0);
+    SoftPwm::write(_yellowPin, 0);
 }
 
 void LedManager::blinkLed(ColorIdentifier colorId, uint8_t count, uint16_t onTime, uint16_t offTime) {
+    PROFILE_STAGE(LED_RENDER);
+    
     uint8_t pin = getColorPin(colorId);
     if (pin == 0) return;
     
     for (int i = 0; i < count; i++) {
-        digitalWrite(pin, HIGH);
+        SoftPwm::write(pin, 255);
         delay(onTime);
-        digitalWrite(pin, LOW);
+        SoftPwm::write(pin, 0);
         
         // Don't delay after the last blink
         if (i < count - 1) {
@@ -55,23 +70,15 @@ void LedManager::blinkLed(ColorIdentifier colorId, uint8_t count, uint16_t onTim
 }
 
 void LedManager::pulseLed(ColorIdentifier colorId, uint8_t count, uint16_t duration) {
+    PROFILE_STAGE(LED_RENDER);
+    
     uint8_t pin = getColorPin(colorId);
     if (pin == 0) return;
     
-    uint16_t stepDuration = duration / 510; // 255 steps up, 255 steps down
-    
-    for (int i = 0; i < count; i++) {
-        // Fade in
-        for (int brightness = 0; brightness <= 255; brightness++) {
-            analogWrite(pin, brightness);
-            delay(stepDuration);
-        }
-        
-        // Fade out
-        for (int brightness = 255; brightness >= 0; brightness--) {
-            analogWrite(pin, brightness);
-            delay(stepDuration);
-        }
+    // The timer interrupt runs the fades; only the wait blocks
+    SoftPwm::pulse(pin, count, duration);
+    while (SoftPwm::isFading(pin)) {
+        delay(1);
     }
 }
 
@@ -81,6 +88,97 @@ void LedManager::showColorResult(ColorIdentifier colorId, uint16_t duration) {
     allOff();
 }
 
+void LedManager::startBlink(ColorIdentifier colorId, uint8_t count, uint16_t onTime, uint16_t offTime) {
+    stopEffect();
+    
+    uint8_t pin = getColorPin(colorId);
+    if (!_effectsEnabled || pin == 0 || count == 0) return;
+    
+    _effect = EFFECT_BLINK;
+    _effectPin = pin;
+    _effectCount = count;
+    _effectOnTime = onTime;
+    _effectPeriod = onTime + offTime;
+    _effectStart = millis();
+    _effectLevel = -1;
+    update();
+}
+
+void LedManager::startPulse(ColorIdentifier colorId, uint8_t count, uint16_t duration) {
+    stopEffect();
+    
+    uint8_t pin = getColorPin(colorId);
+    if (!_effectsEnabled || pin == 0 || count == 0 || duration == 0) return;
+    
+    _effect = EFFECT_PULSE;
+    _effectPin = pin;
+    SoftPwm::pulse(pin, count, duration);
+}
+
+bool LedManager::update() {
+    PROFILE_STAGE(LED_RENDER);
+    
+    if (_effect == EFFECT_NONE) {
+        return false;
+    }
+    
+    // Pulses fade in the timer interrupt; only their end is polled
+    if (_effect == EFFECT_PULSE) {
+        if (!SoftPwm::isFading(_effectPin)) {
+            stopEffect();
+            return false;
+        }
+        return true;
+    }
+    
+    unsigned long elapsed = millis() - _effectStart;
+    
+    // The last blink ends without the trailing off time
+    unsigned long total = (unsigned long)_effectPeriod * _effectCount;
+    total -= _effectPeriod - _effectOnTime;
+    
+    if (elapsed >= total) {
+        stopEffect();
+        return false;
+    }
+    
+    // On for the first part of every blink period
+    unsigned long position = elapsed % _effectPeriod;
+    int16_t level = position < _effectOnTime ? 255 : 0;
+    
+    // Only touch the pin when the level actually changes
+    if (level != _effectLevel) {
+        _effectLevel = level;
+        SoftPwm::write(_effectPin, level);
+    }
+    
+    return true;
+}
+
+void LedManager::stopEffect() {
+    if (_effect != EFFECT_NONE) {
+        SoftPwm::write(_effectPin, 0);
+    }
+    
+    _effect = EFFECT_NONE;
+    _effectLevel = -1;
+}
+
+bool LedManager::isEffectActive() const {
+    return _effect != EFFECT_NONE;
+}
+
+bool LedManager::isModulating() const {
+    return SoftPwm::isActive();
+}
+
+void LedManager::setEffectsEnabled(bool enabled) {
+    _effectsEnabled = enabled;
+    if (!enabled) {
+        stopEffect();
+    }
+}
+
 uint8_t LedManager::getColorPin(ColorIdentifier colorId) {
     switch (colorId) {
         case ColorIdentifier::RED:
@@ -9,13 +9,17 @@
 
 #include <Arduino.h>
 #include "../Configuration/SensorConfig.h"
+#include "../Profiler/Profiler.h"
+#include "../SoftPwm/SoftPwm.h"
 
 /**
  * @class LedManager
  * @brief Interface for controlling status LEDs
  * 
  * This class provides methods to control RGB LEDs for status indication
- * with various patterns and effects.
+ * with various patterns and effects. The LEDs are driven by SoftPwm, so
+ * every pin dims, whether or not it has hardware PWM, and pulses fade in
+ * the timer interrupt instead of the caller's loop.
  */
 class LedManager {
 public:
@@ -77,12 +81,91 @@ public:
      */
     void showColorResult(ColorIdentifier colorId, uint16_t duration = 2000);
     
+    /**
+     * @brief Start blinking an LED without blocking
+     * 
+     * The effect runs from update(); starting a new effect replaces the
+     * running one.
+     * 
+     * @param colorId Color identifier
+     * @param count Number of blinks
+     * @param onTime On time in milliseconds
+     * @param offTime Off time in milliseconds
+     */
+    void startBlink(ColorIdentifier colorId, uint8_t count = 1, uint16_t onTime = 200, uint16_t offTime = 200);
+    
+    /**
+     * @brief Start pulsing an LED (fade in/out) without blocking
+     * 
+     * @param colorId Color identifier
+     * @param count Number of pulses
+     * @param duration Duration of each pulse in milliseconds
+     */
+    void startPulse(ColorIdentifier colorId, uint8_t count = 1, uint16_t duration = 1000);
+    
+    /**
+     * @brief Advance the running LED effect
+     * 
+     * Call frequently from loop() or a scheduler task.
+     * 
+     * @return true while an effect is running
+     */
+    bool update();
+    
+    /**
+     * @brief Stop the running LED effect and turn its LED off
+     */
+    void stopEffect();
+    
+    /**
+     * @brief Check if a non-blocking effect is running
+     * @return true while an effect is running
+     */
+    bool isEffectActive() const;
+    
+    /**
+     * @brief Check if an LED is dimmed or fading
+     * 
+     * The soft PWM timer then has to keep running, which rules out
+     * power-down sleep.
+     * 
+     * @return true while the soft PWM timer runs
+     */
+    bool isModulating() const;
+    
+    /**
+     * @brief Allow or skip blinks and pulses
+     * 
+     * While disabled, startBlink() and startPulse() do nothing and the
+     * running effect stops; setLed() still shows steady colors.
+     * 
+     * @param enabled false to skip effects, for example under load
+     */
+    void setEffectsEnabled(bool enabled);
+    
 private:
+    // Non-blocking effect types
+    enum EffectType {
+        EFFECT_NONE,
+        EFFECT_BLINK,
+        EFFECT_PULSE
+    };
+    
     // Pin configuration
     uint8_t _redPin;
     uint8_t _greenPin;
     uint8_t _yellowPin;
     
+    // Non-blocking effect state
+    EffectType _effect;
+    uint8_t _effectPin;
+    uint8_t _effectCount;
+    uint16_t _effectOnTime;
+    uint16_t _effectPeriod;
+    unsigned long _effectStart;
+    int16_t _effectLevel;
+    bool _effectsEnabled;
+    
     // Helper methods
     uint8_t getColorPin(ColorIdentifier colorId);
 };
@@ -0,0 +1,149 @@
+/**
+ * @file LoadMonitor.cpp
+ * @brief Overload detection and stepwise load shedding implementation
+ * @author catalina
+ */
+
+#include "LoadMonitor.h"
+
+namespace {
+    const uint8_t LEVEL_COUNT = static_cast<uint8_t>(LoadLevel::LEVEL_COUNT);
+    
+    // Names in dump(), by level
+    const char NAME_NORMAL[] PROGMEM = "normal";
+    const char NAME_SLOW_DISPLAY[] PROGMEM = "slow-display";
+    const char NAME_NO_LED_EFFECTS[] PROGMEM = "no-led-effects";
+    const char NAME_BEEP_ONLY[] PROGMEM = "beep-only";
+    const char NAME_REDUCED_COLOR[] PROGMEM = "reduced-color";
+    
+    const char* const LEVEL_NAMES[] PROGMEM = {
+        NAME_NORMAL,
+        NAME_SLOW_DISPLAY,
+        NAME_NO_LED_EFFECTS,
+        NAME_BEEP_ONLY,
+        NAME_REDUCED_COLOR
+    };
+}
+
+LoadMonitor::LoadMonitor()
+    : _level(LoadLevel::NORMAL),
+      _levelCallback(nullptr),
+      _windowWorst(0),
+      _lastWorst(0),
+      _overloadWindows(0),
+      _calmWindows(0),
+      _recoveryWindows(LoadSettings::RECOVERY_WINDOWS),
+      _lastChangeDown(false),
+      _changes(0),
+      _levelSince(0) {
+    reset();
+}
+
+void LoadMonitor::begin() {
+    setLevel(LoadLevel::NORMAL);
+    _windowWorst = 0;
+    _lastWorst = 0;
+    _overloadWindows = 0;
+    _calmWindows = 0;
+    _recoveryWindows = LoadSettings::RECOVERY_WINDOWS;
+    _lastChangeDown = false;
+    reset();
+}
+
+void LoadMonitor::recordLateness(unsigned long lateness) {
+    if (lateness > _windowWorst) {
+        _windowWorst = lateness;
+    }
+}
+
+LoadLevel LoadMonitor::update() {
+    _lastWorst = _windowWorst;
+    _windowWorst = 0;
+    uint8_t level = static_cast<uint8_t>(_level);
+    
+    if (_lastWorst > LoadSettings::OVERLOAD_LATENESS) {
+        _calmWindows = 0;
+        if (++_overloadWindows < LoadSettings::OVERLOAD_WINDOWS) {
+            return _level;
+        }
+        _overloadWindows = 0;
+        if (level + 1 < LEVEL_COUNT) {
+            // Overloaded again right after a drop: wait longer next time
+            if (_lastChangeDown) {
+                _recoveryWindows = _recoveryWindows * 2 < LoadSettings::MAX_RECOVERY_WINDOWS
+                    ? _recoveryWindows * 2
+                    : LoadSettings::MAX_RECOVERY_WINDOWS;
+            }
+            _lastChangeDown = false;
+            setLevel(static_cast<LoadLevel>(level + 1));
+        }
+        return _level;
+    }
+    
+    _overloadWindows = 0;
+    if (level > 0 && ++_calmWindows >= _recoveryWindows) {
+        _calmWindows = 0;
+        setLevel(static_cast<LoadLevel>(level - 1));
+        
+        // Back at NORMAL the next overload is a new one, not a relapse
+        _lastChangeDown = _level != LoadLevel::NORMAL;
+        if (!_lastChangeDown) {
+            _recoveryWindows = LoadSettings::RECOVERY_WINDOWS;
+        }
+    }
+    
+    return _level;
+}
+
+unsigned long LoadMonitor::getTime(LoadLevel level) const {
+    uint8_t index = static_cast<uint8_t>(level);
+    if (index >= LEVEL_COUNT) {
+        return 0;
+    }
+    return level == _level ? _time[index] + (millis() - _levelSince) : _time[index];
+}
+
+void LoadMonitor::setLevelCallback(LevelCallback callback) {
+    _levelCallback = callback;
+}
+
+void LoadMonitor::dump(Print& out) const {
+    // Format: "level=L normal=A slow-display=B ... ms changes=C worst=W ms"
+    out.print(F("level="));
+    out.print(static_cast<uint8_t>(_level));
+    for (uint8_t i = 0; i < LEVEL_COUNT; i++) {
+        out.print(' ');
+        out.print(reinterpret_cast<const __FlashStringHelper*>(pgm_read_ptr(&LEVEL_NAMES[i])));
+        out.print('=');
+        out.print(getTime(static_cast<LoadLevel>(i)));
+    }
+    out.print(F(" ms changes="));
+    out.print(_changes);
+    out.print(F(" worst="));
+    out.print(_lastWorst);
+    out.println(F(" ms"));
+}
+
+void LoadMonitor::reset() {
+    for (uint8_t i = 0; i < LEVEL_COUNT; i++) {
+        _time[i] = 0;
+    }
+    _changes = 0;
+    _levelSince = millis();
+}
+
+void LoadMonitor::setLevel(LoadLevel level) {
+    if (level == _level) {
+        return;
+    }
+    
+    unsigned long now = millis();
+    _time[static_cast<uint8_t>(_level)] += now - _levelSince;
+    _levelSince = now;
+    _level = level;
+    _changes++;
+    
+    if (_levelCallback != nullptr) {
+        _levelCallback(level);
+    }
+}
@@ -0,0 +1,131 @@
+/**
+ * @file LoadMonitor.h
+ * @brief Overload detection and stepwise load shedding
+ * @author catalina
+ */
+
+#ifndef LOAD_MONITOR_H
+#define LOAD_MONITOR_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+
+// Degradation levels; each one keeps the shedding of the levels below it
+enum class LoadLevel : uint8_t {
+    NORMAL = 0,
+    SLOW_DISPLAY,       // Display refreshed less often
+    NO_LED_EFFECTS,     // LED blinks and pulses skipped, steady LEDs kept
+    BEEP_ONLY,          // Melodies cut to their first note
+    REDUCED_COLOR,      // Color channels captured less often
+    LEVEL_COUNT
+};
+
+/**
+ * @class LoadMonitor
+ * @brief Watches how late scheduled tasks start and sheds optional work
+ * 
+ * The sketch reports the lateness of every task start (from
+ * Scheduler::getLastLateness()) and calls update() once per
+ * LoadSettings::WINDOW. A window whose latest start exceeds
+ * OVERLOAD_LATENESS is overloaded; OVERLOAD_WINDOWS of them in a row raise
+ * the level by one, so a single slow step (a startup burst, one long
+ * display refresh) sheds nothing. After RECOVERY_WINDOWS calm
+ * windows in a row the level drops by one. If a window overloads again
+ * right after a drop, the calm windows needed are doubled (up to
+ * MAX_RECOVERY_WINDOWS), so a load that comes back as soon as it is
+ * allowed settles on the level that carries it instead of oscillating;
+ * back at NORMAL the requirement starts over.
+ * 
+ * The monitor only decides. The level callback applies a level to the
+ * drivers and the scheduler, and must undo the levels above it.
+ */
+class LoadMonitor {
+public:
+    // Level callback: the new level
+    typedef void (*LevelCallback)(LoadLevel level);
+    
+    /**
+     * @brief Constructor
+     */
+    LoadMonitor();
+    
+    /**
+     * @brief Start at NORMAL and account time from now
+     */
+    void begin();
+    
+    /**
+     * @brief Record how late a task started
+     * @param lateness Time in ms between the task release and its start
+     */
+    void recordLateness(unsigned long lateness);
+    
+    /**
+     * @brief Close the current window and change the level if needed
+     * 
+     * Call once per LoadSettings::WINDOW, for example from a scheduler task.
+     * 
+     * @return Level after the window
+     */
+    LoadLevel update();
+    
+    /**
+     * @brief Get the current level
+     */
+    LoadLevel getLevel() const { return _level; }
+    
+    /**
+     * @brief Get the latest task start of the last closed window
+     * @return Lateness in ms
+     */
+    unsigned long getLastWorst() const { return _lastWorst; }
+    
+    /**
+     * @brief Get the time spent at a level since begin() or reset()
+     * @param level Load level
+     * @return Time in ms
+     */
+    unsigned long getTime(LoadLevel level) const;
+    
+    /**
+     * @brief Get the number of level changes since begin() or reset()
+     */
+    uint16_t getChangeCount() const { return _changes; }
+    
+    /**
+     * @brief Set the function called on every level change
+     * @param callback Level callback (nullptr to disable)
+     */
+    void setLevelCallback(LevelCallback callback);
+    
+    /**
+     * @brief Print the current level and the time at each level
+     * @param out Output stream
+     */
+    void dump(Print& out) const;
+    
+    /**
+     * @brief Clear the accounted times and the change count
+     */
+    void reset();
+    
+private:
+    LoadLevel _level;
+    LevelCallback _levelCallback;
+    
+    unsigned long _windowWorst;     // ms, latest start in the open window
+    unsigned long _lastWorst;       // ms, latest start in the last closed window
+    uint8_t _overloadWindows;       // Overloaded windows in a row
+    uint8_t _calmWindows;           // Calm windows in a row
+    uint8_t _recoveryWindows;       // Calm windows needed for the next drop
+    bool _lastChangeDown;           // The last change restored a level
+    uint16_t _changes;
+    
+    unsigned long _time[static_cast<uint8_t>(LoadLevel::LEVEL_COUNT)];  // ms, up to _levelSince
+    unsigned long _levelSince;      // millis() when the current level began
+    
+    // Helper methods
+    void setLevel(LoadLevel level);
+};
+
+#endif // LOAD_MONITOR_H
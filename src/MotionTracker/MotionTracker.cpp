@@ -0,0 +1,111 @@
+/**
+ * @file MotionTracker.cpp
+ * @brief Fixed-point alpha-beta tracker implementation
+ * @author catalina
+ */
+
+#include "MotionTracker.h"
+
+namespace {
+    // Fixed-point scales
+    const int32_t UNIT = 256;                   // 1/256 mm per mm, 1/256 per gain
+    const uint8_t TIME_SHIFT = 10;              // Velocity per 1024 ms
+    
+    const int32_t POSITION_LIMIT = MotionTracker::MAX_DISTANCE * UNIT;
+    const int32_t VELOCITY_LIMIT = MotionTracker::MAX_SPEED * UNIT * 1024L / 1000;
+    const int32_t CLOSING_LIMIT = MotionTracker::MIN_CLOSING_SPEED * UNIT * 1024L / 1000;
+    
+    int32_t clamp32(int32_t value, int32_t limit) {
+        return value > limit ? limit : (value < -limit ? -limit : value);
+    }
+}
+
+MotionTracker::MotionTracker(float alpha, float beta, float gate)
+    : _alpha(toGain(alpha)),
+      _beta(toGain(beta)),
+      _gate(gate * 10.0 * UNIT),
+      _position(0),
+      _velocity(0),
+      _lastTime(0),
+      _samples(0),
+      _timeToCollision(NO_COLLISION) {
+}
+
+bool MotionTracker::update(float distance, unsigned long timestamp) {
+    if (distance <= 0) {
+        reset();
+        return false;
+    }
+    
+    int32_t measured = clamp32(distance * 10.0 * UNIT, POSITION_LIMIT);
+    unsigned long elapsed = timestamp - _lastTime;
+    if (_samples == 0 || elapsed > MAX_GAP) {
+        restart(measured, timestamp);
+        return false;
+    }
+    
+    // Predict: |velocity * elapsed| stays below 2^31 for elapsed <= MAX_GAP
+    int32_t predicted = _position + ((_velocity * (int32_t)elapsed) >> TIME_SHIFT);
+    int32_t residual = measured - predicted;
+    if (residual > _gate || residual < -_gate) {
+        restart(measured, timestamp);
+        return false;
+    }
+    
+    // Correct
+    _position = clamp32(predicted + ((residual * _alpha) >> 8), POSITION_LIMIT);
+    if (elapsed > 0) {
+        int32_t step = (residual * _beta) >> 8;
+        _velocity = clamp32(_velocity + (step << TIME_SHIFT) / (int32_t)elapsed, VELOCITY_LIMIT);
+    }
+    _lastTime = timestamp;
+    if (_samples < 2) {
+        _samples++;
+    }
+    
+    // Distance over closing speed, in ms
+    if (_velocity < -CLOSING_LIMIT && _position > 0) {
+        _timeToCollision = (_position << TIME_SHIFT) / -_velocity;
+    } else {
+        _timeToCollision = NO_COLLISION;
+    }
+    return true;
+}
+
+void MotionTracker::reset() {
+    _position = 0;
+    _velocity = 0;
+    _samples = 0;
+    _timeToCollision = NO_COLLISION;
+}
+
+bool MotionTracker::isTracking() const {
+    return _samples >= 2;
+}
+
+float MotionTracker::getDistance() const {
+    return _position / (10.0 * UNIT);
+}
+
+float MotionTracker::getVelocity() const {
+    return _velocity * (1000.0 / 1024.0) / (10.0 * UNIT);
+}
+
+unsigned long MotionTracker::getTimeToCollision() const {
+    if (!isTracking()) {
+        return NO_COLLISION;
+    }
+    return _timeToCollision;
+}
+
+void MotionTracker::restart(int32_t position, unsigned long timestamp) {
+    _position = position;
+    _velocity = 0;
+    _lastTime = timestamp;
+    _samples = 1;
+    _timeToCollision = NO_COLLISION;
+}
+
+uint16_t MotionTracker::toGain(float gain) {
+    return constrain(gain, 0.0, 1.0) * UNIT + 0.5;
+}
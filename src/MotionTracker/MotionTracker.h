@@ -0,0 +1,115 @@
+/**
+ * @file MotionTracker.h
+ * @brief Fixed-point velocity and time-to-collision estimate from distance readings
+ * @author catalina
+ */
+
+#ifndef MOTION_TRACKER_H
+#define MOTION_TRACKER_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+
+/**
+ * @class MotionTracker
+ * @brief Alpha-beta tracker on the distance stream
+ * 
+ * Every reading first predicts the distance from the previous estimate
+ * and velocity, then corrects both by fixed fractions (alpha, beta) of
+ * the prediction error. The state is two integers, and an update costs a
+ * few 32-bit multiplications and one division, so it fits in the time
+ * between two pings on an 8-bit MCU without floating point.
+ * 
+ * Internally distances are kept in 1/256 mm and velocities in 1/256 mm
+ * per 1024 ms, so the prediction step is a shift instead of a division
+ * by 1000. Readings that miss the prediction by more than the gate, no
+ * echo, or a gap longer than MAX_GAP restart the track at the new
+ * reading with zero velocity (a different object, or none).
+ * 
+ * Velocity is negative while the object approaches. The time to
+ * collision is the filtered distance divided by the closing speed, and
+ * is NO_COLLISION while the object is still, receding, or not tracked.
+ */
+class MotionTracker {
+public:
+    /**
+     * @brief Constructor
+     * 
+     * @param alpha Distance correction gain (0-1)
+     * @param beta Velocity correction gain (0-1, typically well below alpha)
+     * @param gate Prediction error in cm beyond which the track restarts
+     */
+    MotionTracker(
+        float alpha = SystemSettings::TRACKER_ALPHA,
+        float beta = SystemSettings::TRACKER_BETA,
+        float gate = SystemSettings::TRACKER_GATE
+    );
+    
+    /**
+     * @brief Process one distance reading
+     * 
+     * @param distance Distance in cm (0 = no echo)
+     * @param timestamp Time of the reading in ms
+     * @return true if the reading extended the track, false if it restarted or ended it
+     */
+    bool update(float distance, unsigned long timestamp);
+    
+    /**
+     * @brief Drop the track
+     */
+    void reset();
+    
+    /**
+     * @brief Check if enough readings have been tracked for a velocity
+     * @return true after two consecutive readings of the same object
+     */
+    bool isTracking() const;
+    
+    /**
+     * @brief Get the filtered distance
+     * @return Distance in cm (0 without a track)
+     */
+    float getDistance() const;
+    
+    /**
+     * @brief Get the estimated velocity
+     * @return Velocity in cm/s, negative while approaching
+     */
+    float getVelocity() const;
+    
+    /**
+     * @brief Get the estimated time until the object reaches the sensor
+     * @return Time in ms, or NO_COLLISION
+     */
+    unsigned long getTimeToCollision() const;
+    
+    // Time to collision while nothing approaches
+    static const unsigned long NO_COLLISION = 0xFFFFFFFFUL;
+    
+    // Longest gap between readings of one track in ms
+    static const unsigned long MAX_GAP = 1000;
+    
+    // Slowest approach that yields a time to collision in mm/s
+    static const int32_t MIN_CLOSING_SPEED = 20;
+    
+    // Limits that keep every intermediate within 32 bits
+    static const int32_t MAX_DISTANCE = 5000;   // mm
+    static const int32_t MAX_SPEED = 5000;      // mm/s
+    
+private:
+    uint16_t _alpha;            // Gains in 1/256
+    uint16_t _beta;
+    int32_t _gate;              // 1/256 mm
+    
+    int32_t _position;          // 1/256 mm
+    int32_t _velocity;          // 1/256 mm per 1024 ms
+    unsigned long _lastTime;
+    uint8_t _samples;           // Readings in the track (saturates at 2)
+    unsigned long _timeToCollision;
+    
+    // Helper methods
+    void restart(int32_t position, unsigned long timestamp);
+    static uint16_t toGain(float gain);
+};
+
+#endif // MOTION_TRACKER_H
@@ -0,0 +1,295 @@
+/**
+ * @file OutputStage.cpp
+ * @brief Change-driven display, LED and audio output implementation
+ * @author catalina
+ */
+
+#include "OutputStage.h"
+#include "../ColorSensor/ColorSensor.h"
+
+namespace {
+    // "R:255 G:255 B:255" and the terminator
+    const uint8_t RGB_TEXT_SIZE = 18;
+    
+    // Append a channel value (clamped to 0-255) in decimal
+    char* appendChannel(char* out, int value) {
+        uint8_t level = constrain(value, 0, 255);
+        if (level >= 100) {
+            *out++ = '0' + level / 100;
+        }
+        if (level >= 10) {
+            *out++ = '0' + level / 10 % 10;
+        }
+        *out++ = '0' + level % 10;
+        return out;
+    }
+}
+
+OutputStage::OutputStage(DisplayManager& display, LedManager& leds, AudioManager& audio, uint8_t colorDebounce)
+    : _display(display),
+      _leds(leds),
+      _audio(audio),
+      _melody(nullptr),
+      _durations(nullptr),
+      _noteCount(0),
+      _screen(),
+      _drawn(),
+      _bannerTop(TextId::TEXT_COUNT),
+      _bannerBottom(TextId::TEXT_COUNT),
+      _bannerPending(false),
+      _bannerHold(0),
+      _bannerEnd(0),
+      _bannerActive(false),
+      _ledColor(ColorIdentifier::NONE),
+      _ledOn(false),
+      _ledKnown(false),
+      _color(ColorIdentifier::NONE),
+      _colorPresented(false),
+      _rgb{ 0, 0, 0 },
+      _colorDebounce(max(colorDebounce, (uint8_t)1)),
+      _candidate(ColorIdentifier::NONE),
+      _candidateCount(0),
+      _applied(),
+      _suppressed() {
+}
+
+void OutputStage::setDetectionMelody(const uint16_t* melody, const uint8_t* durations, uint8_t noteCount) {
+    _melody = melody;
+    _durations = durations;
+    _noteCount = noteCount;
+}
+
+void OutputStage::showMessage(TextId top, TextId bottom) {
+    Screen screen = { SCREEN_MESSAGE, top, bottom, 0, ColorIdentifier::NONE };
+    setScreen(screen);
+}
+
+void OutputStage::showBanner(TextId top, TextId bottom, unsigned long holdTime) {
+    _bannerTop = top;
+    _bannerBottom = bottom;
+    _bannerPending = true;
+    _bannerHold = holdTime;
+}
+
+void OutputStage::showDistance(float distance) {
+    // Compare what the display would show: one decimal place
+    long tenths = (long)(distance * 10.0 + (distance < 0 ? -0.5 : 0.5));
+    Screen screen = { SCREEN_DISTANCE, TextId::TEXT_COUNT, TextId::TEXT_COUNT, tenths, ColorIdentifier::NONE };
+    setScreen(screen);
+}
+
+bool OutputStage::showColor(ColorIdentifier colorId, int red, int green, int blue) {
+    _rgb[0] = red;
+    _rgb[1] = green;
+    _rgb[2] = blue;
+    
+    // A different class must persist before it replaces the presented one
+    if (_colorPresented && colorId != _color) {
+        if (colorId != _candidate) {
+            _candidate = colorId;
+            _candidateCount = 0;
+        }
+        if (++_candidateCount < _colorDebounce) {
+            count(OutputChannel::DISPLAY, false);
+            count(OutputChannel::LED, false);
+            count(OutputChannel::AUDIO, false);
+            return false;
+        }
+    }
+    _candidateCount = 0;
+    
+    bool changed = !_colorPresented || colorId != _color;
+    _color = colorId;
+    _colorPresented = true;
+    
+    Screen screen = { SCREEN_COLOR, TextId::TEXT_COUNT, TextId::TEXT_COUNT, 0, colorId };
+    setScreen(screen);
+    setLed(colorId, true);
+    
+    // Announce a color once, not on every sample that confirms it
+    if (colorId != ColorIdentifier::NONE && _noteCount > 0) {
+        if (changed) {
+            _audio.queueMelody(_melody, _durations, _noteCount, AudioManager::PRIORITY_LOW);
+        }
+        count(OutputChannel::AUDIO, changed);
+    }
+    
+    return changed;
+}
+
+void OutputStage::pulseLed(ColorIdentifier colorId, uint8_t pulses) {
+    _leds.startPulse(colorId, pulses);
+    
+    // A pulse ends dark, so the next setLed() must be applied whatever it asks for
+    _ledColor = colorId;
+    _ledKnown = false;
+    count(OutputChannel::LED, true);
+}
+
+void OutputStage::clearColor() {
+    _colorPresented = false;
+    _candidateCount = 0;
+    setLed(_ledColor, false);
+}
+
+bool OutputStage::render() {
+    unsigned long now = millis();
+    
+    if (_bannerPending) {
+        Screen banner = { SCREEN_MESSAGE, _bannerTop, _bannerBottom, 0, ColorIdentifier::NONE };
+        drawScreen(banner);
+        _drawn = banner;
+        _bannerPending = false;
+        _bannerActive = true;
+        _bannerEnd = now + _bannerHold;
+        return true;
+    }
+    
+    // Keep a banner on screen for its full time
+    if (_bannerActive) {
+        if ((long)(now - _bannerEnd) < 0) {
+            return false;
+        }
+        _bannerActive = false;
+    }
+    
+    if (sameScreen(_screen, _drawn)) {
+        return false;
+    }
+    
+    drawScreen(_screen);
+    _drawn = _screen;
+    return true;
+}
+
+void OutputStage::invalidate() {
+    _drawn.kind = SCREEN_NONE;
+    _ledKnown = false;
+    _colorPresented = false;
+    _candidateCount = 0;
+}
+
+uint16_t OutputStage::getAppliedCount(OutputChannel channel) const {
+    return _applied[static_cast<uint8_t>(channel)];
+}
+
+uint16_t OutputStage::getSuppressedCount(OutputChannel channel) const {
+    return _suppressed[static_cast<uint8_t>(channel)];
+}
+
+void OutputStage::resetCounters() {
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        _applied[i] = 0;
+        _suppressed[i] = 0;
+    }
+}
+
+void OutputStage::dump(Print& out) const {
+    // Format: "name applied=A suppressed=S"
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        switch (static_cast<OutputChannel>(i)) {
+            case OutputChannel::DISPLAY:
+                out.print(F("display"));
+                break;
+            case OutputChannel::LED:
+                out.print(F("led"));
+                break;
+            default:
+                out.print(F("audio"));
+                break;
+        }
+        out.print(F(" applied="));
+        out.print(_applied[i]);
+        out.print(F(" suppressed="));
+        out.println(_suppressed[i]);
+    }
+}
+
+void OutputStage::setScreen(const Screen& screen) {
+    if (sameScreen(screen, _screen)) {
+        count(OutputChannel::DISPLAY, false);
+        return;
+    }
+    _screen = screen;
+}
+
+void OutputStage::setLed(ColorIdentifier colorId, bool on) {
+    if (_ledKnown && _ledOn == on && (!on || _ledColor == colorId)) {
+        count(OutputChannel::LED, false);
+        return;
+    }
+    
+    if (on) {
+        _leds.setLed(colorId);
+    } else {
+        _leds.allOff();
+    }
+    _ledColor = colorId;
+    _ledOn = on;
+    _ledKnown = true;
+    count(OutputChannel::LED, true);
+}
+
+void OutputStage::drawScreen(const Screen& screen) {
+    switch (screen.kind) {
+        case SCREEN_MESSAGE:
+            _display.clear();
+            _display.displayMessage(screen.top, 0, true);
+            _display.displayMessage(screen.bottom, 1, true);
+            break;
+        case SCREEN_DISTANCE:
+            _display.displayDistance(screen.distanceTenths / 10.0);
+            break;
+        case SCREEN_COLOR: {
+            // The RGB readout follows the class; a 16x2 display has no row for it
+            if (_display.getRows() <= 2) {
+                _display.displayColor(ColorSensor::getColorName(screen.colorId));
+                break;
+            }
+            
+            char rgbValues[RGB_TEXT_SIZE];
+            const char channels[] = { 'R', 'G', 'B' };
+            char* out = rgbValues;
+            for (uint8_t i = 0; i < 3; i++) {
+                if (i > 0) {
+                    *out++ = ' ';
+                }
+                *out++ = channels[i];
+                *out++ = ':';
+                out = appendChannel(out, _rgb[i]);
+            }
+            *out = '\0';
+            _display.displayColor(ColorSensor::getColorName(screen.colorId), rgbValues);
+            break;
+        }
+        case SCREEN_NONE:
+        default:
+            _display.clear();
+            break;
+    }
+    count(OutputChannel::DISPLAY, true);
+}
+
+void OutputStage::count(OutputChannel channel, bool applied) {
+    uint16_t* counter = applied ? _applied : _suppressed;
+    uint8_t index = static_cast<uint8_t>(channel);
+    if (counter[index] < 0xFFFF) {
+        counter[index]++;
+    }
+}
+
+bool OutputStage::sameScreen(const Screen& a, const Screen& b) {
+    if (a.kind != b.kind) {
+        return false;
+    }
+    switch (a.kind) {
+        case SCREEN_MESSAGE:
+            return a.top == b.top && a.bottom == b.bottom;
+        case SCREEN_DISTANCE:
+            return a.distanceTenths == b.distanceTenths;
+        case SCREEN_COLOR:
+            return a.colorId == b.colorId;
+        default:
+            return true;
+    }
+}
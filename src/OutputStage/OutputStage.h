@@ -0,0 +1,216 @@
+/**
+ * @file OutputStage.h
+ * @brief Change-driven display, LED and audio output
+ * @author catalina
+ */
+
+#ifndef OUTPUT_STAGE_H
+#define OUTPUT_STAGE_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+#include "../DisplayManager/DisplayManager.h"
+#include "../LedManager/LedManager.h"
+#include "../AudioManager/AudioManager.h"
+#include "../TextTable/TextTable.h"
+
+// Output devices, for the update counters
+enum class OutputChannel : uint8_t {
+    DISPLAY = 0,
+    LED,
+    AUDIO,
+    CHANNEL_COUNT
+};
+
+/**
+ * @class OutputStage
+ * @brief Presents readings and does device work only when they change
+ * 
+ * The stage remembers what the LCD, the LEDs and the buzzer currently
+ * present: the screen (message, distance rounded to the 0.1 cm shown, or
+ * color class), the lit LED and the last announced color. The show*()
+ * methods only record the new state; nothing is written to a device
+ * unless the presented state actually changes, and every update that
+ * changes nothing is counted as suppressed.
+ * 
+ * Color classes are debounced: once a color is presented, a different
+ * class must be reported COLOR_DEBOUNCE times in a row before the LED, the
+ * display and the detection melody follow it, so one noisy sample does
+ * not flash the LED or restart the melody.
+ * 
+ * Display writes are slow (tens of ms over I2C), so the screen is drawn
+ * by render(), which a sketch calls from its display task. A banner shown
+ * with showBanner() stays on screen for its hold time; screen changes
+ * made meanwhile are drawn once it expires.
+ */
+class OutputStage {
+public:
+    /**
+     * @brief Constructor
+     * 
+     * @param display Initialised display
+     * @param leds Initialised LEDs
+     * @param audio Initialised buzzer
+     * @param colorDebounce Consecutive samples needed to change the presented color
+     */
+    OutputStage(
+        DisplayManager& display,
+        LedManager& leds,
+        AudioManager& audio,
+        uint8_t colorDebounce = SystemSettings::COLOR_DEBOUNCE
+    );
+    
+    /**
+     * @brief Set the melody queued when a new color is presented
+     * 
+     * @param melody Note frequencies (must stay valid)
+     * @param durations Note durations
+     * @param noteCount Number of notes (0 = no melody)
+     */
+    void setDetectionMelody(const uint16_t* melody, const uint8_t* durations, uint8_t noteCount);
+    
+    /**
+     * @brief Show a two-line message
+     * 
+     * @param top First line
+     * @param bottom Second line
+     */
+    void showMessage(TextId top, TextId bottom);
+    
+    /**
+     * @brief Show a message for a minimum time, above any other screen
+     * 
+     * @param top First line
+     * @param bottom Second line
+     * @param holdTime Time in ms before the screen below is drawn
+     */
+    void showBanner(TextId top, TextId bottom, unsigned long holdTime);
+    
+    /**
+     * @brief Show a distance
+     * @param distance Distance in cm
+     */
+    void showDistance(float distance);
+    
+    /**
+     * @brief Present a classified color sample
+     * 
+     * @param colorId Detected class
+     * @param red Calibrated RGB of the sample
+     * @param green
+     * @param blue
+     * @return true if the presented color changed
+     */
+    bool showColor(ColorIdentifier colorId, int red, int green, int blue);
+    
+    /**
+     * @brief Pulse an LED, e.g. to acknowledge a mode change
+     * 
+     * The pulse counts as a lit LED, so clearColor() turns it off.
+     * 
+     * @param colorId LED to pulse
+     * @param pulses Number of pulses
+     */
+    void pulseLed(ColorIdentifier colorId, uint8_t pulses);
+    
+    /**
+     * @brief Forget the presented color and turn its LED off
+     */
+    void clearColor();
+    
+    /**
+     * @brief Draw the screen if it changed since it was last drawn
+     * @return true if anything was drawn
+     */
+    bool render();
+    
+    /**
+     * @brief Forget everything presented, so the next updates are applied
+     * 
+     * Call after something else wrote to the display or LEDs.
+     */
+    void invalidate();
+    
+    /**
+     * @brief Get the number of updates applied to a device
+     */
+    uint16_t getAppliedCount(OutputChannel channel) const;
+    
+    /**
+     * @brief Get the number of updates suppressed because nothing changed
+     */
+    uint16_t getSuppressedCount(OutputChannel channel) const;
+    
+    /**
+     * @brief Reset the update counters
+     */
+    void resetCounters();
+    
+    /**
+     * @brief Print the update counters
+     * @param out Destination (typically Serial)
+     */
+    void dump(Print& out) const;
+    
+private:
+    // Screen contents
+    enum ScreenKind : uint8_t {
+        SCREEN_NONE,
+        SCREEN_MESSAGE,
+        SCREEN_DISTANCE,
+        SCREEN_COLOR
+    };
+    
+    struct Screen {
+        ScreenKind kind;
+        TextId top;             // SCREEN_MESSAGE
+        TextId bottom;
+        long distanceTenths;    // SCREEN_DISTANCE, in 0.1 cm
+        ColorIdentifier colorId;// SCREEN_COLOR
+    };
+    
+    static const uint8_t CHANNEL_COUNT = static_cast<uint8_t>(OutputChannel::CHANNEL_COUNT);
+    
+    DisplayManager& _display;
+    LedManager& _leds;
+    AudioManager& _audio;
+    
+    // Detection melody
+    const uint16_t* _melody;
+    const uint8_t* _durations;
+    uint8_t _noteCount;
+    
+    // Presented state
+    Screen _screen;             // Wanted screen
+    Screen _drawn;              // Screen on the LCD
+    TextId _bannerTop;          // Banner waiting to be drawn
+    TextId _bannerBottom;
+    bool _bannerPending;
+    unsigned long _bannerHold;
+    unsigned long _bannerEnd;   // millis() until which the banner stays
+    bool _bannerActive;
+    ColorIdentifier _ledColor;
+    bool _ledOn;
+    bool _ledKnown;             // false after invalidate()
+    ColorIdentifier _color;     // Presented color class
+    bool _colorPresented;
+    int _rgb[3];
+    
+    // Color debounce
+    uint8_t _colorDebounce;
+    ColorIdentifier _candidate;
+    uint8_t _candidateCount;
+    
+    // Counters
+    uint16_t _applied[CHANNEL_COUNT];
+    uint16_t _suppressed[CHANNEL_COUNT];
+    
+    // Helper methods
+    void setScreen(const Screen& screen);
+    void setLed(ColorIdentifier colorId, bool on);
+    void drawScreen(const Screen& screen);
+    void count(OutputChannel channel, bool applied);
+    static bool sameScreen(const Screen& a, const Screen& b);
+};
+
+#endif // OUTPUT_STAGE_H
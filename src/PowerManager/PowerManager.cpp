@@ -0,0 +1,253 @@
+/**
+ * @file PowerManager.cpp
+ * @brief Sleep between scheduled tasks and peripheral standby implementation
+ * @author catalina
+ */
+
+#include "PowerManager.h"
+
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+#ifdef ARDUINO
+// Timer0's millisecond count, kept by the core
+extern volatile unsigned long timer0_millis;
+
+// Set by the watchdog, so a power-down lasts the whole period
+volatile bool watchdogFired = false;
+
+// The watchdog only wakes the CPU; the sleep code does the rest
+ISR(WDT_vect) {
+    watchdogFired = true;
+}
+#endif
+
+namespace {
+    const uint8_t NO_TIMEOUT = 0xFF;
+    
+    // Nominal watchdog period in ms of a WDTO_* timeout
+    unsigned long watchdogPeriod(uint8_t timeout) {
+        return PowerManager::MIN_POWER_DOWN << timeout;
+    }
+    
+    // Longest watchdog timeout that ends within the gap, allowing the
+    // oscillator to run 1/8 slow
+    uint8_t watchdogTimeout(unsigned long idleTime) {
+        unsigned long usable = idleTime - idleTime / 8;
+        if (usable < PowerManager::MIN_POWER_DOWN) {
+            return NO_TIMEOUT;
+        }
+        uint8_t timeout = WDTO_15MS;
+        while (timeout < WDTO_8S && watchdogPeriod(timeout + 1) <= usable) {
+            timeout++;
+        }
+        return timeout;
+    }
+    
+    void startWatchdog(uint8_t timeout) {
+#ifdef ARDUINO
+        // Interrupt mode only; wdt_enable() would also arm the system reset
+        noInterrupts();
+        wdt_reset();
+        MCUSR &= ~_BV(WDRF);
+        WDTCSR = _BV(WDCE) | _BV(WDE);
+        WDTCSR = _BV(WDIE) | ((timeout & 0x08) ? _BV(WDP3) : 0) | (timeout & 0x07);
+        interrupts();
+#else
+        wdt_enable(timeout);
+#endif
+    }
+    
+    void sleepNow() {
+        // Interrupts stay off until the instruction before the sleep, so a
+        // wake-up interrupt cannot slip in between and be missed
+        noInterrupts();
+        sleep_enable();
+        interrupts();
+        sleep_cpu();
+        sleep_disable();
+    }
+    
+#ifdef ARDUINO
+    void sleepUntilWatchdog() {
+        // Checked with interrupts off, so the watchdog cannot fire between
+        // the check and the sleep and leave the CPU asleep for another period
+        noInterrupts();
+        while (!watchdogFired) {
+            sleep_enable();
+            interrupts();
+            sleep_cpu();
+            sleep_disable();
+            noInterrupts();
+        }
+        interrupts();
+    }
+#endif
+}
+
+PowerManager::PowerManager(DisplayManager& display, ColorSensor* colorSensor)
+    : _display(display),
+      _colorSensor(colorSensor),
+      _frequencyScaling(ColorSensor::FREQUENCY_SCALING_20),
+      _standby(false),
+      _lastWake(0),
+      _standbyTime(0),
+      _standbySince(0) {
+    reset();
+}
+
+void PowerManager::begin() {
+    reset();
+}
+
+PowerState PowerManager::sleep(unsigned long idleTime, bool busy) {
+    if (idleTime == 0) {
+        return PowerState::ACTIVE;
+    }
+    
+    unsigned long start = micros();
+    account(PowerState::ACTIVE, start - _lastWake);
+    
+    uint8_t timeout = busy ? NO_TIMEOUT : watchdogTimeout(idleTime);
+    if (timeout == NO_TIMEOUT || !isSerialIdle()) {
+        // Timer0 overflows every 1.024 ms and wakes the CPU to poll again
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        sleepNow();
+        _lastWake = micros();
+        account(PowerState::IDLE, _lastWake - start);
+        return PowerState::IDLE;
+    }
+    
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+#ifdef ARDUINO
+    watchdogFired = false;
+    startWatchdog(timeout);
+    sleepUntilWatchdog();
+    wdt_disable();
+    
+    // Timer0 stood still for the whole period; micros() simply resumes
+    unsigned long slept = watchdogPeriod(timeout);
+    noInterrupts();
+    timer0_millis += slept;
+    interrupts();
+    _lastWake = micros();
+    account(PowerState::POWER_DOWN, slept * 1000);
+#else
+    startWatchdog(timeout);
+    sleepNow();
+    wdt_disable();
+    _lastWake = micros();
+    account(PowerState::POWER_DOWN, _lastWake - start);
+#endif
+    return PowerState::POWER_DOWN;
+}
+
+void PowerManager::setStandby(bool standby) {
+    if (standby == _standby) {
+        return;
+    }
+    _standby = standby;
+    
+    if (standby) {
+        _standbySince = millis();
+        if (_colorSensor != nullptr) {
+            _frequencyScaling = _colorSensor->getFrequencyScaling();
+            _colorSensor->setFrequencyScaling(ColorSensor::FREQUENCY_SCALING_OFF);
+        }
+        _display.setBacklight(false);
+    } else {
+        _standbyTime += millis() - _standbySince;
+        if (_colorSensor != nullptr) {
+            _colorSensor->setFrequencyScaling(_frequencyScaling);
+        }
+        _display.setBacklight(true);
+    }
+}
+
+unsigned long PowerManager::getTime(PowerState state) const {
+    uint8_t index = static_cast<uint8_t>(state);
+    return index < static_cast<uint8_t>(PowerState::STATE_COUNT) ? _time[index] : 0;
+}
+
+unsigned long PowerManager::getStandbyTime() const {
+    return _standby ? _standbyTime + (millis() - _standbySince) : _standbyTime;
+}
+
+float PowerManager::getDutyCycle() const {
+    unsigned long total = totalTime();
+    return total == 0 ? 0.0f : 100.0f * getTime(PowerState::ACTIVE) / total;
+}
+
+float PowerManager::getAverageCurrent() const {
+    unsigned long total = totalTime();
+    if (total == 0) {
+        return 0.0f;
+    }
+    
+    float mcu = (getTime(PowerState::ACTIVE) * PowerSettings::MCU_ACTIVE_CURRENT
+                 + getTime(PowerState::IDLE) * PowerSettings::MCU_IDLE_CURRENT
+                 + getTime(PowerState::POWER_DOWN) * PowerSettings::MCU_POWER_DOWN_CURRENT) / total;
+    
+    // Peripherals switched off in standby draw only while awake
+    float peripherals = PowerSettings::BACKLIGHT_CURRENT;
+    if (_colorSensor != nullptr) {
+        peripherals += PowerSettings::COLOR_SENSOR_CURRENT;
+    }
+    float standby = static_cast<float>(getStandbyTime()) / total;
+    if (standby > 1.0f) {
+        standby = 1.0f;
+    }
+    
+    return PowerSettings::BASE_CURRENT + mcu + peripherals * (1.0f - standby);
+}
+
+void PowerManager::dump(Print& out) const {
+    // Format: "active=A idle=I power-down=P standby=S ms duty=D% current=C mA"
+    out.print(F("active="));
+    out.print(getTime(PowerState::ACTIVE));
+    out.print(F(" idle="));
+    out.print(getTime(PowerState::IDLE));
+    out.print(F(" power-down="));
+    out.print(getTime(PowerState::POWER_DOWN));
+    out.print(F(" standby="));
+    out.print(getStandbyTime());
+    out.print(F(" ms duty="));
+    out.print(getDutyCycle(), 1);
+    out.print(F("% current="));
+    out.print(getAverageCurrent(), 2);
+    out.println(F(" mA"));
+}
+
+void PowerManager::reset() {
+    for (uint8_t i = 0; i < static_cast<uint8_t>(PowerState::STATE_COUNT); i++) {
+        _time[i] = 0;
+        _remainder[i] = 0;
+    }
+    _standbyTime = 0;
+    _standbySince = millis();
+    _lastWake = micros();
+}
+
+bool PowerManager::isSerialIdle() {
+#ifdef ARDUINO
+    // TXC0 is set once the last byte has left the shift register
+    return Serial.availableForWrite() >= SERIAL_TX_BUFFER_SIZE - 1 && bit_is_set(UCSR0A, TXC0);
+#else
+    return Serial.availableForWrite() >= HardwareSerial::TX_BUFFER_SIZE;
+#endif
+}
+
+void PowerManager::account(PowerState state, unsigned long duration) {
+    uint8_t index = static_cast<uint8_t>(state);
+    _remainder[index] += duration;
+    _time[index] += _remainder[index] / 1000;
+    _remainder[index] %= 1000;
+}
+
+unsigned long PowerManager::totalTime() const {
+    unsigned long total = 0;
+    for (uint8_t i = 0; i < static_cast<uint8_t>(PowerState::STATE_COUNT); i++) {
+        total += _time[i];
+    }
+    return total;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file PowerManager.h
+ * @brief Sleep between scheduled tasks and peripheral standby
+ * @author catalina
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+#include "../ColorSensor/ColorSensor.h"
+#include "../DisplayManager/DisplayManager.h"
+
+// Where the MCU spends its time
+enum class PowerState : uint8_t {
+    ACTIVE = 0,     // Running code
+    IDLE,           // Idle sleep: timers, UART and pin interrupts keep running
+    POWER_DOWN,     // Power-down: only the watchdog wakes the CPU
+    STATE_COUNT
+};
+
+/**
+ * @class PowerManager
+ * @brief Puts the MCU into the deepest sleep the pending work allows
+ * 
+ * A sketch calls sleep() whenever no task is due, with the time until the
+ * next release. While something needs the CPU clock soon (a ping in
+ * flight, bytes still shifting out of the UART, a tone or LED effect
+ * running) the MCU goes into idle sleep, which Timer0 ends within 1 ms and
+ * which keeps millis(), micros() and the UART running. Otherwise, and if
+ * the gap is long enough, it powers down for the longest watchdog period
+ * that fits in the gap, less a margin for the inaccurate watchdog
+ * oscillator. Any interrupt ends idle sleep early.
+ * 
+ * On the ATmega328P only level and pin-change interrupts can wake the CPU
+ * from power-down. The echo capture uses INT0 on CHANGE, an edge interrupt
+ * that needs the stopped I/O clock, so the sketch must report a ping in
+ * flight as busy and never power down with an echo pending.
+ * 
+ * Timer0 also stops during power-down, so millis() is advanced by the
+ * watchdog period afterwards. A wake-up by anything but the watchdog is
+ * slept through until the watchdog fires, so the whole period has passed.
+ * The watchdog oscillator's tolerance is the only error left.
+ * 
+ * setStandby() powers down the TCS230 (frequency scaling off) and switches
+ * off the LCD backlight, and restores both. Time in each state and in
+ * standby gives the duty cycle and, with the currents in PowerSettings,
+ * an estimate of the average supply current.
+ */
+class PowerManager {
+public:
+    /**
+     * @brief Constructor
+     * 
+     * @param display Display whose backlight goes off in standby
+     * @param colorSensor Color sensor powered down in standby (nullptr if none)
+     */
+    explicit PowerManager(DisplayManager& display, ColorSensor* colorSensor = nullptr);
+    
+    /**
+     * @brief Start accounting from now
+     */
+    void begin();
+    
+    /**
+     * @brief Sleep until the next task release or an interrupt
+     * 
+     * @param idleTime Time in ms until the next task is due (from Scheduler::getIdleTime())
+     * @param busy true if work in progress needs the timers (idle sleep only)
+     * @return State slept in (ACTIVE if the MCU did not sleep)
+     */
+    PowerState sleep(unsigned long idleTime, bool busy = false);
+    
+    /**
+     * @brief Power the peripherals down or back up
+     * @param standby true to power down the color sensor and the backlight
+     */
+    void setStandby(bool standby);
+    
+    /**
+     * @brief Check whether the peripherals are powered down
+     */
+    bool isStandby() const { return _standby; }
+    
+    /**
+     * @brief Get the time spent in a state since begin() or reset()
+     * @param state Power state
+     * @return Time in ms
+     */
+    unsigned long getTime(PowerState state) const;
+    
+    /**
+     * @brief Get the time spent in standby since begin() or reset()
+     * @return Time in ms
+     */
+    unsigned long getStandbyTime() const;
+    
+    /**
+     * @brief Get the share of time the CPU was running
+     * @return Percent of the accounted time
+     */
+    float getDutyCycle() const;
+    
+    /**
+     * @brief Estimate the average supply current from the time in each state
+     * @return Current in mA
+     */
+    float getAverageCurrent() const;
+    
+    /**
+     * @brief Print the time in each state, the duty cycle and the current estimate
+     * @param out Output stream
+     */
+    void dump(Print& out) const;
+    
+    /**
+     * @brief Clear the accounted times
+     */
+    void reset();
+    
+    /**
+     * @brief Check whether the serial port has finished transmitting
+     * 
+     * The UART stops with the CPU clock, so power-down waits until its
+     * buffer is empty and the last byte has left the shift register.
+     */
+    static bool isSerialIdle();
+    
+    // Shortest gap in ms worth a power-down (the shortest watchdog period)
+    static const unsigned long MIN_POWER_DOWN = 16;
+    
+private:
+    DisplayManager& _display;
+    ColorSensor* _colorSensor;
+    uint8_t _frequencyScaling;      // Color sensor scaling to restore after standby
+    bool _standby;
+    
+    unsigned long _lastWake;        // micros() when the CPU last woke
+    unsigned long _time[static_cast<uint8_t>(PowerState::STATE_COUNT)];         // ms
+    unsigned long _remainder[static_cast<uint8_t>(PowerState::STATE_COUNT)];    // µs not yet in _time
+    unsigned long _standbyTime;     // ms, up to _standbySince
+    unsigned long _standbySince;    // millis() when standby began
+    
+    // Helper methods
+    void account(PowerState state, unsigned long duration);
+    unsigned long totalTime() const;
+};
+
+#endif // POWER_MANAGER_H
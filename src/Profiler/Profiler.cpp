@@ -0,0 +1,134 @@
+/**
+ * @file Profiler.cpp
+ * @brief Per-stage latency instrumentation implementation
+ * @author catalina
+ */
+
+#include "Profiler.h"
+
+namespace {
+    const uint8_t STAGE_COUNT = static_cast<uint8_t>(ProfileStage::STAGE_COUNT);
+    
+    // Names in dump(), by stage
+    const char NAME_DISTANCE_ACQUIRE[] PROGMEM = "dist.acquire";
+    const char NAME_COLOR_ACQUIRE[] PROGMEM = "color.acquire";
+    const char NAME_COLOR_STABILIZE[] PROGMEM = "color.settle";
+    const char NAME_COLOR_CLASSIFY[] PROGMEM = "color.classify";
+    const char NAME_DISPLAY_RENDER[] PROGMEM = "display";
+    const char NAME_LED_RENDER[] PROGMEM = "leds";
+    const char NAME_AUDIO[] PROGMEM = "audio";
+    const char NAME_UNKNOWN[] PROGMEM = "unknown";
+    
+    const char* const STAGE_NAMES[] PROGMEM = {
+        NAME_DISTANCE_ACQUIRE,
+        NAME_COLOR_ACQUIRE,
+        NAME_COLOR_STABILIZE,
+        NAME_COLOR_CLASSIFY,
+        NAME_DISPLAY_RENDER,
+        NAME_LED_RENDER,
+        NAME_AUDIO
+    };
+    static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == STAGE_COUNT, "STAGE_NAMES must list every ProfileStage");
+}
+
+PROFILER_STORAGE LatencyHistogram Profiler::_stages[static_cast<uint8_t>(ProfileStage::STAGE_COUNT)];
+
+void LatencyHistogram::record(unsigned long duration) {
+    // Index of the highest set bit, i.e. floor(log2(duration))
+    uint8_t bucket = 0;
+    unsigned long value = duration >> 1;
+    while (value != 0 && bucket < BUCKET_COUNT - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    
+    // Saturate instead of wrapping around
+    if (_buckets[bucket] < 0xFFFF) {
+        _buckets[bucket]++;
+    }
+    
+    if (_count == 0 || duration < _min) {
+        _min = duration;
+    }
+    if (duration > _max) {
+        _max = duration;
+    }
+    _count++;
+    _total += duration;
+    _last = duration;
+}
+
+void LatencyHistogram::reset() {
+    for (uint8_t i = 0; i < BUCKET_COUNT; i++) {
+        _buckets[i] = 0;
+    }
+    _count = 0;
+    _min = 0;
+    _max = 0;
+    _total = 0;
+    _last = 0;
+}
+
+unsigned long LatencyHistogram::getMean() const {
+    return _count > 0 ? (unsigned long)(_total / _count) : 0;
+}
+
+void Profiler::record(ProfileStage stage, unsigned long duration) {
+    uint8_t index = static_cast<uint8_t>(stage);
+    if (index < static_cast<uint8_t>(ProfileStage::STAGE_COUNT)) {
+        _stages[index].record(duration);
+    }
+}
+
+const LatencyHistogram& Profiler::getHistogram(ProfileStage stage) {
+    uint8_t index = static_cast<uint8_t>(stage);
+    if (index >= static_cast<uint8_t>(ProfileStage::STAGE_COUNT)) {
+        index = 0;
+    }
+    return _stages[index];
+}
+
+void Profiler::reset() {
+    for (uint8_t i = 0; i < static_cast<uint8_t>(ProfileStage::STAGE_COUNT); i++) {
+        _stages[i].reset();
+    }
+}
+
+void Profiler::dump(Print& out) {
+    for (uint8_t i = 0; i < static_cast<uint8_t>(ProfileStage::STAGE_COUNT); i++) {
+        const LatencyHistogram& histogram = _stages[i];
+        if (histogram.getCount() == 0) {
+            continue;
+        }
+        
+        // Format: "name n=COUNT min/mean/max=A/B/C us | b0 b1 ..."
+        out.print(getStageName(static_cast<ProfileStage>(i)));
+        out.print(F(" n="));
+        out.print(histogram.getCount());
+        out.print(F(" min/mean/max="));
+        out.print(histogram.getMin());
+        out.print('/');
+        out.print(histogram.getMean());
+        out.print('/');
+        out.print(histogram.getMax());
+        out.print(F(" us |"));
+        
+        uint8_t last = 0;
+        for (uint8_t b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+            if (histogram.getBucket(b) > 0) {
+                last = b;
+            }
+        }
+        for (uint8_t b = 0; b <= last; b++) {
+            out.print(' ');
+            out.print(histogram.getBucket(b));
+        }
+        out.println();
+    }
+}
+
+const __FlashStringHelper* Profiler::getStageName(ProfileStage stage) {
+    uint8_t index = static_cast<uint8_t>(stage);
+    PGM_P name = index < STAGE_COUNT ? static_cast<PGM_P>(pgm_read_ptr(&STAGE_NAMES[index])) : NAME_UNKNOWN;
+    return reinterpret_cast<const __FlashStringHelper*>(name);
+}
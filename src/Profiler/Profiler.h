@@ -0,0 +1,165 @@
+/**
+ * @file Profiler.h
+ * @brief Per-stage latency instrumentation with log2 histograms
+ * @author catalina
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// Set to 1 (here or with -DDISTANCE_DETECTOR_PROFILING=1) to compile the stage timers in
+#ifndef DISTANCE_DETECTOR_PROFILING
+#define DISTANCE_DETECTOR_PROFILING 0
+#endif
+
+// On the host every simulated device thread keeps its own profile
+#ifdef ARDUINO
+#define PROFILER_STORAGE
+#else
+#define PROFILER_STORAGE thread_local
+#endif
+
+// Instrumented pipeline stages
+enum class ProfileStage : uint8_t {
+    DISTANCE_ACQUIRE = 0,
+    COLOR_ACQUIRE,
+    COLOR_STABILIZE,
+    COLOR_CLASSIFY,
+    DISPLAY_RENDER,
+    LED_RENDER,
+    AUDIO,
+    STAGE_COUNT
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Fixed-size histogram of durations with power-of-two buckets
+ * 
+ * Bucket 0 counts durations below 2 µs and bucket n counts durations in
+ * [2^n, 2^(n+1)) µs; the last bucket also takes everything longer.
+ * Recording is O(1) and the memory footprint is constant.
+ */
+class LatencyHistogram {
+public:
+    constexpr LatencyHistogram()
+        : _buckets(),
+          _count(0),
+          _min(0),
+          _max(0),
+          _total(0),
+          _last(0) {
+    }
+    
+    /**
+     * @brief Add one duration
+     * @param duration Duration in microseconds
+     */
+    void record(unsigned long duration);
+    
+    /**
+     * @brief Clear all samples
+     */
+    void reset();
+    
+    unsigned long getCount() const { return _count; }
+    unsigned long getMin() const { return _count > 0 ? _min : 0; }
+    unsigned long getMax() const { return _max; }
+    unsigned long getMean() const;
+    unsigned long getLast() const { return _last; }
+    uint16_t getBucket(uint8_t index) const { return index < BUCKET_COUNT ? _buckets[index] : 0; }
+    
+    // Number of log2 buckets (the last one covers 2^23 µs and above)
+    static const uint8_t BUCKET_COUNT = 24;
+    
+private:
+    uint16_t _buckets[BUCKET_COUNT];
+    unsigned long _count;
+    unsigned long _min;
+    unsigned long _max;
+    uint64_t _total;
+    unsigned long _last;
+};
+
+/**
+ * @class Profiler
+ * @brief Collects stage timings from the drivers
+ * 
+ * The drivers mark their acquisition, classification, render and audio
+ * stages with PROFILE_STAGE(). With DISTANCE_DETECTOR_PROFILING set to 0 the
+ * macro expands to nothing and the drivers carry no timing code.
+ */
+class Profiler {
+public:
+    /**
+     * @brief Add a duration to a stage histogram
+     * 
+     * @param stage Stage the time was spent in
+     * @param duration Duration in microseconds
+     */
+    static void record(ProfileStage stage, unsigned long duration);
+    
+    /**
+     * @brief Get the histogram of a stage
+     * @param stage Stage
+     * @return Histogram of the stage
+     */
+    static const LatencyHistogram& getHistogram(ProfileStage stage);
+    
+    /**
+     * @brief Clear all stage histograms
+     */
+    static void reset();
+    
+    /**
+     * @brief Print a compact summary of every stage that has samples
+     * 
+     * One line per stage: name, count, min/mean/max in µs and the bucket
+     * counts up to the highest non-empty bucket.
+     * 
+     * @param out Output stream (typically Serial)
+     */
+    static void dump(Print& out);
+    
+    /**
+     * @brief Get the short name of a stage
+     * @param stage Stage
+     * @return Flash pointer to the stage name
+     */
+    static const __FlashStringHelper* getStageName(ProfileStage stage);
+    
+private:
+    static PROFILER_STORAGE LatencyHistogram _stages[static_cast<uint8_t>(ProfileStage::STAGE_COUNT)];
+};
+
+/**
+ * @class ScopedStageTimer
+ * @brief Records the time from construction to destruction into a stage
+ */
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(ProfileStage stage)
+        : _stage(stage),
+          _start(micros()) {
+    }
+    
+    ~ScopedStageTimer() {
+        Profiler::record(_stage, micros() - _start);
+    }
+    
+private:
+    ProfileStage _stage;
+    unsigned long _start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if DISTANCE_DETECTOR_PROFILING
+#define PROFILE_STAGE(stage) ScopedStageTimer PROFILE_CONCAT(_stageTimer, __LINE__)(ProfileStage::stage)
+#else
+#define PROFILE_STAGE(stage) do {} while (0)
+#endif
+
+#endif // PROFILER_H
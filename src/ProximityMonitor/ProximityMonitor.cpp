@@ -0,0 +1,65 @@
+/**
+ * @file ProximityMonitor.cpp
+ * @brief Debounced object arrival and departure events implementation
+ * @author catalina
+ */
+
+#include "ProximityMonitor.h"
+
+ProximityMonitor::ProximityMonitor(DistanceSensor& sensor, float enterThreshold, float exitThreshold, uint8_t debounce)
+    : _sensor(sensor),
+      _enterThreshold(enterThreshold),
+      _exitThreshold(max(exitThreshold, enterThreshold)),
+      _debounce(max(debounce, (uint8_t)1)),
+      _callback(nullptr),
+      _present(false),
+      _count(0),
+      _lastDistance(0.0) {
+}
+
+ProximityEvent ProximityMonitor::poll() {
+    return update(_sensor.getDistance());
+}
+
+ProximityEvent ProximityMonitor::update(float distance) {
+    _lastDistance = distance;
+    
+    // No echo counts as nothing in front of the sensor
+    bool near = distance > 0 && distance <= _enterThreshold;
+    bool far = distance <= 0 || distance > _exitThreshold;
+    
+    bool towardsChange = _present ? far : near;
+    if (!towardsChange) {
+        _count = 0;
+        return ProximityEvent::NONE;
+    }
+    
+    if (++_count < _debounce) {
+        return ProximityEvent::NONE;
+    }
+    
+    _count = 0;
+    _present = !_present;
+    ProximityEvent event = _present ? ProximityEvent::ARRIVED : ProximityEvent::LEFT;
+    if (_callback != nullptr) {
+        _callback(event, distance);
+    }
+    return event;
+}
+
+void ProximityMonitor::setEventCallback(EventCallback callback) {
+    _callback = callback;
+}
+
+void ProximityMonitor::reset() {
+    _present = false;
+    _count = 0;
+}
+
+bool ProximityMonitor::isObjectPresent() const {
+    return _present;
+}
+
+float ProximityMonitor::getLastDistance() const {
+    return _lastDistance;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file ProximityMonitor.h
+ * @brief Debounced object arrival and departure events
+ * @author catalina
+ */
+
+#ifndef PROXIMITY_MONITOR_H
+#define PROXIMITY_MONITOR_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+#include "../DistanceSensor/DistanceSensor.h"
+
+// Proximity events
+enum class ProximityEvent : uint8_t {
+    NONE = 0,
+    ARRIVED,    // An object has settled within the enter threshold
+    LEFT        // The object has moved beyond the exit threshold
+};
+
+/**
+ * @class ProximityMonitor
+ * @brief Turns distance readings into arrival and departure events
+ * 
+ * An object arrives once it is read within the enter threshold on
+ * `debounce` consecutive readings, and leaves once it is read beyond the
+ * exit threshold (or not at all) as many times in a row. Readings between
+ * the two thresholds keep the current state, so an object resting near
+ * the threshold does not flicker in and out.
+ * 
+ * Readings come either from poll(), which pings the sensor itself, or
+ * from update() when something else already pings it (for example the
+ * AcquisitionPipeline), so no distance is measured twice.
+ */
+class ProximityMonitor {
+public:
+    // Event callback: the event and the distance in cm that confirmed it
+    typedef void (*EventCallback)(ProximityEvent event, float distance);
+    
+    /**
+     * @brief Constructor
+     * 
+     * @param sensor Distance sensor used by poll()
+     * @param enterThreshold Distance in cm an object must come within
+     * @param exitThreshold Distance in cm an object must move beyond (>= enterThreshold)
+     * @param debounce Consecutive readings needed to change state
+     */
+    ProximityMonitor(
+        DistanceSensor& sensor,
+        float enterThreshold = SystemSettings::PROXIMITY_THRESHOLD,
+        float exitThreshold = SystemSettings::PROXIMITY_EXIT_THRESHOLD,
+        uint8_t debounce = SystemSettings::PROXIMITY_DEBOUNCE
+    );
+    
+    /**
+     * @brief Measure the distance once and process the reading
+     * @return Event raised by the reading
+     */
+    ProximityEvent poll();
+    
+    /**
+     * @brief Process a distance measured elsewhere
+     * 
+     * @param distance Distance in cm (0 = no echo)
+     * @return Event raised by the reading
+     */
+    ProximityEvent update(float distance);
+    
+    /**
+     * @brief Set the function called on every event
+     * @param callback Event callback (nullptr to disable)
+     */
+    void setEventCallback(EventCallback callback);
+    
+    /**
+     * @brief Forget the object and any partial debounce count
+     */
+    void reset();
+    
+    /**
+     * @brief Check if an object is present
+     * @return true between ARRIVED and LEFT
+     */
+    bool isObjectPresent() const;
+    
+    /**
+     * @brief Get the latest reading
+     * @return Distance in cm (0 = no echo)
+     */
+    float getLastDistance() const;
+    
+private:
+    DistanceSensor& _sensor;
+    float _enterThreshold;
+    float _exitThreshold;
+    uint8_t _debounce;
+    EventCallback _callback;
+    
+    bool _present;
+    uint8_t _count;     // Consecutive readings that point to the other state
+    float _lastDistance;
+};
+
+#endif // PROXIMITY_MONITOR_H
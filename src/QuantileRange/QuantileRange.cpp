@@ -0,0 +1,223 @@
+/**
+ * @file QuantileRange.cpp
+ * @brief Extended P² quantile estimator implementation
+ * @author catalina
+ */
+
+#include "QuantileRange.h"
+
+namespace {
+    // Markers holding the tail and 1 - tail quantiles
+    const uint8_t LOW_MARKER = 2;
+    const uint8_t MEDIAN_MARKER = 3;
+    const uint8_t HIGH_MARKER = 4;
+    
+    float absolute(float value) {
+        return value < 0 ? -value : value;
+    }
+}
+
+QuantileRange::QuantileRange(float tail)
+    : _tail(tail > 0.0f && tail < 0.5f ? tail : 0.02f) {
+    // Too few readings for the tails to hold any are not worth judging
+    float minimum = 1.0f / _tail;
+    _minCount = minimum < MARKERS ? MARKERS : static_cast<uint16_t>(minimum + 0.5f);
+    reset();
+}
+
+void QuantileRange::reset() {
+    for (uint8_t i = 0; i < MARKERS; i++) {
+        _heights[i] = 0.0f;
+        _positions[i] = i + 1;
+    }
+    _count = 0;
+    _checkLow = 0.0f;
+    _checkHigh = 0.0f;
+    _confidence = 0;
+}
+
+void QuantileRange::add(int value) {
+    if (_count == 0xFFFF) {
+        return;
+    }
+    float x = value;
+    
+    // The first readings are kept sorted until every marker has one
+    if (_count < MARKERS) {
+        uint8_t i = _count;
+        while (i > 0 && _heights[i - 1] > x) {
+            _heights[i] = _heights[i - 1];
+            i--;
+        }
+        _heights[i] = x;
+        _count++;
+        if (_count == MARKERS) {
+            limitStart();
+        }
+        return;
+    }
+    
+    // Find the cell the reading falls in, stretching the ends if needed
+    uint8_t cell;
+    if (x < _heights[0]) {
+        _heights[0] = limitLow(x);
+        cell = 0;
+    } else if (x >= _heights[MARKERS - 1]) {
+        _heights[MARKERS - 1] = limitHigh(x);
+        cell = MARKERS - 2;
+    } else {
+        cell = 0;
+        while (x >= _heights[cell + 1]) {
+            cell++;
+        }
+    }
+    
+    for (uint8_t i = cell + 1; i < MARKERS; i++) {
+        _positions[i]++;
+    }
+    _count++;
+    
+    for (uint8_t i = 1; i < MARKERS - 1; i++) {
+        adjust(i);
+    }
+    
+    if (_count % CHECK_INTERVAL == 0) {
+        check();
+    }
+}
+
+int QuantileRange::getLow() const {
+    return static_cast<int>(estimate(LOW_MARKER) + 0.5f);
+}
+
+int QuantileRange::getHigh() const {
+    return static_cast<int>(estimate(HIGH_MARKER) + 0.5f);
+}
+
+int QuantileRange::getMin() const {
+    return _count == 0 ? 0 : static_cast<int>(_heights[0]);
+}
+
+int QuantileRange::getMax() const {
+    if (_count == 0) {
+        return 0;
+    }
+    uint8_t last = _count < MARKERS ? _count - 1 : MARKERS - 1;
+    return static_cast<int>(_heights[last]);
+}
+
+float QuantileRange::fraction(uint8_t marker) const {
+    switch (marker) {
+        case 0: return 0.0f;
+        case 1: return _tail / 2.0f;
+        case 2: return _tail;
+        case 3: return 0.5f;
+        case 4: return 1.0f - _tail;
+        case 5: return 1.0f - _tail / 2.0f;
+        default: return 1.0f;
+    }
+}
+
+float QuantileRange::limitLow(float value) const {
+    // At most double the distance to the median, and at least one count
+    float reach = _heights[MEDIAN_MARKER] - _heights[0];
+    float floor = _heights[0] - (reach < 1.0f ? 1.0f : reach);
+    return value < floor ? floor : value;
+}
+
+float QuantileRange::limitHigh(float value) const {
+    float reach = _heights[MARKERS - 1] - _heights[MEDIAN_MARKER];
+    float ceiling = _heights[MARKERS - 1] + (reach < 1.0f ? 1.0f : reach);
+    return value > ceiling ? ceiling : value;
+}
+
+void QuantileRange::limitStart() {
+    // The first readings hold the ends to the same limit, measured from the inner markers
+    float below = _heights[MEDIAN_MARKER] - _heights[1];
+    float above = _heights[MARKERS - 2] - _heights[MEDIAN_MARKER];
+    float floor = _heights[1] - 2.0f * (below < 1.0f ? 1.0f : below);
+    float ceiling = _heights[MARKERS - 2] + 2.0f * (above < 1.0f ? 1.0f : above);
+    if (_heights[0] < floor) {
+        _heights[0] = floor;
+    }
+    if (_heights[MARKERS - 1] > ceiling) {
+        _heights[MARKERS - 1] = ceiling;
+    }
+}
+
+float QuantileRange::estimate(uint8_t marker) const {
+    if (_count == 0) {
+        return 0.0f;
+    }
+    if (_count >= MARKERS) {
+        return _heights[marker];
+    }
+    
+    // Nearest rank among the readings kept so far
+    uint8_t rank = static_cast<uint8_t>(fraction(marker) * (_count - 1) + 0.5f);
+    return _heights[rank];
+}
+
+void QuantileRange::adjust(uint8_t marker) {
+    float desired = 1.0f + (_count - 1) * fraction(marker);
+    float offset = desired - _positions[marker];
+    int gapAbove = _positions[marker + 1] - _positions[marker];
+    int gapBelow = _positions[marker - 1] - _positions[marker];
+    
+    // Move only toward the desired rank and never onto a neighbour
+    if (!((offset >= 1.0f && gapAbove > 1) || (offset <= -1.0f && gapBelow < -1))) {
+        return;
+    }
+    int step = offset > 0 ? 1 : -1;
+    
+    float q = _heights[marker];
+    float qAbove = _heights[marker + 1];
+    float qBelow = _heights[marker - 1];
+    float n = _positions[marker];
+    float nAbove = _positions[marker + 1];
+    float nBelow = _positions[marker - 1];
+    
+    // Piecewise-parabolic prediction, or linear when it leaves the cell
+    float parabolic = q + step / (nAbove - nBelow)
+        * ((n - nBelow + step) * (qAbove - q) / (nAbove - n)
+           + (nAbove - n - step) * (q - qBelow) / (n - nBelow));
+    if (qBelow < parabolic && parabolic < qAbove) {
+        _heights[marker] = parabolic;
+    } else {
+        float qNext = _heights[marker + step];
+        float nNext = _positions[marker + step];
+        _heights[marker] = q + step * (qNext - q) / (nNext - n);
+    }
+    _positions[marker] += step;
+}
+
+void QuantileRange::check() {
+    float low = _heights[LOW_MARKER];
+    float high = _heights[HIGH_MARKER];
+    float shift = absolute(low - _checkLow);
+    float highShift = absolute(high - _checkHigh);
+    if (highShift > shift) {
+        shift = highShift;
+    }
+    _checkLow = low;
+    _checkHigh = high;
+    
+    if (_count < _minCount + CHECK_INTERVAL) {
+        return;
+    }
+    
+    // 100 without a shift, 0 once it reaches 1/SHIFT_TOLERANCE of the range
+    float range = high - low;
+    float settled = 0.0f;
+    if (range > 0.0f) {
+        settled = 100.0f - 100.0f * SHIFT_TOLERANCE * shift / range;
+    } else if (shift == 0.0f) {
+        settled = 100.0f;
+    }
+    if (settled < 0.0f) {
+        settled = 0.0f;
+    }
+    
+    // One calm check is not enough to call the estimates settled
+    _confidence = (_confidence + static_cast<uint8_t>(settled) + 1) / 2;
+}
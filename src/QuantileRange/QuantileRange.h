@@ -0,0 +1,115 @@
+/**
+ * @file QuantileRange.h
+ * @brief Constant-memory streaming estimate of a low and a high percentile
+ * @author catalina
+ */
+
+#ifndef QUANTILE_RANGE_H
+#define QUANTILE_RANGE_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+
+/**
+ * @class QuantileRange
+ * @brief P² estimate of the range between the tail and 1 - tail quantiles
+ * 
+ * The extended P² algorithm (Jain and Chlamtac; Raatikainen) keeps seven
+ * markers whose heights approximate the minimum, the tail / 2, tail,
+ * median, 1 - tail, 1 - tail / 2 quantiles and the maximum. Every reading
+ * moves each marker by at most one position and adjusts its height by a
+ * piecewise-parabolic fit to its neighbours, so an update is O(1) and the
+ * state is a fixed 60 bytes, however long the stream.
+ * 
+ * A reading beyond an outer marker moves it at most twice as far from the
+ * median as it was (and at least one count). Genuine readings further out
+ * keep stretching the ends on every arrival, while a single glitch (a spike, or
+ * 0 from a pulseIn() timeout) cannot pull the tail markers after it. The
+ * low and high estimates move by a few counts instead of taking over the
+ * range, as they would with a plain minimum and maximum.
+ * 
+ * The confidence figure tracks how far the estimates still move: every
+ * CHECK_INTERVAL readings the largest shift of the low or high estimate is
+ * compared with the current range, and the figure is a running average of
+ * how small that shift was. It stays 0 until enough readings have arrived
+ * for the tails to hold any of them (1 / tail).
+ */
+class QuantileRange {
+public:
+    /**
+     * @brief Constructor
+     * @param tail Fraction of readings left out at each end (0 < tail < 0.5)
+     */
+    explicit QuantileRange(float tail = CalibrationSettings::ColorSensor::QUANTILE_TAIL);
+    
+    /**
+     * @brief Add one reading
+     * @param value Reading
+     */
+    void add(int value);
+    
+    /**
+     * @brief Forget all readings
+     */
+    void reset();
+    
+    /**
+     * @brief Get the estimated tail quantile
+     * @return Low end of the range (0 without readings)
+     */
+    int getLow() const;
+    
+    /**
+     * @brief Get the estimated 1 - tail quantile
+     * @return High end of the range (0 without readings)
+     */
+    int getHigh() const;
+    
+    /**
+     * @brief Get the outer markers (the smallest and largest readings, within the stretch limit)
+     */
+    int getMin() const;
+    int getMax() const;
+    
+    /**
+     * @brief Get the number of readings added
+     */
+    uint16_t getCount() const { return _count; }
+    
+    /**
+     * @brief Get how settled the low and high estimates are
+     * @return 0 (still moving or too few readings) to 100 (settled)
+     */
+    uint8_t getConfidence() const { return _confidence; }
+    
+    // Markers of the extended P² algorithm for two quantiles
+    static const uint8_t MARKERS = 7;
+    
+    // Readings between two confidence checks
+    static const uint8_t CHECK_INTERVAL = 16;
+    
+    // A shift of 1/SHIFT_TOLERANCE of the range between checks counts as unsettled
+    static const uint8_t SHIFT_TOLERANCE = 20;
+    
+private:
+    float _tail;
+    float _heights[MARKERS];        // Marker values
+    uint16_t _positions[MARKERS];   // Marker ranks, 1-based
+    uint16_t _count;
+    uint16_t _minCount;             // Readings before the confidence counts
+    
+    float _checkLow;                // Estimates at the last check
+    float _checkHigh;
+    uint8_t _confidence;
+    
+    // Helper methods
+    float fraction(uint8_t marker) const;
+    void limitStart();
+    float limitLow(float value) const;
+    float limitHigh(float value) const;
+    float estimate(uint8_t marker) const;
+    void adjust(uint8_t marker);
+    void check();
+};
+
+#endif // QUANTILE_RANGE_H
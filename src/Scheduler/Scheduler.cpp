@@ -0,0 +1,159 @@
+/**
+ * @file Scheduler.cpp
+ * @brief Cooperative task scheduler implementation
+ * @author catalina
+ */
+
+#include "Scheduler.h"
+
+Scheduler::Scheduler()
+    : _taskCount(0),
+      _overrunCallback(nullptr),
+      _maxStepTime(0),
+      _lastLateness(0) {
+}
+
+uint8_t Scheduler::addTask(TaskCallback callback, unsigned long period, unsigned long deadline, unsigned long startDelay) {
+    if (callback == nullptr || _taskCount >= MAX_TASKS) {
+        return INVALID_TASK;
+    }
+    
+    Task& task = _tasks[_taskCount];
+    task.callback = callback;
+    task.period = period;
+    task.deadline = deadline > 0 ? deadline : period;
+    task.nextRelease = millis() + startDelay;
+    task.maxRunTime = 0;
+    task.overrunCount = 0;
+    task.enabled = true;
+    
+    return _taskCount++;
+}
+
+void Scheduler::enableTask(uint8_t taskId, unsigned long startDelay) {
+    if (taskId >= _taskCount) return;
+    
+    _tasks[taskId].enabled = true;
+    _tasks[taskId].nextRelease = millis() + startDelay;
+}
+
+void Scheduler::disableTask(uint8_t taskId) {
+    if (taskId >= _taskCount) return;
+    
+    _tasks[taskId].enabled = false;
+}
+
+bool Scheduler::isTaskEnabled(uint8_t taskId) const {
+    return taskId < _taskCount && _tasks[taskId].enabled;
+}
+
+void Scheduler::setTaskPeriod(uint8_t taskId, unsigned long period) {
+    if (taskId >= _taskCount) return;
+    
+    // A deadline that defaulted to the period follows the new period
+    if (_tasks[taskId].deadline == _tasks[taskId].period) {
+        _tasks[taskId].deadline = period;
+    }
+    _tasks[taskId].period = period;
+}
+
+void Scheduler::setOverrunCallback(OverrunCallback callback) {
+    _overrunCallback = callback;
+}
+
+bool Scheduler::run() {
+    unsigned long now = millis();
+    
+    // Pick the due task with the earliest absolute deadline
+    uint8_t next = INVALID_TASK;
+    long nextSlack = 0;
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        const Task& task = _tasks[i];
+        if (!task.enabled || (long)(now - task.nextRelease) < 0) {
+            continue;
+        }
+        
+        // Time left until the deadline (negative once it has passed)
+        long slack = (long)(task.nextRelease + task.deadline - now);
+        if (next == INVALID_TASK || slack < nextSlack) {
+            next = i;
+            nextSlack = slack;
+        }
+    }
+    
+    if (next == INVALID_TASK) {
+        return false;
+    }
+    
+    Task& task = _tasks[next];
+    _lastLateness = now - task.nextRelease;
+    if (nextSlack < 0) {
+        task.overrunCount++;
+        if (_overrunCallback != nullptr) {
+            _overrunCallback(next, (unsigned long)(-nextSlack));
+        }
+    }
+    
+    // Schedule the next release before running, so the task may disable itself
+    if (task.period == 0) {
+        task.enabled = false;
+    } else {
+        task.nextRelease += task.period;
+        
+        // Skip releases that were missed entirely instead of running them back to back
+        if ((long)(now - task.nextRelease) >= 0) {
+            task.nextRelease = now + task.period;
+        }
+    }
+    
+    unsigned long start = micros();
+    task.callback();
+    unsigned long runTime = micros() - start;
+    
+    if (runTime > task.maxRunTime) {
+        task.maxRunTime = runTime;
+    }
+    if (runTime > _maxStepTime) {
+        _maxStepTime = runTime;
+    }
+    
+    return true;
+}
+
+unsigned long Scheduler::getIdleTime() {
+    unsigned long now = millis();
+    unsigned long idle = NO_RELEASE;
+    
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        const Task& task = _tasks[i];
+        if (!task.enabled) {
+            continue;
+        }
+        
+        long untilRelease = (long)(task.nextRelease - now);
+        if (untilRelease <= 0) {
+            return 0;
+        }
+        if ((unsigned long)untilRelease < idle) {
+            idle = untilRelease;
+        }
+    }
+    
+    return idle;
+}
+
+uint16_t Scheduler::getOverrunCount(uint8_t taskId) const {
+    return taskId < _taskCount ? _tasks[taskId].overrunCount : 0;
+}
+
+unsigned long Scheduler::getMaxRunTime(uint8_t taskId) const {
+    return taskId < _taskCount ? _tasks[taskId].maxRunTime : 0;
+}
+
+unsigned long Scheduler::getMaxStepTime() const {
+    return _maxStepTime;
+}
+
+unsigned long Scheduler::getLastLateness() const {
+    return _lastLateness;
+}
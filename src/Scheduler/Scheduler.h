@@ -0,0 +1,157 @@
+/**
+ * @file Scheduler.h
+ * @brief Fixed-capacity cooperative task scheduler
+ * @author catalina
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+/**
+ * @class Scheduler
+ * @brief Runs periodic tasks from loop() without blocking delays
+ * 
+ * Each task is a short step function released every period and expected
+ * to start within its deadline. Every call to run() executes at most one
+ * due task, the one with the earliest deadline, so the worst-case time
+ * spent in a single loop() iteration is bounded by the slowest single task
+ * step instead of the sum of all of them. Tasks that start after their
+ * deadline are counted as overruns and reported through an optional
+ * callback.
+ */
+class Scheduler {
+public:
+    // Task step function
+    typedef void (*TaskCallback)();
+    
+    // Overrun report: task id and how late it started in milliseconds
+    typedef void (*OverrunCallback)(uint8_t taskId, unsigned long lateness);
+    
+    /**
+     * @brief Constructor
+     */
+    Scheduler();
+    
+    /**
+     * @brief Register a task
+     * 
+     * @param callback Step function to run
+     * @param period Release period in milliseconds (0 = run once)
+     * @param deadline Time in ms after release by which the task must start (0 = one period)
+     * @param startDelay Time in ms before the first release
+     * @return Task id, or INVALID_TASK if the scheduler is full
+     */
+    uint8_t addTask(TaskCallback callback, unsigned long period, unsigned long deadline = 0, unsigned long startDelay = 0);
+    
+    /**
+     * @brief Enable a task, releasing it after a delay
+     * 
+     * @param taskId Task id
+     * @param startDelay Time in ms before the next release
+     */
+    void enableTask(uint8_t taskId, unsigned long startDelay = 0);
+    
+    /**
+     * @brief Disable a task until it is enabled again
+     * @param taskId Task id
+     */
+    void disableTask(uint8_t taskId);
+    
+    /**
+     * @brief Check if a task is enabled
+     * @param taskId Task id
+     * @return true if the task is enabled
+     */
+    bool isTaskEnabled(uint8_t taskId) const;
+    
+    /**
+     * @brief Change the period of a task
+     * 
+     * @param taskId Task id
+     * @param period New period in milliseconds
+     */
+    void setTaskPeriod(uint8_t taskId, unsigned long period);
+    
+    /**
+     * @brief Set the function called when a task misses its deadline
+     * @param callback Overrun callback (nullptr to disable)
+     */
+    void setOverrunCallback(OverrunCallback callback);
+    
+    /**
+     * @brief Run the most urgent due task, if any
+     * 
+     * Call this from loop().
+     * 
+     * @return true if a task was run
+     */
+    bool run();
+    
+    /**
+     * @brief Get the time until the next task release
+     * @return Time in ms until a task is due (0 if one is due now,
+     *         NO_RELEASE if no task is enabled)
+     */
+    unsigned long getIdleTime();
+    
+    /**
+     * @brief Get the number of times a task started after its deadline
+     * @param taskId Task id
+     * @return Overrun count
+     */
+    uint16_t getOverrunCount(uint8_t taskId) const;
+    
+    /**
+     * @brief Get the longest execution time of a single task step
+     * @param taskId Task id
+     * @return Execution time in microseconds
+     */
+    unsigned long getMaxRunTime(uint8_t taskId) const;
+    
+    /**
+     * @brief Get the longest execution time of any single task step
+     * @return Execution time in microseconds
+     */
+    unsigned long getMaxStepTime() const;
+    
+    /**
+     * @brief Get how long the last task run waited after its release
+     * 
+     * The lateness of every task start, not only of overruns, shows how
+     * far the loop has fallen behind.
+     * 
+     * @return Time in ms between the release and the start of the step
+     */
+    unsigned long getLastLateness() const;
+    
+    // Maximum number of tasks
+    static const uint8_t MAX_TASKS = 8;
+    
+    // Returned by addTask() when no slot is left
+    static const uint8_t INVALID_TASK = 0xFF;
+    
+    // Returned by getIdleTime() when no task will ever be released
+    static const unsigned long NO_RELEASE = 0xFFFFFFFFUL;
+    
+private:
+    // Registered task
+    struct Task {
+        TaskCallback callback;
+        unsigned long period;
+        unsigned long deadline;
+        unsigned long nextRelease;
+        unsigned long maxRunTime;
+        uint16_t overrunCount;
+        bool enabled;
+    };
+    
+    Task _tasks[MAX_TASKS];
+    uint8_t _taskCount;
+    OverrunCallback _overrunCallback;
+    unsigned long _maxStepTime;
+    unsigned long _lastLateness;
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,67 @@
+/**
+ * @file SensorTrace.cpp
+ * @brief Raw driver input recording implementation
+ * @author catalina
+ */
+
+#include "SensorTrace.h"
+
+namespace {
+    const uint8_t CHANNEL_COUNT = static_cast<uint8_t>(TraceChannel::CHANNEL_COUNT);
+    
+    // Channel names, by channel
+    const char NAME_ECHO[] PROGMEM = "echo";
+    const char NAME_RED[] PROGMEM = "red";
+    const char NAME_GREEN[] PROGMEM = "green";
+    const char NAME_BLUE[] PROGMEM = "blue";
+    const char NAME_UNKNOWN[] PROGMEM = "unknown";
+    
+    const char* const CHANNEL_NAMES[] PROGMEM = {
+        NAME_ECHO,
+        NAME_RED,
+        NAME_GREEN,
+        NAME_BLUE
+    };
+    static_assert(sizeof(CHANNEL_NAMES) / sizeof(CHANNEL_NAMES[0]) == CHANNEL_COUNT, "CHANNEL_NAMES must list every TraceChannel");
+}
+
+SENSOR_TRACE_STORAGE SensorTrace::Sink SensorTrace::_sink = nullptr;
+SENSOR_TRACE_STORAGE SpscRing<SensorTrace::QueuedSample, SensorTrace::QUEUE_SIZE> SensorTrace::_queue;
+
+void SensorTrace::setSink(Sink sink) {
+    flush();
+    _sink = sink;
+}
+
+bool SensorTrace::isRecording() {
+    return _sink != nullptr;
+}
+
+void SensorTrace::record(TraceChannel channel, unsigned long value) {
+    if (_sink != nullptr) {
+        QueuedSample sample = { micros(), value, channel };
+        _queue.push(sample);
+    }
+}
+
+uint8_t SensorTrace::flush() {
+    uint8_t count = 0;
+    QueuedSample sample;
+    while (_queue.pop(sample)) {
+        if (_sink != nullptr) {
+            _sink(sample.channel, sample.timestamp, sample.value);
+        }
+        count++;
+    }
+    return count;
+}
+
+uint16_t SensorTrace::getDroppedCount() {
+    return _queue.getOverflowCount();
+}
+
+const __FlashStringHelper* SensorTrace::getChannelName(TraceChannel channel) {
+    uint8_t index = static_cast<uint8_t>(channel);
+    PGM_P name = index < CHANNEL_COUNT ? static_cast<PGM_P>(pgm_read_ptr(&CHANNEL_NAMES[index])) : NAME_UNKNOWN;
+    return reinterpret_cast<const __FlashStringHelper*>(name);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file SensorTrace.h
+ * @brief Hook for recording the raw inputs the sensor drivers see
+ * @author catalina
+ */
+
+#ifndef SENSOR_TRACE_H
+#define SENSOR_TRACE_H
+
+#include <Arduino.h>
+#include "../SpscRing/SpscRing.h"
+
+// Set to 1 (here or with -DDISTANCE_DETECTOR_TRACING=1) to compile the trace hooks in
+#ifndef DISTANCE_DETECTOR_TRACING
+#define DISTANCE_DETECTOR_TRACING 0
+#endif
+
+// On the host every simulated device thread keeps its own sink
+#ifdef ARDUINO
+#define SENSOR_TRACE_STORAGE
+#else
+#define SENSOR_TRACE_STORAGE thread_local
+#endif
+
+// Raw driver inputs
+enum class TraceChannel : uint8_t {
+    ECHO = 0,       // HC-SR04 echo pulse width
+    COLOR_RED,      // TCS230 output pulse width per filter
+    COLOR_GREEN,
+    COLOR_BLUE,
+    CHANNEL_COUNT
+};
+
+/**
+ * @class SensorTrace
+ * @brief Forwards every raw pulse width the drivers measure to a sink
+ * 
+ * The drivers mark their raw readings with TRACE_SAMPLE(). While a sink is
+ * set, each reading is stamped and published into a lock-free ring, and
+ * flush() passes the queued readings to the sink; a sketch typically
+ * forwards them as telemetry samples so the readings can be replayed
+ * through the drivers later. Publishing is a few byte copies, so it is
+ * safe from an interrupt and keeps the sink's cost out of the timed
+ * acquisition. Readings that find the ring full are dropped and counted.
+ * With DISTANCE_DETECTOR_TRACING set to 0 the macro expands to nothing.
+ */
+class SensorTrace {
+public:
+    // Receives one raw reading; timestamp in µs
+    typedef void (*Sink)(TraceChannel channel, unsigned long timestamp, unsigned long value);
+    
+    /**
+     * @brief Start or stop recording
+     * 
+     * Readings still queued are passed to the previous sink first.
+     * 
+     * @param sink Sink for the readings (nullptr to stop)
+     */
+    static void setSink(Sink sink);
+    
+    /**
+     * @brief Check if readings are being recorded
+     * @return true if a sink is set
+     */
+    static bool isRecording();
+    
+    /**
+     * @brief Queue a reading for the sink, if any
+     * 
+     * @param channel Input the reading came from
+     * @param value Raw value (pulse width in µs)
+     */
+    static void record(TraceChannel channel, unsigned long value);
+    
+    /**
+     * @brief Pass the queued readings to the sink
+     * 
+     * Call from loop(), not from an interrupt.
+     * 
+     * @return Number of readings passed on
+     */
+    static uint8_t flush();
+    
+    /**
+     * @brief Get the number of readings dropped because the queue was full
+     * @return Drop count since start
+     */
+    static uint16_t getDroppedCount();
+    
+    /**
+     * @brief Get the short name of a channel
+     * @param channel Channel
+     * @return Flash pointer to the channel name
+     */
+    static const __FlashStringHelper* getChannelName(TraceChannel channel);
+    
+    // Readings queued between two flush() calls
+    static const uint8_t QUEUE_SIZE = 8;
+    
+private:
+    // One queued reading
+    struct QueuedSample {
+        unsigned long timestamp;    // µs
+        unsigned long value;
+        TraceChannel channel;
+    };
+    
+    static SENSOR_TRACE_STORAGE Sink _sink;
+    static SENSOR_TRACE_STORAGE SpscRing<QueuedSample, QUEUE_SIZE> _queue;
+};
+
+#if DISTANCE_DETECTOR_TRACING
+#define TRACE_SAMPLE(channel, value) SensorTrace::record(TraceChannel::channel, value)
+#else
+#define TRACE_SAMPLE(channel, value) do {} while (0)
+#endif
+
+#endif // SENSOR_TRACE_H
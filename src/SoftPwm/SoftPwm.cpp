@@ -0,0 +1,366 @@
+/**
+ * @file SoftPwm.cpp
+ * @brief 8-bit brightness on any output pin by bit-angle modulation implementation
+ * @author catalina
+ */
+
+#include "SoftPwm.h"
+
+#ifndef ARDUINO
+#include <VirtualDevice.h>
+#endif
+
+namespace {
+    const uint8_t SLICES = 8;
+    const unsigned long FRAME_US = 255UL * SoftPwm::TICK_US;
+    
+    struct Channel {
+        uint8_t pin;
+        uint8_t port;           // Index into Engine::ports
+        uint8_t mask;           // Bit of the pin in its port
+        uint8_t level;
+        uint8_t target;         // Level at the end of the running ramp
+        uint16_t value;         // Level in 8.8 fixed point while fading
+        int16_t step;           // Change of value per frame
+        uint16_t frames;        // Frames left in the running ramp (0 = steady)
+        uint16_t rampFrames;    // Frames per ramp of a pulse
+        uint16_t ramps;         // Pulse ramps left after the running one
+    };
+    
+    // Pins on one output port; on the host all pins form a single port
+    struct Port {
+#ifdef ARDUINO
+        volatile uint8_t* out;
+#endif
+        uint8_t mask;           // Attached pins on this port
+        uint8_t shown;          // Bits of the last write
+        uint8_t planes[SLICES]; // Attached pins lit during each slice
+    };
+    
+    struct Engine {
+        Channel channels[SoftPwm::MAX_CHANNELS];
+        Port ports[SoftPwm::MAX_CHANNELS];
+        uint8_t channelCount;
+        uint8_t portCount;
+        uint8_t slice;          // Bit whose slice is running
+    };
+    
+    // On the host every simulated device thread drives its own pins
+#ifdef ARDUINO
+    Engine engine;
+#else
+    thread_local Engine engine;
+#endif
+    
+    int8_t findChannel(uint8_t pin) {
+        for (uint8_t i = 0; i < engine.channelCount; i++) {
+            if (engine.channels[i].pin == pin) {
+                return i;
+            }
+        }
+        return -1;
+    }
+    
+    void showPlane(Port& port, uint8_t plane) {
+#ifdef ARDUINO
+        *port.out = (*port.out & ~port.mask) | plane;
+#else
+        // No port registers on the host: write the pins that change
+        uint8_t changed = plane ^ port.shown;
+        for (uint8_t i = 0; changed != 0 && i < engine.channelCount; i++) {
+            const Channel& channel = engine.channels[i];
+            if (&engine.ports[channel.port] == &port && (changed & channel.mask)) {
+                digitalWrite(channel.pin, (plane & channel.mask) ? HIGH : LOW);
+            }
+        }
+#endif
+        port.shown = plane;
+    }
+    
+    void setLevel(Channel& channel, uint8_t level) {
+        channel.level = level;
+        Port& port = engine.ports[channel.port];
+        for (uint8_t bit = 0; bit < SLICES; bit++) {
+            if (level & (1 << bit)) {
+                port.planes[bit] |= channel.mask;
+            } else {
+                port.planes[bit] &= ~channel.mask;
+            }
+        }
+    }
+    
+    // Start a ramp from the current value, over at least one frame
+    void startRamp(Channel& channel, uint8_t target, uint16_t frames) {
+        channel.target = target;
+        channel.frames = frames > 0 ? frames : 1;
+        channel.step = channel.frames > 1
+            ? (static_cast<long>(target) * 256 - channel.value) / channel.frames
+            : 0; // The last frame lands on the target
+    }
+    
+    uint16_t framesOf(uint16_t duration) {
+        return static_cast<uint16_t>(duration * 1000UL / FRAME_US);
+    }
+    
+    // Dimmed and fading pins need the slices; on and off pins do not
+    bool needsTimer() {
+        for (uint8_t i = 0; i < engine.channelCount; i++) {
+            const Channel& channel = engine.channels[i];
+            if (channel.frames > 0 || (channel.level != 0 && channel.level != 255)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void onSlice();
+
+#ifdef ARDUINO
+    // Timer1 counts at F_CPU / 8
+    const uint16_t TICK_COUNTS = SoftPwm::TICK_US * (F_CPU / 8000000UL);
+    
+    void setSliceLength(uint8_t bit) {
+        OCR1A = (TICK_COUNTS << bit) - 1;
+        
+        // A handler held up past a short slice would otherwise let the
+        // counter run on to 0xFFFF
+        if (TCNT1 > OCR1A) {
+            TCNT1 = 0;
+        }
+    }
+    
+    void startTimer() {
+        TCCR1B = 0;
+        TCCR1A = 0;
+        TCNT1 = 0;
+        OCR1A = TICK_COUNTS - 1;
+        TIFR1 = _BV(OCF1A);
+        TIMSK1 |= _BV(OCIE1A);
+        TCCR1B = _BV(WGM12) | _BV(CS11); // CTC on OCR1A, clock / 8
+    }
+    
+    void stopTimer() {
+        TCCR1B = 0;
+        TIMSK1 &= ~_BV(OCIE1A);
+    }
+    
+    bool timerRunning() {
+        return TCCR1B != 0;
+    }
+#else
+    void setSliceLength(uint8_t bit) {
+        VirtualDevice::current().setTimerPeriod((static_cast<uint64_t>(SoftPwm::TICK_US) * 1000) << bit);
+    }
+    
+    void startTimer() {
+        VirtualDevice::current().startTimer(SoftPwm::TICK_US * 1000ULL, onSlice);
+    }
+    
+    void stopTimer() {
+        VirtualDevice::current().stopTimer();
+    }
+    
+    bool timerRunning() {
+        return VirtualDevice::current().timerRunning();
+    }
+#endif
+    
+    // Once per frame: move every fading channel one step
+    void stepFades() {
+        for (uint8_t i = 0; i < engine.channelCount; i++) {
+            Channel& channel = engine.channels[i];
+            if (channel.frames == 0) {
+                continue;
+            }
+            
+            channel.value += channel.step;
+            if (--channel.frames == 0) {
+                channel.value = static_cast<uint16_t>(channel.target) * 256;
+                if (channel.ramps > 0) {
+                    channel.ramps--;
+                    startRamp(channel, channel.target == 0 ? 255 : 0, channel.rampFrames);
+                }
+            }
+            setLevel(channel, channel.value >> 8);
+        }
+    }
+    
+    // Called with interrupts off: run the timer only while it is needed
+    void refresh() {
+        if (needsTimer()) {
+            if (!timerRunning()) {
+                engine.slice = 0;
+                for (uint8_t i = 0; i < engine.portCount; i++) {
+                    showPlane(engine.ports[i], engine.ports[i].planes[0]);
+                }
+                startTimer();
+            }
+            return;
+        }
+        
+        // Every level is 0 or 255, so each plane holds the steady state
+        if (timerRunning()) {
+            stopTimer();
+        }
+        for (uint8_t i = 0; i < engine.portCount; i++) {
+            showPlane(engine.ports[i], engine.ports[i].planes[0]);
+        }
+    }
+    
+    void onSlice() {
+        uint8_t bit = (engine.slice + 1) & (SLICES - 1);
+        engine.slice = bit;
+        for (uint8_t i = 0; i < engine.portCount; i++) {
+            showPlane(engine.ports[i], engine.ports[i].planes[bit]);
+        }
+        setSliceLength(bit);
+        
+        // The longest slice leaves time for the fades; the new levels
+        // show from the next frame on
+        if (bit == SLICES - 1) {
+            stepFades();
+            if (!needsTimer()) {
+                refresh();
+            }
+        }
+    }
+}
+
+#ifdef ARDUINO
+ISR(TIMER1_COMPA_vect) {
+    onSlice();
+}
+#endif
+
+bool SoftPwm::attach(uint8_t pin) {
+    if (findChannel(pin) >= 0) {
+        return true;
+    }
+    if (engine.channelCount >= MAX_CHANNELS) {
+        return false;
+    }
+    
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    
+    noInterrupts();
+    uint8_t index = engine.channelCount;
+    Channel& channel = engine.channels[index];
+    channel.pin = pin;
+    channel.level = 0;
+    channel.target = 0;
+    channel.value = 0;
+    channel.step = 0;
+    channel.frames = 0;
+    channel.rampFrames = 0;
+    channel.ramps = 0;
+    
+    // Share the port with the pins already on it
+    uint8_t port = 0;
+#ifdef ARDUINO
+    volatile uint8_t* out = portOutputRegister(digitalPinToPort(pin));
+    channel.mask = digitalPinToBitMask(pin);
+    while (port < engine.portCount && engine.ports[port].out != out) {
+        port++;
+    }
+#else
+    channel.mask = 1 << index;
+#endif
+    if (port == engine.portCount) {
+        Port& added = engine.ports[port];
+#ifdef ARDUINO
+        added.out = out;
+#endif
+        added.mask = 0;
+        added.shown = 0;
+        for (uint8_t bit = 0; bit < SLICES; bit++) {
+            added.planes[bit] = 0;
+        }
+        engine.portCount++;
+    }
+    channel.port = port;
+    engine.ports[port].mask |= channel.mask;
+    engine.channelCount++;
+    interrupts();
+    return true;
+}
+
+void SoftPwm::write(uint8_t pin, uint8_t level) {
+    int8_t index = findChannel(pin);
+    if (index < 0) {
+        return;
+    }
+    
+    noInterrupts();
+    Channel& channel = engine.channels[index];
+    channel.frames = 0;
+    channel.ramps = 0;
+    channel.value = static_cast<uint16_t>(level) * 256;
+    setLevel(channel, level);
+    refresh();
+    interrupts();
+}
+
+void SoftPwm::fade(uint8_t pin, uint8_t level, uint16_t duration) {
+    int8_t index = findChannel(pin);
+    if (index < 0) {
+        return;
+    }
+    
+    noInterrupts();
+    Channel& channel = engine.channels[index];
+    channel.ramps = 0;
+    channel.value = static_cast<uint16_t>(channel.level) * 256;
+    startRamp(channel, level, framesOf(duration));
+    refresh();
+    interrupts();
+}
+
+void SoftPwm::pulse(uint8_t pin, uint8_t count, uint16_t duration) {
+    int8_t index = findChannel(pin);
+    if (index < 0 || count == 0) {
+        return;
+    }
+    
+    // Up and down ramps alternate from off, each half a pulse long
+    noInterrupts();
+    Channel& channel = engine.channels[index];
+    channel.value = 0;
+    setLevel(channel, 0);
+    channel.rampFrames = framesOf(duration / 2);
+    channel.ramps = count * 2 - 1;
+    startRamp(channel, 255, channel.rampFrames);
+    refresh();
+    interrupts();
+}
+
+uint8_t SoftPwm::read(uint8_t pin) {
+    int8_t index = findChannel(pin);
+    if (index < 0) {
+        return 0;
+    }
+    
+    noInterrupts();
+    uint8_t level = engine.channels[index].level;
+    interrupts();
+    return level;
+}
+
+bool SoftPwm::isFading(uint8_t pin) {
+    int8_t index = findChannel(pin);
+    if (index < 0) {
+        return false;
+    }
+    
+    noInterrupts();
+    bool fading = engine.channels[index].frames > 0;
+    interrupts();
+    return fading;
+}
+
+bool SoftPwm::isActive() {
+    noInterrupts();
+    bool active = timerRunning();
+    interrupts();
+    return active;
+}
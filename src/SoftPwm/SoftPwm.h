@@ -0,0 +1,96 @@
+/**
+ * @file SoftPwm.h
+ * @brief 8-bit brightness on any output pin by bit-angle modulation
+ * @author catalina
+ */
+
+#ifndef SOFT_PWM_H
+#define SOFT_PWM_H
+
+#include <Arduino.h>
+
+/**
+ * @class SoftPwm
+ * @brief Timer1-driven bit-angle modulation (BAM) of up to MAX_CHANNELS pins
+ * 
+ * A frame is split into eight slices, one per bit of the brightness, the
+ * slice of bit n lasting TICK_US << n. At the start of a slice the Timer1
+ * compare interrupt writes a precomputed port value that has a pin high
+ * if that bit of its level is set, so a pin is lit for level/255 of the
+ * frame. Every pin on a port changes with one write, and the handler does
+ * the same small amount of work in every slice, whatever the levels.
+ * A frame takes 255 ticks (8.16 ms, 122 Hz).
+ * 
+ * Fades and pulses run in the interrupt as well: once per frame, during
+ * the longest slice, each fading channel moves one step and its bits are
+ * rebuilt, so the main loop only starts them. The timer runs only while
+ * some pin is dimmed or fading; fully on and off pins are written once
+ * and cost nothing afterwards.
+ * 
+ * The engine owns Timer1 and its compare A vector (the Servo library
+ * cannot be used alongside). All writes to an attached pin must go
+ * through it, since every slice overwrites the pin. Timer1 stops in
+ * power-down, so isActive() must keep the MCU in idle sleep.
+ */
+class SoftPwm {
+public:
+    /**
+     * @brief Add a pin to the engine
+     * 
+     * The pin becomes an output and starts off. Attaching a pin twice
+     * has no further effect.
+     * 
+     * @param pin Output pin
+     * @return false if MAX_CHANNELS pins are already attached
+     */
+    static bool attach(uint8_t pin);
+    
+    /**
+     * @brief Set a steady brightness, stopping any fade on the pin
+     * @param pin Attached pin
+     * @param level Brightness (0-255)
+     */
+    static void write(uint8_t pin, uint8_t level);
+    
+    /**
+     * @brief Ramp the brightness to a level
+     * @param pin Attached pin
+     * @param level Final brightness (0-255)
+     * @param duration Ramp time in ms
+     */
+    static void fade(uint8_t pin, uint8_t level, uint16_t duration);
+    
+    /**
+     * @brief Fade in and out, ending off
+     * @param pin Attached pin
+     * @param count Number of pulses
+     * @param duration Duration of each pulse in ms
+     */
+    static void pulse(uint8_t pin, uint8_t count, uint16_t duration);
+    
+    /**
+     * @brief Get the current brightness of a pin
+     * @param pin Attached pin
+     * @return Brightness (0 for a pin that is not attached)
+     */
+    static uint8_t read(uint8_t pin);
+    
+    /**
+     * @brief Check if a fade or pulse is running on a pin
+     * @param pin Attached pin
+     */
+    static bool isFading(uint8_t pin);
+    
+    /**
+     * @brief Check if the timer runs (a pin is dimmed or fading)
+     */
+    static bool isActive();
+    
+    // Most pins the engine drives
+    static const uint8_t MAX_CHANNELS = 4;
+    
+    // Length of the shortest slice in µs
+    static const uint8_t TICK_US = 32;
+};
+
+#endif // SOFT_PWM_H
@@ -0,0 +1,176 @@
+/**
+ * @file SpscRing.h
+ * @brief Lock-free single-producer / single-consumer ring buffer
+ * @author catalina
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <Arduino.h>
+
+#ifndef ARDUINO
+#include <atomic>
+#endif
+
+/**
+ * @class SpscRing
+ * @brief Fixed-capacity queue between one producer and one consumer
+ * 
+ * The producer (typically an interrupt handler) only writes the head
+ * index and the consumer (loop()) only writes the tail, so neither side
+ * ever has to disable interrupts or take a lock. Both indices run freely
+ * modulo 256 and are masked on access, so all CAPACITY slots are usable.
+ * 
+ * A slot is written before the head that publishes it, and read before
+ * the tail that frees it. On AVR, byte accesses are atomic and a single
+ * core only needs a compiler barrier to keep that order; on the host the
+ * indices are std::atomic with acquire/release ordering, so one producer
+ * thread and one consumer thread may use the ring concurrently.
+ * 
+ * push() on a full ring drops the item and counts an overflow.
+ * 
+ * @tparam T Trivially copyable item type
+ * @tparam CAPACITY Number of slots, a power of two from 2 to 128
+ */
+template <typename T, uint8_t CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY >= 2 && CAPACITY <= 128 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "SpscRing capacity must be a power of two from 2 to 128");
+    
+public:
+    SpscRing() : _head(0), _tail(0), _overflows(0) {
+    }
+    
+    /**
+     * @brief Append an item (producer only)
+     * @param item Item to copy in
+     * @return true if queued, false if the ring was full
+     */
+    bool push(const T& item) {
+        uint8_t head = loadRelaxed(_head);
+        if (static_cast<uint8_t>(head - loadAcquire(_tail)) >= CAPACITY) {
+            countOverflow();
+            return false;
+        }
+        _items[head & MASK] = item;
+        storeRelease(_head, head + 1);
+        return true;
+    }
+    
+    /**
+     * @brief Remove the oldest item (consumer only)
+     * @param item Receives the item
+     * @return true if an item was removed, false if the ring was empty
+     */
+    bool pop(T& item) {
+        uint8_t tail = loadRelaxed(_tail);
+        if (tail == loadAcquire(_head)) {
+            return false;
+        }
+        item = _items[tail & MASK];
+        storeRelease(_tail, tail + 1);
+        return true;
+    }
+    
+    /**
+     * @brief Drop every queued item (consumer only)
+     */
+    void clear() {
+        storeRelease(_tail, loadAcquire(_head));
+    }
+    
+    /**
+     * @brief Get the number of queued items
+     * 
+     * Exact on either side while the other side is idle, otherwise a
+     * snapshot.
+     */
+    uint8_t size() const {
+        return static_cast<uint8_t>(loadAcquire(_head) - loadAcquire(_tail));
+    }
+    
+    /**
+     * @brief Check if nothing is queued
+     */
+    bool isEmpty() const {
+        return size() == 0;
+    }
+    
+    /**
+     * @brief Get the number of items dropped because the ring was full
+     */
+    uint16_t getOverflowCount() const {
+        return loadOverflows();
+    }
+    
+private:
+    static const uint8_t MASK = CAPACITY - 1;
+
+#ifdef ARDUINO
+    typedef volatile uint8_t Index;
+    
+    static uint8_t loadRelaxed(const Index& index) {
+        return index;
+    }
+    
+    static uint8_t loadAcquire(const Index& index) {
+        uint8_t value = index;
+        asm volatile("" ::: "memory");
+        return value;
+    }
+    
+    static void storeRelease(Index& index, uint8_t value) {
+        asm volatile("" ::: "memory");
+        index = value;
+    }
+    
+    void countOverflow() {
+        _overflows = _overflows + 1;
+    }
+    
+    uint16_t loadOverflows() const {
+        // A 16-bit read is two byte reads; retry if the producer moved it in between
+        uint16_t value;
+        do {
+            value = _overflows;
+        } while (value != _overflows);
+        return value;
+    }
+    
+    Index _head;
+    Index _tail;
+    volatile uint16_t _overflows;
+#else
+    typedef std::atomic<uint8_t> Index;
+    
+    static uint8_t loadRelaxed(const Index& index) {
+        return index.load(std::memory_order_relaxed);
+    }
+    
+    static uint8_t loadAcquire(const Index& index) {
+        return index.load(std::memory_order_acquire);
+    }
+    
+    static void storeRelease(Index& index, uint8_t value) {
+        index.store(value, std::memory_order_release);
+    }
+    
+    void countOverflow() {
+        _overflows.store(_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    
+    uint16_t loadOverflows() const {
+        return _overflows.load(std::memory_order_relaxed);
+    }
+    
+    // Producer and consumer indices on separate cache lines
+    alignas(64) Index _head;
+    alignas(64) Index _tail;
+    std::atomic<uint16_t> _overflows;
+#endif
+    
+    T _items[CAPACITY];
+};
+
+#endif // SPSC_RING_H
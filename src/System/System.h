@@ -0,0 +1,478 @@
+/**
+ * @file System.h
+ * @brief Compile-time composition of drivers, their pins and periodic tasks
+ * @author catalina
+ */
+
+#ifndef SYSTEM_H
+#define SYSTEM_H
+
+#include <Arduino.h>
+#include "../ColorSensor/ColorSensor.h"
+#include "../DistanceSensor/DistanceSensor.h"
+#include "../DisplayManager/DisplayManager.h"
+#include "../LedManager/LedManager.h"
+#include "../AudioManager/AudioManager.h"
+
+namespace SystemDetail {
+    // Digital pins of the Uno: D0-D13 and A0-A5 as 14-19
+    const uint8_t PIN_LIMIT = 20;
+    
+    // Hardware serial (RX, TX) and the I2C bus (SDA, SCL)
+    const uint32_t SERIAL_PINS = (1UL << 0) | (1UL << 1);
+    const uint32_t I2C_PINS = (1UL << 18) | (1UL << 19);
+    
+    template <uint8_t PIN>
+    struct PinBit {
+        static_assert(PIN < PIN_LIMIT, "Pin number out of range for the Uno");
+        static const uint32_t value = 1UL << PIN;
+    };
+    
+    constexpr uint8_t bitCount(uint32_t bits) {
+        return bits == 0 ? 0 : static_cast<uint8_t>((bits & 1) + bitCount(bits >> 1));
+    }
+    
+    // Pins of a list of pin sets, and whether any two sets share one
+    template <typename... Parts>
+    struct PinUsage {
+        static const uint32_t mask = 0;
+        static const bool disjoint = true;
+    };
+    
+    template <typename First, typename... Rest>
+    struct PinUsage<First, Rest...> {
+        static const uint32_t mask = First::PIN_MASK | PinUsage<Rest...>::mask;
+        static const bool disjoint = (First::PIN_MASK & PinUsage<Rest...>::mask) == 0
+                                     && PinUsage<Rest...>::disjoint;
+    };
+    
+    // Position of a task type in a task list (the list length if absent)
+    template <typename Step, typename... Steps>
+    struct TaskIndex {
+        static const uint8_t value = 0;
+    };
+    
+    template <typename Step, typename... Rest>
+    struct TaskIndex<Step, Step, Rest...> {
+        static const uint8_t value = 0;
+    };
+    
+    template <typename Step, typename First, typename... Rest>
+    struct TaskIndex<Step, First, Rest...> {
+        static const uint8_t value = 1 + TaskIndex<Step, Rest...>::value;
+    };
+    
+    template <typename Driver>
+    struct DriverTag {};
+}
+
+/**
+ * @brief Ultrasonic sensor on a trigger pin and an echo pin
+ * 
+ * The echo is timed by a pin-change interrupt, so it needs one of the
+ * Uno's external interrupt pins.
+ */
+template <uint8_t TRIG, uint8_t ECHO>
+struct DistancePins {
+    static_assert(ECHO == 2 || ECHO == 3, "The echo pin must be an external interrupt pin (2 or 3)");
+    
+    typedef DistanceSensor Driver;
+    static const uint32_t PIN_MASK = SystemDetail::PinBit<TRIG>::value | SystemDetail::PinBit<ECHO>::value;
+    static const uint8_t PIN_COUNT = 2;
+    
+    DistancePins() : driver(TRIG, ECHO) {}
+    Driver driver;
+};
+
+/**
+ * @brief TCS230 color sensor on its scaling, filter and output pins
+ */
+template <uint8_t S0, uint8_t S1, uint8_t S2, uint8_t S3, uint8_t OUT>
+struct ColorPins {
+    typedef ColorSensor Driver;
+    static const uint32_t PIN_MASK = SystemDetail::PinBit<S0>::value | SystemDetail::PinBit<S1>::value
+                                     | SystemDetail::PinBit<S2>::value | SystemDetail::PinBit<S3>::value
+                                     | SystemDetail::PinBit<OUT>::value;
+    static const uint8_t PIN_COUNT = 5;
+    
+    ColorPins() : driver(S0, S1, S2, S3, OUT) {}
+    Driver driver;
+};
+
+/**
+ * @brief Red, green and yellow indicator LEDs
+ */
+template <uint8_t RED, uint8_t GREEN, uint8_t YELLOW>
+struct LedPins {
+    typedef LedManager Driver;
+    static const uint32_t PIN_MASK = SystemDetail::PinBit<RED>::value | SystemDetail::PinBit<GREEN>::value
+                                     | SystemDetail::PinBit<YELLOW>::value;
+    static const uint8_t PIN_COUNT = 3;
+    
+    LedPins() : driver(RED, GREEN, YELLOW) {}
+    Driver driver;
+};
+
+/**
+ * @brief Piezo buzzer on one pin
+ */
+template <uint8_t PIN>
+struct BuzzerPin {
+    typedef AudioManager Driver;
+    static const uint32_t PIN_MASK = SystemDetail::PinBit<PIN>::value;
+    static const uint8_t PIN_COUNT = 1;
+    
+    BuzzerPin() : driver(PIN) {}
+    Driver driver;
+};
+
+/**
+ * @brief Character LCD on the I2C bus (A4 and A5)
+ */
+template <uint8_t ADDRESS = 0x27, uint8_t COLUMNS = 16, uint8_t ROWS = 2>
+struct I2cLcd {
+    typedef DisplayManager Driver;
+    static const uint32_t PIN_MASK = SystemDetail::I2C_PINS;
+    static const uint8_t PIN_COUNT = 2;
+    
+    I2cLcd() : driver(ADDRESS, COLUMNS, ROWS) {}
+    Driver driver;
+};
+
+/**
+ * @class DriverSet
+ * @brief Holds one driver per pin set, looked up by driver type
+ * 
+ * begin() starts the drivers in list order. Each driver type may appear
+ * only once.
+ */
+template <typename... Parts>
+class DriverSet {
+public:
+    void begin() {}
+    
+protected:
+    void driver() {}
+};
+
+template <typename First, typename... Rest>
+class DriverSet<First, Rest...> : public DriverSet<Rest...> {
+    static_assert(SystemDetail::bitCount(First::PIN_MASK) == First::PIN_COUNT,
+                  "A driver uses the same pin twice");
+    
+public:
+    void begin() {
+        _part.driver.begin();
+        DriverSet<Rest...>::begin();
+    }
+    
+protected:
+    using DriverSet<Rest...>::driver;
+    
+    typename First::Driver& driver(SystemDetail::DriverTag<typename First::Driver>) {
+        return _part.driver;
+    }
+    
+private:
+    First _part;
+};
+
+/**
+ * @brief Task calling a free function
+ * 
+ * @tparam STEP Step function
+ * @tparam PERIOD_MS Release period in ms (0 = run once)
+ * @tparam DEADLINE_MS Time in ms after release by which the step must start (0 = one period)
+ */
+template <void (*STEP)(), unsigned long PERIOD_MS, unsigned long DEADLINE_MS = 0>
+struct PeriodicTask {
+    static const unsigned long PERIOD = PERIOD_MS;
+    static const unsigned long DEADLINE = DEADLINE_MS;
+    
+    template <typename Drivers>
+    static void step(Drivers&) {
+        STEP();
+    }
+};
+
+/**
+ * @brief Task calling update() on a driver of the system
+ * 
+ * @tparam Driver Driver type (LedManager, AudioManager, ...)
+ * @tparam PERIOD_MS Release period in ms
+ * @tparam DEADLINE_MS Time in ms after release by which the step must start (0 = one period)
+ */
+template <typename Driver, unsigned long PERIOD_MS, unsigned long DEADLINE_MS = 0>
+struct DriverUpdate {
+    static const unsigned long PERIOD = PERIOD_MS;
+    static const unsigned long DEADLINE = DEADLINE_MS;
+    
+    template <typename Drivers>
+    static void step(Drivers& drivers) {
+        drivers.template get<Driver>().update();
+    }
+};
+
+/**
+ * @brief List of the tasks a System runs; the position is the task id
+ */
+template <typename... Steps>
+struct TaskSet {};
+
+template <typename Drivers, typename Tasks>
+class System;
+
+/**
+ * @class System
+ * @brief Drivers and periodic tasks fixed at compile time
+ * 
+ * The drivers are named by their pin sets, so only the listed drivers
+ * exist and pin conflicts (two drivers on one pin, the serial pins, the
+ * I2C pins with an LCD present, an echo pin without an interrupt) fail
+ * to compile.
+ * 
+ * The tasks are scheduled like Scheduler does it: run() starts the due
+ * task with the earliest deadline, at most one per call, and reports
+ * tasks that start late. The task list is a type, though, so the search
+ * is unrolled with each task's deadline rule folded in, and the chosen
+ * step is a direct call the compiler can inline. The task state is sized
+ * to the list: a release time and a period per task and one enable bit.
+ * Step run times are not measured; the stage timers of the Profiler
+ * cover that when profiling is compiled in.
+ * 
+ * Tasks are addressed by type, e.g. system.disable<PipelineTask>().
+ * 
+ * @tparam Drivers DriverSet of pin sets
+ * @tparam Tasks TaskSet of PeriodicTask and DriverUpdate types
+ */
+template <typename... Parts, typename... Steps>
+class System<DriverSet<Parts...>, TaskSet<Steps...>> : private DriverSet<Parts...> {
+    static_assert(sizeof...(Steps) >= 1 && sizeof...(Steps) <= 16, "A system runs 1 to 16 tasks");
+    static_assert(SystemDetail::PinUsage<Parts...>::disjoint, "Two drivers share a pin");
+    static_assert((SystemDetail::PinUsage<Parts...>::mask & SystemDetail::SERIAL_PINS) == 0,
+                  "Pins 0 and 1 belong to the serial port");
+    
+public:
+    // Overrun report: task id and how late it started in milliseconds
+    typedef void (*OverrunCallback)(uint8_t taskId, unsigned long lateness);
+    
+    static const uint8_t TASK_COUNT = sizeof...(Steps);
+    
+    System() : _enabled(0), _overrunCallback(nullptr), _lastLateness(0) {
+        for (uint8_t i = 0; i < TASK_COUNT; i++) {
+            _nextRelease[i] = 0;
+        }
+        TaskList<0, Steps...>::initPeriods(_period);
+    }
+    
+    /**
+     * @brief Initialize the drivers in list order
+     */
+    void begin() {
+        DriverSet<Parts...>::begin();
+    }
+    
+    /**
+     * @brief Enable every task and release it now
+     */
+    void start() {
+        unsigned long now = millis();
+        for (uint8_t i = 0; i < TASK_COUNT; i++) {
+            _nextRelease[i] = now;
+        }
+        _enabled = static_cast<EnableMask>((1UL << TASK_COUNT) - 1);
+    }
+    
+    /**
+     * @brief Get a driver of the system
+     * @tparam Driver Driver type named by one of the pin sets
+     */
+    template <typename Driver>
+    Driver& get() {
+        return this->driver(SystemDetail::DriverTag<Driver>());
+    }
+    
+    /**
+     * @brief Get the id of a task, as passed to the overrun callback
+     */
+    template <typename Step>
+    static constexpr uint8_t taskId() {
+        return SystemDetail::TaskIndex<Step, Steps...>::value;
+    }
+    
+    /**
+     * @brief Enable a task, releasing it after a delay
+     * @param startDelay Time in ms before the next release
+     */
+    template <typename Step>
+    void enable(unsigned long startDelay = 0) {
+        const uint8_t id = checkedId<Step>();
+        _enabled |= taskBit(id);
+        _nextRelease[id] = millis() + startDelay;
+    }
+    
+    /**
+     * @brief Disable a task until it is enabled again
+     */
+    template <typename Step>
+    void disable() {
+        _enabled &= ~taskBit(checkedId<Step>());
+    }
+    
+    /**
+     * @brief Check if a task is enabled
+     */
+    template <typename Step>
+    bool isEnabled() const {
+        return (_enabled & taskBit(checkedId<Step>())) != 0;
+    }
+    
+    /**
+     * @brief Change the period of a task
+     * 
+     * A task without a fixed deadline keeps a deadline of one period.
+     * 
+     * @param period New period in milliseconds
+     */
+    template <typename Step>
+    void setPeriod(unsigned long period) {
+        _period[checkedId<Step>()] = period;
+    }
+    
+    /**
+     * @brief Set the function called when a task misses its deadline
+     * @param callback Overrun callback (nullptr to disable)
+     */
+    void setOverrunCallback(OverrunCallback callback) {
+        _overrunCallback = callback;
+    }
+    
+    /**
+     * @brief Run the most urgent due task, if any
+     * @return true if a task was run
+     */
+    bool run() {
+        unsigned long now = millis();
+        
+        uint8_t next = TASK_COUNT;
+        long nextSlack = 0;
+        TaskList<0, Steps...>::pick(_enabled, _nextRelease, _period, now, next, nextSlack);
+        if (next == TASK_COUNT) {
+            return false;
+        }
+        
+        _lastLateness = now - _nextRelease[next];
+        if (nextSlack < 0 && _overrunCallback != nullptr) {
+            _overrunCallback(next, (unsigned long)(-nextSlack));
+        }
+        
+        // Schedule the next release before running, so the task may disable itself
+        if (_period[next] == 0) {
+            _enabled &= ~taskBit(next);
+        } else {
+            _nextRelease[next] += _period[next];
+            
+            // Skip releases that were missed entirely instead of running them back to back
+            if ((long)(now - _nextRelease[next]) >= 0) {
+                _nextRelease[next] = now + _period[next];
+            }
+        }
+        
+        TaskList<0, Steps...>::dispatch(next, *this);
+        return true;
+    }
+    
+    /**
+     * @brief Get the time until the next task release
+     * @return Time in ms until a task is due (0 if one is due now)
+     */
+    unsigned long getIdleTime() const {
+        unsigned long now = millis();
+        unsigned long idle = 0;
+        bool found = false;
+        
+        for (uint8_t i = 0; i < TASK_COUNT; i++) {
+            if (!(_enabled & taskBit(i))) {
+                continue;
+            }
+            
+            long untilRelease = (long)(_nextRelease[i] - now);
+            if (untilRelease <= 0) {
+                return 0;
+            }
+            if (!found || (unsigned long)untilRelease < idle) {
+                idle = untilRelease;
+                found = true;
+            }
+        }
+        
+        return idle;
+    }
+    
+    /**
+     * @brief Get how long the last task run waited after its release
+     * @return Time in ms between the release and the start of the step
+     */
+    unsigned long getLastLateness() const {
+        return _lastLateness;
+    }
+    
+private:
+    typedef uint16_t EnableMask;
+    
+    // Compile-time walk over the task list; INDEX is the id of First
+    template <uint8_t INDEX, typename... Rest>
+    struct TaskList {
+        static void initPeriods(unsigned long*) {}
+        static void pick(EnableMask, const unsigned long*, const unsigned long*, unsigned long, uint8_t&, long&) {}
+        static void dispatch(uint8_t, System&) {}
+    };
+    
+    template <uint8_t INDEX, typename First, typename... Rest>
+    struct TaskList<INDEX, First, Rest...> {
+        static void initPeriods(unsigned long* period) {
+            period[INDEX] = First::PERIOD;
+            TaskList<INDEX + 1, Rest...>::initPeriods(period);
+        }
+        
+        // Pick the due task with the earliest absolute deadline; ties go to the lower id
+        static void pick(EnableMask enabled, const unsigned long* nextRelease, const unsigned long* period,
+                         unsigned long now, uint8_t& next, long& nextSlack) {
+            if ((enabled & (EnableMask(1) << INDEX)) && (long)(now - nextRelease[INDEX]) >= 0) {
+                unsigned long deadline = First::DEADLINE > 0 ? First::DEADLINE : period[INDEX];
+                long slack = (long)(nextRelease[INDEX] + deadline - now);
+                if (next == TASK_COUNT || slack < nextSlack) {
+                    next = INDEX;
+                    nextSlack = slack;
+                }
+            }
+            TaskList<INDEX + 1, Rest...>::pick(enabled, nextRelease, period, now, next, nextSlack);
+        }
+        
+        static void dispatch(uint8_t id, System& system) {
+            if (id == INDEX) {
+                First::step(system);
+            } else {
+                TaskList<INDEX + 1, Rest...>::dispatch(id, system);
+            }
+        }
+    };
+    
+    template <typename Step>
+    static constexpr uint8_t checkedId() {
+        static_assert(SystemDetail::TaskIndex<Step, Steps...>::value < TASK_COUNT, "Not a task of this system");
+        return SystemDetail::TaskIndex<Step, Steps...>::value;
+    }
+    
+    static EnableMask taskBit(uint8_t id) {
+        return EnableMask(1) << id;
+    }
+    
+    unsigned long _nextRelease[TASK_COUNT];
+    unsigned long _period[TASK_COUNT];
+    EnableMask _enabled;
+    OverrunCallback _overrunCallback;
+    unsigned long _lastLateness;
+};
+
+#endif // SYSTEM_H
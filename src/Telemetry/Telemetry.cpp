@@ -0,0 +1,240 @@
+/**
+ * @file Telemetry.cpp
+ * @brief Compact binary telemetry stream implementation
+ * @author catalina
+ */
+
+#include "Telemetry.h"
+
+namespace {
+    void put16(uint8_t* data, uint16_t value) {
+        data[0] = value & 0xFF;
+        data[1] = value >> 8;
+    }
+    
+    void put32(uint8_t* data, uint32_t value) {
+        put16(data, value & 0xFFFF);
+        put16(data + 2, value >> 16);
+    }
+    
+    uint16_t get16(const uint8_t* data) {
+        return data[0] | (static_cast<uint16_t>(data[1]) << 8);
+    }
+    
+    uint32_t get32(const uint8_t* data) {
+        return get16(data) | (static_cast<uint32_t>(get16(data + 2)) << 16);
+    }
+
+    // Index accesses ordered like SpscRing's: bytes before the index that publishes them
+#ifdef ARDUINO
+    uint8_t loadAcquire(const volatile uint8_t& index) {
+        uint8_t value = index;
+        asm volatile("" ::: "memory");
+        return value;
+    }
+    
+    void storeRelease(volatile uint8_t& index, uint8_t value) {
+        asm volatile("" ::: "memory");
+        index = value;
+    }
+#else
+    uint8_t loadAcquire(const std::atomic<uint8_t>& index) {
+        return index.load(std::memory_order_acquire);
+    }
+    
+    void storeRelease(std::atomic<uint8_t>& index, uint8_t value) {
+        index.store(value, std::memory_order_release);
+    }
+#endif
+    
+#if DISTANCE_DETECTOR_PROFILING
+    uint16_t saturate16(unsigned long value) {
+        return value > 0xFFFF ? 0xFFFF : value;
+    }
+#endif
+}
+
+Telemetry::Telemetry(Print& out)
+    : _out(out),
+      _head(0),
+      _tail(0),
+      _sequence(0),
+      _dropped(0) {
+}
+
+bool Telemetry::send(TelemetryRecord& record) {
+    record.sequence = _sequence++;
+    record.dropped = _dropped;
+    
+    uint8_t frame[FRAME_SIZE];
+    encode(record, frame);
+    return enqueue(frame, FRAME_SIZE);
+}
+
+bool Telemetry::sendSample(uint8_t channel, unsigned long timestamp, unsigned long value) {
+    TelemetrySample sample;
+    sample.sequence = _sequence++;
+    sample.timestamp = timestamp;
+    sample.channel = channel;
+    sample.value = value > 0xFFFF ? 0xFFFF : value;
+    
+    uint8_t frame[SAMPLE_FRAME_SIZE];
+    encodeSample(sample, frame);
+    return enqueue(frame, SAMPLE_FRAME_SIZE);
+}
+
+uint8_t Telemetry::pump() {
+    uint8_t moved = 0;
+    uint8_t tail = loadAcquire(_tail);
+    uint8_t head = loadAcquire(_head);
+    int room = _out.availableForWrite();
+    
+    while (tail != head && room > 0) {
+        _out.write(_buffer[tail]);
+        tail = (tail + 1) & (BUFFER_SIZE - 1);
+        room--;
+        moved++;
+    }
+    
+    // Free the bytes only after they are read
+    storeRelease(_tail, tail);
+    return moved;
+}
+
+uint16_t Telemetry::getDroppedCount() const {
+    return _dropped;
+}
+
+uint8_t Telemetry::getPendingBytes() const {
+    return (loadAcquire(_head) - loadAcquire(_tail)) & (BUFFER_SIZE - 1);
+}
+
+void Telemetry::captureStageTimings(TelemetryRecord& record) {
+#if DISTANCE_DETECTOR_PROFILING
+    record.distanceTime = saturate16(Profiler::getHistogram(ProfileStage::DISTANCE_ACQUIRE).getLast());
+    record.colorTime = saturate16(Profiler::getHistogram(ProfileStage::COLOR_ACQUIRE).getLast());
+    record.displayTime = saturate16(Profiler::getHistogram(ProfileStage::DISPLAY_RENDER).getLast());
+#else
+    record.distanceTime = 0;
+    record.colorTime = 0;
+    record.displayTime = 0;
+#endif
+}
+
+void Telemetry::encode(const TelemetryRecord& record, uint8_t* frame) {
+    frame[0] = SYNC_1;
+    frame[1] = SYNC_2;
+    frame[2] = TYPE_READING;
+    
+    uint8_t* payload = frame + 3;
+    payload[0] = record.sequence;
+    put32(payload + 1, record.timestamp);
+    put16(payload + 5, record.echoDuration);
+    put16(payload + 7, record.distance);
+    payload[9] = record.status;
+    payload[10] = record.red;
+    payload[11] = record.green;
+    payload[12] = record.blue;
+    payload[13] = record.colorId;
+    put16(payload + 14, record.distanceTime);
+    put16(payload + 16, record.colorTime);
+    put16(payload + 18, record.displayTime);
+    put16(payload + 20, record.dropped);
+    
+    put16(frame + 3 + PAYLOAD_SIZE, crc16(frame + 2, 1 + PAYLOAD_SIZE));
+}
+
+bool Telemetry::decode(const uint8_t* frame, TelemetryRecord& record) {
+    if (frame[0] != SYNC_1 || frame[1] != SYNC_2 || frame[2] != TYPE_READING) {
+        return false;
+    }
+    if (get16(frame + 3 + PAYLOAD_SIZE) != crc16(frame + 2, 1 + PAYLOAD_SIZE)) {
+        return false;
+    }
+    
+    const uint8_t* payload = frame + 3;
+    record.sequence = payload[0];
+    record.timestamp = get32(payload + 1);
+    record.echoDuration = get16(payload + 5);
+    record.distance = get16(payload + 7);
+    record.status = payload[9];
+    record.red = payload[10];
+    record.green = payload[11];
+    record.blue = payload[12];
+    record.colorId = payload[13];
+    record.distanceTime = get16(payload + 14);
+    record.colorTime = get16(payload + 16);
+    record.displayTime = get16(payload + 18);
+    record.dropped = get16(payload + 20);
+    return true;
+}
+
+void Telemetry::encodeSample(const TelemetrySample& sample, uint8_t* frame) {
+    frame[0] = SYNC_1;
+    frame[1] = SYNC_2;
+    frame[2] = TYPE_SAMPLE;
+    
+    uint8_t* payload = frame + 3;
+    payload[0] = sample.sequence;
+    put32(payload + 1, sample.timestamp);
+    payload[5] = sample.channel;
+    put16(payload + 6, sample.value);
+    
+    put16(frame + 3 + SAMPLE_PAYLOAD_SIZE, crc16(frame + 2, 1 + SAMPLE_PAYLOAD_SIZE));
+}
+
+bool Telemetry::decodeSample(const uint8_t* frame, TelemetrySample& sample) {
+    if (frame[0] != SYNC_1 || frame[1] != SYNC_2 || frame[2] != TYPE_SAMPLE) {
+        return false;
+    }
+    if (get16(frame + 3 + SAMPLE_PAYLOAD_SIZE) != crc16(frame + 2, 1 + SAMPLE_PAYLOAD_SIZE)) {
+        return false;
+    }
+    
+    const uint8_t* payload = frame + 3;
+    sample.sequence = payload[0];
+    sample.timestamp = get32(payload + 1);
+    sample.channel = payload[5];
+    sample.value = get16(payload + 6);
+    return true;
+}
+
+uint8_t Telemetry::getFrameSize(uint8_t type) {
+    switch (type) {
+        case TYPE_READING:
+            return FRAME_SIZE;
+        case TYPE_SAMPLE:
+            return SAMPLE_FRAME_SIZE;
+        default:
+            return 0;
+    }
+}
+
+uint16_t Telemetry::crc16(const uint8_t* data, uint8_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < length; i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+bool Telemetry::enqueue(const uint8_t* frame, uint8_t size) {
+    // One slot stays empty to tell a full buffer from an empty one
+    uint8_t head = loadAcquire(_head);
+    uint8_t used = (head - loadAcquire(_tail)) & (BUFFER_SIZE - 1);
+    if (BUFFER_SIZE - 1 - used < size) {
+        _dropped++;
+        return false;
+    }
+    
+    // Publish the frame only after all of it is in the buffer
+    for (uint8_t i = 0; i < size; i++) {
+        _buffer[head] = frame[i];
+        head = (head + 1) & (BUFFER_SIZE - 1);
+    }
+    storeRelease(_head, head);
+    return true;
+}
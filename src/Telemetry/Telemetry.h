@@ -0,0 +1,216 @@
+/**
+ * @file Telemetry.h
+ * @brief Compact binary telemetry stream over a serial port
+ * @author catalina
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "../Configuration/SensorConfig.h"
+#include "../Profiler/Profiler.h"
+#include "../SensorTrace/SensorTrace.h"
+
+#ifndef ARDUINO
+#include <atomic>
+#endif
+
+/**
+ * @brief One reading of the system
+ * 
+ * Fields that do not apply to a reading (e.g. the color while nothing is
+ * in range) are left at zero and flagged in the status byte.
+ */
+struct TelemetryRecord {
+    uint8_t sequence;           // Set by Telemetry::send()
+    uint32_t timestamp;         // ms since start
+    uint16_t echoDuration;      // Raw echo pulse width in µs (saturated)
+    uint16_t distance;          // Filtered distance in mm (saturated)
+    uint8_t status;             // STATUS_* flags
+    uint8_t red;                // Calibrated RGB (0-255)
+    uint8_t green;
+    uint8_t blue;
+    uint8_t colorId;            // ColorIdentifier
+    uint16_t distanceTime;      // Last stage timings in µs (0 without profiling)
+    uint16_t colorTime;
+    uint16_t displayTime;
+    uint16_t dropped;           // Records dropped before this one (set by send())
+};
+
+/**
+ * @brief One raw driver input (see SensorTrace)
+ */
+struct TelemetrySample {
+    uint8_t sequence;           // Set by Telemetry::sendSample()
+    uint32_t timestamp;         // µs since start
+    uint8_t channel;            // TraceChannel
+    uint16_t value;             // Pulse width in µs (saturated)
+};
+
+/**
+ * @class Telemetry
+ * @brief Sends readings as fixed-size, CRC-checked binary frames
+ * 
+ * Frame layout (little-endian):
+ *   0xA5 0x5A | type | payload | CRC-16/CCITT over type+payload
+ * Readings have a 22-byte payload (27-byte frame), raw samples an 8-byte
+ * payload (13-byte frame). Both share one sequence counter, so a receiver
+ * can tell lost frames of either type.
+ * 
+ * send() never blocks: a frame is copied into a ring buffer in one piece,
+ * or dropped and counted when the buffer is full. pump() moves bytes from
+ * the ring into the serial port only as far as the port's own transmit
+ * buffer has room, so it never blocks either. pump() may be called from
+ * loop() or from a timer interrupt; send() and pump() form a single
+ * producer / single consumer pair and need no locking. As in SpscRing, a
+ * frame is written before the head index that publishes it, behind a
+ * compiler barrier on the AVR and release/acquire ordering on the host.
+ * 
+ * A receiver resynchronises on the sync bytes and rejects any frame with
+ * a bad CRC, so text printed to the same port (banners, profiler dumps)
+ * only costs the frames it overlaps.
+ */
+class Telemetry {
+public:
+    /**
+     * @brief Constructor
+     * @param out Port the frames are written to (typically Serial)
+     */
+    explicit Telemetry(Print& out);
+    
+    /**
+     * @brief Queue a record for transmission
+     * 
+     * The sequence number and drop count of the record are filled in.
+     * 
+     * @param record Reading to send
+     * @return true if the record was queued, false if it was dropped
+     */
+    bool send(TelemetryRecord& record);
+    
+    /**
+     * @brief Queue a raw driver input for transmission
+     * 
+     * Matches SensorTrace::Sink apart from the types, so a sketch can
+     * forward trace samples with a one-line sink.
+     * 
+     * @param channel TraceChannel of the input
+     * @param timestamp Time of the reading in µs
+     * @param value Raw value (saturated to 16 bits)
+     * @return true if the sample was queued, false if it was dropped
+     */
+    bool sendSample(uint8_t channel, unsigned long timestamp, unsigned long value);
+    
+    /**
+     * @brief Move queued bytes into the serial port without blocking
+     * @return Number of bytes moved
+     */
+    uint8_t pump();
+    
+    /**
+     * @brief Get the number of records dropped because the buffer was full
+     * @return Drop count since start
+     */
+    uint16_t getDroppedCount() const;
+    
+    /**
+     * @brief Get the number of bytes waiting in the ring buffer
+     */
+    uint8_t getPendingBytes() const;
+    
+    /**
+     * @brief Copy the latest stage timings from the profiler into a record
+     * 
+     * Leaves the timings at zero when profiling is compiled out.
+     * 
+     * @param record Record to fill
+     */
+    static void captureStageTimings(TelemetryRecord& record);
+    
+    /**
+     * @brief Encode a record into a complete frame
+     * 
+     * @param record Record to encode
+     * @param frame Output buffer of FRAME_SIZE bytes
+     */
+    static void encode(const TelemetryRecord& record, uint8_t* frame);
+    
+    /**
+     * @brief Decode and verify a complete frame
+     * 
+     * @param frame Buffer of FRAME_SIZE bytes starting at the sync bytes
+     * @param record Decoded record
+     * @return true if sync, type and CRC are valid
+     */
+    static bool decode(const uint8_t* frame, TelemetryRecord& record);
+    
+    /**
+     * @brief Encode a raw sample into a complete frame
+     * 
+     * @param sample Sample to encode
+     * @param frame Output buffer of SAMPLE_FRAME_SIZE bytes
+     */
+    static void encodeSample(const TelemetrySample& sample, uint8_t* frame);
+    
+    /**
+     * @brief Decode and verify a complete raw sample frame
+     * 
+     * @param frame Buffer of SAMPLE_FRAME_SIZE bytes starting at the sync bytes
+     * @param sample Decoded sample
+     * @return true if sync, type and CRC are valid
+     */
+    static bool decodeSample(const uint8_t* frame, TelemetrySample& sample);
+    
+    /**
+     * @brief Get the frame size of a frame type
+     * @param type Frame type
+     * @return Size in bytes, or 0 for an unknown type
+     */
+    static uint8_t getFrameSize(uint8_t type);
+    
+    /**
+     * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+     */
+    static uint16_t crc16(const uint8_t* data, uint8_t length);
+    
+    // Frame format
+    static const uint8_t SYNC_1 = 0xA5;
+    static const uint8_t SYNC_2 = 0x5A;
+    static const uint8_t TYPE_READING = 0x01;
+    static const uint8_t TYPE_SAMPLE = 0x02;
+    static const uint8_t PAYLOAD_SIZE = 22;
+    static const uint8_t FRAME_SIZE = 2 + 1 + PAYLOAD_SIZE + 2;
+    static const uint8_t SAMPLE_PAYLOAD_SIZE = 8;
+    static const uint8_t SAMPLE_FRAME_SIZE = 2 + 1 + SAMPLE_PAYLOAD_SIZE + 2;
+    
+    // Status flags
+    static const uint8_t STATUS_OBJECT_IN_RANGE = 0x01;
+    static const uint8_t STATUS_NO_ECHO = 0x02;
+    static const uint8_t STATUS_COLOR_VALID = 0x04;
+    static const uint8_t STATUS_COLOR_MODE = 0x08;
+    static const uint8_t STATUS_LOAD_SHED = 0x10;
+    static const uint8_t STATUS_OVERRUN = 0x20;     // A task overran since the previous record
+    
+    // Ring buffer size (power of two, holds several frames)
+    static const uint8_t BUFFER_SIZE = 128;
+    
+private:
+#ifdef ARDUINO
+    typedef volatile uint8_t Index;
+#else
+    typedef std::atomic<uint8_t> Index;
+#endif
+    
+    Print& _out;
+    uint8_t _buffer[BUFFER_SIZE];
+    Index _head;  // Written by send()
+    Index _tail;  // Written by pump()
+    uint8_t _sequence;
+    uint16_t _dropped;
+    
+    // Helper methods
+    bool enqueue(const uint8_t* frame, uint8_t size);
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,68 @@
+/**
+ * @file TextTable.cpp
+ * @brief Flash-resident text table implementation
+ * @author catalina
+ */
+
+#include "TextTable.h"
+
+namespace {
+    const char DISTANCE_LABEL[] PROGMEM = "Distance:";
+    const char COLOR_DETECTED[] PROGMEM = "Color detected:";
+    const char COLOR_NONE[] PROGMEM = "No color";
+    const char COLOR_RED[] PROGMEM = "Red";
+    const char COLOR_GREEN[] PROGMEM = "Green";
+    const char COLOR_BLUE[] PROGMEM = "Blue";
+    const char COLOR_UNKNOWN[] PROGMEM = "Unknown";
+    const char SYSTEM_STARTING[] PROGMEM = "System Starting";
+    const char PLEASE_WAIT[] PROGMEM = "Please Wait...";
+    const char READY[] PROGMEM = "Ready!";
+    const char OBJECT_DETECTED[] PROGMEM = "Object Detected!";
+    const char CHECKING_COLOR[] PROGMEM = "Checking Color...";
+    const char OBJECT_LEFT[] PROGMEM = "Object Left";
+    const char DISTANCE_MODE[] PROGMEM = "Distance Mode";
+    const char NO_OBJECT[] PROGMEM = "No object";
+    const char COLOR_MODE[] PROGMEM = "Color Mode";
+    const char READING[] PROGMEM = "Reading...";
+    const char EMPTY[] PROGMEM = "";
+    
+    const uint8_t TEXT_COUNT = static_cast<uint8_t>(TextId::TEXT_COUNT);
+    
+    // Indexed by TextId
+    const char* const TEXTS[] PROGMEM = {
+        DISTANCE_LABEL,
+        COLOR_DETECTED,
+        COLOR_NONE,
+        COLOR_RED,
+        COLOR_GREEN,
+        COLOR_BLUE,
+        COLOR_UNKNOWN,
+        SYSTEM_STARTING,
+        PLEASE_WAIT,
+        READY,
+        OBJECT_DETECTED,
+        CHECKING_COLOR,
+        OBJECT_LEFT,
+        DISTANCE_MODE,
+        NO_OBJECT,
+        COLOR_MODE,
+        READING
+    };
+    static_assert(sizeof(TEXTS) / sizeof(TEXTS[0]) == TEXT_COUNT, "TEXTS must list every TextId");
+    
+    PGM_P lookup(TextId id) {
+        uint8_t index = static_cast<uint8_t>(id);
+        if (index >= TEXT_COUNT) {
+            return EMPTY;
+        }
+        return static_cast<PGM_P>(pgm_read_ptr(&TEXTS[index]));
+    }
+}
+
+const __FlashStringHelper* TextTable::get(TextId id) {
+    return reinterpret_cast<const __FlashStringHelper*>(lookup(id));
+}
+
+uint8_t TextTable::length(TextId id) {
+    return strlen_P(lookup(id));
+}
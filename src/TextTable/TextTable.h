@@ -0,0 +1,67 @@
+/**
+ * @file TextTable.h
+ * @brief Flash-resident table of the user-facing texts
+ * @author catalina
+ */
+
+#ifndef TEXT_TABLE_H
+#define TEXT_TABLE_H
+
+#include <Arduino.h>
+
+// User-facing texts
+enum class TextId : uint8_t {
+    // Display labels
+    DISTANCE_LABEL = 0,     // "Distance:"
+    COLOR_DETECTED,         // "Color detected:"
+    
+    // Color names, in ColorIdentifier order
+    COLOR_NONE,             // "No color"
+    COLOR_RED,
+    COLOR_GREEN,
+    COLOR_BLUE,
+    COLOR_UNKNOWN,
+    
+    // Status messages
+    SYSTEM_STARTING,
+    PLEASE_WAIT,
+    READY,
+    OBJECT_DETECTED,
+    CHECKING_COLOR,
+    OBJECT_LEFT,
+    DISTANCE_MODE,
+    NO_OBJECT,
+    COLOR_MODE,
+    READING,
+    
+    TEXT_COUNT
+};
+
+/**
+ * @class TextTable
+ * @brief Looks up texts kept in flash by id
+ * 
+ * The texts and the table of pointers to them live in PROGMEM, so they
+ * take no SRAM: a plain string literal is copied into SRAM at startup on
+ * an AVR, and a String built from it also takes heap. get() returns a
+ * flash pointer that Print (Serial, the LCD) and DisplayManager stream
+ * straight from flash.
+ */
+class TextTable {
+public:
+    /**
+     * @brief Get a text
+     * @param id Text id
+     * @return Flash pointer to the text (an empty text for an unknown id)
+     */
+    static const __FlashStringHelper* get(TextId id);
+    
+    /**
+     * @brief Get the length of a text
+     * @param id Text id
+     * @return Number of characters
+     */
+    static uint8_t length(TextId id);
+};
+
+#endif // TEXT_TABLE_H